@@ -0,0 +1,94 @@
+/**
+
+    @file      emu_address_bitmap.h
+    @brief     a set of addresses in the 64K as one bitmap per page
+    @details   for breakpoints and watchpoints, which the machine flags per page so that only an access to a flagged
+               page ever tests a bit:
+               + set() and reset() report when a page gains its first address or loses its last, the moment to
+                 set or clear the page's flag
+               + the bitmaps are allocated with the first address, an empty set costs a vector and a copy of one
+                 costs nothing
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "emu_memory_types.h"
+
+namespace emu {
+
+    class address_bitmap {
+
+        struct page_t {
+            std::array<uint64_t, PAGE_SIZE / 64> bits{};
+            uint16_t count{ 0 };
+        };
+
+    public:
+
+        // returns true if the page now holds its first address
+        bool set(address_t addr) {
+            if (pages.empty()) {
+                pages.resize(PAGE_COUNT);
+            }
+            auto& page = pages[page_of(addr)];
+            auto& word = page.bits[(addr % PAGE_SIZE) >> 6];
+            auto bit = 1ull << (addr & 63);
+            if (word & bit) {
+                return false;
+            }
+            word |= bit;
+            ++count_;
+            return ++page.count == 1;
+        }
+
+        // returns true if the page no longer holds any address
+        bool reset(address_t addr) {
+            if (!test(addr)) {
+                return false;
+            }
+            auto& page = pages[page_of(addr)];
+            page.bits[(addr % PAGE_SIZE) >> 6] &= ~(1ull << (addr & 63));
+            --count_;
+            return --page.count == 0;
+        }
+
+        inline bool test(address_t addr) const {
+            return !pages.empty() && (pages[page_of(addr)].bits[(addr % PAGE_SIZE) >> 6] >> (addr & 63)) & 1;
+        }
+
+        inline bool empty() const {
+            return count_ == 0;
+        }
+
+        inline size_t size() const {
+            return count_;
+        }
+
+        std::vector<address_t> addresses() const {
+            std::vector<address_t> list;
+            for (uint32_t addr{ 0 }; addr < 0x10000 && list.size() < count_; ++addr) {
+                if (test((address_t)addr)) list.push_back((address_t)addr);
+            }
+            return list;
+        }
+
+        void clear() {
+            pages.clear();
+            count_ = 0;
+        }
+
+    private:
+
+        std::vector<page_t> pages;
+        size_t count_{ 0 };
+
+    };
+
+}
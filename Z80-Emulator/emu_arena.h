@@ -0,0 +1,99 @@
+/**
+
+    @file      emu_arena.h
+    @brief     per machine small block arena
+    @details   recycles fixed size classes of memory from large chunks so that short lived objects, such as device
+               coroutine frames, never go back to the heap:
+               + blocks are rounded up to a multiple of GRAIN and kept on one free list per size class
+               + blocks larger than MAX_BLOCK fall back to operator new
+               + memory is returned to the system only when the arena is destroyed
+               + not thread safe, an arena belongs to the thread emulating its machine
+               copying an arena gives an empty arena, blocks are never shared between machines
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace emu {
+
+    class arena {
+
+        static constexpr size_t GRAIN = 64;
+        static constexpr size_t MAX_BLOCK = 4096;
+        static constexpr size_t CHUNK = 64 * 1024;
+        static constexpr size_t CLASSES = MAX_BLOCK / GRAIN;
+
+        struct free_block {
+            free_block* next;
+        };
+
+    public:
+
+        arena() = default;
+
+        arena(const arena&) : arena() {}
+
+        arena& operator=(const arena&) {
+            return *this;
+        }
+
+        void* allocate(size_t size) {
+            if (size > MAX_BLOCK) {
+                return ::operator new(size);
+            }
+            auto c = size_class(size);
+            if (auto b = free_lists[c]) {
+                free_lists[c] = b->next;
+                return b;
+            }
+            auto block_size = (c + 1) * GRAIN;
+            if (chunk_used + block_size > CHUNK || chunks.empty()) {
+                chunks.emplace_back(new (std::align_val_t{ GRAIN }) std::byte[CHUNK]);
+                chunk_used = 0;
+            }
+            auto p = chunks.back().get() + chunk_used;
+            chunk_used += block_size;
+            return p;
+        }
+
+        void deallocate(void* p, size_t size) {
+            if (size > MAX_BLOCK) {
+                ::operator delete(p);
+                return;
+            }
+            auto c = size_class(size);
+            free_lists[c] = new (p) free_block{ free_lists[c] };
+        }
+
+        // bytes reserved from the system
+        inline size_t reserved() const {
+            return chunks.size() * CHUNK;
+        }
+
+    private:
+
+        static inline size_t size_class(size_t size) {
+            return (size == 0) ? 0 : (size - 1) / GRAIN;
+        }
+
+        struct chunk_delete {
+            void operator()(std::byte* p) const {
+                ::operator delete[](p, std::align_val_t{ GRAIN });
+            }
+        };
+
+        std::vector<std::unique_ptr<std::byte[], chunk_delete>> chunks;
+        std::array<free_block*, CLASSES> free_lists{};
+        size_t chunk_used{ 0 };
+
+    };
+
+}
@@ -0,0 +1,190 @@
+/**
+
+    @file      emu_async_disk.h
+    @brief     asynchronous disk image I/O for emulated disk controllers
+    @details   a controller submits a sector read or write together with the emulated cycle at which the operation
+               should complete, carries on emulating, and gets its completion as a scheduler event:
+               + host I/O runs on a small pool of worker threads, each with its own stream on the image
+               + poll() on the CPU thread turns finished requests into events at max(due, now), so while the host
+                 keeps up the emulated timing is deterministic
+               + complete() waits for the host instead, for when the emulated program is only polling the
+                 controller and there is nothing to overlap - the CPU loop then skips straight to the event
+               + buffers belong to the caller and must stay valid until the completion handler has run
+               + with the default single worker requests are performed in submission order
+               an io_uring backend would replace the workers behind the same interface, it needs liburing which
+               is not available to this project
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "emu_scheduler.h"
+
+namespace emu {
+
+    class async_disk {
+
+    public:
+
+        using request_id_t = uint64_t;
+        using completion_t = std::function<void(cycle_t when, size_t transferred)>;   // transferred < size is an I/O error
+
+        async_disk(const std::string& filename, size_t worker_count = 1) :
+            fpath(filename)
+        {
+            if (!std::filesystem::exists(fpath)) {
+                throw std::runtime_error("file load error: \"" + fpath.string() + "\" file not found");
+            }
+            for (size_t i{ 0 }; i < std::max<size_t>(worker_count, 1); ++i) {
+                workers.emplace_back([this] { work(); });
+            }
+        }
+
+        async_disk(const async_disk&) = delete;
+        async_disk& operator=(const async_disk&) = delete;
+
+        ~async_disk() {
+            {
+                std::lock_guard<std::mutex> lock(guard);
+                stopping = true;
+            }
+            submitted.notify_all();
+            for (auto& w : workers) {
+                w.join();
+            }
+        }
+
+        inline request_id_t read(uint64_t offset, byte_t* dst, size_t size, cycle_t due, completion_t done) {
+            return submit({ 0, false, offset, dst, size, due, std::move(done), 0 });
+        }
+
+        inline request_id_t write(uint64_t offset, const byte_t* src, size_t size, cycle_t due, completion_t done) {
+            return submit({ 0, true, offset, const_cast<byte_t*>(src), size, due, std::move(done), 0 });
+        }
+
+        // CPU thread: schedule the completion of every finished request, returns how many
+        size_t poll(scheduler& events) {
+            std::vector<request> ready;
+            {
+                std::lock_guard<std::mutex> lock(guard);
+                if (finished.empty()) {
+                    return 0;
+                }
+                ready.swap(finished);
+            }
+            for (auto& r : ready) {
+                auto when = std::max(r.due, events.now());
+                events.schedule(when, [done = std::move(r.done), transferred = r.transferred](cycle_t t) {
+                    done(t, transferred);
+                });
+            }
+            return ready.size();
+        }
+
+        // CPU thread: block until the host has finished everything submitted, then poll
+        size_t complete(scheduler& events) {
+            {
+                std::unique_lock<std::mutex> lock(guard);
+                idle.wait(lock, [this] { return pending.empty() && busy == 0; });
+            }
+            return poll(events);
+        }
+
+        inline size_t outstanding() const {
+            std::lock_guard<std::mutex> lock(guard);
+            return pending.size() + busy + finished.size();
+        }
+
+    private:
+
+        struct request {
+            request_id_t id;
+            bool is_write;
+            uint64_t offset;
+            byte_t* buffer;
+            size_t size;
+            cycle_t due;
+            completion_t done;
+            size_t transferred;
+        };
+
+        request_id_t submit(request r) {
+            request_id_t id;
+            {
+                std::lock_guard<std::mutex> lock(guard);
+                id = r.id = ++last_id;
+                pending.push_back(std::move(r));
+            }
+            submitted.notify_one();
+            return id;
+        }
+
+        void work() {
+            std::fstream f(fpath, std::ios::in | std::ios::out | std::ios::binary);
+            if (!f.is_open()) {
+                f.open(fpath, std::ios::in | std::ios::binary);    // read only image, writes report 0 transferred
+            }
+            std::unique_lock<std::mutex> lock(guard);
+            while (true) {
+                submitted.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+                auto r = std::move(pending.front());
+                pending.pop_front();
+                ++busy;
+                lock.unlock();
+                r.transferred = transfer(f, r);
+                lock.lock();
+                --busy;
+                finished.push_back(std::move(r));
+                if (pending.empty() && busy == 0) {
+                    idle.notify_all();
+                }
+            }
+        }
+
+        static size_t transfer(std::fstream& f, const request& r) {
+            f.clear();
+            if (r.is_write) {
+                f.seekp((std::streamoff)r.offset);
+                f.write((const char*)r.buffer, (std::streamsize)r.size);
+                f.flush();  // other workers have their own streams
+                return f ? r.size : 0;
+            }
+            f.seekg((std::streamoff)r.offset);
+            f.read((char*)r.buffer, (std::streamsize)r.size);
+            return (size_t)f.gcount();
+        }
+
+        const std::filesystem::path fpath;
+
+        mutable std::mutex guard;
+        std::condition_variable submitted;
+        std::condition_variable idle;
+        std::deque<request> pending;
+        std::vector<request> finished;
+        size_t busy{ 0 };
+        bool stopping{ false };
+        request_id_t last_id{ 0 };
+
+        std::vector<std::thread> workers;
+
+    };
+
+}
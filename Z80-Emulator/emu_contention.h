@@ -0,0 +1,90 @@
+/**
+
+    @file      emu_contention.h
+    @brief     table driven memory contention and wait-state model
+    @details   a machine describes which pages insert wait states and how many, as a function of the T-state phase
+               within a repeating period (e.g. a display line), once at construction:
+               + every page maps to a pattern class, class 0 is uncontended
+               + a contended access costs pattern[t % period] extra T-states
+               + an uncontended access is one byte load and a predictable branch, so the accurate and the fast
+                 machine are the same machine
+               e.g. RAM that is locked out for the first 128 T-states of each 207 T-state line
+                    contention_table{}.contend(0x4000, 0x7FFF, contention_table::window(207, 0, 128, { 4 }))
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "emu_scheduler.h"
+
+namespace emu {
+
+    class contention_table {
+
+    public:
+
+        using pattern_t = std::vector<uint8_t>;
+
+        static constexpr uint8_t UNCONTENDED = 0;
+
+        // pages begin..end (inclusive addresses) wait pattern[t % pattern.size()] T-states per access
+        contention_table& contend(address_t begin, address_t end, pattern_t pattern) {
+            if (pattern.empty()) {
+                throw std::runtime_error("contention error: empty wait-state pattern");
+            }
+            if (patterns.size() == UINT8_MAX) {
+                throw std::runtime_error(std::format("contention error: more than {} wait-state patterns", UINT8_MAX));
+            }
+            patterns.push_back(std::move(pattern));
+            for (auto page{ page_of(begin) }; page <= page_of(end); ++page) {
+                page_class[page] = (uint8_t)patterns.size();
+            }
+            return *this;
+        }
+
+        // a period with the repeated wait states inside [first, last) and none outside
+        static pattern_t window(size_t period, size_t first, size_t last, const pattern_t& waits) {
+            if (first > last || last > period || waits.empty()) {
+                throw std::runtime_error(std::format("contention error: window [{}, {}) outside period {}", first, last, period));
+            }
+            pattern_t pattern(period, 0);
+            for (auto t{ first }; t < last; ++t) {
+                pattern[t] = waits[(t - first) % waits.size()];
+            }
+            return pattern;
+        }
+
+        inline unsigned wait_states(address_t addr, cycle_t t) const {
+            auto c = page_class[page_of(addr)];
+            if (c == UNCONTENDED) {
+                return 0;
+            }
+            const auto& pattern = patterns[c - 1];
+            return pattern[t % pattern.size()];
+        }
+
+        inline bool contended(address_t addr) const {
+            return page_class[page_of(addr)] != UNCONTENDED;
+        }
+
+        inline bool empty() const {
+            return patterns.empty();
+        }
+
+    private:
+
+        std::array<uint8_t, PAGE_COUNT> page_class{};
+        std::vector<pattern_t> patterns;
+
+    };
+
+}
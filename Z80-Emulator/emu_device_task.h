@@ -0,0 +1,246 @@
+/**
+
+    @file      emu_device_task.h
+    @brief     C++20 coroutine device behaviours driven by the machine's event scheduler
+    @details   sequential peripheral logic is written as it is described in the data sheet, instead of as a hand
+               rolled state machine e.g.
+
+                   emu::device_task transmit(emu::device_context& ctx, uart& u) {
+                       while (true) {
+                           co_await u.data_written;            // CPU wrote the transmit register
+                           for (auto bit : u.frame()) {
+                               u.line = bit;
+                               co_await ctx.delay(u.bit_time);
+                           }
+                       }
+                   }
+
+               + a coroutine must take a device_context& parameter, its frame is allocated from that context's arena
+               + the task starts running immediately, up to its first co_await
+               + co_await ctx.delay(n) resumes n T-states after the scheduler's current cycle, co_await ctx.at(t) at
+                 cycle t, a resumed coroutine sees the scheduler's now() at exactly its due cycle
+               + co_await a device_signal resumes at the next scheduler service after raise() e.g. when a CPU port
+                 write hands the device some work
+               + destroying a device_task cancels whatever it is waiting on
+               + an exception escaping a device propagates out of scheduler::service()
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+#include "emu_arena.h"
+#include "emu_scheduler.h"
+
+namespace emu {
+
+    class device_signal;
+
+    struct device_context {
+
+        scheduler& events;
+        arena& frames;
+
+        struct cycle_awaiter;
+
+        inline cycle_awaiter at(cycle_t when);
+        inline cycle_awaiter delay(cycle_t tstates);
+
+    };
+
+    class device_task {
+
+        static constexpr size_t HEADER = 16;    // arena pointer, keeps the frame at the default new alignment
+
+    public:
+
+        struct promise_type {
+
+            template<typename... ARGS>
+            static void* operator new(size_t size, ARGS&... args) {
+                auto& frames = context_of(args...).frames;
+                auto p = static_cast<std::byte*>(frames.allocate(size + HEADER));
+                *reinterpret_cast<arena**>(p) = &frames;
+                return p + HEADER;
+            }
+
+            static void operator delete(void* frame, size_t size) {
+                auto p = static_cast<std::byte*>(frame) - HEADER;
+                (*reinterpret_cast<arena**>(p))->deallocate(p, size + HEADER);
+            }
+
+            template<typename... ARGS>
+            promise_type(ARGS&... args) :
+                ctx(&context_of(args...))
+            {}
+
+            device_task get_return_object() {
+                return device_task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_always final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() {}
+
+            void unhandled_exception() {
+                throw;
+            }
+
+            device_context* ctx;
+            scheduler::event_id_t pending{ 0 };     // scheduler event that will resume us
+            device_signal* waiting{ nullptr };      // or the signal we are waiting on
+
+        };
+
+        using handle_t = std::coroutine_handle<promise_type>;
+
+        device_task() = default;
+
+        device_task(device_task&& other) noexcept :
+            handle(std::exchange(other.handle, nullptr))
+        {}
+
+        device_task& operator=(device_task&& other) noexcept {
+            if (this != &other) {
+                destroy();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~device_task() {
+            destroy();
+        }
+
+        inline bool done() const {
+            return !handle || handle.done();
+        }
+
+    private:
+
+        explicit device_task(handle_t h) :
+            handle(h)
+        {}
+
+        template<typename FIRST, typename... REST>
+        static device_context& context_of(FIRST& first, REST&... rest) {
+            if constexpr (std::is_same_v<std::remove_cv_t<FIRST>, device_context>) {
+                return const_cast<device_context&>(first);
+            }
+            else {
+                static_assert(sizeof...(REST) != 0, "a device coroutine must take a device_context& parameter");
+                return context_of(rest...);
+            }
+        }
+
+        inline void destroy();
+
+        handle_t handle{ nullptr };
+
+    };
+
+    struct device_context::cycle_awaiter {
+
+        device_context& ctx;
+        cycle_t when;
+
+        // even a zero delay goes through the scheduler so that events on the same cycle keep their order
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(device_task::handle_t h) {
+            h.promise().pending = ctx.events.schedule(when, [h](cycle_t) {
+                h.promise().pending = 0;
+                h.resume();
+            });
+        }
+
+        void await_resume() const noexcept {}
+
+    };
+
+    inline device_context::cycle_awaiter device_context::at(cycle_t when) {
+        return { *this, when };
+    }
+
+    inline device_context::cycle_awaiter device_context::delay(cycle_t tstates) {
+        return { *this, events.now() + tstates };
+    }
+
+    class device_signal {
+
+        friend class device_task;
+
+    public:
+
+        explicit device_signal(scheduler& events) :
+            events(events)
+        {}
+
+        device_signal(const device_signal&) = delete;
+        device_signal& operator=(const device_signal&) = delete;
+
+        // wake the waiting device at the next scheduler service, or let its next wait fall straight through
+        void raise() {
+            if (waiter) {
+                auto h = std::exchange(waiter, nullptr);
+                h.promise().waiting = nullptr;
+                h.promise().pending = events.schedule(events.now(), [h](cycle_t) {
+                    h.promise().pending = 0;
+                    h.resume();
+                });
+            }
+            else {
+                raised = true;
+            }
+        }
+
+        inline bool await_ready() noexcept {
+            return std::exchange(raised, false);
+        }
+
+        void await_suspend(device_task::handle_t h) noexcept {
+            waiter = h;
+            h.promise().waiting = this;
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+
+        scheduler& events;
+        device_task::handle_t waiter{ nullptr };
+        bool raised{ false };
+
+    };
+
+    inline void device_task::destroy() {
+        if (!handle) {
+            return;
+        }
+        auto& p = handle.promise();
+        if (p.pending) {
+            p.ctx->events.cancel(p.pending);
+        }
+        if (p.waiting) {
+            p.waiting->waiter = nullptr;
+        }
+        handle.destroy();
+        handle = nullptr;
+    }
+
+}
@@ -0,0 +1,389 @@
+/**
+
+    @file      emu_host_bridge.h
+    @brief     non-blocking host endpoints (pty or Unix domain socket) for emulated serial and console channels
+    @details   every channel of every machine in the process is multiplexed on one epoll thread, the emulation
+               thread moves bytes through the rings and its only system call is the eventfd write that wakes the
+               bridge, at most one each time a tx ring goes from idle to busy or a stalled rx ring gets room:
+               + host -> emulator bytes are pushed by the bridge thread into the channel's rx ring
+               + emulator -> host bytes are pushed by the emulated device into the channel's tx ring and the
+                 bridge thread is woken through an eventfd only when it may have stopped draining that ring, the
+                 bridge flags the ring idle before its last empty check so a push that races it still wakes it
+               + when a rx ring is full the bridge stops reading that endpoint, the kernel buffer then applies
+                 back pressure to the host side instead of dropping bytes
+               Linux only (epoll, eventfd, ptys)
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "emu_spsc_ring.h"
+
+namespace emu {
+
+    class host_bridge;
+
+    class serial_channel {
+
+        friend class host_bridge;
+
+        static constexpr size_t RING_SIZE = 4096;
+
+        enum class kind_t { pty, socket_listener, socket_client };
+
+    public:
+
+        // emulated device side, called on the CPU thread
+
+        inline bool receive(byte_t& b) {
+            if (rx.pop(b)) {
+                if (rx_stalled.load(std::memory_order_relaxed) && rx_stalled.exchange(false)) {
+                    wake();     // once per stall, the bridge resumes reading the endpoint
+                }
+                return true;
+            }
+            return false;
+        }
+
+        inline bool transmit(byte_t b) {
+            if (!tx.push(b)) {
+                return false;   // host is not draining, the device sees a busy transmitter
+            }
+            // the push is seen by the bridge's empty check or the bridge's idle flag is seen here
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (tx_idle.load(std::memory_order_relaxed) && tx_idle.exchange(false)) {
+                wake();
+            }
+            return true;
+        }
+
+        inline bool rx_ready() const {
+            return !rx.empty();
+        }
+
+        inline bool tx_ready() const {
+            return tx.free_space() != 0;
+        }
+
+        // host side
+
+        inline const std::string& path() const {
+            return path_;
+        }
+
+    private:
+
+        serial_channel(host_bridge& bridge, kind_t kind, std::string path) :
+            bridge(bridge),
+            kind(kind),
+            path_(std::move(path))
+        {}
+
+        void wake();
+
+        host_bridge& bridge;
+        kind_t kind;
+        std::string path_;
+
+        size_t index{ 0 };      // position in the bridge's channel table
+        int fd{ -1 };           // pty master or connected client
+        int listen_fd{ -1 };    // Unix socket listener
+        int pty_slave{ -1 };    // held open so the master does not report EPOLLHUP while no host client is attached
+        bool want_out{ false };
+        bool rx_paused{ false };                // bridge thread only
+        std::atomic<bool> rx_stalled{ false };  // set by the bridge, cleared by the device when it makes room
+        std::atomic<bool> tx_idle{ true };      // set by the bridge when it stops draining, cleared by the device
+
+        spsc_ring<RING_SIZE> rx;
+        spsc_ring<RING_SIZE> tx;
+
+    };
+
+    class host_bridge {
+
+        static constexpr int MAX_EVENTS = 256;
+        static constexpr size_t IO_CHUNK = 4096;
+
+        // epoll_event.data.u64 tags: channel index << 1 | endpoint
+        static constexpr uint64_t WAKE_TAG = ~uint64_t{ 0 };
+        static constexpr uint64_t TAG_IO = 0;
+        static constexpr uint64_t TAG_LISTENER = 1;
+
+    public:
+
+        host_bridge() :
+            epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+            wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        {
+            if (epoll_fd < 0 || wake_fd < 0) {
+                throw std::runtime_error(std::format("host bridge error: {}", std::strerror(errno)));
+            }
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = WAKE_TAG;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+            worker = std::thread([this] { run(); });
+        }
+
+        host_bridge(const host_bridge&) = delete;
+        host_bridge& operator=(const host_bridge&) = delete;
+
+        ~host_bridge() {
+            running.store(false);
+            notify();
+            worker.join();
+            for (auto& c : channels) {
+                close_fd(c->fd);
+                close_fd(c->listen_fd);
+                close_fd(c->pty_slave);
+                if (c->kind != serial_channel::kind_t::pty) {
+                    unlink(c->path_.c_str());
+                }
+            }
+            close(wake_fd);
+            close(epoll_fd);
+        }
+
+        // the one bridge shared by all machines in the process
+        static host_bridge& shared() {
+            static host_bridge bridge;
+            return bridge;
+        }
+
+        // channel is a new pty, the host connects to channel.path() e.g. with screen or minicom
+        serial_channel& open_pty() {
+            auto master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+            if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+                close_fd(master);
+                throw std::runtime_error(std::format("pty open error: {}", std::strerror(errno)));
+            }
+            std::string name = ptsname(master);
+            auto slave = open(name.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+            termios tio{};
+            if (slave >= 0 && tcgetattr(slave, &tio) == 0) {
+                cfmakeraw(&tio);
+                tcsetattr(slave, TCSANOW, &tio);
+            }
+            std::lock_guard<std::mutex> lock(guard);
+            auto& c = add_channel(serial_channel::kind_t::pty, name);
+            c.fd = master;
+            c.pty_slave = slave;
+            watch(c.fd, EPOLLIN, tag(c, TAG_IO));
+            return c;
+        }
+
+        // channel is a listening Unix domain socket, one host client at a time
+        serial_channel& open_unix_socket(const std::string& path) {
+            sockaddr_un addr{};
+            if (path.size() >= sizeof(addr.sun_path)) {
+                throw std::runtime_error("socket open error: \"" + path + "\" path too long");
+            }
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            auto s = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            unlink(path.c_str());
+            if (s < 0 || bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 1) != 0) {
+                close_fd(s);
+                throw std::runtime_error("socket open error: \"" + path + "\" " + std::strerror(errno));
+            }
+            std::lock_guard<std::mutex> lock(guard);
+            auto& c = add_channel(serial_channel::kind_t::socket_listener, path);
+            c.listen_fd = s;
+            watch(c.listen_fd, EPOLLIN, tag(c, TAG_LISTENER));
+            return c;
+        }
+
+        inline size_t channel_count() const {
+            std::lock_guard<std::mutex> lock(guard);
+            return channels.size();
+        }
+
+        // called from the emulated side when a tx ring needs draining or a stalled rx ring has room
+        inline void notify() {
+            uint64_t one{ 1 };
+            [[maybe_unused]] auto n = write(wake_fd, &one, sizeof(one));
+        }
+
+    private:
+
+        serial_channel& add_channel(serial_channel::kind_t kind, const std::string& path) {
+            channels.emplace_back(new serial_channel(*this, kind, path));
+            auto& c = *channels.back();
+            c.index = channels.size() - 1;
+            return c;
+        }
+
+        static inline uint64_t tag(const serial_channel& c, uint64_t endpoint) {
+            return (uint64_t)c.index << 1 | endpoint;
+        }
+
+        inline void watch(int fd, uint32_t events, uint64_t data) {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = data;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+            }
+        }
+
+        inline void rewatch(serial_channel& c) {
+            if (c.fd < 0) return;
+            uint32_t events = c.rx_paused ? 0u : (uint32_t)EPOLLIN;
+            if (c.want_out) events |= EPOLLOUT;
+            epoll_event ev{};
+            ev.events = events | EPOLLRDHUP;
+            ev.data.u64 = tag(c, TAG_IO);
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+        }
+
+        static inline void close_fd(int& fd) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        void run() {
+            epoll_event events[MAX_EVENTS];
+            while (running.load()) {
+                auto n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+                std::lock_guard<std::mutex> lock(guard);
+                for (int i{ 0 }; i < n; ++i) {
+                    auto data = events[i].data.u64;
+                    if (data == WAKE_TAG) {
+                        uint64_t count;
+                        [[maybe_unused]] auto r = read(wake_fd, &count, sizeof(count));
+                        continue;
+                    }
+                    auto& c = *channels[data >> 1];
+                    if ((data & 1) == TAG_LISTENER) {
+                        accept_client(c);
+                    }
+                    else if (events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR) && c.kind != serial_channel::kind_t::pty) {
+                        // the client may have written just before closing, hand over what is left first
+                        if (!c.rx_paused) fill_rx(c);
+                        if (c.rx_paused) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, nullptr);    // read to EOF once the device makes room
+                        else if (c.fd >= 0) drop_client(c);
+                    }
+                    else {
+                        if (events[i].events & EPOLLOUT) c.want_out = false;
+                        if (events[i].events & EPOLLIN) fill_rx(c);
+                    }
+                }
+                // the wake event carries no channel, every channel is cheap to check
+                for (auto& c : channels) {
+                    if (c->rx_paused && !c->rx_stalled.load(std::memory_order_relaxed)) {
+                        c->rx_paused = false;
+                        rewatch(*c);
+                        fill_rx(*c);
+                    }
+                    drain_tx(*c);
+                }
+            }
+        }
+
+        void accept_client(serial_channel& c) {
+            auto client = accept4(c.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client < 0) return;
+            if (c.fd >= 0) {
+                close(client);  // one host client per channel
+                return;
+            }
+            c.fd = client;
+            c.kind = serial_channel::kind_t::socket_client;
+            watch(c.fd, EPOLLIN | EPOLLRDHUP, tag(c, TAG_IO));
+        }
+
+        void drop_client(serial_channel& c) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, nullptr);
+            close_fd(c.fd);
+            c.want_out = false;
+            c.rx_paused = false;
+            c.kind = serial_channel::kind_t::socket_listener;
+        }
+
+        void fill_rx(serial_channel& c) {
+            byte_t buffer[IO_CHUNK];
+            while (c.fd >= 0) {
+                auto room = std::min(c.rx.free_space(), IO_CHUNK);
+                if (room == 0) {
+                    c.rx_paused = true;
+                    c.rx_stalled.store(true);
+                    rewatch(c);
+                    return;
+                }
+                auto n = read(c.fd, buffer, room);
+                if (n <= 0) {
+                    if (n == 0 && c.kind != serial_channel::kind_t::pty) drop_client(c);
+                    return;
+                }
+                c.rx.push(buffer, (size_t)n);
+            }
+        }
+
+        void drain_tx(serial_channel& c) {
+            if (c.want_out) return;             // still waiting for EPOLLOUT
+            byte_t buffer[IO_CHUNK];
+            do {
+                c.tx_idle.store(false, std::memory_order_relaxed);
+                while (!c.tx.empty()) {
+                    if (c.fd < 0) {
+                        c.tx.skip(c.tx.available());    // no host attached, the line is open circuit
+                        continue;
+                    }
+                    auto n = c.tx.peek(buffer, IO_CHUNK);
+                    // a socket whose host has gone would raise SIGPIPE on write()
+                    auto written = (c.kind == serial_channel::kind_t::pty) ? write(c.fd, buffer, n) : send(c.fd, buffer, n, MSG_NOSIGNAL);
+                    if (written > 0) c.tx.skip((size_t)written);
+                    if (written < (ssize_t)n) {
+                        c.want_out = true;      // kernel buffer is full, resume when the host reads
+                        rewatch(c);
+                        return;
+                    }
+                }
+                // idle first, then the last look, pairs with the fence in transmit()
+                c.tx_idle.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            } while (!c.tx.empty());
+        }
+
+        mutable std::mutex guard;   // channel table, held by the bridge thread only while servicing events
+        std::vector<std::unique_ptr<serial_channel>> channels;
+
+        int epoll_fd;
+        int wake_fd;
+        std::atomic<bool> running{ true };
+        std::thread worker;
+
+    };
+
+    inline void serial_channel::wake() {
+        bridge.notify();
+    }
+
+}
+
+#endif
@@ -62,6 +62,29 @@ namespace emu {
             load(filename);
         }
 
+        memory(const memory& other) :
+            begin_(other.begin_),
+            end_(other.end_),
+            column_count(other.column_count),
+            bytes(other.bytes ? new byte_array_t(*other.bytes) : nullptr)
+        {}
+
+        // a moved from memory has no bytes, a copy of it has none either
+        memory& operator=(const memory& other) {
+            if (this != &other) {
+                begin_ = other.begin_;
+                end_ = other.end_;
+                column_count = other.column_count;
+                if (!other.bytes) bytes.reset();
+                else if (bytes) *bytes = *other.bytes;
+                else bytes.reset(new byte_array_t(*other.bytes));
+            }
+            return *this;
+        }
+
+        memory(memory&&) noexcept = default;
+        memory& operator=(memory&&) noexcept = default;
+
         inline byte_t operator[](address_t addr) const {
             return bytes->at((size_t)addr - address_begin());
         }
@@ -70,6 +93,15 @@ namespace emu {
             return bytes->at((size_t)addr - address_begin());
         }
 
+        // the bytes from address_begin() on, contiguous
+        inline byte_t* data() {
+            return bytes->data();
+        }
+
+        inline const byte_t* data() const {
+            return bytes->data();
+        }
+
         inline address_t address_begin() const {
             return begin_;
         }
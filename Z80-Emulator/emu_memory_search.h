@@ -0,0 +1,350 @@
+/**
+
+    @file      emu_memory_search.h
+    @brief     byte pattern search with wildcards and candidate narrowing over emulated memory
+    @details   the reverse engineering and cheat finding workflows, find every copy of a routine or a table and
+               follow a value from frame to frame until only the variable that holds it is left:
+               + a pattern is hex bytes with ?? for any byte e.g. "3E ?? CD ?? ?? C9", its first fixed byte is the
+                 anchor, 32 bytes a time are compared with it by AVX2, 16 by SSE2 and one by one elsewhere, and
+                 only the offsets the anchor matches are compared with the whole pattern masked 16 bytes a time
+               + find() searches any contiguous bytes, an emu::memory or the RAM of every machine of a farm, the
+                 offsets found are addresses from the memory's address_begin()
+               + memory_candidates is one bit per byte of the memory and the bytes seen last, narrow() keeps the
+                 bytes that equal, differ from, exceed or fall short of a value or their last value 64 at a time
+                 and skips the words with no candidate left, so each frame after the first few costs next to nothing
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <bit>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EMU_SEARCH_SSE2
+#endif
+
+#include "emu_memory.h"
+#include "emu_memory_types.h"
+
+namespace emu {
+
+    class memory_pattern {
+
+    public:
+
+        memory_pattern(const std::string& text) {
+            for (size_t i{ 0 }; i < text.size(); ) {
+                if (std::isspace((unsigned char)text[i])) {
+                    ++i;
+                    continue;
+                }
+                if (i + 1 >= text.size() || std::isspace((unsigned char)text[i + 1])) {
+                    throw std::runtime_error(std::format("memory pattern error: \"{}\" byte at {} is not two digits", text, i));
+                }
+                if (text[i] == '?' && text[i + 1] == '?') {
+                    bytes_.push_back(0);
+                    mask_.push_back(0);
+                }
+                else if (std::isxdigit((unsigned char)text[i]) && std::isxdigit((unsigned char)text[i + 1])) {
+                    bytes_.push_back((uint8_t)std::stoul(text.substr(i, 2), nullptr, 16));
+                    mask_.push_back(0xFF);
+                }
+                else {
+                    throw std::runtime_error(std::format("memory pattern error: \"{}\" byte at {} is neither hex nor ??", text, i));
+                }
+                i += 2;
+            }
+            anchor_of();
+        }
+
+        // a mask bit of 0 matches either value of the byte's bit
+        memory_pattern(const std::vector<uint8_t>& bytes, const std::vector<uint8_t>& mask) :
+            bytes_(bytes),
+            mask_(mask)
+        {
+            if (bytes_.size() != mask_.size()) {
+                throw std::runtime_error(std::format("memory pattern error: {} bytes and {} mask bytes", bytes_.size(), mask_.size()));
+            }
+            for (size_t i{ 0 }; i < bytes_.size(); ++i) bytes_[i] &= mask_[i];
+            anchor_of();
+        }
+
+        inline size_t size() const {
+            return bytes_.size();
+        }
+
+        inline const std::vector<uint8_t>& bytes() const {
+            return bytes_;
+        }
+
+        inline const std::vector<uint8_t>& mask() const {
+            return mask_;
+        }
+
+        // the offset of the first byte with every bit fixed, size() if there is none
+        inline size_t anchor() const {
+            return anchor_;
+        }
+
+        // does the pattern match the bytes at p, the bytes are size() rounded up to 16 readable
+        inline bool matches_padded(const uint8_t* p) const {
+#if defined(__AVX2__) || defined(EMU_SEARCH_SSE2)
+            for (size_t i{ 0 }; i < bytes_.size(); i += 16) {
+                auto data = _mm_and_si128(_mm_loadu_si128((const __m128i*)(p + i)), _mm_loadu_si128((const __m128i*)(padded_mask.data() + i)));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(data, _mm_loadu_si128((const __m128i*)(padded_bytes.data() + i)))) != 0xFFFF) return false;
+            }
+            return true;
+#else
+            return matches(p);
+#endif
+        }
+
+        inline bool matches(const uint8_t* p) const {
+            for (size_t i{ 0 }; i < bytes_.size(); ++i) {
+                if ((p[i] & mask_[i]) != bytes_[i]) return false;
+            }
+            return true;
+        }
+
+        // the length the masked compare reads
+        inline size_t padded_size() const {
+            return padded_bytes.size();
+        }
+
+    private:
+
+        void anchor_of() {
+            if (bytes_.empty()) {
+                throw std::runtime_error("memory pattern error: empty pattern");
+            }
+            anchor_ = 0;
+            while (anchor_ < mask_.size() && mask_[anchor_] != 0xFF) ++anchor_;
+            auto padded = (bytes_.size() + 15) & ~size_t{ 15 };
+            padded_bytes = bytes_;
+            padded_bytes.resize(padded, 0);
+            padded_mask = mask_;
+            padded_mask.resize(padded, 0);
+        }
+
+        std::vector<uint8_t> bytes_;
+        std::vector<uint8_t> mask_;
+        std::vector<uint8_t> padded_bytes;
+        std::vector<uint8_t> padded_mask;
+        size_t anchor_{ 0 };
+
+    };
+
+    class memory_search {
+
+    public:
+
+        // every offset of size bytes at which the pattern starts, in order
+        static std::vector<uint32_t> find(const byte_t* data, size_t size, const memory_pattern& pattern) {
+            std::vector<uint32_t> found;
+            auto bytes = (const uint8_t*)data;
+            if (pattern.size() > size) {
+                return found;
+            }
+            auto last = size - pattern.size();                          // the last offset a match can start at
+            auto anchor = pattern.anchor();
+            auto check = [&](size_t offset) {
+                if (offset + pattern.padded_size() <= size ? pattern.matches_padded(bytes + offset) : pattern.matches(bytes + offset)) {
+                    found.push_back((uint32_t)offset);
+                }
+            };
+            if (anchor == pattern.size()) {                             // no fixed byte to filter on
+                for (size_t offset{ 0 }; offset <= last; ++offset) check(offset);
+                return found;
+            }
+            auto first = pattern.bytes()[anchor];
+            size_t offset{ 0 };
+#if defined(__AVX2__)
+            auto key = _mm256_set1_epi8((char)first);
+            for (; offset + 32 <= last + 1; offset += 32) {
+                auto hits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(bytes + anchor + offset)), key));
+                for (; hits; hits &= hits - 1) check(offset + std::countr_zero(hits));
+            }
+#elif defined(EMU_SEARCH_SSE2)
+            auto key = _mm_set1_epi8((char)first);
+            for (; offset + 16 <= last + 1; offset += 16) {
+                auto hits = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(bytes + anchor + offset)), key));
+                for (; hits; hits &= hits - 1) check(offset + std::countr_zero(hits));
+            }
+#endif
+            for (; offset <= last; ++offset) {
+                if (bytes[anchor + offset] == first) check(offset);
+            }
+            return found;
+        }
+
+        template<size_t SIZE>
+        static std::vector<address_t> find(const memory<SIZE>& mem, const memory_pattern& pattern) {
+            std::vector<address_t> found;
+            for (auto offset : find(mem.data(), SIZE, pattern)) {
+                found.push_back((address_t)(mem.address_begin() + offset));
+            }
+            return found;
+        }
+
+        // the addresses found in each machine's RAM, a farm of any range of machines
+        template<typename MACHINES>
+        static std::vector<std::vector<address_t>> find_each(const MACHINES& machines, const memory_pattern& pattern) {
+            std::vector<std::vector<address_t>> found;
+            for (const auto& machine : machines) {
+                found.push_back(find(machine.ram(), pattern));
+            }
+            return found;
+        }
+
+    };
+
+    class memory_candidates {
+
+    public:
+
+        enum class relation_t { equal, not_equal, greater, less, changed, unchanged, increased, decreased };
+
+        // every byte a candidate, the bytes as they are now the last seen
+        memory_candidates(const byte_t* data, size_t size) :
+            begin_(0),
+            bits((size + 63) / 64, ~0ull),
+            previous((const uint8_t*)data, (const uint8_t*)data + size)
+        {
+            if (size % 64) {
+                bits.back() = (1ull << (size % 64)) - 1;
+            }
+            count_ = size;
+        }
+
+        template<size_t SIZE>
+        explicit memory_candidates(const memory<SIZE>& mem) :
+            memory_candidates(mem.data(), SIZE)
+        {
+            begin_ = mem.address_begin();
+        }
+
+        // keeps the candidates whose byte is in relation to the value, or to its last value for changed, unchanged,
+        // increased and decreased, then remembers the bytes, returns the candidates left
+        size_t narrow(const byte_t* data, size_t size, relation_t relation, uint8_t value = 0) {
+            if (size != previous.size()) {
+                throw std::runtime_error(std::format("memory search error: {} bytes narrowed against {} candidates", size, previous.size()));
+            }
+            auto bytes = (const uint8_t*)data;
+            count_ = 0;
+            for (size_t word{ 0 }; word < bits.size(); ++word) {
+                if (bits[word] == 0) continue;
+                auto offset = word * 64;
+                if (offset + 64 <= size) {
+                    bits[word] &= keep(bytes + offset, previous.data() + offset, relation, value);
+                }
+                else {
+                    for (size_t i{ offset }; i < size; ++i) {
+                        if (!keep(bytes[i], previous[i], relation, value)) bits[word] &= ~(1ull << (i - offset));
+                    }
+                }
+                count_ += std::popcount(bits[word]);
+            }
+            std::memcpy(previous.data(), bytes, size);
+            return count_;
+        }
+
+        template<size_t SIZE>
+        size_t narrow(const memory<SIZE>& mem, relation_t relation, uint8_t value = 0) {
+            return narrow(mem.data(), SIZE, relation, value);
+        }
+
+        inline size_t size() const {
+            return count_;
+        }
+
+        inline bool test(address_t addr) const {
+            size_t i = (address_t)(addr - begin_);
+            return i < previous.size() && (bits[i / 64] >> (i % 64)) & 1;
+        }
+
+        std::vector<address_t> addresses() const {
+            std::vector<address_t> list;
+            for (size_t word{ 0 }; word < bits.size(); ++word) {
+                for (auto b = bits[word]; b; b &= b - 1) {
+                    list.push_back((address_t)(begin_ + word * 64 + std::countr_zero(b)));
+                }
+            }
+            return list;
+        }
+
+    private:
+
+        static inline bool keep(uint8_t now, uint8_t was, relation_t relation, uint8_t value) {
+            switch (relation) {
+                case relation_t::equal: return now == value;
+                case relation_t::not_equal: return now != value;
+                case relation_t::greater: return now > value;
+                case relation_t::less: return now < value;
+                case relation_t::changed: return now != was;
+                case relation_t::unchanged: return now == was;
+                case relation_t::increased: return now > was;
+                case relation_t::decreased: return now < was;
+            }
+            return false;
+        }
+
+        // the bits of 64 bytes in relation
+        static inline uint64_t keep(const uint8_t* now, const uint8_t* was, relation_t relation, uint8_t value) {
+            bool against_last = relation >= relation_t::changed;
+            uint64_t bits{ 0 };
+#if defined(__AVX2__)
+            auto key = _mm256_set1_epi8((char)value);
+            for (int half{ 0 }; half < 2; ++half) {
+                auto x = _mm256_loadu_si256((const __m256i*)(now + half * 32));
+                auto y = against_last ? _mm256_loadu_si256((const __m256i*)(was + half * 32)) : key;
+                uint32_t mask{ 0 };
+                switch (relation) {
+                    case relation_t::equal: case relation_t::unchanged: mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)); break;
+                    case relation_t::not_equal: case relation_t::changed: mask = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)); break;
+                    case relation_t::greater: case relation_t::increased: mask = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(x, y), y)); break;
+                    case relation_t::less: case relation_t::decreased: mask = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(x, y), x)); break;
+                }
+                bits |= (uint64_t)mask << (half * 32);
+            }
+#elif defined(EMU_SEARCH_SSE2)
+            auto key = _mm_set1_epi8((char)value);
+            for (int quarter{ 0 }; quarter < 4; ++quarter) {
+                auto x = _mm_loadu_si128((const __m128i*)(now + quarter * 16));
+                auto y = against_last ? _mm_loadu_si128((const __m128i*)(was + quarter * 16)) : key;
+                uint32_t mask{ 0 };
+                switch (relation) {
+                    case relation_t::equal: case relation_t::unchanged: mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)); break;
+                    case relation_t::not_equal: case relation_t::changed: mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)); break;
+                    case relation_t::greater: case relation_t::increased: mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, y), y)); break;
+                    case relation_t::less: case relation_t::decreased: mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, y), x)); break;
+                }
+                bits |= (uint64_t)(mask & 0xFFFF) << (quarter * 16);
+            }
+#else
+            for (int i{ 0 }; i < 64; ++i) {
+                if (keep(now[i], was[i], relation, value)) bits |= 1ull << i;
+            }
+#endif
+            return bits;
+        }
+
+        address_t begin_;
+        std::vector<uint64_t> bits;
+        std::vector<uint8_t> previous;
+        size_t count_{ 0 };
+
+    };
+
+}
@@ -10,6 +10,7 @@
 **/
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 // Z80 is little-endian i.e. stores the least-significant byte at the smallest address
@@ -22,4 +23,13 @@ namespace emu {
     using word_t = int16_t;
     using address_t = uint16_t;
 
+    // the 64K address space is managed in 256 byte pages e.g. for wait states, ROM protection and debug flags
+    constexpr size_t PAGE_SHIFT = 8;
+    constexpr size_t PAGE_SIZE = 1 << PAGE_SHIFT;
+    constexpr size_t PAGE_COUNT = 0x10000 >> PAGE_SHIFT;
+
+    inline constexpr size_t page_of(address_t addr) {
+        return addr >> PAGE_SHIFT;
+    }
+
 }
\ No newline at end of file
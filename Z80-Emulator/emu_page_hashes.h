@@ -0,0 +1,171 @@
+/**
+
+    @file      emu_page_hashes.h
+    @brief     a fast non-cryptographic 64 bit hash and a cache of the hash of every page of the 64K
+    @details   loop detection, deduplication of states in a search and snapshot equality hash the machine state
+               far more often than all of memory changes:
+               + hash_bytes() is four lanes of xxHash64 style rounds, 32 bytes a round, and an avalanche at the end,
+                 fast rather than a standard and not for anything adversarial
+               + page_hashes holds a hash per page and a dirty bitmap, one bit per page, that the memory path marks
+                 on every write, hash() rehashes only the dirty pages
+               + the memory hash is the sum of the page hashes each mixed with its page number, so a rehashed page
+                 swaps its old term for its new one without touching the other 255
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include "emu_memory_types.h"
+
+namespace emu {
+
+    namespace hash_detail {
+
+        constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+        constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+        constexpr uint64_t P3 = 0x165667B19E3779F9ull;
+        constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+
+        inline uint64_t word(const uint8_t* p) {
+            uint64_t w;
+            std::memcpy(&w, p, sizeof(w));
+            return w;
+        }
+
+        inline uint64_t round(uint64_t lane, uint64_t w) {
+            return std::rotl(lane + w * P2, 31) * P1;
+        }
+
+        inline uint64_t avalanche(uint64_t h) {
+            h ^= h >> 33;
+            h *= P2;
+            h ^= h >> 29;
+            h *= P3;
+            h ^= h >> 32;
+            return h;
+        }
+
+    }
+
+    inline uint64_t hash_bytes(const void* data, size_t n, uint64_t seed = 0) {
+        using namespace hash_detail;
+        auto p = (const uint8_t*)data;
+        auto end = p + n;
+        uint64_t h;
+        if (n >= 32) {
+            uint64_t v1{ seed + P1 + P2 }, v2{ seed + P2 }, v3{ seed }, v4{ seed - P1 };
+            for (; p + 32 <= end; p += 32) {
+                v1 = round(v1, word(p));
+                v2 = round(v2, word(p + 8));
+                v3 = round(v3, word(p + 16));
+                v4 = round(v4, word(p + 24));
+            }
+            h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        }
+        else {
+            h = seed + P4;
+        }
+        h += n;
+        for (; p + 8 <= end; p += 8) {
+            h = std::rotl(h ^ round(0, word(p)), 27) * P1 + P4;
+        }
+        for (; p < end; ++p) {
+            h = std::rotl(h ^ (*p * P4), 11) * P1;
+        }
+        return avalanche(h);
+    }
+
+    // one value folded into a running hash, order matters
+    inline uint64_t hash_combine(uint64_t h, uint64_t v) {
+        return hash_detail::avalanche(h ^ (v + hash_detail::P3 + (h << 6) + (h >> 2)));
+    }
+
+    class page_hashes {
+
+    public:
+
+        page_hashes() {
+            touch_all();
+        }
+
+        // the write path, one bit set
+        inline void touch(address_t addr) {
+            auto page = page_of(addr);
+            dirty[page >> 6] |= 1ull << (page & 63);
+        }
+
+        // count bytes from begin, wrapping at the end of the 64K
+        void touch(address_t begin, size_t count) {
+            if (count == 0) {
+                return;
+            }
+            auto pages = std::min<size_t>(((begin % PAGE_SIZE) + count + PAGE_SIZE - 1) / PAGE_SIZE, PAGE_COUNT);
+            for (size_t i{ 0 }; i < pages; ++i) {
+                auto page = (page_of(begin) + i) % PAGE_COUNT;
+                dirty[page >> 6] |= 1ull << (page & 63);
+            }
+        }
+
+        void touch_all() {
+            dirty.fill(~0ull);
+        }
+
+        // the hash of the 64K at memory, rehashing only the pages touched since the last call
+        uint64_t hash(const byte_t* memory) {
+            rehashed_ = 0;
+            for (size_t word{ 0 }; word < dirty.size(); ++word) {
+                for (auto bits = dirty[word]; bits; bits &= bits - 1) {
+                    auto page = word * 64 + std::countr_zero(bits);
+                    auto h = hash_bytes(memory + page * PAGE_SIZE, PAGE_SIZE, page);
+                    sum += term(page, h) - term(page, hashes[page]);
+                    hashes[page] = h;
+                    ++rehashed_;
+                }
+                dirty[word] = 0;
+            }
+            return sum;
+        }
+
+        // the page was written since the last hash()
+        inline bool dirty_page(size_t page) const {
+            return (dirty[page >> 6] >> (page & 63)) & 1;
+        }
+
+        // pages the last hash() rehashed
+        inline size_t rehashed() const {
+            return rehashed_;
+        }
+
+        inline uint64_t page_hash(size_t page) const {
+            return hashes[page];
+        }
+
+    private:
+
+        static inline uint64_t term(size_t page, uint64_t h) {
+            return hash_combine(page, h);
+        }
+
+        std::array<uint64_t, PAGE_COUNT / 64> dirty{};
+        std::array<uint64_t, PAGE_COUNT> hashes{};
+        uint64_t sum{ initial_sum() };
+        size_t rehashed_{ 0 };
+
+        // the sum for hashes of zero, so that the first hash() can swap each term like any other
+        static uint64_t initial_sum() {
+            uint64_t s{ 0 };
+            for (size_t page{ 0 }; page < PAGE_COUNT; ++page) s += term(page, 0);
+            return s;
+        }
+
+    };
+
+}
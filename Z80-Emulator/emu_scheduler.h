@@ -0,0 +1,120 @@
+/**
+
+    @file      emu_scheduler.h
+    @brief     emulated-cycle event scheduler
+    @details   devices ask to be called back at an absolute T-state, the CPU loop asks when the next event is due
+               and services everything that has become due:
+               + events are kept sorted latest first so the next event is the back of the vector
+               + events due on the same cycle run in the order they were scheduled
+               + handlers may schedule or cancel further events, including on the cycle being serviced
+               a machine has a handful of pending events (frame interrupt, tape edge, disk completion ...) so a
+               sorted vector beats a heap and keeps next_event() a single load
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace emu {
+
+    using cycle_t = uint64_t;
+
+    class scheduler {
+
+    public:
+
+        using event_id_t = uint64_t;
+        using handler_t = std::function<void(cycle_t)>;
+
+        static constexpr cycle_t NEVER = std::numeric_limits<cycle_t>::max();
+
+        // the handler is called with the cycle it was scheduled for, even if serviced late
+        event_id_t schedule(cycle_t when, handler_t handler) {
+            auto id = ++last_id;
+            event e{ when, id, std::move(handler) };
+            auto pos = std::upper_bound(events.begin(), events.end(), e, [](const event& a, const event& b) {
+                return later(a, b);
+            });
+            events.insert(pos, std::move(e));
+            return id;
+        }
+
+        inline event_id_t schedule_in(cycle_t delay, handler_t handler) {
+            return schedule(now_ + delay, std::move(handler));
+        }
+
+        bool cancel(event_id_t id) {
+            auto it = std::find_if(events.begin(), events.end(), [id](const event& e) { return e.id == id; });
+            if (it == events.end()) {
+                return false;
+            }
+            events.erase(it);
+            return true;
+        }
+
+        inline cycle_t next_event() const {
+            return events.empty() ? NEVER : events.back().when;
+        }
+
+        inline bool due(cycle_t now) const {
+            return !events.empty() && events.back().when <= now;
+        }
+
+        // run every event due at or before now, returns the number of handlers called
+        size_t service(cycle_t now) {
+            size_t count{ 0 };
+            while (due(now)) {
+                auto e = std::move(events.back());
+                events.pop_back();
+                now_ = e.when;
+                e.handler(e.when);
+                ++count;
+            }
+            now_ = now;
+            return count;
+        }
+
+        // the cycle last serviced, the time base for schedule_in
+        inline cycle_t now() const {
+            return now_;
+        }
+
+        inline size_t size() const {
+            return events.size();
+        }
+
+        inline bool empty() const {
+            return events.empty();
+        }
+
+        void clear() {
+            events.clear();
+        }
+
+    private:
+
+        struct event {
+            cycle_t when;
+            event_id_t id;
+            handler_t handler;
+        };
+
+        // sort order puts the earliest event, and the first scheduled of equal events, at the back
+        static inline bool later(const event& a, const event& b) {
+            return (a.when != b.when) ? a.when > b.when : a.id > b.id;
+        }
+
+        std::vector<event> events;
+        event_id_t last_id{ 0 };
+        cycle_t now_{ 0 };
+
+    };
+
+}
@@ -0,0 +1,120 @@
+/**
+
+    @file      emu_spsc_ring.h
+    @brief     lock-free single producer single consumer byte ring
+    @details   moves bytes between exactly two threads without locks e.g. between the host I/O thread and an
+               emulated device on the CPU thread:
+               + the producer only ever writes head, the consumer only ever writes tail
+               + CAPACITY must be a power of two so that the indices wrap with a mask
+               + head and tail live on separate cache lines so the two threads do not false share
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#include "emu_memory_types.h"
+
+namespace emu {
+
+    template<size_t CAPACITY>
+    class spsc_ring {
+
+        static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "spsc_ring capacity must be a power of two");
+
+        static constexpr size_t MASK = CAPACITY - 1;
+        static constexpr size_t CACHE_LINE = 64;
+
+    public:
+
+        // producer side
+
+        inline bool push(byte_t b) {
+            auto head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) == CAPACITY) {
+                return false;
+            }
+            bytes[head & MASK] = b;
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t push(const byte_t* src, size_t n) {
+            auto head = head_.load(std::memory_order_relaxed);
+            n = std::min(n, CAPACITY - (head - tail_.load(std::memory_order_acquire)));
+            for (size_t i{ 0 }; i < n; ++i) {
+                bytes[(head + i) & MASK] = src[i];
+            }
+            head_.store(head + n, std::memory_order_release);
+            return n;
+        }
+
+        inline size_t free_space() const {
+            return CAPACITY - (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+        }
+
+        // consumer side
+
+        inline bool pop(byte_t& b) {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            if (tail == head_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            b = bytes[tail & MASK];
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t pop(byte_t* dst, size_t n) {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            n = std::min(n, head_.load(std::memory_order_acquire) - tail);
+            for (size_t i{ 0 }; i < n; ++i) {
+                dst[i] = bytes[(tail + i) & MASK];
+            }
+            tail_.store(tail + n, std::memory_order_release);
+            return n;
+        }
+
+        // copy without consuming, then skip what was actually used
+        size_t peek(byte_t* dst, size_t n) const {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            n = std::min(n, head_.load(std::memory_order_acquire) - tail);
+            for (size_t i{ 0 }; i < n; ++i) {
+                dst[i] = bytes[(tail + i) & MASK];
+            }
+            return n;
+        }
+
+        inline void skip(size_t n) {
+            tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+        }
+
+        inline size_t available() const {
+            return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+        }
+
+        // either side
+
+        inline bool empty() const {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        static inline size_t capacity() {
+            return CAPACITY;
+        }
+
+    private:
+
+        alignas(CACHE_LINE) std::atomic<size_t> head_{ 0 };
+        alignas(CACHE_LINE) std::atomic<size_t> tail_{ 0 };
+        alignas(CACHE_LINE) std::array<byte_t, CAPACITY> bytes{};
+
+    };
+
+}
@@ -14,9 +14,34 @@
 #include <functional>
 #include <iostream>
 
+#include "test_alu.h"
+#include "test_alu_exhaustive.h"
+#include "test_assembler.h"
+#include "test_breakpoints.h"
+#include "test_capi.h"
+#include "test_condition.h"
+#include "test_contention.h"
+#include "test_device_task.h"
+#include "test_explorer.h"
 #include "test_flags.h"
+#include "test_gdb.h"
+#include "test_halt.h"
+#include "test_host_bridge.h"
+#include "test_loop_idioms.h"
+#include "test_memory_search.h"
+#include "test_polling_loop.h"
 #include "test_registers.h"
 #include "test_rom.h"
+#include "test_scheduler.h"
+#include "test_selftest.h"
+#include "test_spsc_ring.h"
+#include "test_state_hash.h"
+#include "test_superinstructions.h"
+#include "test_superoptimizer.h"
+#include "test_trace.h"
+#include "test_traps.h"
+#include "test_zx81_batch.h"
+#include "test_zx81_profiler.h"
 
 #include "zx80_disassembler.h"
 
@@ -27,6 +52,31 @@ int main() {
     //if(test_flags::run()) std::cout << "pass\n";
     //if(test_registers::run()) std::cout << "pass\n";
     //if(test_rom::run(true)) std::cout << "pass\n";
+    //if(test_spsc_ring::run()) std::cout << "pass\n";
+    //if(test_scheduler::run()) std::cout << "pass\n";
+    //if(test_contention::run()) std::cout << "pass\n";
+    //if(test_device_task::run()) std::cout << "pass\n";
+    //if(test_halt::run()) std::cout << "pass\n";
+    //if(test_polling_loop::run()) std::cout << "pass\n";
+    //if(test_traps::run()) std::cout << "pass\n";
+    //if(test_superinstructions::run()) std::cout << "pass\n";
+    //if(test_loop_idioms::run()) std::cout << "pass\n";
+    //if(test_alu::run()) std::cout << "pass\n";
+    //if(test_alu_exhaustive::run()) std::cout << "pass\n";
+    //if(test_selftest::run()) std::cout << "pass\n";
+    //if(test_trace::run()) std::cout << "pass\n";
+    //if(test_assembler::run()) std::cout << "pass\n";
+    //if(test_capi::run()) std::cout << "pass\n";
+    //if(test_gdb::run()) std::cout << "pass\n";
+    //if(test_breakpoints::run()) std::cout << "pass\n";
+    //if(test_condition::run()) std::cout << "pass\n";
+    //if(test_memory_search::run()) std::cout << "pass\n";
+    //if(test_state_hash::run()) std::cout << "pass\n";
+    //if(test_explorer::run()) std::cout << "pass\n";
+    //if(test_superoptimizer::run()) std::cout << "pass\n";
+    //if(test_zx81_profiler::run()) std::cout << "pass\n";
+    //if(test_zx81_batch::run()) std::cout << "pass\n";
+    //if(test_host_bridge::run()) std::cout << "pass\n";
 
     const emu::memory<8192> rom(0x3000, "zx81-v2.rom");
 
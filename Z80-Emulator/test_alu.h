@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+#include "z80_alu.h"
+#include "z80_assembler.h"
+#include "z80_core.h"
+#include "z80_flags.h"
+#include "z80_machine.h"
+
+namespace test_alu {
+
+    // copy, call and memory operand code for the core alone
+    template<typename CORE>
+    void boot(emu::z80_machine& m) {
+        m.superinstruction_fusion(false);
+        m.loop_idioms(false);
+        m.ram().fill(0);
+        emu::z80_assembler::assemble(R"(
+again:  LD HL,$8000
+        LD DE,$C000
+        LD BC,$0400
+copy:   LD A,(HL)
+        INC HL
+        LD (DE),A
+        INC DE
+        DEC BC
+        LD A,B
+        OR C
+        JR NZ,copy
+        LD B,0
+sum:    CALL add
+        DJNZ sum
+        JP again
+add:    LD HL,($9000)
+        ADD A,(HL)
+        LD ($9000),HL
+        BIT 0,(HL)
+        RET
+)", m.ram());
+        m.registers().word(SP) = (emu::word_t)0xFF00;
+        m.attach(CORE{});
+    }
+
+    // seconds for the next 20M T-states
+    double step_loop(emu::z80_machine& m) {
+        auto start = std::chrono::steady_clock::now();
+        m.run(m.cycles() + 20'000'000);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test Z80 ALU undocumented flags...";
+
+        using namespace emu;
+
+        uint8_t f{ 0 };
+
+        // CP takes x and y from the operand, SUB from the result
+        alu::cp(0x00, 0x28, f);
+        assert((f & alu::XY) == 0x28);
+        alu::sub(0x00, 0x28, f);
+        assert((f & alu::XY) == (0xD8 & alu::XY));
+
+        // SCF and CCF: x and y from A after an instruction that wrote the flags, from A | F after one that did not
+        f = 0x28;
+        alu::scf(0x00, f, f);
+        assert(f == CARRY);
+        f = 0x28;
+        alu::scf(0x00, f, 0);
+        assert(f == (0x28 | CARRY));
+        f = CARRY;
+        alu::ccf(0xFF, f, f);
+        assert(f == (HALF_CARRY | alu::XY));
+
+        // BIT b,(HL) takes x and y from MEMPTR's high byte, BIT b,r from the value
+        f = 0;
+        alu::bit(3, 0x28, f, 0x00);
+        assert((f & alu::XY) == 0 && !(f & ZERO));
+        alu::bit(4, 0x00, f, 0x28);
+        assert((f & alu::XY) == 0x28 && (f & ZERO) && (f & PARITY_OVERFLOW));
+        alu::bit(7, 0x80, f, 0x80);
+        assert((f & SIGN) && !(f & ZERO));
+
+        // DAA after 15 + 27
+        auto a = alu::add(0x15, 0x27, f);
+        a = alu::daa(a, f);
+        assert(a == 0x42 && !(f & CARRY));
+        a = alu::sub(0x42, 0x27, f);
+        a = alu::daa(a, f);
+        assert(a == 0x15 && (f & NEGATE));
+
+        // 16 bit, x and y from the high byte of the result
+        auto hl = alu::add16(0x0FFF, 0x0001, f);
+        assert(hl == 0x1000 && (f & HALF_CARRY) && !(f & CARRY));
+        f = 0;
+        hl = alu::sbc16(0x0000, 0x0001, f);
+        assert(hl == 0xFFFF && f == (SIGN | alu::XY | HALF_CARRY | NEGATE | CARRY));
+        f = CARRY;
+        hl = alu::adc16(0x7FFF, 0x0000, f);
+        assert(hl == 0x8000 && (f & PARITY_OVERFLOW) && (f & SIGN));
+
+        // the core without MEMPTR and Q runs the same program to the same state bar the x and y flags BIT n,(HL)
+        // takes from MEMPTR, and leaves MEMPTR and Q as they were
+        emu::z80_machine with, without;
+        boot<emu::z80_core>(with);
+        boot<emu::basic_z80_core<false>>(without);
+        with.run(200'000);
+        without.run(200'000);
+        assert(with.cycles() == without.cycles());
+        auto x = with.snapshot(), y = without.snapshot();
+        x.byte(F) = y.byte(F) = 0;
+        assert(std::memcmp(&x, &y, sizeof(emu::z80_registers_t)) == 0);
+        for (size_t addr{ 0 }; addr < with.ram().size(); ++addr) {
+            assert(with.ram()[(emu::address_t)addr] == without.ram()[(emu::address_t)addr]);
+        }
+        assert(with.control().memptr != 0);
+        assert(without.control().memptr == 0 && without.control().q == 0);
+
+        // what tracking them costs the step loop, best of 9 runs each taken in turn
+        if (verbose) {
+            double tracked{ 1e9 }, untracked{ 1e9 };
+            for (auto run{ 0 }; run < 9; ++run) {
+                tracked = std::min(tracked, step_loop(with));
+                untracked = std::min(untracked, step_loop(without));
+            }
+            std::cout << std::format("\nstep loop with MEMPTR and Q {:.4f}s, without {:.4f}s, x{:.3f}\n", tracked, untracked, tracked / untracked);
+        }
+
+        return true;
+    }
+
+}
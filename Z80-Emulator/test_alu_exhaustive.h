@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "z80_alu.h"
+
+// every 8 bit ALU, rotate, shift, BIT, DAA, SCF and CCF operation for all operands and incoming flags, and 16 bit
+// ADD, ADC and SBC for every HL against a spread of operands, checked against a reference written from the data
+// sheet descriptions a bit at a time, across all cores
+namespace test_alu_exhaustive {
+
+    // the reference model, nothing shared with z80_alu.h or z80_flags.h
+
+    namespace reference {
+
+        struct sum_t {
+            unsigned result{ 0 };
+            bool carry{ false };        // out of the top bit
+            bool half{ false };         // out of bit 3, or bit 11
+            bool overflow{ false };     // carry into the top bit != carry out of it
+        };
+
+        // a ripple carry adder
+        inline sum_t ripple(unsigned x, unsigned y, bool carry, unsigned bits) {
+            sum_t s;
+            for (unsigned i{ 0 }; i < bits; ++i) {
+                bool xb = (x >> i) & 1, yb = (y >> i) & 1;
+                if (i == bits - 1) s.overflow = carry;
+                s.result |= (unsigned)(xb ^ yb ^ carry) << i;
+                carry = (xb && yb) || (carry && (xb != yb));
+                if (i == bits - 5) s.half = carry;
+            }
+            s.overflow = s.overflow != carry;
+            s.carry = carry;
+            return s;
+        }
+
+        // x - y - borrow is x + ~y + !borrow, the Z80's carry and half carry are borrows
+        inline sum_t subtract(unsigned x, unsigned y, bool borrow, unsigned bits) {
+            auto mask = (1u << bits) - 1;
+            auto s = ripple(x, ~y & mask, !borrow, bits);
+            s.carry = !s.carry;
+            s.half = !s.half;
+            return s;
+        }
+
+        inline bool bit(unsigned v, unsigned b) {
+            return (v >> b) & 1;
+        }
+
+        inline bool even_parity(unsigned v) {
+            unsigned ones{ 0 };
+            for (unsigned i{ 0 }; i < 8; ++i) ones += bit(v, i);
+            return ones % 2 == 0;
+        }
+
+        inline uint8_t flags(bool s, bool z, bool x, bool h, bool y, bool pv, bool n, bool c) {
+            return (uint8_t)(s << 7 | z << 6 | x << 5 | h << 4 | y << 3 | pv << 2 | n << 1 | c);
+        }
+
+        struct result_t {
+            unsigned value;
+            uint8_t f;
+            bool operator==(const result_t&) const = default;
+        };
+
+        inline result_t arithmetic(unsigned a, unsigned b, uint8_t f, bool subtracting, bool with_carry, bool compare) {
+            bool c = with_carry && bit(f, 0);
+            auto s = subtracting ? subtract(a, b, c, 8) : ripple(a, b, c, 8);
+            auto r = s.result;
+            auto xy = compare ? b : r;
+            return { compare ? a : r, flags(bit(r, 7), r == 0, bit(xy, 5), s.half, bit(xy, 3), s.overflow, subtracting, s.carry) };
+        }
+
+        inline result_t logic(unsigned r, bool h) {
+            return { r, flags(bit(r, 7), r == 0, bit(r, 5), h, bit(r, 3), even_parity(r), false, false) };
+        }
+
+        inline result_t inc_dec(unsigned v, uint8_t f, bool decrement) {
+            auto s = decrement ? subtract(v, 1, false, 8) : ripple(v, 1, false, 8);
+            auto r = s.result;
+            return { r, flags(bit(r, 7), r == 0, bit(r, 5), s.half, bit(r, 3), s.overflow, decrement, bit(f, 0)) };
+        }
+
+        inline result_t cpl(unsigned a, uint8_t f) {
+            auto r = ~a & 0xFF;
+            return { r, flags(bit(f, 7), bit(f, 6), bit(r, 5), true, bit(r, 3), bit(f, 2), true, bit(f, 0)) };
+        }
+
+        // the DAA tables of "The Undocumented Z80 Documented"
+        inline result_t daa(unsigned a, uint8_t f) {
+            bool c = bit(f, 0), h = bit(f, 4), n = bit(f, 1);
+            unsigned hi = a >> 4, lo = a & 0x0F;
+            unsigned diff;
+            if (!c && hi <= 9 && !h && lo <= 9) diff = 0x00;
+            else if (!c && hi <= 9 && h && lo <= 9) diff = 0x06;
+            else if (!c && hi <= 8 && lo >= 10) diff = 0x06;
+            else if (!c && hi >= 10 && !h && lo <= 9) diff = 0x60;
+            else if (c && !h && lo <= 9) diff = 0x60;
+            else if (c && h && lo <= 9) diff = 0x66;
+            else if (c && lo >= 10) diff = 0x66;
+            else if (!c && hi >= 9 && lo >= 10) diff = 0x66;
+            else diff = 0x66;                               // !c, hi a-f, h, lo 0-9
+            bool carry;
+            if (c) carry = true;
+            else if (hi <= 9 && lo <= 9) carry = false;
+            else if (hi <= 8 && lo >= 10) carry = false;
+            else carry = true;
+            bool half;
+            if (!n) half = lo >= 10;
+            else half = h && lo <= 5;
+            auto r = (n ? a - diff : a + diff) & 0xFF;
+            return { r, flags(bit(r, 7), r == 0, bit(r, 5), half, bit(r, 3), even_parity(r), n, carry) };
+        }
+
+        // rotate or shift one place, in is the bit shifted in
+        inline unsigned shift(unsigned v, bool left, bool in) {
+            return left ? ((v << 1) | in) & 0xFF : (v >> 1) | (in << 7);
+        }
+
+        inline result_t accumulator_rotate(unsigned a, uint8_t f, bool left, bool through_carry) {
+            bool out = left ? bit(a, 7) : bit(a, 0);
+            bool in = through_carry ? bit(f, 0) : out;
+            auto r = shift(a, left, in);
+            return { r, flags(bit(f, 7), bit(f, 6), bit(r, 5), false, bit(r, 3), bit(f, 2), false, out) };
+        }
+
+        enum class cb_t { rlc, rrc, rl, rr, sla, sra, sll, srl };
+
+        inline result_t cb_shift(unsigned v, uint8_t f, cb_t op) {
+            bool left = op == cb_t::rlc || op == cb_t::rl || op == cb_t::sla || op == cb_t::sll;
+            bool out = left ? bit(v, 7) : bit(v, 0);
+            bool in{ false };
+            switch (op) {
+            case cb_t::rlc: case cb_t::rrc: in = out; break;
+            case cb_t::rl: case cb_t::rr: in = bit(f, 0); break;
+            case cb_t::sra: in = bit(v, 7); break;
+            case cb_t::sll: in = true; break;
+            default: in = false;
+            }
+            auto r = shift(v, left, in);
+            return { r, flags(bit(r, 7), r == 0, bit(r, 5), false, bit(r, 3), even_parity(r), false, out) };
+        }
+
+        inline uint8_t bit_test(unsigned b, unsigned v, uint8_t f, unsigned xy) {
+            bool set = bit(v, b);
+            return flags(b == 7 && set, !set, bit(xy, 5), true, bit(xy, 3), !set, false, bit(f, 0));
+        }
+
+        inline uint8_t scf_ccf(unsigned a, uint8_t f, uint8_t q, bool complement) {
+            auto xy = (q ^ f) | a;
+            bool c = bit(f, 0);
+            return flags(bit(f, 7), bit(f, 6), bit(xy, 5), complement && c, bit(xy, 3), bit(f, 2), false, complement ? !c : true);
+        }
+
+        inline result_t add16(unsigned x, unsigned y, uint8_t f) {
+            auto s = ripple(x, y, false, 16);
+            auto hi = s.result >> 8;
+            return { s.result, flags(bit(f, 7), bit(f, 6), bit(hi, 5), s.half, bit(hi, 3), bit(f, 2), false, s.carry) };
+        }
+
+        inline result_t adc_sbc16(unsigned x, unsigned y, uint8_t f, bool subtracting) {
+            auto s = subtracting ? subtract(x, y, bit(f, 0), 16) : ripple(x, y, bit(f, 0), 16);
+            auto hi = s.result >> 8;
+            return { s.result, flags(bit(hi, 7), s.result == 0, bit(hi, 5), s.half, bit(hi, 3), s.overflow, subtracting, s.carry) };
+        }
+
+    }
+
+    // runs job(0) .. job(count - 1) on every core
+    inline void parallel_for(unsigned count, const std::function<void(unsigned)>& job) {
+        auto workers = std::max(1u, std::thread::hardware_concurrency());
+        std::atomic<unsigned> next{ 0 };
+        std::vector<std::thread> pool;
+        for (unsigned w{ 0 }; w < workers; ++w) {
+            pool.emplace_back([&]() {
+                for (auto i = next++; i < count; i = next++) {
+                    job(i);
+                }
+            });
+        }
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+
+    struct report_t {
+
+        std::atomic<uint64_t> checks{ 0 };
+        std::atomic<uint64_t> failures{ 0 };
+        std::mutex lock;
+        std::string first;
+
+        template<typename DESCRIBE>
+        inline void check(bool same, DESCRIBE describe) {
+            if (!same && failures++ == 0) {
+                std::lock_guard<std::mutex> guard(lock);
+                first = describe();
+            }
+        }
+
+    };
+
+    using reference::result_t;
+
+    inline std::string mismatch(const char* op, unsigned x, unsigned y, uint8_t f, result_t got, result_t want) {
+        return std::format("{} ${:04X} ${:04X} F=${:02X}: ${:04X} F=${:02X}, reference ${:04X} F=${:02X}", op, x, y, f, got.value, got.f, want.value, want.f);
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test Z80 ALU exhaustively...";
+
+        using namespace emu;
+        using reference::cb_t;
+
+        report_t report;
+        auto start = std::chrono::steady_clock::now();
+
+        // binary 8 bit operations, every A, operand and incoming F
+        parallel_for(256, [&report](unsigned a) {
+            uint64_t n{ 0 };
+            for (unsigned b{ 0 }; b < 256; ++b) {
+                for (unsigned fi{ 0 }; fi < 256; ++fi) {
+                    auto f0 = (uint8_t)fi;
+                    auto check = [&](const char* op, result_t got, result_t want) {
+                        ++n;
+                        report.check(got == want, [&]() { return mismatch(op, a, b, f0, got, want); });
+                    };
+                    uint8_t f = f0;
+                    unsigned r = alu::add(a, b, f);
+                    check("ADD", { r, f }, reference::arithmetic(a, b, f0, false, false, false));
+                    f = f0; r = alu::adc(a, b, f);
+                    check("ADC", { r, f }, reference::arithmetic(a, b, f0, false, true, false));
+                    f = f0; r = alu::sub(a, b, f);
+                    check("SUB", { r, f }, reference::arithmetic(a, b, f0, true, false, false));
+                    f = f0; r = alu::sbc(a, b, f);
+                    check("SBC", { r, f }, reference::arithmetic(a, b, f0, true, true, false));
+                    f = f0; alu::cp(a, b, f);
+                    check("CP", { a, f }, reference::arithmetic(a, b, f0, true, false, true));
+                    f = f0; r = alu::and_(a, b, f);
+                    check("AND", { r, f }, reference::logic(a & b, true));
+                    f = f0; r = alu::or_(a, b, f);
+                    check("OR", { r, f }, reference::logic(a | b, false));
+                    f = f0; r = alu::xor_(a, b, f);
+                    check("XOR", { r, f }, reference::logic(a ^ b, false));
+                    // SCF and CCF for every Q, b stands in for A
+                    auto q = (uint8_t)a;
+                    f = f0; alu::scf(b, f, q);
+                    check("SCF", { 0, f }, { 0, reference::scf_ccf(b, f0, q, false) });
+                    f = f0; alu::ccf(b, f, q);
+                    check("CCF", { 0, f }, { 0, reference::scf_ccf(b, f0, q, true) });
+                    // BIT, a stands in for MEMPTR's high byte
+                    for (unsigned n_bit{ 0 }; n_bit < 8; ++n_bit) {
+                        f = f0; alu::bit(n_bit, (uint8_t)b, f, (uint8_t)a);
+                        check("BIT", { n_bit, f }, { n_bit, reference::bit_test(n_bit, b, f0, a) });
+                    }
+                }
+            }
+            report.checks += n;
+        });
+
+        // unary 8 bit operations, every value and incoming F
+        parallel_for(256, [&report](unsigned v) {
+            uint64_t n{ 0 };
+            for (unsigned fi{ 0 }; fi < 256; ++fi) {
+                auto f0 = (uint8_t)fi;
+                auto check = [&](const char* op, result_t got, result_t want) {
+                    ++n;
+                    report.check(got == want, [&]() { return mismatch(op, v, 0, f0, got, want); });
+                };
+                uint8_t f = f0;
+                unsigned r = alu::inc(v, f);
+                check("INC", { r, f }, reference::inc_dec(v, f0, false));
+                f = f0; r = alu::dec(v, f);
+                check("DEC", { r, f }, reference::inc_dec(v, f0, true));
+                f = f0; r = alu::neg(v, f);
+                check("NEG", { r, f }, reference::arithmetic(0, v, f0, true, false, false));
+                f = f0; r = alu::cpl(v, f);
+                check("CPL", { r, f }, reference::cpl(v, f0));
+                f = f0; r = alu::daa(v, f);
+                check("DAA", { r, f }, reference::daa(v, f0));
+                f = f0; r = alu::rlca(v, f);
+                check("RLCA", { r, f }, reference::accumulator_rotate(v, f0, true, false));
+                f = f0; r = alu::rrca(v, f);
+                check("RRCA", { r, f }, reference::accumulator_rotate(v, f0, false, false));
+                f = f0; r = alu::rla(v, f);
+                check("RLA", { r, f }, reference::accumulator_rotate(v, f0, true, true));
+                f = f0; r = alu::rra(v, f);
+                check("RRA", { r, f }, reference::accumulator_rotate(v, f0, false, true));
+                f = f0; r = alu::rlc(v, f);
+                check("RLC", { r, f }, reference::cb_shift(v, f0, cb_t::rlc));
+                f = f0; r = alu::rrc(v, f);
+                check("RRC", { r, f }, reference::cb_shift(v, f0, cb_t::rrc));
+                f = f0; r = alu::rl(v, f);
+                check("RL", { r, f }, reference::cb_shift(v, f0, cb_t::rl));
+                f = f0; r = alu::rr(v, f);
+                check("RR", { r, f }, reference::cb_shift(v, f0, cb_t::rr));
+                f = f0; r = alu::sla(v, f);
+                check("SLA", { r, f }, reference::cb_shift(v, f0, cb_t::sla));
+                f = f0; r = alu::sra(v, f);
+                check("SRA", { r, f }, reference::cb_shift(v, f0, cb_t::sra));
+                f = f0; r = alu::sll(v, f);
+                check("SLL", { r, f }, reference::cb_shift(v, f0, cb_t::sll));
+                f = f0; r = alu::srl(v, f);
+                check("SRL", { r, f }, reference::cb_shift(v, f0, cb_t::srl));
+            }
+            report.checks += n;
+        });
+
+        // 16 bit, every HL against each high byte with a spread of low bytes, carry and the untouched flags
+        // all set and all clear
+        parallel_for(256, [&report](unsigned hi) {
+            static constexpr uint8_t LOW[] = { 0x00, 0x0F, 0x80, 0xFF };
+            static constexpr uint8_t FLAGS[] = { 0x00, 0xFF };
+            uint64_t n{ 0 };
+            for (auto lo : LOW) {
+                unsigned y = hi << 8 | lo;
+                for (unsigned x{ 0 }; x < 0x10000; ++x) {
+                    for (auto f0 : FLAGS) {
+                        auto check = [&](const char* op, result_t got, result_t want) {
+                            ++n;
+                            report.check(got == want, [&]() { return mismatch(op, x, y, f0, got, want); });
+                        };
+                        uint8_t f = f0;
+                        unsigned r = alu::add16(x, y, f);
+                        check("ADD HL", { r, f }, reference::add16(x, y, f0));
+                        f = f0; r = alu::adc16(x, y, f);
+                        check("ADC HL", { r, f }, reference::adc_sbc16(x, y, f0, false));
+                        f = f0; r = alu::sbc16(x, y, f);
+                        check("SBC HL", { r, f }, reference::adc_sbc16(x, y, f0, true));
+                    }
+                }
+            }
+            report.checks += n;
+        });
+
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (verbose || report.failures) {
+            std::cout << '\n' << report.checks << " checks on " << std::max(1u, std::thread::hardware_concurrency())
+                << " threads in " << seconds << "s, " << report.failures << " failures " << report.first << '\n';
+        }
+        assert(report.failures == 0);
+
+        return true;
+    }
+
+}
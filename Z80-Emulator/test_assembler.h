@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "z80_assembler.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+#include "zx80_disassembler.h"
+
+namespace test_assembler {
+
+    bool throws(const std::string& source) {
+        try {
+            emu::z80_assembler::assemble(source);
+        }
+        catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test Z80 assembler...";
+
+        using emu::z80_assembler;
+
+        // every opcode of every table comes back as it went in
+        auto failures = z80_assembler::round_trip();
+        if (verbose) {
+            for (const auto& f : failures) std::cout << '\n' << f;
+        }
+        assert(failures.empty());
+
+        // labels, expressions and directives
+        auto program = z80_assembler::assemble(R"(
+COUNT   EQU 3
+        ORG $8000
+start:  LD B,COUNT          ; forward and backward references
+        LD HL,table
+loop    LD A,(HL)
+        ADD A,(IX+COUNT-1)
+        LD (IY-2),'A'
+        INC HL
+        DJNZ loop
+        JR done
+table:  DB 1,2,$FF,"hi"
+        DW table,$-start
+        DS 2,%1010
+done:   RST 38h
+        EX AF,AF'
+        BIT 7,(IX)
+        OUT (C),0
+        IM 2
+        JP (IY)
+)");
+        const std::vector<uint8_t> expected{
+            0x06, 0x03,                     // LD B,3
+            0x21, 0x12, 0x80,               // LD HL,table
+            0x7E,                           // LD A,(HL)
+            0xDD, 0x86, 0x02,               // ADD A,(IX+2)
+            0xFD, 0x36, 0xFE, 0x41,         // LD (IY-2),'A'
+            0x23,                           // INC HL
+            0x10, 0xF5,                     // DJNZ loop
+            0x18, 0x0B,                     // JR done
+            0x01, 0x02, 0xFF, 0x68, 0x69,   // table
+            0x12, 0x80, 0x17, 0x00,         // DW table,$-start
+            0x0A, 0x0A,                     // DS 2,%1010
+            0xFF,                           // RST $38
+            0x08,                           // EX AF,AF'
+            0xDD, 0xCB, 0x00, 0x7E,         // BIT 7,(IX+0)
+            0xED, 0x71,                     // OUT (C),0
+            0xED, 0x5E,                     // IM 2
+            0xFD, 0xE9                      // JP (IY)
+        };
+        assert(program.segments.size() == 1 && program.segments[0].address == 0x8000);
+        assert(program.bytes() == expected);
+        assert(program.symbol("loop") == 0x8005 && program.symbol("done") == 0x801D && program.symbol("COUNT") == 3);
+
+        // the mirrors assemble to the documented encoding
+        assert(z80_assembler::assemble("    NEG").bytes() == (std::vector<uint8_t>{ 0xED, 0x44 }));
+        assert(z80_assembler::assemble("    LD (1234h),HL").bytes() == (std::vector<uint8_t>{ 0x22, 0x34, 0x12 }));
+
+        assert(throws("    JR far\n    DS 200\nfar: NOP"));
+        assert(throws("    LD A,nowhere"));
+        assert(throws("    LD A,256"));
+        assert(throws("    LD HL,(IX+1)"));
+        assert(throws("    NOP\nx: NOP\nx: NOP"));
+        assert(throws("    DB 256") && throws("    DB -129"));
+        assert(throws("    DW $10000") && throws("    DW -32769") && throws("    DW far\nfar EQU $12345"));
+        assert(z80_assembler::assemble("    DW -32768,$FFFF").bytes() == (std::vector<uint8_t>{ 0x00, 0x80, 0xFF, 0xFF }));
+
+        // straight into a machine and run on the core
+        emu::z80_machine m;
+        m.ram().fill(0);
+        z80_assembler::assemble(R"(
+        ORG 0
+        LD HL,0             ; 7 * 6 by repeated addition
+        LD DE,7
+        LD B,6
+again:  ADD HL,DE
+        DJNZ again
+        LD (result),HL
+        HALT
+result: DW 0
+)", m.ram());
+        m.attach(emu::z80_core{});
+        m.run(1000);
+        assert(m.control().halted && m.ram()[0x000F] == 42 && m.ram()[0x0010] == 0);
+
+        // and the listing of it
+        auto first = emu::zx80_disassembler::decode([&m](emu::address_t a) { return m.ram()[a]; }, 0x0009);
+        assert(first.text == "DJNZ $0008" && first.length == 2);
+
+        return true;
+    }
+
+}
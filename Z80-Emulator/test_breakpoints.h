@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+#include "z80_assembler.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+
+namespace test_breakpoints {
+
+    // emulated MHz of the best of three cold ZX81 boots, the same state and dispatches every time
+    double boot_mhz(unsigned breakpoints, emu::z80_registers_t& state, emu::z80_machine::dispatch_stats_t& stats) {
+        constexpr emu::cycle_t TSTATES = 20'000'000;
+        double best{ 0 };
+        for (int i{ 0 }; i < 3; ++i) {
+            emu::z80_machine m;
+            m.ram().fill(0);
+            m.load("zx81-v2.rom", 0);
+            m.protect(0x0000, 0x1FFF);
+            m.attach(emu::z80_core{});
+            for (unsigned n{ 0 }; n < breakpoints; ++n) m.set_breakpoint((emu::address_t)(0x8000 + n * 41));
+            auto start = std::chrono::steady_clock::now();
+            m.run(TSTATES);
+            std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+            assert(!m.stopped());
+            best = std::max(best, m.cycles() / seconds.count() / 1e6);
+            state = m.snapshot();
+            stats = m.dispatch_stats();
+        }
+        return best;
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test breakpoints and watchpoints...";
+
+        emu::z80_machine m;
+        m.ram().fill(0);
+        auto program = emu::z80_assembler::assemble(R"(
+        ORG 0
+        LD SP,0
+        LD HL,source
+        LD DE,dest
+        LD BC,64
+copy:   LD A,(HL)           ; a copy idiom
+        INC HL
+        LD (DE),A
+        INC DE
+        DEC BC
+        LD A,B
+        OR C
+        JR NZ,copy
+wait:   LD A,(ticks)        ; a polling loop
+        AND 1
+        JR Z,wait
+        HALT
+source: DS 64,$AA
+dest:   DS 64
+ticks:  DB 0
+)", m.ram());
+        m.attach(emu::z80_core{});
+        auto source = program.symbol("source"), dest = program.symbol("dest");
+        auto ticks = program.symbol("ticks"), wait = program.symbol("wait");
+        m.events().schedule(50'000, [&m, ticks](emu::cycle_t) { m.ram()[ticks] = 1; });
+
+        // a read watchpoint stops after the read, even in the middle of a copy the machine would run natively
+        m.watch((emu::address_t)(source + 40), emu::watch_t::read);
+        assert(m.flags(source) & emu::PAGE_READ_WATCH);
+        m.run(1'000'000);
+        assert(m.stopped() && !m.breakpoint_hit() && m.watch_hit());
+        assert(m.watch_hit()->address == source + 40 && m.watch_hit()->access == emu::watch_t::read);
+        assert(emu::get_pair(m.registers(), H) == source + 40 && (emu::address_t)m.registers().word(PC) == program.symbol("copy") + 1);
+        assert((uint8_t)m.ram()[(emu::address_t)(dest + 39)] == 0xAA && m.ram()[(emu::address_t)(dest + 40)] == 0);
+        m.unwatch((emu::address_t)(source + 40), emu::watch_t::read);
+        assert(!(m.flags(source) & emu::PAGE_READ_WATCH) && !m.watching());
+
+        // a breakpoint stops on its PC before the instruction, and at once while the machine is on it
+        m.set_breakpoint(wait);
+        m.run(1'000'000);
+        assert(m.stopped() && m.breakpoint_hit() && !m.watch_hit() && (emu::address_t)m.registers().word(PC) == wait);
+        assert(m.dispatch_stats().breakpoint_lookups > 0);
+        assert((uint8_t)m.ram()[(emu::address_t)(dest + 63)] == 0xAA);
+        auto at = m.cycles();
+        m.run(1'000'000);
+        assert(m.breakpoint_hit() && m.cycles() == at);
+        m.step();
+        m.clear_breakpoint(wait);
+        assert(!(m.flags(wait) & emu::PAGE_BREAK));
+
+        // a read watchpoint on the polled location stops the loop the machine would otherwise fast-forward
+        m.watch(ticks, emu::watch_t::access);
+        m.run(1'000'000);
+        assert(m.watch_hit() && m.watch_hit()->address == ticks && (emu::address_t)m.registers().word(PC) == wait + 3);
+        assert(m.cycles() < 50'000);
+        m.unwatch(ticks, emu::watch_t::access);
+        m.run(1'000'000);
+        assert(!m.stopped() && m.control().halted);
+
+        // a write watchpoint
+        m.watch(0x9000);
+        m.write(0x8FFF, 1);
+        assert(!m.watch_hit());
+        m.registers().word(PC) = 0;
+        m.control().halted = false;
+        m.write_block(0, "\x32\x00\x90", 3);                    // LD ($9000),A
+        m.step();
+        assert(m.watch_hit() && m.watch_hit()->access == emu::watch_t::write && m.watch_hit()->address == 0x9000);
+
+        // 100 breakpoints on pages the ROM never runs cost nothing, no fast path is given up and the bitmap is
+        // never looked at
+        emu::z80_registers_t without, with;
+        emu::z80_machine::dispatch_stats_t plain, flagged;
+        auto none = boot_mhz(0, without, plain);
+        auto hundred = boot_mhz(100, with, flagged);
+        if (verbose) std::cout << std::format("\nZX81 boot {:.0f} MHz, with 100 breakpoints elsewhere {:.0f} MHz ", none, hundred);
+        assert(std::memcmp(&without, &with, sizeof(without)) == 0);
+        assert(plain.core == flagged.core && plain.fused == flagged.fused && plain.idioms == flagged.idioms);
+        assert(plain.fused_instructions == flagged.fused_instructions && plain.idiom_iterations == flagged.idiom_iterations);
+        assert(plain.breakpoint_lookups == 0 && flagged.breakpoint_lookups == 0);
+
+        return true;
+    }
+
+}
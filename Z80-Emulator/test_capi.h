@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "z80_assembler.h"
+#include "z80_capi.h"
+
+namespace test_capi {
+
+    struct host_t {
+        std::vector<uint8_t> out;
+        unsigned traps{ 0 };
+        unsigned frames{ 0 };
+    };
+
+    void on_out(void* user, uint16_t port, uint8_t value) {
+        if ((port & 0xFF) == 0x10) static_cast<host_t*>(user)->out.push_back(value);
+    }
+
+    uint32_t on_trap(void* user, z80_emulator*, uint16_t) {
+        ++static_cast<host_t*>(user)->traps;
+        return 17;
+    }
+
+    // a 1,000,000 T-state frame that schedules the next one
+    void on_frame(void* user, z80_emulator* z80, uint64_t when) {
+        if (++static_cast<host_t*>(user)->frames < 10) z80_schedule(z80, when + 1'000'000, on_frame, user);
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test C API...";
+
+        auto z80 = z80_create();
+        assert(z80 && std::string(z80_error(z80)).empty());
+
+        // bulk memory
+        std::vector<uint8_t> image(0x10000), back(0x10000);
+        for (size_t i{ 0 }; i < image.size(); ++i) image[i] = (uint8_t)(i * 7 + (i >> 8));
+        assert(z80_write_memory(z80, 0, image.data(), image.size()) == Z80_OK);
+        assert(z80_read_memory(z80, 0, back.data(), back.size()) == Z80_OK && back == image);
+        assert(z80_write_memory(z80, 0xFFF0, image.data(), 32) == Z80_ERROR);
+        if (verbose) std::cout << '\n' << z80_error(z80);
+        assert(!std::string(z80_error(z80)).empty());
+        assert(z80_load(z80, "no such image", 0) == Z80_ERROR);
+
+        // the whole state in and out
+        z80_state_t state;
+        std::memset(&state, 0, sizeof(state));
+        state.a = 0x12; state.f = 0x34; state.h_ = 0x56;
+        state.sp = 0xFFFE; state.pc = 0x1234; state.iy = 0xBEEF;
+        state.r = 0x85; state.im = 2; state.iff1 = 1; state.memptr = 0xCAFE;
+        z80_set_state(z80, &state);
+        z80_state_t got;
+        z80_get_state(z80, &got);
+        assert(std::memcmp(&got, &state, sizeof(state)) == 0);
+
+        // a program with a port and a trapped subroutine
+        auto program = emu::z80_assembler::assemble(R"(
+        ORG 0
+        LD HL,0
+        LD B,10
+loop:   INC HL
+        LD A,L
+        OUT ($10),A
+        CALL sub
+        DJNZ loop
+        HALT
+sub:    LD A,$FF            ; trapped, never runs
+        LD (flag),A
+        RET
+flag:   DB 0
+)");
+        auto code = program.bytes();
+        assert(z80_write_memory(z80, 0, code.data(), code.size()) == Z80_OK);
+        std::memset(&state, 0, sizeof(state));
+        state.sp = 0x8000;
+        z80_set_state(z80, &state);
+        host_t host;
+        z80_on_out(z80, on_out, &host);
+        assert(z80_trap(z80, program.symbol("sub"), on_trap, &host, 1) == Z80_OK);
+        assert(z80_run(z80, 10'000) == Z80_OK);
+        z80_get_state(z80, &state);
+        assert(state.halted && state.h == 0 && state.l == 10 && state.sp == 0x8000);
+        assert(host.out == (std::vector<uint8_t>{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }) && host.traps == 10);
+        uint8_t flag{ 0xAA };
+        assert(z80_read_memory(z80, program.symbol("flag"), &flag, 1) == Z80_OK && flag == 0);
+
+        // one call runs millions of instructions, events call back into the API
+        const uint8_t spin[] = { 0x00, 0x00, 0x18, 0xFC };      // NOP, NOP, JR -4
+        assert(z80_write_memory(z80, 0x4000, spin, sizeof(spin)) == Z80_OK);
+        state.pc = 0x4000;
+        state.halted = 0;
+        z80_set_state(z80, &state);
+        auto start = z80_cycles(z80);
+        assert(z80_schedule(z80, start + 1'000'000, on_frame, &host) == Z80_OK);
+        assert(z80_run(z80, 10'000'000) == Z80_OK);
+        assert(z80_cycles(z80) >= start + 10'000'000 && host.frames == 10);
+
+        // single instructions
+        z80_get_state(z80, &state);
+        state.pc = 0x4000;
+        z80_set_state(z80, &state);
+        assert(z80_step(z80, 3) == Z80_OK);
+        z80_get_state(z80, &state);
+        assert(state.pc == 0x4000);
+
+        z80_destroy(z80);
+
+        return true;
+    }
+
+}
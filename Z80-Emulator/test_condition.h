@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "z80_assembler.h"
+#include "z80_condition.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+
+namespace test_condition {
+
+    bool throws(const std::string& text) {
+        try {
+            emu::z80_condition c(text);
+        }
+        catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test breakpoint conditions...";
+
+        emu::z80_machine m;
+        m.ram().fill(0);
+        auto& regs = m.registers();
+        emu::set_pair(regs, H, 0x4000);
+        regs.word(IY) = 0x4000;
+        m.ram()[0x403B] = (emu::byte_t)0x80;
+        regs.byte(F) = ZERO | CARRY;
+        regs.byte(SHADOW + A) = 0x12;
+        m.refresh_register(0x85);
+
+        auto eval = [&m](const std::string& text) { return emu::z80_condition(text).evaluate(m); };
+
+        // precedence, grouping with [ ] and memory with ( )
+        assert(eval("HL == 0x4000 && (IY+0x3B) & 0x80") == 1);
+        assert(eval("HL == $4000 && (IY+%111011) & 0x40") == 0);
+        assert(eval("1 + 2 * 3") == 7 && eval("[1 + 2] * 3") == 9 && eval("(IY + 0x3B)") == 0x80);
+        assert(eval("1 << 4 | 1 == 1") == 17 && eval("10 - 4 - 3") == 3 && eval("-2 * -3") == 6);
+        assert(eval("7 / 0") == 0 && eval("7 % 0") == 0 && eval("!0 + ~0") == 0);
+        assert(eval("f & zero") == ZERO && eval("F & CARRY && ![F & SIGN]") == 1);
+        assert(eval("a' == 0x12 && af' >> 8 == $12 && R == $85") == 1);
+        assert(eval("0 || 5") == 1 && eval("2 && 0") == 0 && eval("cycles") == 0);
+
+        // constants fold away, a constant side of && or || decides it or drops out
+        assert(emu::z80_condition("2 * [3 + 4] == 14").constant());
+        assert(emu::z80_condition("HL == 1 || 1").constant());
+        assert(emu::z80_condition("HL == 0x4000 && 1").size() == 4);       // HL, 0x4000, ==, truth
+        assert(emu::z80_condition("(IY + [0x30 + 0xB]) & 0x80").size() == 6);  // IY, $3B, +, peek, $80, &
+
+        assert(throws("HL =="));
+        assert(throws("HL = 1"));
+        assert(throws("(IY+1"));
+        assert(throws("IZ == 0"));
+        assert(throws("PC'"));
+
+        // every other evaluation hits, the time each takes is reported when verbose
+        emu::z80_condition condition("HL == 0x4000 && (IY+0x3B) & 0x80");
+        constexpr int N = 10'000'000;
+        int64_t hits{ 0 };
+        auto start = std::chrono::steady_clock::now();
+        for (int i{ 0 }; i < N; ++i) {
+            regs.byte(L) = (emu::byte_t)(i & 1);
+            hits += condition.evaluate(m);
+        }
+        std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - start;
+        if (verbose) std::cout << std::format("\n{:.1f} ns a condition ", ns.count() / N);
+        assert(hits == N / 2);
+
+        // a conditional breakpoint in a loop
+        emu::z80_machine loop;
+        loop.ram().fill(0);
+        auto program = emu::z80_assembler::assemble(R"(
+        ORG 0
+        LD B,10
+again:  DEC B
+        JR NZ,again
+        HALT
+)", loop.ram());
+        loop.attach(emu::z80_core{});
+        loop.set_breakpoint(program.symbol("again"), emu::z80_condition("B == 3"));
+        loop.run(1000);
+        assert(loop.breakpoint_hit() && loop.registers().byte(B) == 3);
+        loop.step();
+        loop.run(1000);
+        assert(!loop.stopped() && loop.control().halted);
+
+        return true;
+    }
+
+}
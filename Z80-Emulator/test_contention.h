@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+
+#include "emu_contention.h"
+#include "z80_machine.h"
+
+namespace test_contention {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test contention...";
+
+        emu::contention_table table;
+        assert(table.empty());
+        assert(table.wait_states(0x4000, 0) == 0);
+
+        table.contend(0x4000, 0x7FFF, emu::contention_table::window(8, 2, 6, { 3, 1 }));
+        assert(!table.contended(0x3FFF));
+        assert(table.contended(0x4000) && table.contended(0x7FFF));
+        assert(!table.contended(0x8000));
+        unsigned expected[] = { 0, 0, 3, 1, 3, 1, 0, 0 };
+        for (emu::cycle_t t{ 0 }; t < 16; ++t) {
+            if (verbose) std::cout << table.wait_states(0x4000, t) << ' ';
+            assert(table.wait_states(0x4000, t) == expected[t % 8]);
+            assert(table.wait_states(0x8000, t) == 0);
+        }
+
+        emu::z80_machine zx(table);
+        zx.ram().fill(0);
+        zx.protect(0x0000, 0x1FFF);
+        zx.write(0x1000, 0x55);
+        assert(zx.ram()[0x1000] == 0);
+        assert(zx.cycles() == 0);
+        zx.tick(2);
+        zx.write(0x4000, 0x55);                 // phase 2 waits 3
+        assert(zx.cycles() == 5);
+        assert(zx.read(0x4000) == 0x55);        // phase 5 waits 1
+        assert(zx.cycles() == 6);
+        assert(zx.read(0x8000) == 0);
+        assert(zx.cycles() == 6);
+
+        try {
+            zx.load("zx81-v2.rom", 0);
+            const emu::memory<8192> rom(0, "zx81-v2.rom");
+            assert(zx.ram()[0x0000] == rom[0x0000] && zx.ram()[0x1FFF] == rom[0x1FFF]);
+        }
+        catch (std::exception& e) {
+            std::cout << e.what() << '\n';
+            return false;
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+#include "emu_device_task.h"
+#include "z80_machine.h"
+
+namespace test_device_task {
+
+    // a serial transmitter: start bit, 8 data bits lsb first, stop bit
+    struct transmitter {
+
+        transmitter(emu::scheduler& events) :
+            data_written(events)
+        {}
+
+        emu::device_task run(emu::device_context& ctx, emu::cycle_t bit_time) {
+            while (true) {
+                co_await data_written;
+                edges.push_back({ ctx.events.now(), 0 });
+                for (int i{ 0 }; i < 8; ++i) {
+                    co_await ctx.delay(bit_time);
+                    edges.push_back({ ctx.events.now(), (data >> i) & 1 });
+                }
+                co_await ctx.delay(bit_time);
+                edges.push_back({ ctx.events.now(), 1 });
+            }
+        }
+
+        struct edge {
+            emu::cycle_t when;
+            int level;
+        };
+
+        emu::device_signal data_written;
+        uint8_t data{ 0 };
+        std::vector<edge> edges;
+
+    };
+
+    emu::device_task count_to(emu::device_context& ctx, int n, int& counter) {
+        for (int i{ 0 }; i < n; ++i) {
+            co_await ctx.delay(10);
+            ++counter;
+        }
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test device coroutines...";
+
+        emu::z80_machine zx;
+        auto& events = zx.events();
+
+        transmitter uart(events);
+        auto task = uart.run(zx.devices(), 100);
+        assert(!task.done());
+        assert(events.empty());                 // waiting on the signal, not the scheduler
+
+        events.service(1000);
+        uart.data = 0b10100101;
+        uart.data_written.raise();
+        events.service(1000);                   // start bit now, data bits to come
+        assert(uart.edges.size() == 1 && uart.edges[0].when == 1000);
+        events.service(2000);
+        if (verbose) for (auto& e : uart.edges) std::cout << e.when << ':' << e.level << ' ';
+        assert(uart.edges.size() == 10);
+        for (emu::cycle_t i{ 0 }; i < 8; ++i) {
+            assert(uart.edges[i + 1].when == 1000 + 100 * (i + 1));
+            assert(uart.edges[i + 1].level == ((uart.data >> i) & 1));
+        }
+        assert(uart.edges[9].when == 1900 && uart.edges[9].level == 1);
+
+        // finished tasks free their frames back to the arena, the next ones reuse them
+        int counter{ 0 };
+        {
+            auto t = count_to(zx.devices(), 3, counter);
+            events.service(events.now() + 100);
+            assert(t.done() && counter == 3);
+        }
+        auto reserved = zx.devices().frames.reserved();
+        for (int i{ 0 }; i < 1000; ++i) {
+            auto t = count_to(zx.devices(), 1, counter);
+            events.service(events.now() + 10);
+            assert(t.done());
+        }
+        assert(zx.devices().frames.reserved() == reserved);
+        assert(counter == 1003);
+
+        // destroying a waiting task cancels its event
+        {
+            auto t = count_to(zx.devices(), 5, counter);
+            assert(events.size() == 1);
+        }
+        assert(events.empty());
+        events.service(events.now() + 1000);
+        assert(counter == 1003);
+
+        return true;
+    }
+
+}
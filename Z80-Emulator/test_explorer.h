@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <iostream>
+#include <thread>
+
+#include "z80_assembler.h"
+#include "z80_condition.h"
+#include "z80_core.h"
+#include "z80_explorer.h"
+#include "z80_machine.h"
+#include "z80_snapshot.h"
+
+namespace test_explorer {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test state space explorer...";
+
+        // a snapshot taken after a write shares every other page, restoring it copies one back
+        emu::z80_machine m;
+        m.ram().fill(0);
+        emu::z80_snapshot base(m);
+        m.write(0x4000, 1);
+        m.registers().byte(B) = 7;
+        emu::z80_snapshot next(m, base);
+        assert(next.shared(base) == emu::PAGE_COUNT - 1 && next[0x4000] == 1 && base[0x4000] == 0);
+        assert(next.hash() != base.hash());
+        base.restore(m, next);
+        assert(m.ram()[0x4000] == 0 && m.registers().byte(B) == 0 && m.hash() == base.hash());
+        next.restore(m, base);
+        assert(m.ram()[0x4000] == 1 && m.hash() == next.hash());
+
+        // two keys read from a port, only their low two bits matter
+        emu::z80_machine start;
+        start.ram().fill(0);
+        auto program = emu::z80_assembler::assemble(R"(
+        ORG 0
+        LD SP,0
+        IN A,($FE)
+        AND 3
+        LD B,A
+        IN A,($FE)
+        AND 3
+        ADD A,B
+        LD (sum),A
+        CP 6
+        JR NZ,done
+six:    NOP
+done:   HALT
+sum:    DB 0
+)", start.ram());
+        start.attach(emu::z80_core{});
+        auto six = program.symbol("six"), done = program.symbol("done");
+        start.set_breakpoint(six, emu::z80_condition("B == 3"));
+        assert(emu::z80_explorer::port_read(start, 3) == 0xFE && !emu::z80_explorer::port_read(start, 5));
+
+        emu::z80_explorer explorer(start);
+        explorer.assertion(done, emu::z80_condition(std::format("(${:04X}) != 5", program.symbol("sum"))));
+        auto report = explorer.explore();
+
+        // one fork on the first read, 4 of 256 distinct on the second, then every second key
+        assert(report.states == 5 && report.duplicates == 252);
+        assert(report.branches == 1 + 256 + 4 * 256);
+        auto breakpoints = std::count_if(report.hits.begin(), report.hits.end(), [](const auto& h) { return h.kind == emu::z80_explorer::hit_t::kind_t::breakpoint; });
+        assert(breakpoints == 64 && report.hits.size() == 64 + 128);
+        assert(report.halted == 1024 - 64 - 128 && report.bounded == 0);
+        for (const auto& hit : report.hits) {
+            assert(hit.inputs.size() == 2 && hit.inputs[0].port == 0xFE);
+            auto total = (hit.inputs[0].value & 3) + (hit.inputs[1].value & 3);
+            assert(hit.kind == emu::z80_explorer::hit_t::kind_t::breakpoint ? (hit.pc == six && total == 6) : (hit.pc == done && total == 5));
+        }
+        assert(std::find(report.coverage.begin(), report.coverage.end(), six) != report.coverage.end());
+        assert(report.coverage.size() == 12);
+
+        // a single thread finds the same, with a smaller domain and a step bound
+        explorer.inputs([](emu::address_t) { return std::vector<uint8_t>{ 0, 1, 2, 3 }; });
+        auto small = explorer.explore(1);
+        assert(small.states == 5 && small.duplicates == 0 && small.branches == 1 + 4 + 16 && small.hits.size() == 1 + 2);
+        explorer.max_steps(3);
+        assert(explorer.explore(2).bounded == 4);
+        if (verbose) std::cout << std::format("\n{} branches, {} states, {} duplicates on {} threads ", report.branches, report.states, report.duplicates, std::max(1u, std::thread::hardware_concurrency()));
+
+        return true;
+    }
+
+}
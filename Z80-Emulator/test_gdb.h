@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cassert>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "z80_assembler.h"
+#include "z80_core.h"
+#include "z80_gdb.h"
+#include "z80_machine.h"
+
+namespace test_gdb {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test GDB stub...";
+
+        emu::z80_machine m;
+        m.ram().fill(0);
+        auto program = emu::z80_assembler::assemble(R"(
+        ORG 0
+        LD SP,0
+        LD HL,buffer
+        LD B,4
+fill:   LD (HL),B
+        INC HL
+        DJNZ fill
+        LD A,$55
+        LD (flag),A
+spin:   JR spin
+buffer: DS 4
+flag:   DB 0
+)", m.ram());
+        m.attach(emu::z80_core{});
+        emu::z80_gdb_stub gdb(m);
+
+        assert(gdb.handle("qSupported:swbreak+").starts_with("PacketSize="));
+        assert(gdb.handle("?") == "S05");
+        assert(gdb.handle("vMustReplyEmpty").empty());
+
+        // registers, little-endian in gdb's order
+        m.registers().word(IX) = 0x1234;
+        emu::set_pair(m.registers(), D, 0xABCD);
+        auto g = gdb.handle("g");
+        assert(g.size() == emu::z80_gdb_stub::REGISTER_COUNT * 4);
+        assert(g.substr(2 * 4, 4) == "cdab" && g.substr(6 * 4, 4) == "3412");
+        assert(gdb.handle("P7=efbe") == "OK" && m.registers().word(IY) == (emu::word_t)0xBEEF);
+        assert(gdb.handle("p7") == "efbe" && gdb.handle("pd") == "E01");
+        assert(gdb.handle("G" + g) == "OK" && gdb.handle("g") == g);
+
+        // memory in bulk, hex and binary, wrapping at the top
+        auto image = gdb.handle("m0,10000");
+        assert(image.size() == 0x20000 && image.substr(0, 6) == "310000");
+        assert(gdb.handle("MFFFF,3:a1b2c3") == "OK");
+        assert((uint8_t)m.ram()[0xFFFF] == 0xA1 && (uint8_t)m.ram()[0x0000] == 0xB2 && (uint8_t)m.ram()[0x0001] == 0xC3);
+        assert(gdb.handle("mffff,3") == "a1b2c3");
+        assert(gdb.handle("M0,3:310000") == "OK");
+        std::string binary{ "\x01}\x03}]\x7F" };       // $01 # } $7F escaped
+        assert(gdb.handle("XF000,5:" + emu::z80_gdb_stub::unescape(binary)) == "E01");
+        assert(gdb.handle("XF000,4:" + emu::z80_gdb_stub::unescape(binary)) == "OK");
+        assert((uint8_t)m.ram()[0xF001] == 0x23 && (uint8_t)m.ram()[0xF002] == 0x7D);
+        assert(gdb.handle("xf000,4") == "b" + binary);
+        assert(gdb.handle("m10000,1") == "E01");
+
+        // a breakpoint stops on its PC before the instruction, continue steps off it
+        auto fill = program.symbol("fill");
+        assert(gdb.handle(std::format("Z0,{:x},1", fill)) == "OK");
+        assert(gdb.handle("c") == "S05" && (emu::address_t)m.registers().word(PC) == fill && m.registers().byte(B) == 4);
+        assert(gdb.handle("c") == "S05" && (emu::address_t)m.registers().word(PC) == fill && m.registers().byte(B) == 3);
+        assert(gdb.handle(std::format("z0,{:x},1", fill)) == "OK");
+        assert(gdb.handle("s") == "S05" && (emu::address_t)m.registers().word(PC) == fill + 1);
+
+        // a write watchpoint stops after the instruction that writes
+        auto flag = program.symbol("flag");
+        assert(gdb.handle(std::format("Z2,{:x},1", flag)) == "OK");
+        auto reply = gdb.handle("c");
+        if (verbose) std::cout << '\n' << reply;
+        assert(reply == std::format("T05watch:{:04x};", flag) && (uint8_t)m.ram()[flag] == 0x55);
+        assert((emu::address_t)m.registers().word(PC) == program.symbol("spin"));
+        assert(gdb.handle(std::format("z2,{:x},1", flag)) == "OK");
+        assert(gdb.handle("Z4,8000,2") == "OK" && m.flags(0x8001) & emu::PAGE_READ_WATCH);
+        assert(gdb.handle("z4,8000,2") == "OK" && !(m.flags(0x8001) & (emu::PAGE_READ_WATCH | emu::PAGE_WRITE_WATCH)));
+        assert(gdb.handle("Z5,0,1").empty());
+
+        // continue runs at full speed until the debugger interrupts
+        unsigned polls{ 0 };
+        auto before = m.cycles();
+        assert(gdb.handle("c", [&polls] { return ++polls == 20; }) == "S02" && gdb.handle("?") == "S02");
+        assert(m.cycles() - before >= 19'000'000);
+
+        assert(gdb.handle("D") == "OK" && !gdb.attached());
+
+        return true;
+    }
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+#include "test_harness.h"
+#include "z80_machine.h"
+
+namespace test_halt {
+
+    // a frame interrupt every 3251 T-states, deliberately not a multiple of 4, that the handler acknowledges with an OUT
+    void boot(emu::z80_machine& m, uint64_t& steps) {
+        test_harness::boot(m, R"(
+        IM 1
+        EI
+wait:   HALT
+        JR wait
+        ORG $0038
+        OUT ($FE),A
+        EI
+        RET
+)", steps);
+        m.on_out([&m](emu::address_t, emu::byte_t) { m.interrupt(false); });
+        test_harness::every(m, 3251, [](emu::z80_machine& m) { m.interrupt(true); });
+        m.run(100000);
+        m.events().clear();
+        m.on_out(nullptr);
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test HALT fast-forward...";
+
+        emu::z80_machine stepped, fast;
+        stepped.halt_fast_forward(false);
+        uint64_t stepped_steps{ 0 }, fast_steps{ 0 };
+        boot(stepped, stepped_steps);
+        boot(fast, fast_steps);
+
+        if (verbose) std::cout << fast.cycles() << ' ' << fast_steps << " instructions " << (int)fast.refresh_register() << '\n';
+        test_harness::same(stepped, fast);
+        assert(fast.control().halted && fast_steps == stepped_steps && fast_steps > 3 * 100000 / 3251);
+
+        // a read watchpoint where the halted CPU re-fetches fires with or without the fast-forward
+        for (bool on : { false, true }) {
+            emu::z80_machine m;
+            m.halt_fast_forward(on);
+            uint64_t steps{ 0 };
+            auto program = test_harness::boot(m, R"(
+        HALT
+after:  NOP
+)", steps);
+            auto after = program.symbol("after");
+            m.watch(after, emu::watch_t::read);
+            m.run(100000);
+            assert(m.control().halted && m.watch_hit() && m.watch_hit()->address == after);
+            assert(m.cycles() == 8 && (emu::address_t)m.registers().word(PC) == after);
+        }
+
+        // bit 7 of R is preserved
+        fast.refresh_register(0xFF);
+        fast.refresh(1);
+        assert(fast.refresh_register() == 0x80);
+        fast.refresh(0x7F);
+        assert(fast.refresh_register() == 0xFF && (uint8_t)fast.snapshot().byte(R) == 0xFF);
+        fast.refresh(2);
+        assert(fast.refresh_register() == 0x81 && fast.refresh_address() == 0x0081);
+
+        return true;
+    }
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include "z80_assembler.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+
+// what the fast path tests share: the program runs on the interpreting core, once stepped and once fast, and the two
+// machines must end in the same state
+namespace test_harness {
+
+    // clears memory, assembles the program into it and attaches the core, counting the instructions it steps
+    emu::z80_program boot(emu::z80_machine& m, const std::string& source, uint64_t& steps) {
+        m.ram().fill(0);
+        auto program = emu::z80_assembler::assemble(source, m.ram());
+        m.registers().word(SP) = (emu::word_t)0xFF00;
+        m.attach([core = emu::z80_core{}, &steps](emu::z80_machine& m) mutable { ++steps; core(m); });
+        return program;
+    }
+
+    // a device that acts every period T-states from the first period on
+    void every(emu::z80_machine& m, emu::cycle_t period, std::function<void(emu::z80_machine&)> device) {
+        struct tick_t {
+            emu::z80_machine* m;
+            emu::cycle_t period;
+            std::function<void(emu::z80_machine&)> device;
+            void operator()(emu::cycle_t t) {
+                device(*m);
+                m->events().schedule(t + period, *this);
+            }
+        };
+        m.events().schedule(m.cycles() + period, tick_t{ &m, period, std::move(device) });
+    }
+
+    // every register, MEMPTR, Q, R, the HALT state, the T-state count and every byte of memory
+    void same(emu::z80_machine& x, emu::z80_machine& y) {
+        assert(x.cycles() == y.cycles());
+        assert(std::memcmp(&x.snapshot(), &y.snapshot(), sizeof(emu::z80_registers_t)) == 0);
+        assert(x.refresh_register() == y.refresh_register());
+        assert(x.control().memptr == y.control().memptr && x.control().q == y.control().q);
+        assert(x.control().halted == y.control().halted);
+        assert(x.control().iff1 == y.control().iff1 && x.control().iff2 == y.control().iff2);
+        for (size_t a{ 0 }; a < x.ram().size(); ++a) {
+            assert(x.ram()[(emu::address_t)a] == y.ram()[(emu::address_t)a]);
+        }
+    }
+
+}
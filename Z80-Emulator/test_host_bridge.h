@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "emu_host_bridge.h"
+
+#endif
+
+namespace test_host_bridge {
+
+#if defined(__linux__)
+
+    // the host end of a channel, a Unix socket client or the pty slave
+    int attach(const emu::serial_channel& c, bool pty) {
+        if (pty) {
+            auto fd = open(c.path().c_str(), O_RDWR | O_NOCTTY);
+            termios tio{};
+            tcgetattr(fd, &tio);
+            cfmakeraw(&tio);
+            tcsetattr(fd, TCSANOW, &tio);
+            return fd;
+        }
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, c.path().c_str(), c.path().size() + 1);
+        auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        return connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0 ? fd : -1;
+    }
+
+    // what the host reads within the deadline
+    std::string host_read(int fd, size_t n, int milliseconds = 2000) {
+        std::string text;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+        while (text.size() < n && std::chrono::steady_clock::now() < deadline) {
+            pollfd p{ fd, POLLIN, 0 };
+            if (poll(&p, 1, 10) == 1) {
+                char buffer[256];
+                auto got = read(fd, buffer, std::min(sizeof(buffer), n - text.size()));
+                if (got > 0) text.append(buffer, (size_t)got);
+            }
+        }
+        return text;
+    }
+
+    // what the device receives within the deadline
+    std::string device_read(emu::serial_channel& c, size_t n, int milliseconds = 2000) {
+        std::string text;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+        emu::byte_t b;
+        while (text.size() < n && std::chrono::steady_clock::now() < deadline) {
+            if (c.receive(b)) text += (char)b;
+            else std::this_thread::yield();
+        }
+        return text;
+    }
+
+#endif
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test host bridge...";
+
+#if defined(__linux__)
+
+        emu::host_bridge bridge;
+        std::vector<emu::serial_channel*> channels{
+            &bridge.open_unix_socket(std::format("/tmp/emu_bridge_test_{}_a", getpid())),
+            &bridge.open_unix_socket(std::format("/tmp/emu_bridge_test_{}_b", getpid())),
+            &bridge.open_pty()
+        };
+        assert(bridge.channel_count() == 3);
+        std::vector<int> hosts;
+        for (size_t i{ 0 }; i < channels.size(); ++i) {
+            hosts.push_back(attach(*channels[i], i == 2));
+            assert(hosts.back() >= 0);
+        }
+
+        // host to device, which also tells the socket channels are connected
+        for (size_t i{ 0 }; i < channels.size(); ++i) {
+            auto hello = std::format("hello {}", i);
+            auto written = write(hosts[i], hello.data(), hello.size());
+            assert(written == (ssize_t)hello.size());
+            assert(device_read(*channels[i], hello.size()) == hello);
+        }
+
+        // device to host a byte at a time with pauses, every push after the bridge has gone idle must wake it
+        for (int round{ 0 }; round < 50; ++round) {
+            for (size_t i{ 0 }; i < channels.size(); ++i) {
+                assert(channels[i]->transmit((emu::byte_t)('a' + round % 26)));
+            }
+            for (size_t i{ 0 }; i < channels.size(); ++i) {
+                assert(host_read(hosts[i], 1) == std::string(1, (char)('a' + round % 26)));
+            }
+            if (round % 5 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // bursts with pushes microseconds apart race the bridge as it drains, the last byte of each must arrive
+        std::mt19937 rand{ 76 };
+        auto spin = [](unsigned ns) {
+            auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+            while (std::chrono::steady_clock::now() < until) {}
+        };
+        for (int burst{ 0 }; burst < 2000; ++burst) {
+            auto n = 1 + rand() % 4;
+            for (unsigned i{ 0 }; i < n; ++i) {
+                assert(channels[0]->transmit((emu::byte_t)('A' + i)));
+                spin(rand() % 20000);
+            }
+            assert(host_read(hosts[0], n, 500).size() == n);
+        }
+
+        // the device echoes every channel at once, bytes arrive complete and in order
+        std::string block;
+        for (int i{ 0 }; i < 3000; ++i) block += (char)('0' + i % 10);
+        std::vector<std::thread> hosts_writing;
+        for (size_t i{ 0 }; i < channels.size(); ++i) {
+            hosts_writing.emplace_back([&, i] {
+                for (size_t at{ 0 }; at < block.size(); ) {
+                    auto n = write(hosts[i], block.data() + at, std::min<size_t>(500, block.size() - at));
+                    if (n > 0) at += (size_t)n;
+                }
+            });
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        std::vector<size_t> sent(channels.size(), 0);
+        std::vector<std::string> heard(channels.size());
+        for (bool done{ false }; !done && std::chrono::steady_clock::now() < deadline; ) {
+            done = true;
+            for (size_t i{ 0 }; i < channels.size(); ++i) {
+                emu::byte_t b;
+                while (channels[i]->tx_ready() && channels[i]->receive(b)) {
+                    channels[i]->transmit(b);
+                    ++sent[i];
+                }
+                pollfd p{ hosts[i], POLLIN, 0 };
+                if (poll(&p, 1, 0) == 1) {
+                    char buffer[1024];
+                    auto got = read(hosts[i], buffer, sizeof(buffer));
+                    if (got > 0) heard[i].append(buffer, (size_t)got);
+                }
+                done = done && heard[i].size() == block.size();
+            }
+        }
+        for (auto& t : hosts_writing) {
+            t.join();
+        }
+        for (size_t i{ 0 }; i < channels.size(); ++i) {
+            assert(sent[i] == block.size() && heard[i] == block);
+        }
+
+        // a socket host that hangs up while the device transmits is dropped, not a SIGPIPE for the process
+        close(hosts[1]);
+        for (int i{ 0 }; i < 100; ++i) {
+            channels[1]->transmit((emu::byte_t)'x');
+            if (i % 10 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        assert(channels[0]->transmit((emu::byte_t)'!') && host_read(hosts[0], 1) == "!");
+        close(hosts[0]);
+        close(hosts[2]);
+        if (verbose) std::cout << std::format("\n{} channels, {} bytes echoed on each ", channels.size(), block.size());
+
+#endif
+
+        return true;
+    }
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+#include "test_harness.h"
+#include "z80_loop_idioms.h"
+#include "z80_machine.h"
+
+namespace test_loop_idioms {
+
+    // events cut the loops short now and then, returns the number of instructions the core stepped
+    uint64_t boot(emu::z80_machine& m, emu::cycle_t until) {
+        uint64_t steps{ 0 };
+        test_harness::boot(m, R"(
+        LD HL,$1000
+        LD DE,$2000
+        LD BC,$0300
+copy:   LD A,(HL)
+        INC HL
+        LD (DE),A
+        INC DE
+        DEC BC
+        LD A,B
+        OR C
+        JR NZ,copy
+        LD B,0
+fill:   LD (HL),$E5
+        INC HL
+        DJNZ fill
+        LD A,$5A
+        LD B,$40
+fillde: LD (DE),A
+        INC DE
+        DJNZ fillde
+        LD H,$C9
+        LD L,0
+        LD D,0
+        LD E,$B7
+        LD B,8
+mul:    ADD HL,HL
+        JR NC,skip
+        ADD HL,DE
+skip:   DJNZ mul
+        LD A,$F3
+        LD HL,0
+        LD DE,$0021
+        LD B,8
+mula:   ADD HL,HL
+        RLA
+        JR NC,skipa
+        ADD HL,DE
+skipa:  DJNZ mula
+        LD ($5000),HL
+        LD H,$C8         ; the last multiplier bit is 0, MEMPTR is left by JR NC
+        LD L,0
+        LD DE,$00B7
+        LD B,8
+mul0:   ADD HL,HL
+        JR NC,skip0
+        ADD HL,DE
+skip0:  DJNZ mul0
+        LD ($5006),HL
+        LD HL,$2000
+        LD BC,0
+find:   LD A,(HL)
+        CP $76
+        INC HL
+        DEC BC
+        JR NZ,find
+        LD ($5002),HL
+        LD ($5004),BC
+        LD HL,$2000
+scan:   LD A,(HL)
+        INC HL
+        CP E
+        JR NZ,scan
+        LD A,$E5
+        LD HL,$2000
+seek:   CP (HL)
+        INC HL
+        JR NZ,seek
+        DEC HL
+once:   CP (HL)          ; matches at once, MEMPTR is left as it was
+        INC HL
+        JR NZ,once
+        HALT
+)", steps);
+        for (emu::address_t i{ 0 }; i < 0x300; ++i) {
+            m.ram()[(emu::address_t)(0x1000 + i)] = (emu::byte_t)(i * 0x35 + 7);
+        }
+        test_harness::every(m, 4999, [](emu::z80_machine& m) { ++m.ram()[0x4000]; });
+        m.run(until);
+        m.events().clear();
+        return steps;
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test loop idioms...";
+
+        auto peek = [](const uint8_t* bytes) { return [bytes](emu::address_t a) { return (emu::byte_t)bytes[a]; }; };
+
+        const uint8_t copy[] = { 0x7E, 0x23, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF7 };
+        auto idiom = emu::detect_loop_idiom(peek(copy), 0);
+        assert(idiom && idiom->kind == emu::loop_idiom::kind_t::copy && idiom->branch == 7 && idiom->end == 9);
+        const uint8_t fill[] = { 0x73, 0x23, 0x10, 0xFC };
+        idiom = emu::detect_loop_idiom(peek(fill), 0);
+        assert(idiom && idiom->kind == emu::loop_idiom::kind_t::fill && idiom->source == E && idiom->pointer == H);
+        const uint8_t mul[] = { 0x29, 0x17, 0x30, 0x01, 0x19, 0x10, 0xF9 };
+        idiom = emu::detect_loop_idiom(peek(mul), 0);
+        assert(idiom && idiom->kind == emu::loop_idiom::kind_t::multiply && idiom->rla);
+        const uint8_t elsewhere[] = { 0x77, 0x23, 0x10, 0xFA };       // DJNZ not to the head
+        assert(!emu::detect_loop_idiom(peek(elsewhere), 0));
+        const uint8_t search[] = { 0x7E, 0x23, 0xFE, 0x76, 0x20, 0xFA };
+        idiom = emu::detect_loop_idiom(peek(search), 0);
+        assert(idiom && idiom->kind == emu::loop_idiom::kind_t::search && idiom->load && !idiom->counted);
+        assert(idiom->source == -1 && idiom->value == 0x76 && idiom->tstates == 32 && idiom->m1 == 4);
+        const uint8_t seek[] = { 0xBE, 0x23, 0x0B, 0x20, 0xFB };
+        idiom = emu::detect_loop_idiom(peek(seek), 0);
+        assert(idiom && idiom->kind == emu::loop_idiom::kind_t::search && !idiom->load && idiom->counted);
+        assert(idiom->tstates == 31 && idiom->m1 == 4);
+        const uint8_t counted_c[] = { 0x7E, 0xB9, 0x23, 0x0B, 0x20, 0xFA };  // CP C against the count
+        assert(!emu::detect_loop_idiom(peek(counted_c), 0));
+
+        emu::z80_machine stepped, fast;
+        stepped.loop_idioms(false);
+        stepped.superinstruction_fusion(false);
+        auto stepped_steps = boot(stepped, 100000);
+        auto fast_steps = boot(fast, 100000);
+        assert(stepped.control().halted);
+        test_harness::same(stepped, fast);
+        assert((uint8_t)fast.ram()[0x5000] == (0xF3 * 0x21 & 0xFF) && (uint8_t)fast.ram()[0x5001] == 0xF3 * 0x21 >> 8);
+        assert((uint8_t)fast.ram()[0x5002] == 0x94 && (uint8_t)fast.ram()[0x5003] == 0x20);
+        assert((uint8_t)fast.ram()[0x5004] == 0x6C && (uint8_t)fast.ram()[0x5005] == 0xFF);
+        assert(((uint8_t)fast.ram()[0x5007] << 8 | (uint8_t)fast.ram()[0x5006]) == 0xC8 * 0xB7);
+        assert(emu::get_pair(fast.registers(), H) == 0x2027);
+        assert(fast.dispatch_stats().idioms > 0 && fast_steps * 20 < stepped_steps);
+
+        if (verbose) {
+            std::cout << '\n' << stepped_steps << " core steps down to " << fast_steps << " and "
+                << fast.dispatch_stats().idioms << " idioms (" << fast.dispatch_stats().idiom_iterations << " iterations)\n";
+        }
+
+        // a ROM destination falls back to stepping
+        emu::z80_machine stepped_rom, fast_rom;
+        stepped_rom.loop_idioms(false);
+        stepped_rom.protect(0x2000, 0x20FF);
+        fast_rom.protect(0x2000, 0x20FF);
+        boot(stepped_rom, 100000);
+        boot(fast_rom, 100000);
+        assert(stepped_rom.control().halted);
+        test_harness::same(stepped_rom, fast_rom);
+
+        // so does a search over a read watched page, and both stop on the watched read
+        emu::z80_machine stepped_watch, fast_watch;
+        stepped_watch.loop_idioms(false);
+        stepped_watch.watch(0x2050, emu::watch_t::read);
+        fast_watch.watch(0x2050, emu::watch_t::read);
+        boot(stepped_watch, 100000);
+        boot(fast_watch, 100000);
+        assert(stepped_watch.watch_hit() && stepped_watch.watch_hit()->address == 0x2050);
+        assert(fast_watch.watch_hit() && fast_watch.watch_hit()->address == 0x2050);
+        test_harness::same(stepped_watch, fast_watch);
+
+        return true;
+    }
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "emu_memory.h"
+#include "emu_memory_search.h"
+#include "z80_machine.h"
+
+namespace test_memory_search {
+
+    bool throws(const std::string& text) {
+        try {
+            emu::memory_pattern p(text);
+        }
+        catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    }
+
+    // every offset the pattern matches one byte at a time
+    std::vector<uint32_t> naive(const emu::byte_t* data, size_t size, const emu::memory_pattern& pattern) {
+        std::vector<uint32_t> found;
+        for (size_t offset{ 0 }; offset + pattern.size() <= size; ++offset) {
+            if (pattern.matches((const uint8_t*)data + offset)) found.push_back((uint32_t)offset);
+        }
+        return found;
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test memory search...";
+
+        assert(throws(""));
+        assert(throws("3E ?"));
+        assert(throws("3E 0G"));
+        assert(throws("3 E"));
+        assert(emu::memory_pattern("3E??C9").size() == 3 && emu::memory_pattern("?? ?? 3E").anchor() == 2);
+
+        // wildcards, the first and last offsets and an all wildcard pattern
+        emu::memory<0x100> page(0x4000, 0);
+        page[0x4000] = (emu::byte_t)0x3E;
+        page[0x4002] = (emu::byte_t)0xC9;
+        page[0x4080] = (emu::byte_t)0x3E;
+        page[0x4081] = (emu::byte_t)0x55;
+        page[0x4082] = (emu::byte_t)0xC9;
+        page[0x40FD] = (emu::byte_t)0x3E;
+        page[0x40FF] = (emu::byte_t)0xC9;
+        assert((emu::memory_search::find(page, emu::memory_pattern("3E ?? C9")) == std::vector<emu::address_t>{ 0x4000, 0x4080, 0x40FD }));
+        assert((emu::memory_search::find(page, emu::memory_pattern("3E 55 C9")) == std::vector<emu::address_t>{ 0x4080 }));
+        assert(emu::memory_search::find(page, emu::memory_pattern("?? ?? ??")).size() == 0xFE);
+        assert(emu::memory_search::find(page, emu::memory_pattern("C9 ??")).size() == 2);
+        assert(emu::memory_search::find(page, emu::memory_pattern({ 0x30, 0x00, 0xC9 }, { 0xF0, 0x00, 0xFF })).size() == 3);
+
+        // the vector search finds what the byte at a time search does in random memory, long patterns included
+        emu::memory<0x10000> random(0);
+        random.randomize(0, 3);
+        for (auto text : { "01", "01 ?? 02", "?? 03 ?? ?? 00", "00 01 02 03 ?? 00 01 02 03 ?? 00 01 02 03 ?? 00 01", "?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? 02" }) {
+            emu::memory_pattern pattern(text);
+            assert(emu::memory_search::find(random.data(), 0x10000, pattern) == naive(random.data(), 0x10000, pattern));
+            assert(emu::memory_search::find(random.data() + 5, 0x1000 - 7, pattern) == naive(random.data() + 5, 0x1000 - 7, pattern));
+        }
+
+        // a lives counter that goes down from frame to frame while the rest of memory churns
+        emu::memory<0x10000> ram(0);
+        ram[0x7123] = 9;
+        emu::memory_candidates candidates(ram);
+        assert(candidates.size() == 0x10000);
+        for (emu::byte_t lives{ 8 }; lives > 5; --lives) {
+            ram.randomize();
+            ram[0x7123] = lives;
+            candidates.narrow(ram, emu::memory_candidates::relation_t::decreased);
+        }
+        ram.randomize();
+        ram[0x7123] = 6;
+        candidates.narrow(ram, emu::memory_candidates::relation_t::unchanged);
+        candidates.narrow(ram, emu::memory_candidates::relation_t::equal, 6);
+        assert(candidates.test(0x7123));
+        assert(candidates.size() == candidates.addresses().size() && candidates.size() < 4);
+        for (auto addr : candidates.addresses()) assert(ram[addr] == 6);
+
+        emu::memory<100> odd(0x8000, 1);
+        emu::memory_candidates few(odd);
+        odd[0x8063] = 2;
+        assert(few.narrow(odd, emu::memory_candidates::relation_t::increased) == 1 && few.addresses()[0] == 0x8063);
+        assert(few.narrow(odd, emu::memory_candidates::relation_t::greater, 2) == 0);
+
+        // every instance of a farm searched, the time taken is reported when verbose
+        std::vector<emu::z80_machine> farm(1000);
+        const std::vector<uint8_t> routine{ 0x21, 0x00, 0x40, 0x11, 0x01, 0x40, 0x01, 0xFF, 0x00, 0xED, 0xB0, 0xC9 };
+        for (size_t i{ 0 }; i < farm.size(); ++i) {
+            farm[i].write_block((emu::address_t)(0x1000 + i * 61), (const char*)routine.data(), routine.size());
+        }
+        emu::memory_pattern pattern("21 ?? ?? 11 ?? ?? 01 ?? ?? ED B0 C9");
+        auto start = std::chrono::steady_clock::now();
+        auto found = emu::memory_search::find_each(farm, pattern);
+        std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+        if (verbose) std::cout << std::format("\n1000 machines searched in {:.1f} ms ", ms.count());
+        for (size_t i{ 0 }; i < farm.size(); ++i) {
+            bool planted{ false };
+            for (auto addr : found[i]) planted |= addr == 0x1000 + i * 61;
+            assert(planted);
+        }
+
+        return true;
+    }
+
+}
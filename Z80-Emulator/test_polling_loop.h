@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "test_harness.h"
+#include "z80_machine.h"
+#include "z80_polling_loop.h"
+
+namespace test_polling_loop {
+
+    // a device counts frames every 3251 T-states
+    void boot(emu::z80_machine& m, uint64_t& steps, emu::cycle_t until) {
+        test_harness::boot(m, R"(
+wait1:  LD A,($4000)
+        AND $01
+        JR Z,wait1
+wait0:  LD A,($4000)
+        AND $01
+        JR NZ,wait0
+        JR wait1
+)", steps);
+        test_harness::every(m, 3251, [](emu::z80_machine& m) { ++m.ram()[0x4000]; });
+        m.run(until);
+        m.events().clear();
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test polling loop fast-forward...";
+
+        auto peek = [](const emu::byte_t* bytes) { return [bytes](emu::address_t a) { return bytes[a]; }; };
+
+        const emu::byte_t frames[] = { 0x3A, 0x00, 0x40, (emu::byte_t)0xE6, 0x01, 0x28, (emu::byte_t)0xF9 };
+        auto loop = emu::detect_polling_loop(peek(frames), 0);
+        assert(loop && loop->branch == 5 && loop->end == 7);
+        assert(loop->tstates == 13 + 7 + 12 && loop->m1 == 3);
+        assert(loop->source == emu::polling_loop::source_t::absolute && loop->address == 0x4000);
+
+        const emu::byte_t key[] = { (emu::byte_t)0xDB, (emu::byte_t)0xFE, 0x1F, 0x38, (emu::byte_t)0xFB };     // IN A,($FE) RRA JR C
+        assert(!emu::detect_polling_loop(peek(key), 0));                // RRA depends on the carry coming in
+
+        const emu::byte_t bit[] = { (emu::byte_t)0xFD, (emu::byte_t)0xCB, 0x3B, 0x7E, (emu::byte_t)0xCA, 0x00, 0x00 };  // BIT 7,(IY+$3B) JP Z
+        loop = emu::detect_polling_loop(peek(bit), 0);
+        assert(loop && loop->source == emu::polling_loop::source_t::iy && loop->displacement == 0x3B && loop->tstates == 30);
+
+        const emu::byte_t store[] = { 0x3A, 0x00, 0x40, 0x32, 0x01, 0x40, 0x28, (emu::byte_t)0xF8 };         // LD ($4001),A
+        assert(!emu::detect_polling_loop(peek(store), 0));
+
+        emu::z80_machine stepped, fast;
+        stepped.polling_fast_forward(false);
+        uint64_t stepped_steps{ 0 }, fast_steps{ 0 };
+        boot(stepped, stepped_steps, 1000000);
+        boot(fast, fast_steps, 1000000);
+
+        if (verbose) std::cout << stepped_steps << " steps down to " << fast_steps << '\n';
+        test_harness::same(stepped, fast);
+        assert(fast_steps * 10 < stepped_steps);
+
+        // a loop entered at its test runs once from the head before it is skipped, the value polled then ends it
+        const char* entered_at_test = R"(
+        LD A,$01
+        LD ($4000),A
+        XOR A
+        JR test
+wait:   LD A,($4000)
+test:   AND $01
+        JR Z,wait
+done:   HALT
+)";
+        emu::z80_machine stepped_entry, fast_entry;
+        stepped_entry.polling_fast_forward(false);
+        auto program = test_harness::boot(stepped_entry, entered_at_test, stepped_steps);
+        test_harness::boot(fast_entry, entered_at_test, fast_steps);
+        stepped_entry.run(10000);
+        fast_entry.run(10000);
+        test_harness::same(stepped_entry, fast_entry);
+        assert(fast_entry.control().halted && (emu::address_t)fast_entry.registers().word(PC) == program.symbol("done") + 1);
+
+        return true;
+    }
+
+}
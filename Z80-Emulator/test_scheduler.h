@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cassert>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "emu_async_disk.h"
+#include "emu_memory.h"
+#include "emu_scheduler.h"
+#include "z80_assembler.h"
+#include "z80_core.h"
+#include "z80_disk_controller.h"
+
+namespace test_scheduler {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test scheduler...";
+
+        emu::scheduler events;
+        std::vector<int> order;
+
+        assert(events.next_event() == emu::scheduler::NEVER);
+        events.schedule(300, [&](emu::cycle_t t) { order.push_back(3); assert(t == 300); });
+        events.schedule(100, [&](emu::cycle_t) { order.push_back(1); });
+        auto id = events.schedule(200, [&](emu::cycle_t) { order.push_back(-1); });
+        events.schedule(100, [&](emu::cycle_t) {
+            order.push_back(2);                                                     // same cycle, scheduled second
+            events.schedule_in(50, [&](emu::cycle_t t) { order.push_back(4); assert(t == 150); });
+        });
+        assert(events.next_event() == 100);
+        assert(events.cancel(id));
+        assert(!events.cancel(id));
+        assert(events.service(99) == 0);
+        assert(events.service(250) == 3);
+        assert(events.next_event() == 300);
+        events.service(1000);
+        assert((order == std::vector<int>{ 1, 2, 4, 3 }));
+        assert(events.empty());
+
+        // disk image reads complete as events at the requested cycle
+        try {
+            const emu::memory<8192> rom(0, "zx81-v2.rom");
+            emu::async_disk disk("zx81-v2.rom");
+            std::vector<emu::byte_t> sector(256);
+            size_t transferred{ 0 };
+            emu::cycle_t completed{ 0 };
+            disk.read(0x100, sector.data(), sector.size(), 1200, [&](emu::cycle_t t, size_t n) {
+                completed = t;
+                transferred = n;
+            });
+            disk.complete(events);
+            assert(events.next_event() == 1200);
+            events.service(1200);
+            if (verbose) std::cout << transferred << " bytes at cycle " << completed << '\n';
+            assert(transferred == sector.size() && completed == 1200);
+            for (size_t i{ 0 }; i < sector.size(); ++i) {
+                assert(sector[i] == rom[(emu::address_t)(0x100 + i)]);
+            }
+            // past the end of the image is a short transfer
+            disk.read(8192 - 16, sector.data(), sector.size(), 0, [&](emu::cycle_t, size_t n) { transferred = n; });
+            disk.complete(events);
+            events.service(events.now());
+            assert(transferred == 16);
+        }
+        catch (std::exception& e) {
+            std::cout << e.what() << '\n';
+            return false;
+        }
+
+        // a program reads sector 3 and writes it back as sector 5, polling the controller's status in between, its
+        // breakpoint off the polling loop's page which the fast paths would decline
+        auto image = std::filesystem::temp_directory_path() / "emu_disk_controller_test.img";
+        {
+            std::ofstream f(image, std::ios::binary);
+            for (size_t i{ 0 }; i < 8 * emu::z80_disk_controller::SECTOR_SIZE; ++i) {
+                f.put((char)(i * 7 + i / emu::z80_disk_controller::SECTOR_SIZE));
+            }
+        }
+        const char* source = R"(
+        ORG 0
+        LD SP,0
+        LD A,3
+        OUT ($E0),A
+        XOR A
+        OUT ($E1),A
+        OUT ($E2),A
+        LD A,$80
+        OUT ($E3),A
+        LD A,1
+        OUT ($E4),A
+read:   IN A,($E4)
+        AND $80
+        JR NZ,read
+        LD A,5
+        OUT ($E0),A
+        LD A,2
+        OUT ($E4),A
+write:  IN A,($E4)
+        AND $80
+        JR NZ,write
+        JP done
+        ORG $0100
+done:   HALT
+)";
+        try {
+            // skipping the polls and stepping them reach the end on the same cycle, with the same state
+            std::vector<emu::cycle_t> ends;
+            std::vector<uint64_t> dispatched;
+            for (bool fast : { true, false }) {
+                emu::z80_machine m;
+                m.ram().fill(0);
+                auto program = emu::z80_assembler::assemble(source, m.ram());
+                m.attach(emu::z80_core{});
+                m.polling_fast_forward(fast);
+                m.set_breakpoint(program.symbol("done"));
+                emu::z80_disk_controller controller(m, image.string(), 0xE0, 50000);
+                m.run(1'000'000);
+                assert(m.breakpoint_hit() && controller.transfers() == 2 && controller.status() == 0);
+                for (size_t i{ 0 }; i < emu::z80_disk_controller::SECTOR_SIZE; ++i) {
+                    auto at = 3 * emu::z80_disk_controller::SECTOR_SIZE + i;
+                    assert((uint8_t)m.ram()[(emu::address_t)(0x8000 + i)] == (uint8_t)(at * 7 + at / emu::z80_disk_controller::SECTOR_SIZE));
+                }
+                ends.push_back(m.cycles());
+                dispatched.push_back(m.dispatch_stats().core);
+            }
+            if (verbose) std::cout << std::format("\nsectors at T-state {}, {} instructions polling skipped, {} stepped ", ends[0], dispatched[0], dispatched[1]);
+            assert(ends[0] == ends[1] && ends[0] > 2 * 50000);
+            assert(dispatched[0] < 50 && dispatched[1] > 2 * 50000 / 30);
+            std::ifstream f(image, std::ios::binary);
+            std::vector<char> bytes(8 * emu::z80_disk_controller::SECTOR_SIZE);
+            f.read(bytes.data(), bytes.size());
+            for (size_t i{ 0 }; i < emu::z80_disk_controller::SECTOR_SIZE; ++i) {
+                assert(bytes[5 * emu::z80_disk_controller::SECTOR_SIZE + i] == bytes[3 * emu::z80_disk_controller::SECTOR_SIZE + i]);
+            }
+            f.close();
+            std::filesystem::remove(image);
+        }
+        catch (std::exception& e) {
+            std::cout << e.what() << '\n';
+            return false;
+        }
+
+        return true;
+    }
+
+}
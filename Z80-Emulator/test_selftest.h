@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "z80_core.h"
+#include "z80_machine.h"
+#include "z80_selftest.h"
+
+namespace test_selftest {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test Z80 core self test programs...";
+
+        using emu::z80_selftest;
+
+        emu::cycle_t tstates{ 0 };
+        double seconds{ 0 };
+        for (const auto& result : z80_selftest::run_all()) {
+            if (verbose || !result.passed) {
+                std::cout << std::format("\n{:<32} {} CRC {:04X} expected {:04X} {} T-states {:.1f}MHz", result.name,
+                    result.passed ? "pass" : "FAIL", result.crc, result.expected, result.tstates, result.mhz());
+            }
+            assert(result.passed);
+            tstates += result.tstates;
+            seconds += result.seconds;
+        }
+        if (verbose) std::cout << std::format("\n{} T-states at {:.1f}MHz emulated\n", tstates, tstates / seconds / 1e6);
+
+        // a core that gets one instruction wrong fails its group and only its group
+        emu::z80_core core;
+        auto broken = [core](emu::z80_machine& m) mutable {
+            auto pc = (emu::address_t)m.registers().word(PC);
+            if (m.ram()[pc] == (emu::byte_t)0x2F) {                         // CPL forgets the half carry
+                core(m);
+                m.registers().byte(F) &= ~HALF_CARRY;
+                return;
+            }
+            core(m);
+        };
+        const auto& groups = z80_selftest::groups();
+        auto daa = std::find_if(groups.begin(), groups.end(), [](const auto& g) { return std::string(g.name) == "DAA CPL NEG SCF CCF"; });
+        assert(daa != groups.end());
+        auto failed = z80_selftest::run(*daa, broken);
+        assert(!failed.passed && failed.crc != failed.expected && failed.tstates < z80_selftest::BUDGET);
+        assert(z80_selftest::run(groups.front(), broken).passed);
+
+        return true;
+    }
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+#include <thread>
+
+#include "emu_spsc_ring.h"
+
+namespace test_spsc_ring {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test SPSC ring...";
+
+        emu::spsc_ring<8> ring;
+        emu::byte_t b;
+
+        assert(ring.empty());
+        assert(!ring.pop(b));
+        for (emu::byte_t i{ 0 }; i < 8; ++i) {
+            assert(ring.push(i));
+        }
+        assert(!ring.push(8));
+        assert(ring.available() == 8);
+        assert(ring.pop(b) && b == 0);
+        assert(ring.push(8));
+
+        emu::byte_t buffer[16];
+        assert(ring.peek(buffer, 16) == 8);
+        assert(buffer[0] == 1 && buffer[7] == 8);
+        ring.skip(3);
+        assert(ring.pop(buffer, 16) == 5);
+        assert(buffer[0] == 4 && buffer[4] == 8);
+        assert(ring.empty());
+
+        // producer and consumer on different threads, bytes arrive complete and in order
+        constexpr size_t COUNT = 1 << 20;
+        emu::spsc_ring<1024> pipe;
+        std::thread producer([&pipe] {
+            for (size_t i{ 0 }; i < COUNT; ) {
+                if (pipe.push((emu::byte_t)i)) ++i;
+            }
+        });
+        size_t errors{ 0 };
+        for (size_t i{ 0 }; i < COUNT; ) {
+            if (pipe.pop(b)) {
+                if (b != (emu::byte_t)i) ++errors;
+                ++i;
+            }
+        }
+        producer.join();
+        if (verbose) std::cout << COUNT << " bytes " << errors << " errors\n";
+        assert(errors == 0);
+
+        return true;
+    }
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <iostream>
+
+#include "emu_page_hashes.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+
+namespace test_state_hash {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test state hashing...";
+
+        // the hash of bytes sees every byte and its length
+        uint8_t bytes[100]{};
+        auto h = emu::hash_bytes(bytes, sizeof(bytes));
+        assert(h != emu::hash_bytes(bytes, sizeof(bytes) - 1));
+        bytes[99] = 1;
+        assert(h != emu::hash_bytes(bytes, sizeof(bytes)));
+        bytes[99] = 0;
+        assert(h == emu::hash_bytes(bytes, sizeof(bytes)));
+
+        emu::z80_machine m;
+        m.ram().fill(0);
+        m.load("zx81-v2.rom", 0);
+        m.protect(0x0000, 0x1FFF);
+        m.attach(emu::z80_core{});
+        m.run(3'000'000);
+        auto boot = m.hash();
+        assert(m.rehashed_pages() == emu::PAGE_COUNT);
+
+        // a copy is the same state, whatever the T-states, until a byte or a register differs
+        emu::z80_machine other(m);
+        other.tick(100);
+        assert(other.hash() == boot && other.rehashed_pages() == 0);
+        other.write(0x4100, (emu::byte_t)(m.ram()[0x4100] + 1));
+        assert(other.hash() != boot && other.rehashed_pages() == 1);
+        other.write(0x4100, m.ram()[0x4100]);
+        assert(other.hash() == boot);
+        other.registers().byte(SHADOW + E) ^= 1;
+        assert(other.hash() != boot);
+        other.registers().byte(SHADOW + E) ^= 1;
+        other.control().iff2 = !other.control().iff2;
+        assert(other.hash() != boot);
+
+        // a write through ram() is seen once touched
+        emu::z80_machine host(m);
+        host.ram()[0x7000] = (emu::byte_t)(host.ram()[0x7000] + 1);
+        assert(host.hash() == boot);
+        host.touch(0x7000);
+        assert(host.hash() != boot);
+
+        // a frame dirties a few pages and only those are rehashed, to the hash of them all
+        m.run(m.cycles() + 65'000);
+        auto start = std::chrono::steady_clock::now();
+        auto frame = m.hash();
+        std::chrono::duration<double, std::nano> incremental = std::chrono::steady_clock::now() - start;
+        auto dirty = m.rehashed_pages();
+        emu::z80_machine full(m);
+        full.touch(0, 0x10000);
+        start = std::chrono::steady_clock::now();
+        assert(full.hash() == frame);
+        std::chrono::duration<double, std::nano> whole = std::chrono::steady_clock::now() - start;
+        if (verbose) std::cout << std::format("\n{} dirty pages a frame rehashed in {:.0f} ns, all 256 in {:.0f} ns ", dirty, incremental.count(), whole.count());
+        assert(dirty > 0 && dirty < 16);
+
+        return true;
+    }
+
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+#include "emu_contention.h"
+#include "test_harness.h"
+#include "z80_machine.h"
+#include "z80_superinstructions.h"
+
+namespace test_superinstructions {
+
+    // events land inside fusable groups now and then, returns the number of instructions the core stepped
+    uint64_t boot(emu::z80_machine& m, emu::cycle_t until) {
+        uint64_t steps{ 0 };
+        test_harness::boot(m, R"(
+        LD HL,$1000
+        LD DE,$2000
+        LD BC,$0100
+copy:   LD A,(HL)
+        INC HL
+        LD (DE),A
+        INC DE
+        DEC BC
+        LD A,B
+        OR C
+        JR NZ,copy
+        LD HL,$2000
+        LD B,$80
+count:  LD A,(HL)
+        INC HL
+        CP $55
+        JR NZ,skip
+        INC E
+skip:   DEC B
+        JR NZ,count
+        LD E,(HL)
+        INC HL
+        LD D,(HL)
+        OR A
+        JR Z,done
+        AND A
+done:   HALT
+)", steps);
+        for (emu::address_t i{ 0 }; i < 0x100; ++i) {
+            m.ram()[(emu::address_t)(0x1000 + i)] = (emu::byte_t)(i * 0x35);
+        }
+        m.loop_idioms(false);
+        test_harness::every(m, 333, [](emu::z80_machine& m) { ++m.ram()[0x3000]; });
+        m.run(until);
+        m.events().clear();
+        return steps;
+    }
+
+    // copy and count loops over 16K with no events, fused or not, in millions of instructions a second
+    double benchmark(bool fused, uint64_t& instructions) {
+        emu::z80_machine m;
+        m.superinstruction_fusion(fused);
+        m.loop_idioms(false);
+        uint64_t steps{ 0 };
+        test_harness::boot(m, R"(
+again:  LD HL,$8000
+        LD DE,$C000
+        LD BC,$4000
+copy:   LD A,(HL)
+        INC HL
+        LD (DE),A
+        INC DE
+        DEC BC
+        LD A,B
+        OR C
+        JR NZ,copy
+        LD HL,$C000
+        LD B,0
+count:  LD A,(HL)
+        INC HL
+        CP $55
+        JR NZ,skip
+        INC E
+skip:   DEC B
+        JR NZ,count
+        JR again
+)", steps);
+        auto start = std::chrono::steady_clock::now();
+        m.run(50'000'000);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        instructions = m.dispatch_stats().core + m.dispatch_stats().fused_instructions;
+        return instructions / elapsed.count() / 1e6;
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test superinstructions...";
+
+        using fusion_t = emu::z80_machine::fusion_t;
+
+        const uint8_t pair[] = { 0xFE, 0x3A, 0x28, 0x04 };
+        auto s = fusion_t::match(pair);
+        assert(s && std::strcmp(s->name, "CP n / JR Z,e") == 0 && s->last == 2);
+        const uint8_t none[] = { 0xFE, 0x3A, 0x38, 0x04 };
+        assert(!fusion_t::match(none));
+
+        emu::z80_machine stepped, fused;
+        stepped.superinstruction_fusion(false);
+        stepped.pair_profile(true);
+        auto stepped_steps = boot(stepped, 40000);
+        auto fused_steps = boot(fused, 40000);
+        assert(stepped.control().halted);
+        test_harness::same(stepped, fused);
+        const auto& stats = fused.dispatch_stats();
+        assert(stats.core == fused_steps && stepped.dispatch_stats().fused == 0);
+        assert(stats.core + stats.fused_instructions == stepped_steps);
+        assert(stats.fused > 0);
+
+        if (verbose) {
+            std::cout << '\n' << stepped_steps << " dispatches down to " << stats.core + stats.fused
+                << " (" << stats.fused << " fused, " << stats.fused_instructions << " instructions)\n";
+        }
+
+        // dynamic profile, the loops' pairs come first and the catalogue fuses them
+        auto hottest = fusion_t::hottest(stepped.pair_profile(), 4);
+        assert(hottest.size() == 4);
+        for (const auto& pair : hottest) {
+            if (verbose) std::cout << std::format("{:02X} {:02X} {} {}\n", pair.first, pair.second, pair.count, pair.fused ? pair.fused : "-");
+            assert(pair.count >= 0x100);
+        }
+        assert(hottest[0].fused && std::strcmp(hottest[0].fused, "LD A,(HL) / INC HL") == 0);
+        assert(fused.pair_profile().empty());
+
+        // a store into the group's own bytes, LD (HL),A rewrites INC HL as DEC HL before it runs
+        const char* patch = R"(
+        LD HL,store+1
+        LD A,$2B
+store:  LD (HL),A
+        INC HL
+        HALT
+)";
+        emu::z80_machine stepped_patch, fused_patch;
+        stepped_patch.superinstruction_fusion(false);
+        auto program = test_harness::boot(stepped_patch, patch, stepped_steps);
+        test_harness::boot(fused_patch, patch, fused_steps);
+        stepped_patch.run(100);
+        fused_patch.run(100);
+        test_harness::same(stepped_patch, fused_patch);
+        assert(emu::get_pair(fused_patch.registers(), H) == program.symbol("store"));
+        assert(fused_patch.dispatch_stats().fused == 0);
+
+        // contention only steps the groups that touch a contended page, here the copy's stores
+        emu::contention_table table;
+        table.contend(0x2000, 0x2FFF, emu::contention_table::window(8, 2, 6, { 3, 1 }));
+        emu::z80_machine stepped_contended(table), fused_contended(table);
+        stepped_contended.superinstruction_fusion(false);
+        boot(stepped_contended, 40000);
+        boot(fused_contended, 40000);
+        assert(stepped_contended.control().halted);
+        test_harness::same(stepped_contended, fused_contended);
+        assert(fused_contended.dispatch_stats().fused > 0 && fused_contended.dispatch_stats().fused < stats.fused);
+
+        if (verbose) {
+            uint64_t instructions{ 0 };
+            auto off = benchmark(false, instructions);
+            auto on = benchmark(true, instructions);
+            std::cout << std::format("{} instructions {:.1f}M/s stepped {:.1f}M/s fused x{:.2f}\n", instructions, off, on, on / off);
+        }
+
+        // static profile of the ROM
+        emu::z80_machine rom;
+        try {
+            rom.load("zx81-v2.rom", 0);
+            auto counts = fusion_t::profile([&rom](emu::address_t a) { return rom.ram()[a]; }, 0, 0x2000);
+            assert(counts.size() == fusion_t::catalogue().size());
+            if (verbose) {
+                for (size_t i{ 0 }; i < counts.size(); ++i) {
+                    std::cout << fusion_t::catalogue()[i].name << ' ' << counts[i] << '\n';
+                }
+            }
+        }
+        catch (const std::runtime_error&) {
+            if (verbose) std::cout << "zx81-v2.rom not found, no profile\n";
+        }
+
+        return true;
+    }
+
+}
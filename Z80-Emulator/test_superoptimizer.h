@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <iostream>
+
+#include "z80_superoptimizer.h"
+
+namespace test_superoptimizer {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test superoptimizer...";
+
+        // the alphabet has no memory, I/O or control flow and is in order of T-states
+        emu::z80_superoptimizer sla("SLA A");
+        const auto& alphabet = sla.alphabet();
+        assert(std::is_sorted(alphabet.begin(), alphabet.end(), [](const auto& a, const auto& b) { return a.tstates < b.tstates; }));
+        for (const auto& i : alphabet) {
+            assert(i.text.find('(') == std::string::npos && !i.text.starts_with("JR") && !i.text.starts_with("NOP"));
+        }
+        assert(alphabet.front().tstates == 4);
+
+        // SLA A is ADD A,A but for H and P/V, verified on every A
+        sla.live_in({ A });
+        sla.live_out({ A }, CARRY | ZERO | SIGN);
+        auto found = sla.search();
+        assert(found.size() == 1 && found[0].text == "ADD A,A" && found[0].saving == 4 && found[0].exhaustive);
+        assert((found[0].bytes == std::vector<uint8_t>{ 0x87 }));
+
+        // without the flags both ways of zeroing A
+        emu::z80_superoptimizer zero("LD A,0");
+        zero.live_in({});
+        zero.live_out({ A }, 0);
+        found = zero.search();
+        assert(found.size() == 2 && found[0].tstates == 4 && found[0].saving == 3);
+        assert(std::all_of(found.begin(), found.end(), [](const auto& r) { return r.text == "SUB A" || r.text == "XOR A"; }));
+
+        // code that undoes itself is no code at all, 32 live in bits are verified on a sample
+        emu::z80_superoptimizer swap("EX DE,HL\nEX DE,HL");
+        swap.live_in({ D, E, H, L });
+        swap.live_out({ D, E, H, L }, 0);
+        found = swap.search();
+        assert(found.size() == 1 && found[0].text.empty() && found[0].saving == 8 && !found[0].exhaustive);
+
+        // nothing beats one 4 T-state instruction with its flags
+        emu::z80_superoptimizer add("ADD A,B");
+        add.live_in({ A, B });
+        add.live_out({ A });
+        assert(add.search().empty());
+
+        // a shift by two from three rotates, one T-state cheaper
+        emu::z80_superoptimizer srl("SRL A\nSRL A");
+        srl.live_in({ A });
+        srl.live_out({ A }, 0);
+        auto start = std::chrono::steady_clock::now();
+        found = srl.search();
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        if (verbose) std::cout << std::format("\n{} candidates in {:.2f}s, {} shortlisted ", srl.statistics().candidates, seconds.count(), srl.statistics().shortlisted);
+        assert(!found.empty() && found[0].tstates == 15 && found[0].saving == 1 && found[0].exhaustive);
+        assert(std::any_of(found.begin(), found.end(), [](const auto& r) { return r.text == "RRCA; AND $7F; RRA"; }));
+
+        return true;
+    }
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "z80_core.h"
+#include "z80_machine.h"
+#include "z80_trace.h"
+
+namespace test_trace {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test golden traces...";
+
+        using emu::z80_trace;
+        using emu::trace_record;
+
+        // every byte of a record is compared
+        std::vector<trace_record> golden(100), live(100);
+        for (size_t i{ 0 }; i < golden.size(); ++i) {
+            for (size_t j{ 0 }; j < sizeof(trace_record); ++j) ((uint8_t*)&golden[i])[j] = (uint8_t)(i * 31 + j);
+        }
+        live = golden;
+        assert(z80_trace::mismatch(golden.data(), live.data(), golden.size()) == golden.size());
+        for (size_t j{ 0 }; j < sizeof(trace_record); ++j) {
+            live = golden;
+            ((uint8_t*)&live[57 + j])[j] ^= 0x80;
+            assert(z80_trace::mismatch(golden.data(), live.data(), golden.size()) == 57 + j);
+        }
+
+        auto dir = std::filesystem::temp_directory_path() / "z80_golden_traces";
+        std::filesystem::remove_all(dir);
+
+        // the first run records, the second compares
+        const auto& workload = z80_trace::workloads()[1];
+        assert(!z80_trace::regress(workload, dir));
+        auto path = z80_trace::golden_path(workload, dir);
+        assert(z80_trace::count(path) == workload.instructions);
+        auto start = std::chrono::steady_clock::now();
+        assert(!z80_trace::regress(workload, dir));
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (verbose) {
+            std::cout << std::format("\n{} instructions of \"{}\" compared in {:.3f}s", workload.instructions, workload.name, elapsed.count());
+        }
+
+        // a core whose 150000th instruction leaves the wrong flags
+        emu::z80_core core;
+        uint64_t executed{ 0 };
+        auto broken = [core, &executed](emu::z80_machine& m) mutable {
+            core(m);
+            if (++executed == 150000) m.registers().byte(F) ^= HALF_CARRY;
+        };
+        auto divergence = z80_trace::regress(workload, dir, broken);
+        assert(divergence && divergence->index == 149999);
+        assert((divergence->golden.registers[F] ^ divergence->live.registers[F]) == HALF_CARRY);
+        auto report = divergence->report();
+        assert(report.find("instruction 149999") != std::string::npos && report.find("\n    F ") != std::string::npos);
+        assert(report.find("\n    A ") == std::string::npos);
+        if (verbose) std::cout << '\n' << report;
+
+        // a core that does not reproduce the committed digest records no golden trace
+        std::filesystem::remove_all(dir);
+        executed = 0;
+        bool refused{ false };
+        try {
+            z80_trace::regress(workload, dir, broken);
+        }
+        catch (const std::runtime_error&) {
+            refused = true;
+        }
+        assert(refused && !std::filesystem::exists(path));
+
+        // every workload reproduces its committed digest and leaves the same machine with every fast path on and off
+        for (const auto& w : z80_trace::workloads()) {
+            try {
+                emu::z80_machine m;
+                w.prepare(m);
+                m.attach(emu::z80_core{});
+                assert(z80_trace::digest(m, w.instructions) == w.digest);
+                auto divergence = z80_trace::fast_paths(w, 4'000'000, 250'000);
+                if (divergence && verbose) std::cout << '\n' << w.name << ' ' << divergence->report();
+                assert(!divergence);
+            }
+            catch (const std::runtime_error&) {
+                if (verbose) std::cout << std::format("\n\"{}\" cannot be prepared here", w.name);
+            }
+        }
+
+        // the ZX81 boot if the ROM is here
+        try {
+            const auto& boot = z80_trace::workloads()[0];
+            emu::z80_machine m;
+            boot.prepare(m);
+            m.attach(emu::z80_core{});
+            auto boot_path = dir / "boot.z80trace";
+            z80_trace::record(m, 100000, boot_path);
+            emu::z80_machine again;
+            boot.prepare(again);
+            again.attach(emu::z80_core{});
+            assert(!z80_trace::compare(again, boot_path));
+
+            // a core that counts its calls in memory above the ZX81's RAM is told apart as soon as the fast paths
+            // run instructions without it
+            auto counting = [core](emu::z80_machine& m) mutable {
+                core(m);
+                if (++m.ram()[0xC000] == 0) ++m.ram()[0xC001];
+            };
+            auto fast = z80_trace::fast_paths(boot, 4'000'000, 250'000, counting);
+            assert(fast && fast->memory == 0xC000);
+            if (verbose) std::cout << '\n' << fast->report();
+        }
+        catch (const std::runtime_error&) {
+            if (verbose) std::cout << "\nzx81-v2.rom not found, no boot trace";
+        }
+        if (verbose) std::cout << '\n';
+
+        std::filesystem::remove_all(dir);
+
+        return true;
+    }
+
+}
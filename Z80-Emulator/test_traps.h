@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "test_harness.h"
+#include "z80_machine.h"
+
+namespace test_traps {
+
+    void boot(emu::z80_machine& m, uint64_t& steps) {
+        test_harness::boot(m, R"(
+        LD HL,$4000
+        LD B,16
+        LD A,$55
+        CALL fill
+        HALT
+        ORG $0100
+fill:   LD (HL),A
+        INC HL
+        DJNZ fill
+        RET
+)", steps);
+    }
+
+    // native fill: 26 T-states a byte, the last DJNZ falls through in 8, then RET which leaves MEMPTR at the return
+    unsigned native_fill(emu::z80_machine& m) {
+        auto& regs = m.registers();
+        auto sp = (emu::address_t)regs.word(SP);
+        m.control().memptr = (uint16_t)((uint8_t)m.ram()[sp] | (uint8_t)m.ram()[(emu::address_t)(sp + 1)] << 8);
+        unsigned n = (uint8_t)regs.byte(B) ? (uint8_t)regs.byte(B) : 256;
+        uint16_t hl = (uint8_t)regs.byte(L) | (uint8_t)regs.byte(H) << 8;
+        std::vector<emu::byte_t> bytes(n, regs.byte(A));
+        m.write_block(hl, bytes.data(), n);        // through the machine, so hashes and cached code see the writes
+        hl += n;
+        regs.byte(L) = (emu::byte_t)hl;
+        regs.byte(H) = (emu::byte_t)(hl >> 8);
+        regs.byte(B) = 0;
+        m.refresh(3 * n + 1);
+        return 26 * n - 5 + 10;
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test traps...";
+
+        emu::z80_machine original, trapped;
+        uint64_t steps{ 0 };
+        boot(original, steps);
+        boot(trapped, steps);
+        original.run(2000);
+
+        int hits{ 0 };
+        trapped.trap(0x0100, [&hits](emu::z80_machine& m) { ++hits; return native_fill(m); });
+        assert(trapped.flags(0x0100) & emu::PAGE_TRAP);
+        assert(!(trapped.flags(0x0000) & emu::PAGE_TRAP));
+        trapped.verify(true);
+        trapped.hash();         // page hashes now only follow the writes the machine is told of
+        trapped.run(2000);
+        if (verbose) std::cout << hits << " hit(s) " << trapped.cycles() << " T-states\n";
+        assert(hits == 1);
+        test_harness::same(original, trapped);
+        assert(trapped.hash() == original.hash());
+        assert(trapped.control().halted);
+        assert(trapped.ram()[0x400F] == 0x55 && trapped.ram()[0x4010] == 0);
+
+        // a declared cost that is wrong is caught
+        emu::z80_machine wrong;
+        boot(wrong, steps);
+        wrong.trap(0x0100, [](emu::z80_machine& m) { return native_fill(m) + 1; });
+        wrong.verify(true);
+        bool caught{ false };
+        try {
+            wrong.run(2000);
+        }
+        catch (std::exception& e) {
+            if (verbose) std::cout << e.what() << '\n';
+            caught = true;
+        }
+        assert(caught);
+
+        // a declining trap runs the original code
+        emu::z80_machine declined;
+        boot(declined, steps);
+        declined.trap(0x0100, [](emu::z80_machine&) { return emu::z80_machine::traps_t::DECLINE; });
+        declined.run(2000);
+        test_harness::same(original, declined);
+        declined.untrap(0x0100);
+        assert(!(declined.flags(0x0100) & emu::PAGE_TRAP));
+
+        // copy construction and assignment cope with a moved from memory on either side
+        emu::memory<16> moved(0, 1), copy(0, 2);
+        auto taken = std::move(moved);
+        copy = moved;
+        emu::memory<16> copied(moved);
+        copy = taken;
+        assert(copy[0] == 1 && copy[15] == 1 && taken[0] == 1);
+
+        return true;
+    }
+
+}
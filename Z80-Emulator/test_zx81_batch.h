@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <vector>
+
+#include "zx81_basic.h"
+#include "zx81_batch.h"
+
+namespace test_zx81_batch {
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test ZX81 BASIC batch runner...";
+
+        using basic = emu::zx81_basic;
+
+        // numbers as the ROM stores them, keywords as tokens, names and strings as they are
+        assert((basic::number(1) == std::array<uint8_t, 5>{ 0x81, 0x00, 0, 0, 0 }));
+        assert((basic::number(-50) == std::array<uint8_t, 5>{ 0x86, 0xC8, 0, 0, 0 }));
+        assert((basic::number(0.5) == std::array<uint8_t, 5>{ 0x80, 0x00, 0, 0, 0 }));
+        assert((basic::tokenize("10 let total=toy+1\n") == std::vector<uint8_t>{ 0x00, 0x0A, 0x13, 0x00,
+            0xF1, 0x39, 0x34, 0x39, 0x26, 0x31, 0x14, 0x39, 0x34, 0x3E, 0x15, 0x1D, 0x7E, 0x81, 0, 0, 0, 0, 0x76 }));
+        assert((basic::tokenize("5 PRINT \"A\"\"B\";X<>Y\n") == std::vector<uint8_t>{ 0x00, 0x05, 0x0B, 0x00,
+            0xF5, 0x0B, 0x26, 0xC0, 0x27, 0x0B, 0x19, 0x3D, 0xDD, 0x3E, 0x76 }));
+
+        emu::zx81_batch batch;
+        auto boot = batch.machine().cycles();
+
+        // a job's program is its listing, the screen its output
+        auto hello = batch.run("10 PRINT \"HELLO\"\n20 PRINT 6*7\n");
+        assert(hello.ended && hello.report == 0 && hello.line == 20 && hello.error.empty());
+        assert(hello.screen.starts_with("HELLO\n42\n"));
+        assert(basic::listing(batch.machine()).size() == 2 && basic::listing(batch.machine())[1].text == "PRINT 6*7");
+
+        // errors report their code and line, a loop times out, a bad program does not run
+        auto undefined = batch.run("10 LET A=1\n20 PRINT B\n");
+        assert(undefined.ended && undefined.report == 2 && undefined.line == 20);
+        auto forever = batch.run("10 GOTO 10\n", 1'000'000);
+        assert(!forever.ended && forever.tstates >= 1'000'000 && forever.tstates < 1'001'000);
+        assert(!batch.run("10 PRINT \"OOPS\n").error.empty() && !batch.run("20 CLS\n10 CLS\n").error.empty());
+
+        // every job starts from READY, whatever ran before
+        auto again = batch.run("10 PRINT \"HELLO\"\n20 PRINT 6*7\n");
+        assert(again.tstates == hello.tstates && again.screen == hello.screen);
+
+        // a batch on threads gives each job the result it has alone, in job order
+        std::vector<emu::zx81_batch::job_t> jobs;
+        for (int i{ 0 }; i < 64; ++i) {
+            jobs.push_back({ std::format("5 LET S=0\n10 FOR I=1 TO {}\n20 LET S=S+I\n30 NEXT I\n40 PRINT S\n", i % 8 + 1) });
+        }
+        jobs.push_back({ "10 GOTO 10\n", 100'000 });
+        auto start = std::chrono::steady_clock::now();
+        auto results = batch.run(jobs);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        assert(results.size() == jobs.size() && !results.back().ended);
+        for (int i{ 0 }; i < 64; ++i) {
+            auto n = i % 8 + 1;
+            assert(results[i].ended && results[i].report == 0);
+            assert(results[i].screen.starts_with(std::format("{}\n", n * (n + 1) / 2)));
+            assert(results[i].tstates == results[i % 8].tstates && results[i].tstates < boot);
+        }
+        auto alone = batch.run(jobs[5].program);
+        assert(alone.tstates == results[5].tstates && alone.screen == results[5].screen);
+        if (verbose) std::cout << std::format("\nboot {} T-states, {} jobs in {:.1f}ms ", boot, jobs.size(), elapsed.count());
+
+        return true;
+    }
+
+}
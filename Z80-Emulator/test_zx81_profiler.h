@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <vector>
+
+#include "z80_core.h"
+#include "z80_machine.h"
+#include "zx81_basic.h"
+#include "zx81_profiler.h"
+
+namespace test_zx81_profiler {
+
+    // a tokenized line, number big-endian then length little-endian
+    std::vector<uint8_t> line(uint16_t number, std::vector<uint8_t> text) {
+        text.push_back(emu::zx81_basic::NEWLINE);
+        std::vector<uint8_t> bytes{ (uint8_t)(number >> 8), (uint8_t)number, (uint8_t)text.size(), (uint8_t)(text.size() >> 8) };
+        for (auto b : text) bytes.push_back(b);
+        return bytes;
+    }
+
+    bool run(bool verbose = false) {
+
+        std::cout << "test ZX81 BASIC profiler...";
+
+        using basic = emu::zx81_basic;
+
+        emu::z80_machine m;
+        m.ram().fill(0);
+        m.load("zx81-v2.rom", 0);
+        m.protect(0x0000, 0x1FFF);
+        m.attach(emu::z80_core{});
+        m.trap(basic::DISPLAY, [](emu::z80_machine&) { return 10u; });
+        m.set_breakpoint(basic::READY);
+        m.run(10'000'000);
+        assert(m.breakpoint_hit() && m.registers().word(PC) == basic::READY);
+        m.clear_breakpoint(basic::READY);
+        assert(basic::listing(m).empty());
+
+        // 10 FOR I=1 TO 50, 20 LET X=SQR I, 30 NEXT I, 40 PRINT X
+        std::vector<uint8_t> program;
+        for (const auto& l : {
+            line(10, { 0xEB, 0x2E, 0x14, 0x1D, 0x7E, 0x81, 0, 0, 0, 0, 0xDF, 0x21, 0x1C, 0x7E, 0x86, 0x48, 0, 0, 0 }),
+            line(20, { 0xF1, 0x3D, 0x14, 0xD0, 0x2E }),
+            line(30, { 0xF3, 0x2E }),
+            line(40, { 0xF5, 0x3D }) }) {
+            program.insert(program.end(), l.begin(), l.end());
+        }
+        basic::inject(m, program);
+        auto listing = basic::listing(m);
+        assert(listing.size() == 4 && listing[0].text == "FOR I=1 TO 50" && listing[1].text == "LET X=SQR I");
+        assert(basic::word(m, basic::D_FILE) == basic::PROG + program.size());
+        emu::z80_machine ready(m);
+
+        // the same run with and without the profiler, which costs no T-states
+        basic::run(m);
+        m.set_breakpoint(basic::REPORT);
+        auto start = std::chrono::steady_clock::now();
+        m.run(m.cycles() + 50'000'000);
+        std::chrono::duration<double, std::milli> plain = std::chrono::steady_clock::now() - start;
+        assert(m.breakpoint_hit() && basic::report_code(m) == 0);
+
+        emu::zx81_profiler profiler(ready);
+        basic::run(ready);
+        ready.set_breakpoint(basic::REPORT);
+        auto from = ready.cycles();
+        start = std::chrono::steady_clock::now();
+        ready.run(ready.cycles() + 50'000'000);
+        std::chrono::duration<double, std::milli> profiled = std::chrono::steady_clock::now() - start;
+        assert(ready.breakpoint_hit() && ready.cycles() == m.cycles() && ready.hash() == m.hash());
+
+        // every line of the listing, the loop body dominant, the lines' T-states within the run's
+        auto rows = profiler.report();
+        assert(rows.size() == 4);
+        uint64_t total{ 0 };
+        for (size_t i{ 0 }; i < rows.size(); ++i) {
+            assert(rows[i].line == listing[i].number && rows[i].text == listing[i].text);
+            total += rows[i].tstates;
+        }
+        assert(rows[0].runs == 1 && rows[1].runs == 50 && rows[2].runs == 50 && rows[3].runs == 1);
+        assert(std::max_element(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.tstates < b.tstates; })->line == 20);
+        assert(total > 0 && total <= ready.cycles() - from);
+        if (verbose) std::cout << std::format("\n{}{:.1f}ms plain, {:.1f}ms profiled ", profiler.table(), plain.count(), profiled.count());
+
+        return true;
+    }
+
+}
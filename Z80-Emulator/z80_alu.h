@@ -0,0 +1,241 @@
+/**
+
+    @file      z80_alu.h
+    @brief     Z80 arithmetic and logic with every documented and undocumented flag
+    @details   each operation returns its result and writes the flags through f:
+               + 8 bit results take S, Z, bits 5 (x) and 3 (y), and P where it is parity, from the constexpr
+                 tables in z80_flags.h, so the undocumented bits cost nothing over the documented ones
+               + CP takes x and y from the operand, not the result
+               + SCF and CCF take x and y from ((Q ^ F) | A) where Q is the flags the previous instruction wrote,
+                 or 0 if it wrote none (the z80_control_t::q the core keeps)
+               + BIT b,(HL) takes x and y from the high byte of MEMPTR, the other BITs from the tested value, so
+                 bit() takes the byte x and y come from
+               + 16 bit ADD leaves S, Z and P/V alone, ADC and SBC set all of them, x and y come from the high
+                 byte of the result
+               MEMPTR itself is the core's business, see z80_control_t
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <cstdint>
+
+#include "z80_flags.h"
+#include "z80_registers.h"
+
+namespace emu {
+
+    namespace alu {
+
+        constexpr uint8_t XY = BIT5_X | BIT3_Y;
+        constexpr uint8_t SZP = SIGN | ZERO | PARITY_OVERFLOW;
+
+        // 8 bit arithmetic
+
+        constexpr uint8_t add(uint8_t a, uint8_t b, uint8_t& f, uint8_t carry = 0) {
+            unsigned r = a + b + carry;
+            auto result = (uint8_t)r;
+            f = (uint8_t)(flags::SZ53[result] | ((a ^ b ^ r) & HALF_CARRY)
+                | ((~(a ^ b) & (a ^ r) & 0x80) ? PARITY_OVERFLOW : 0) | (r > 0xFF ? CARRY : 0));
+            return result;
+        }
+
+        constexpr uint8_t adc(uint8_t a, uint8_t b, uint8_t& f) {
+            return add(a, b, f, f & CARRY);
+        }
+
+        constexpr uint8_t sub(uint8_t a, uint8_t b, uint8_t& f, uint8_t carry = 0) {
+            unsigned r = a - b - carry;
+            auto result = (uint8_t)r;
+            f = (uint8_t)(flags::SZ53[result] | NEGATE | ((a ^ b ^ r) & HALF_CARRY)
+                | (((a ^ b) & (a ^ r) & 0x80) ? PARITY_OVERFLOW : 0) | ((r >> 8) & CARRY));
+            return result;
+        }
+
+        constexpr uint8_t sbc(uint8_t a, uint8_t b, uint8_t& f) {
+            return sub(a, b, f, f & CARRY);
+        }
+
+        constexpr void cp(uint8_t a, uint8_t b, uint8_t& f) {
+            sub(a, b, f);
+            f = (uint8_t)((f & ~XY) | (b & XY));
+        }
+
+        constexpr uint8_t neg(uint8_t a, uint8_t& f) {
+            return sub(0, a, f);
+        }
+
+        constexpr uint8_t inc(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v + 1);
+            f = (uint8_t)((f & CARRY) | flags::SZ53[r] | ((r & 0x0F) == 0 ? HALF_CARRY : 0) | (r == 0x80 ? PARITY_OVERFLOW : 0));
+            return r;
+        }
+
+        constexpr uint8_t dec(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v - 1);
+            f = (uint8_t)((f & CARRY) | NEGATE | flags::SZ53[r] | ((v & 0x0F) == 0 ? HALF_CARRY : 0) | (v == 0x80 ? PARITY_OVERFLOW : 0));
+            return r;
+        }
+
+        // logic
+
+        constexpr uint8_t and_(uint8_t a, uint8_t b, uint8_t& f) {
+            auto r = (uint8_t)(a & b);
+            f = (uint8_t)(flags::SZ53P[r] | HALF_CARRY);
+            return r;
+        }
+
+        constexpr uint8_t or_(uint8_t a, uint8_t b, uint8_t& f) {
+            auto r = (uint8_t)(a | b);
+            f = flags::SZ53P[r];
+            return r;
+        }
+
+        constexpr uint8_t xor_(uint8_t a, uint8_t b, uint8_t& f) {
+            auto r = (uint8_t)(a ^ b);
+            f = flags::SZ53P[r];
+            return r;
+        }
+
+        constexpr uint8_t cpl(uint8_t a, uint8_t& f) {
+            auto r = (uint8_t)~a;
+            f = (uint8_t)((f & (SZP | CARRY)) | HALF_CARRY | NEGATE | (r & XY));
+            return r;
+        }
+
+        constexpr uint8_t daa(uint8_t a, uint8_t& f) {
+            uint8_t diff{ 0 }, carry{ 0 };
+            if ((f & HALF_CARRY) || (a & 0x0F) > 9) diff |= 0x06;
+            if ((f & CARRY) || a > 0x99) {
+                diff |= 0x60;
+                carry = CARRY;
+            }
+            bool half = (f & NEGATE) ? (f & HALF_CARRY) && (a & 0x0F) < 6 : (a & 0x0F) > 9;
+            auto r = (uint8_t)((f & NEGATE) ? a - diff : a + diff);
+            f = (uint8_t)(flags::SZ53P[r] | (f & NEGATE) | carry | (half ? HALF_CARRY : 0));
+            return r;
+        }
+
+        // carry flag, q is the flags written by the previous instruction or 0
+
+        constexpr void scf(uint8_t a, uint8_t& f, uint8_t q) {
+            f = (uint8_t)((f & SZP) | ((((q ^ f) | a)) & XY) | CARRY);
+        }
+
+        constexpr void ccf(uint8_t a, uint8_t& f, uint8_t q) {
+            f = (uint8_t)((f & SZP) | ((((q ^ f) | a)) & XY) | ((f & CARRY) ? HALF_CARRY : CARRY));
+        }
+
+        // accumulator rotates leave S, Z and P/V alone
+
+        constexpr uint8_t rlca(uint8_t a, uint8_t& f) {
+            auto r = (uint8_t)(a << 1 | a >> 7);
+            f = (uint8_t)((f & SZP) | (r & XY) | (a >> 7));
+            return r;
+        }
+
+        constexpr uint8_t rrca(uint8_t a, uint8_t& f) {
+            auto r = (uint8_t)(a >> 1 | a << 7);
+            f = (uint8_t)((f & SZP) | (r & XY) | (a & CARRY));
+            return r;
+        }
+
+        constexpr uint8_t rla(uint8_t a, uint8_t& f) {
+            auto r = (uint8_t)(a << 1 | (f & CARRY));
+            f = (uint8_t)((f & SZP) | (r & XY) | (a >> 7));
+            return r;
+        }
+
+        constexpr uint8_t rra(uint8_t a, uint8_t& f) {
+            auto r = (uint8_t)(a >> 1 | (f & CARRY) << 7);
+            f = (uint8_t)((f & SZP) | (r & XY) | (a & CARRY));
+            return r;
+        }
+
+        // CB rotates and shifts
+
+        constexpr uint8_t rlc(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v << 1 | v >> 7);
+            f = (uint8_t)(flags::SZ53P[r] | (v >> 7));
+            return r;
+        }
+
+        constexpr uint8_t rrc(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v >> 1 | v << 7);
+            f = (uint8_t)(flags::SZ53P[r] | (v & CARRY));
+            return r;
+        }
+
+        constexpr uint8_t rl(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v << 1 | (f & CARRY));
+            f = (uint8_t)(flags::SZ53P[r] | (v >> 7));
+            return r;
+        }
+
+        constexpr uint8_t rr(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v >> 1 | (f & CARRY) << 7);
+            f = (uint8_t)(flags::SZ53P[r] | (v & CARRY));
+            return r;
+        }
+
+        constexpr uint8_t sla(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v << 1);
+            f = (uint8_t)(flags::SZ53P[r] | (v >> 7));
+            return r;
+        }
+
+        constexpr uint8_t sra(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)((v >> 1) | (v & 0x80));
+            f = (uint8_t)(flags::SZ53P[r] | (v & CARRY));
+            return r;
+        }
+
+        // undocumented SLL, shifts a 1 in
+        constexpr uint8_t sll(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v << 1 | 1);
+            f = (uint8_t)(flags::SZ53P[r] | (v >> 7));
+            return r;
+        }
+
+        constexpr uint8_t srl(uint8_t v, uint8_t& f) {
+            auto r = (uint8_t)(v >> 1);
+            f = (uint8_t)(flags::SZ53P[r] | (v & CARRY));
+            return r;
+        }
+
+        // BIT b, x and y come from xy: the value for BIT b,r, MEMPTR's high byte for BIT b,(HL), the high byte of
+        // the address for BIT b,(IX+d)
+        constexpr void bit(unsigned b, uint8_t v, uint8_t& f, uint8_t xy) {
+            auto r = (uint8_t)(v & (1u << b));
+            f = (uint8_t)((f & CARRY) | HALF_CARRY | (r & SIGN) | (r ? 0 : ZERO | PARITY_OVERFLOW) | (xy & XY));
+        }
+
+        // 16 bit arithmetic
+
+        constexpr uint16_t add16(uint16_t x, uint16_t y, uint8_t& f) {
+            uint32_t r = x + y;
+            f = (uint8_t)((f & SZP) | ((r >> 8) & XY) | (((x ^ y ^ r) >> 8) & HALF_CARRY) | (r >> 16));
+            return (uint16_t)r;
+        }
+
+        constexpr uint16_t adc16(uint16_t x, uint16_t y, uint8_t& f) {
+            uint32_t r = x + y + (f & CARRY);
+            auto result = (uint16_t)r;
+            f = (uint8_t)(((result >> 8) & (SIGN | XY)) | (result == 0 ? ZERO : 0) | (((x ^ y ^ r) >> 8) & HALF_CARRY)
+                | ((~(x ^ y) & (x ^ r) & 0x8000) ? PARITY_OVERFLOW : 0) | (r >> 16));
+            return result;
+        }
+
+        constexpr uint16_t sbc16(uint16_t x, uint16_t y, uint8_t& f) {
+            uint32_t r = x - y - (f & CARRY);
+            auto result = (uint16_t)r;
+            f = (uint8_t)(((result >> 8) & (SIGN | XY)) | (result == 0 ? ZERO : 0) | NEGATE | (((x ^ y ^ r) >> 8) & HALF_CARRY)
+                | (((x ^ y) & (x ^ r) & 0x8000) ? PARITY_OVERFLOW : 0) | ((r >> 16) & CARRY));
+            return result;
+        }
+
+    }
+
+}
@@ -0,0 +1,627 @@
+/**
+
+    @file      z80_assembler.h
+    @brief     two pass Z80 assembler encoding from the disassembler's opcode tables
+    @details   the encoder is the templates of z80_opcodes.h turned round, so whatever the disassembler lists the
+               assembler takes back:
+               + a line is [label[:]] [instruction | directive] [; comment], a label starts in the first column or
+                 ends with a colon, mnemonics and registers in any case, labels as written
+               + directives ORG, EQU, DB (DEFB, DEFM) of expressions and "strings", DW (DEFW), DS (DEFS) count[,fill]
+                 and END
+               + expressions of numbers ($FF, 0xFF, 0FFh, %1010, 255, 'c'), labels and $ for the current address,
+                 with unary - + ~ and, lowest first, | ^ & << >> + - * / %
+               + (IX+d) and (IY+d) take any expression for d, (IX) is (IX+0), an operand wholly in parentheses
+                 is an address
+               + the first pass sizes every line with undefined labels as 0, the second encodes and range checks,
+                 errors throw with the line number
+               + a program is its segments, one per ORG, and its symbols, load() writes it into any emu::memory
+               round_trip() disassembles, assembles, disassembles and assembles again every opcode of every table,
+               a mirror such as ED 63 LD (nn),HL comes back as its documented encoding
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <format>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "z80_opcodes.h"
+#include "zx80_disassembler.h"
+
+namespace emu {
+
+    class z80_program {
+
+    public:
+
+        struct segment_t {
+            address_t address;
+            std::vector<uint8_t> bytes;
+        };
+
+        std::vector<segment_t> segments;
+        std::map<std::string, int32_t> symbols;
+
+        int32_t symbol(const std::string& name) const {
+            auto it = symbols.find(name);
+            if (it == symbols.end()) {
+                throw std::runtime_error("assembler error: no symbol \"" + name + "\"");
+            }
+            return it->second;
+        }
+
+        // every byte from the lowest address assembled to the highest, gaps as 0
+        std::vector<uint8_t> bytes() const {
+            if (segments.empty()) return {};
+            uint32_t lo{ 0xFFFF }, hi{ 0 };
+            for (const auto& s : segments) {
+                if (s.bytes.empty()) continue;
+                lo = std::min<uint32_t>(lo, s.address);
+                hi = std::max<uint32_t>(hi, s.address + (uint32_t)s.bytes.size());
+            }
+            if (hi <= lo) return {};
+            std::vector<uint8_t> image(hi - lo, 0);
+            for (const auto& s : segments) {
+                std::copy(s.bytes.begin(), s.bytes.end(), image.begin() + (s.address - lo));
+            }
+            return image;
+        }
+
+        template<typename MEMORY>
+        void load(MEMORY& memory) const {
+            for (const auto& s : segments) {
+                for (size_t i{ 0 }; i < s.bytes.size(); ++i) {
+                    memory[(address_t)(s.address + i)] = (byte_t)s.bytes[i];
+                }
+            }
+        }
+
+    };
+
+    class z80_assembler {
+
+        using prefix_t = z80_opcodes::prefix_t;
+
+        struct encoding_t {
+            prefix_t prefix;
+            uint8_t opcode;
+            std::string pattern;
+        };
+
+        // an operand as written, the shapes it could take in a template and its expression
+        struct operand_t {
+            std::vector<std::string> shapes;
+            std::string expression;
+        };
+
+    public:
+
+        static z80_program assemble(const std::string& source) {
+            z80_assembler assembler(source);
+            assembler.pass(false);
+            assembler.pass(true);
+            return std::move(assembler.program);
+        }
+
+        template<typename MEMORY>
+        static z80_program assemble(const std::string& source, MEMORY& memory) {
+            auto program = assemble(source);
+            program.load(memory);
+            return program;
+        }
+
+        // every opcode of every table through disassemble, assemble, disassemble and assemble, the failures
+        static std::vector<std::string> round_trip() {
+            static constexpr address_t ORIGIN = 0x4000;
+            std::vector<std::string> failures;
+            auto disassemble = [](const std::vector<uint8_t>& bytes) {
+                return zx80_disassembler::decode([&bytes](address_t a) {
+                    auto i = (size_t)(address_t)(a - ORIGIN);
+                    return (byte_t)((i < bytes.size()) ? bytes[i] : 0);
+                }, ORIGIN);
+            };
+            auto reassemble = [](const std::string& text) {
+                return assemble(std::format("    ORG ${:04X}\n    {}\n", ORIGIN, text)).bytes();
+            };
+            for (auto prefix : z80_opcodes::PREFIXES) {
+                for (unsigned op{ 0 }; op < 256; ++op) {
+                    auto bytes = z80_opcodes::prefix_bytes(prefix);
+                    if (prefix == prefix_t::ddcb || prefix == prefix_t::fdcb) bytes.push_back(0xF3);
+                    bytes.push_back((uint8_t)op);
+                    bytes.insert(bytes.end(), { 0xF3, 0x5A, 0x12 });
+                    try {
+                        auto first = disassemble(bytes);
+                        auto encoded = reassemble(first.text);
+                        auto second = disassemble(encoded);
+                        auto again = reassemble(second.text);
+                        if (second.length != encoded.size() || second.text != first.text || again != encoded) {
+                            failures.push_back(std::format("{:02X}: \"{}\" comes back as \"{}\"", op, first.text, second.text));
+                        }
+                    }
+                    catch (const std::runtime_error& e) {
+                        failures.push_back(std::format("{:02X}: {}", op, e.what()));
+                    }
+                }
+            }
+            return failures;
+        }
+
+    private:
+
+        explicit z80_assembler(const std::string& source) {
+            std::istringstream in(source);
+            std::string line;
+            while (std::getline(in, line)) lines.push_back(line);
+        }
+
+        // template, with literal numbers as #value, to the first opcode that has it
+        static const std::unordered_map<std::string, encoding_t>& encodings() {
+            static const std::unordered_map<std::string, encoding_t> table = [] {
+                std::unordered_map<std::string, encoding_t> t;
+                for (auto prefix : z80_opcodes::PREFIXES) {
+                    const auto& templates = z80_opcodes::table(prefix);
+                    bool index_cb = prefix == prefix_t::ddcb || prefix == prefix_t::fdcb;
+                    for (unsigned n{ 0 }; n < 256; ++n) {
+                        // DDCB and FDCB visit register field 6 first, the documented form of each group of 8
+                        auto op = index_cb ? ((n + 6) & 7) | (n & 0xF8) : n;
+                        const auto& pattern = templates[op];
+                        if (pattern.empty()) continue;
+                        auto [mnemonic, operands] = split_instruction(pattern);
+                        auto key = mnemonic;
+                        for (size_t i{ 0 }; i < operands.size(); ++i) {
+                            auto value = number(operands[i]);
+                            key += (i ? "," : " ") + (value ? "#" + std::to_string(*value) : operands[i]);
+                        }
+                        t.try_emplace(key, encoding_t{ prefix, (uint8_t)op, pattern });
+                    }
+                }
+                return t;
+            }();
+            return table;
+        }
+
+        static bool is_mnemonic(const std::string& word) {
+            static const std::unordered_map<std::string, bool> words = [] {
+                std::unordered_map<std::string, bool> w;
+                for (const auto& [key, encoding] : encodings()) w[key.substr(0, key.find(' '))] = true;
+                for (auto d : { "ORG", "EQU", "DB", "DEFB", "DEFM", "DW", "DEFW", "DS", "DEFS", "END" }) w[d] = true;
+                return w;
+            }();
+            return words.contains(word);
+        }
+
+        static std::string upper(std::string s) {
+            for (auto& c : s) c = (char)std::toupper((unsigned char)c);
+            return s;
+        }
+
+        static std::string trim(const std::string& s) {
+            auto begin = s.find_first_not_of(" \t\r");
+            if (begin == std::string::npos) return {};
+            return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+        }
+
+        // splits at commas outside quotes and parentheses
+        static std::vector<std::string> split_operands(const std::string& s) {
+            std::vector<std::string> operands;
+            std::string current;
+            int depth{ 0 };
+            char quote{ 0 };
+            for (size_t i{ 0 }; i < s.size(); ++i) {
+                auto c = s[i];
+                if (quote) {
+                    if (c == quote) quote = 0;
+                }
+                else if ((c == '"' || c == '\'') && !(c == '\'' && upper(current) == "AF")) {
+                    quote = c;
+                }
+                else if (c == '(') {
+                    ++depth;
+                }
+                else if (c == ')') {
+                    --depth;
+                }
+                else if (c == ',' && depth == 0) {
+                    operands.push_back(trim(current));
+                    current.clear();
+                    continue;
+                }
+                current += c;
+            }
+            if (!trim(current).empty() || !operands.empty()) operands.push_back(trim(current));
+            return operands;
+        }
+
+        static std::pair<std::string, std::vector<std::string>> split_instruction(const std::string& s) {
+            auto text = trim(s);
+            auto space = text.find_first_of(" \t");
+            if (space == std::string::npos) return { upper(text), {} };
+            return { upper(text.substr(0, space)), split_operands(text.substr(space + 1)) };
+        }
+
+        // a plain number literal, for the numbers written into templates
+        static std::optional<int32_t> number(const std::string& s) {
+            if (s.empty()) return std::nullopt;
+            size_t used{ 0 };
+            try {
+                int32_t v{ 0 };
+                if (s[0] == '$' && s.size() > 1) v = std::stoi(s.substr(1), &used, 16), ++used;
+                else if (std::isdigit((unsigned char)s[0])) v = std::stoi(s, &used, 10);
+                else return std::nullopt;
+                if (used != s.size()) return std::nullopt;
+                return v;
+            }
+            catch (const std::exception&) {
+                return std::nullopt;
+            }
+        }
+
+        // expressions
+
+        [[noreturn]] void error(const std::string& message) const {
+            throw std::runtime_error(std::format("assembler error: line {}: {}: \"{}\"", line_number, message, trim(lines[line_number - 1])));
+        }
+
+        int32_t evaluate(const std::string& expression) {
+            text = expression;
+            at = 0;
+            auto v = parse_or();
+            skip();
+            if (at != text.size()) error("bad expression");
+            return v;
+        }
+
+        void skip() {
+            while (at < text.size() && std::isspace((unsigned char)text[at])) ++at;
+        }
+
+        bool accept(const char* op) {
+            skip();
+            auto n = std::char_traits<char>::length(op);
+            if (text.compare(at, n, op) != 0) return false;
+            at += n;
+            return true;
+        }
+
+        int32_t parse_or() {
+            auto v = parse_xor();
+            while (accept("|")) v |= parse_xor();
+            return v;
+        }
+
+        int32_t parse_xor() {
+            auto v = parse_and();
+            while (accept("^")) v ^= parse_and();
+            return v;
+        }
+
+        int32_t parse_and() {
+            auto v = parse_shift();
+            while (accept("&")) v &= parse_shift();
+            return v;
+        }
+
+        int32_t parse_shift() {
+            auto v = parse_sum();
+            for (;;) {
+                if (accept("<<")) v <<= parse_sum();
+                else if (accept(">>")) v >>= parse_sum();
+                else return v;
+            }
+        }
+
+        int32_t parse_sum() {
+            auto v = parse_product();
+            for (;;) {
+                if (accept("+")) v += parse_product();
+                else if (accept("-")) v -= parse_product();
+                else return v;
+            }
+        }
+
+        int32_t parse_product() {
+            auto v = parse_unary();
+            for (;;) {
+                if (accept("*")) v *= parse_unary();
+                else if (accept("/") || accept("%")) {
+                    bool divide = text[at - 1] == '/';
+                    auto d = parse_unary();
+                    if (d == 0) error("division by zero");
+                    v = divide ? v / d : v % d;
+                }
+                else return v;
+            }
+        }
+
+        int32_t parse_unary() {
+            if (accept("-")) return -parse_unary();
+            if (accept("+")) return parse_unary();
+            if (accept("~")) return ~parse_unary();
+            return parse_primary();
+        }
+
+        int32_t parse_primary() {
+            skip();
+            if (at >= text.size()) error("missing operand");
+            auto c = text[at];
+            if (c == '(') {
+                ++at;
+                auto v = parse_or();
+                if (!accept(")")) error("missing )");
+                return v;
+            }
+            if (c == '\'' && at + 2 < text.size() && text[at + 2] == '\'') {
+                at += 3;
+                return (uint8_t)text[at - 2];
+            }
+            if (c == '$' && (at + 1 >= text.size() || !std::isxdigit((unsigned char)text[at + 1]))) {
+                ++at;
+                return pc;
+            }
+            auto begin = at;
+            if (c == '$' || c == '%') ++at;
+            while (at < text.size() && (std::isalnum((unsigned char)text[at]) || text[at] == '_' || text[at] == '.')) ++at;
+            auto word = text.substr(begin, at - begin);
+            if (word.empty()) error("bad expression");
+            try {
+                size_t used{ 0 };
+                int32_t v{ 0 };
+                auto lower = word;
+                for (auto& ch : lower) ch = (char)std::tolower((unsigned char)ch);
+                if (word[0] == '$') v = std::stoi(word.substr(1), &used, 16), ++used;
+                else if (word[0] == '%') v = std::stoi(word.substr(1), &used, 2), ++used;
+                else if (lower.starts_with("0x")) v = std::stoi(word.substr(2), &used, 16), used += 2;
+                else if (std::isdigit((unsigned char)word[0]) && lower.back() == 'h') v = std::stoi(word.substr(0, word.size() - 1), &used, 16), ++used;
+                else if (std::isdigit((unsigned char)word[0])) v = std::stoi(word, &used, 10);
+                else {
+                    auto it = program.symbols.find(word);
+                    if (it != program.symbols.end()) return it->second;
+                    if (final) error("undefined symbol " + word);
+                    return 0;
+                }
+                if (used != word.size()) error("bad number " + word);
+                return v;
+            }
+            catch (const std::logic_error&) {
+                error("bad number " + word);
+            }
+        }
+
+        // operands
+
+        operand_t classify(const std::string& written) {
+            static const char* REGISTER_WORDS[] = {
+                "A", "B", "C", "D", "E", "H", "L", "I", "R", "AF", "AF'", "BC", "DE", "HL", "SP", "IX", "IY",
+                "IXH", "IXL", "IYH", "IYL", "(C)", "(BC)", "(DE)", "(HL)", "(SP)", "NZ", "Z", "NC", "PO", "PE", "P", "M"
+            };
+            auto up = upper(written);
+            std::string squeezed;
+            for (auto c : up) {
+                if (!std::isspace((unsigned char)c)) squeezed += c;
+            }
+            for (auto word : REGISTER_WORDS) {
+                if (squeezed == word) return { { squeezed }, {} };
+            }
+            for (auto xy : { "IX", "IY" }) {
+                auto open = std::string("(") + xy;
+                if (squeezed == open + ")") return { { open + ")", open + "+d)" }, "0" };
+                if (squeezed.starts_with(open) && squeezed.back() == ')' && (squeezed[3] == '+' || squeezed[3] == '-')) {
+                    auto inner = trim(written.substr(written.find_first_of("xXyY") + 1));
+                    return { { open + "+d)" }, inner.substr(0, inner.size() - 1) };
+                }
+            }
+            if (wholly_parenthesised(written)) {
+                auto inner = trim(written).substr(1);
+                inner.pop_back();
+                return { { "(n)", "(nn)" }, inner };
+            }
+            auto value = evaluate(written);
+            return { { "#" + std::to_string(value), "n", "nn", "e" }, written };
+        }
+
+        static bool wholly_parenthesised(const std::string& s) {
+            auto t = trim(s);
+            if (t.size() < 2 || t.front() != '(' || t.back() != ')') return false;
+            int depth{ 0 };
+            for (size_t i{ 0 }; i < t.size(); ++i) {
+                if (t[i] == '(') ++depth;
+                else if (t[i] == ')' && --depth == 0 && i + 1 < t.size()) return false;
+            }
+            return true;
+        }
+
+        // the first combination of shapes that has a template
+        const encoding_t* find(const std::string& mnemonic, const std::vector<operand_t>& operands, std::vector<std::string>& chosen) {
+            chosen.assign(operands.size(), {});
+            const encoding_t* found{ nullptr };
+            auto search = [&](auto& self, size_t i, const std::string& key) -> void {
+                if (found) return;
+                if (i == operands.size()) {
+                    auto it = encodings().find(key);
+                    if (it != encodings().end()) found = &it->second;
+                    return;
+                }
+                for (const auto& shape : operands[i].shapes) {
+                    chosen[i] = shape;
+                    self(self, i + 1, key + (i ? "," : " ") + shape);
+                    if (found) return;
+                }
+            };
+            search(search, 0, mnemonic);
+            return found;
+        }
+
+        // the bytes of one instruction at pc
+        std::vector<uint8_t> encode(const std::string& mnemonic, const std::vector<std::string>& written) {
+            std::vector<operand_t> operands;
+            for (const auto& w : written) operands.push_back(classify(w));
+            std::vector<std::string> chosen;
+            auto encoding = find(mnemonic, operands, chosen);
+            if (!encoding) error("no such instruction");
+            auto bytes = z80_opcodes::prefix_bytes(encoding->prefix);
+            bool index_cb = encoding->prefix == prefix_t::ddcb || encoding->prefix == prefix_t::fdcb;
+            if (!index_cb) bytes.push_back(encoding->opcode);
+            auto length = (unsigned)bytes.size() + (index_cb ? 2 : 0);
+            for (const auto& shape : chosen) {
+                if (shape == "n" || shape == "(n)" || shape == "e" || shape.ends_with("+d)")) length += 1;
+                else if (shape == "nn" || shape == "(nn)") length += 2;
+            }
+            auto in_range = [this](int32_t v, int32_t lo, int32_t hi, const char* what) {
+                if (final && (v < lo || v > hi)) error(std::format("{} {} out of range", what, v));
+            };
+            for (size_t i{ 0 }; i < chosen.size(); ++i) {
+                const auto& shape = chosen[i];
+                if (shape == "n" || shape == "(n)") {
+                    auto v = evaluate(operands[i].expression);
+                    in_range(v, -128, 255, "byte");
+                    bytes.push_back((uint8_t)v);
+                }
+                else if (shape == "nn" || shape == "(nn)") {
+                    auto v = evaluate(operands[i].expression);
+                    in_range(v, -32768, 65535, "word");
+                    bytes.push_back((uint8_t)v);
+                    bytes.push_back((uint8_t)(v >> 8));
+                }
+                else if (shape == "e") {
+                    auto v = evaluate(operands[i].expression) - (pc + (int32_t)length);
+                    in_range(v, -128, 127, "relative jump");
+                    bytes.push_back((uint8_t)v);
+                }
+                else if (shape.ends_with("+d)")) {
+                    auto v = evaluate(operands[i].expression);
+                    in_range(v, -128, 127, "displacement");
+                    bytes.push_back((uint8_t)v);
+                }
+            }
+            if (index_cb) bytes.push_back(encoding->opcode);
+            return bytes;
+        }
+
+        // passes
+
+        void emit(const std::vector<uint8_t>& bytes) {
+            if (final) {
+                if (program.segments.empty()) program.segments.push_back({ (address_t)pc, {} });
+                auto& s = program.segments.back();
+                s.bytes.insert(s.bytes.end(), bytes.begin(), bytes.end());
+            }
+            pc += (int32_t)bytes.size();
+            if (pc > 0x10000) error("past the end of memory");
+        }
+
+        void define(const std::string& label, int32_t value) {
+            if (!final && program.symbols.contains(label)) error("duplicate label " + label);
+            program.symbols[label] = value;
+        }
+
+        void pass(bool last) {
+            final = last;
+            pc = 0;
+            program.segments.clear();
+            for (line_number = 1; line_number <= lines.size(); ++line_number) {
+                auto line = lines[line_number - 1];
+                // the comment, outside quotes
+                char quote{ 0 };
+                for (size_t i{ 0 }; i < line.size(); ++i) {
+                    if (quote) {
+                        if (line[i] == quote) quote = 0;
+                    }
+                    else if (line[i] == '"' || (line[i] == '\'' && i + 2 < line.size() && line[i + 2] == '\'')) {
+                        quote = line[i];
+                    }
+                    else if (line[i] == ';') {
+                        line.resize(i);
+                        break;
+                    }
+                }
+                if (trim(line).empty()) continue;
+                // the label
+                std::string label;
+                auto body = line;
+                auto first = trim(line);
+                auto end = first.find_first_of(" \t:");
+                auto word = first.substr(0, end);
+                if (end != std::string::npos && first[end] == ':') {
+                    label = word;
+                    body = first.substr(end + 1);
+                }
+                else if (!std::isspace((unsigned char)line[0]) && !is_mnemonic(upper(word))) {
+                    label = word;
+                    body = (end == std::string::npos) ? "" : first.substr(end);
+                }
+                auto [mnemonic, operands] = split_instruction(body);
+                if (mnemonic == "EQU") {
+                    if (label.empty() || operands.size() != 1) error("EQU needs a label and a value");
+                    define(label, evaluate(operands[0]));
+                    continue;
+                }
+                if (!label.empty()) define(label, pc);
+                if (mnemonic.empty()) continue;
+                if (mnemonic == "END") break;
+                if (mnemonic == "ORG") {
+                    if (operands.size() != 1) error("ORG needs an address");
+                    pc = evaluate(operands[0]);
+                    if (pc < 0 || pc > 0xFFFF) error("ORG out of range");
+                    if (final) program.segments.push_back({ (address_t)pc, {} });
+                }
+                else if (mnemonic == "DB" || mnemonic == "DEFB" || mnemonic == "DEFM") {
+                    std::vector<uint8_t> bytes;
+                    for (const auto& operand : operands) {
+                        if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"') {
+                            for (size_t i{ 1 }; i + 1 < operand.size(); ++i) bytes.push_back((uint8_t)operand[i]);
+                            continue;
+                        }
+                        auto v = evaluate(operand);
+                        if (final && (v < -128 || v > 255)) error(std::format("byte {} out of range", v));
+                        bytes.push_back((uint8_t)v);
+                    }
+                    emit(bytes);
+                }
+                else if (mnemonic == "DW" || mnemonic == "DEFW") {
+                    std::vector<uint8_t> bytes;
+                    for (const auto& operand : operands) {
+                        auto v = evaluate(operand);
+                        if (final && (v < -32768 || v > 0xFFFF)) error(std::format("word {} out of range", v));
+                        bytes.push_back((uint8_t)v);
+                        bytes.push_back((uint8_t)(v >> 8));
+                    }
+                    emit(bytes);
+                }
+                else if (mnemonic == "DS" || mnemonic == "DEFS") {
+                    if (operands.empty() || operands.size() > 2) error("DS needs a count");
+                    auto count = evaluate(operands[0]);
+                    if (count < 0 || pc + count > 0x10000) error("DS count out of range");
+                    emit(std::vector<uint8_t>((size_t)count, (uint8_t)(operands.size() == 2 ? evaluate(operands[1]) : 0)));
+                }
+                else {
+                    emit(encode(mnemonic, operands));
+                }
+            }
+        }
+
+        std::vector<std::string> lines;
+        z80_program program;
+        size_t line_number{ 0 };
+        int32_t pc{ 0 };
+        bool final{ false };
+
+        // the expression being parsed
+        std::string text;
+        size_t at{ 0 };
+
+    };
+
+}
@@ -0,0 +1,167 @@
+/**
+
+    @file      z80_capi.cpp
+    @brief     the C API over emu::z80_machine
+    @details   every entry point that can fail catches at the boundary and keeps the message in the handle
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <string>
+
+#include "z80_capi.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+#include "z80_registers.h"
+
+struct z80_emulator {
+    emu::z80_machine machine;
+    std::string error;
+};
+
+static_assert(offsetof(z80_state_t, sp) == SP && offsetof(z80_state_t, pc) == PC
+    && offsetof(z80_state_t, ix) == IX && offsetof(z80_state_t, iy) == IY
+    && offsetof(z80_state_t, f_) == SHADOW && offsetof(z80_state_t, iff1) == Z80_SRAM_SIZE,
+    "z80_state_t starts with the register file");
+static_assert(Z80_TRAP_DECLINE == emu::z80_machine::traps_t::DECLINE, "the same decline");
+
+namespace {
+
+    // runs f, a thrown exception becomes Z80_ERROR with its message
+    template<typename F>
+    z80_status guard(z80_emulator* z80, F f) {
+        try {
+            f();
+            z80->error.clear();
+            return Z80_OK;
+        }
+        catch (const std::exception& e) {
+            z80->error = e.what();
+        }
+        catch (...) {
+            z80->error = "unknown error";
+        }
+        return Z80_ERROR;
+    }
+
+}
+
+z80_emulator* z80_create(void) {
+    auto z80 = new (std::nothrow) z80_emulator;
+    if (z80) {
+        z80->machine.attach(emu::z80_core{});
+    }
+    return z80;
+}
+
+void z80_destroy(z80_emulator* z80) {
+    delete z80;
+}
+
+const char* z80_error(const z80_emulator* z80) {
+    return z80->error.c_str();
+}
+
+z80_status z80_load(z80_emulator* z80, const char* filename, uint16_t addr) {
+    return guard(z80, [&] { z80->machine.load(filename, addr); });
+}
+
+z80_status z80_protect(z80_emulator* z80, uint16_t begin, uint16_t end) {
+    return guard(z80, [&] { z80->machine.protect(begin, end); });
+}
+
+z80_status z80_read_memory(z80_emulator* z80, uint16_t addr, void* out, size_t n) {
+    return guard(z80, [&] { z80->machine.read_block(addr, out, n); });
+}
+
+z80_status z80_write_memory(z80_emulator* z80, uint16_t addr, const void* in, size_t n) {
+    return guard(z80, [&] { z80->machine.write_block(addr, in, n); });
+}
+
+z80_status z80_run(z80_emulator* z80, uint64_t tstates) {
+    return guard(z80, [&] { z80->machine.run(z80->machine.cycles() + tstates); });
+}
+
+z80_status z80_step(z80_emulator* z80, uint64_t instructions) {
+    return guard(z80, [&] {
+        auto& m = z80->machine;
+        for (uint64_t i{ 0 }; i < instructions; ++i) {
+            m.events().service(m.cycles());
+            m.step();
+        }
+    });
+}
+
+uint64_t z80_cycles(const z80_emulator* z80) {
+    return z80->machine.cycles();
+}
+
+void z80_interrupt(z80_emulator* z80, int level) {
+    z80->machine.interrupt(level != 0);
+}
+
+void z80_nmi(z80_emulator* z80) {
+    z80->machine.nmi();
+}
+
+void z80_get_state(z80_emulator* z80, z80_state_t* state) {
+    std::memcpy(state, &z80->machine.snapshot().byte(0), Z80_SRAM_SIZE);
+    const auto& cpu = z80->machine.control();
+    state->iff1 = cpu.iff1;
+    state->iff2 = cpu.iff2;
+    state->im = cpu.im;
+    state->halted = cpu.halted;
+    state->int_line = cpu.int_line;
+    state->nmi = cpu.nmi;
+    state->ei_delay = cpu.ei_delay;
+    state->q = cpu.q;
+    state->memptr = cpu.memptr;
+}
+
+void z80_set_state(z80_emulator* z80, const z80_state_t* state) {
+    auto& m = z80->machine;
+    std::memcpy(&m.registers().byte(0), state, Z80_SRAM_SIZE);
+    m.refresh_register(state->r);
+    auto& cpu = m.control();
+    cpu.iff1 = state->iff1 != 0;
+    cpu.iff2 = state->iff2 != 0;
+    cpu.im = state->im;
+    cpu.halted = state->halted != 0;
+    cpu.int_line = state->int_line != 0;
+    cpu.nmi = state->nmi != 0;
+    cpu.ei_delay = state->ei_delay != 0;
+    cpu.q = state->q;
+    cpu.memptr = state->memptr;
+}
+
+void z80_on_in(z80_emulator* z80, z80_in_fn in, void* user) {
+    if (in) z80->machine.on_in([in, user](emu::address_t port) { return (emu::byte_t)in(user, port); });
+    else z80->machine.on_in(nullptr);
+}
+
+void z80_on_out(z80_emulator* z80, z80_out_fn out, void* user) {
+    if (out) z80->machine.on_out([out, user](emu::address_t port, emu::byte_t b) { out(user, port, (uint8_t)b); });
+    else z80->machine.on_out(nullptr);
+}
+
+z80_status z80_trap(z80_emulator* z80, uint16_t pc, z80_trap_fn trap, void* user, int returns) {
+    return guard(z80, [&] {
+        z80->machine.trap(pc, [z80, trap, user, pc](emu::z80_machine&) { return (unsigned)trap(user, z80, pc); }, returns != 0);
+    });
+}
+
+void z80_untrap(z80_emulator* z80, uint16_t pc) {
+    z80->machine.untrap(pc);
+}
+
+z80_status z80_schedule(z80_emulator* z80, uint64_t when, z80_event_fn event, void* user) {
+    return guard(z80, [&] {
+        z80->machine.events().schedule(when, [z80, event, user](emu::cycle_t at) { event(user, z80, at); });
+    });
+}
@@ -0,0 +1,104 @@
+/**
+
+    @file      z80_capi.h
+    @brief     C API for embedding the emulator in a host across a binary boundary
+    @details   a machine is an opaque handle with the interpreting core attached, every call does as much work as it
+               can so that a host makes few of them:
+               + z80_run() runs for a number of T-states with all of the machine's fast paths, millions of
+                 instructions in one call, z80_step() a number of single instructions with due events serviced
+               + z80_state_t is the register file in the machine's own layout followed by the CPU control state,
+                 getting or setting it is one copy of the register file
+               + z80_read_memory() and z80_write_memory() copy a whole range, a write bypasses ROM protection
+               + callbacks are plain function pointers with a user pointer: port input and output, native traps by
+                 PC and one shot events at a T-state, a callback may call back into the API for the same machine
+               + a call that can fail returns Z80_OK or Z80_ERROR and z80_error() has the reason, no exception
+                 crosses the boundary
+               R in the state is up to date, the T-state count only moves by running
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(Z80_CAPI_EXPORTS)
+#define Z80_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(Z80_CAPI_IMPORTS)
+#define Z80_API __declspec(dllimport)
+#else
+#define Z80_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    typedef struct z80_emulator z80_emulator;
+
+    typedef enum z80_status {
+        Z80_OK = 0,
+        Z80_ERROR = -1
+    } z80_status;
+
+    // the register file, byte for byte as the machine stores it, words are little-endian
+    typedef struct z80_state_t {
+        uint8_t f, a, b, c, d, e, h, l, i, r;
+        uint16_t sp, pc, ix, iy;
+        uint8_t f_, a_, b_, c_, d_, e_, h_, l_;     // the shadow registers
+        uint8_t iff1, iff2, im, halted;
+        uint8_t int_line, nmi, ei_delay, q;
+        uint16_t memptr;
+    } z80_state_t;
+
+    // returns the byte read from the port, the whole 16 bit address is on the bus
+    typedef uint8_t (*z80_in_fn)(void* user, uint16_t port);
+    typedef void (*z80_out_fn)(void* user, uint16_t port, uint8_t value);
+    // returns the T-states the trapped routine takes, or Z80_TRAP_DECLINE to run the original code
+    typedef uint32_t (*z80_trap_fn)(void* user, z80_emulator* z80, uint16_t pc);
+    // called with the T-state it was scheduled for
+    typedef void (*z80_event_fn)(void* user, z80_emulator* z80, uint64_t when);
+
+#define Z80_TRAP_DECLINE 0xFFFFFFFFu
+
+    // lifetime
+
+    Z80_API z80_emulator* z80_create(void);
+    Z80_API void z80_destroy(z80_emulator* z80);
+    // the reason for the last Z80_ERROR, "" if there was none
+    Z80_API const char* z80_error(const z80_emulator* z80);
+
+    // images and memory
+
+    Z80_API z80_status z80_load(z80_emulator* z80, const char* filename, uint16_t addr);
+    Z80_API z80_status z80_protect(z80_emulator* z80, uint16_t begin, uint16_t end);
+    Z80_API z80_status z80_read_memory(z80_emulator* z80, uint16_t addr, void* out, size_t n);
+    Z80_API z80_status z80_write_memory(z80_emulator* z80, uint16_t addr, const void* in, size_t n);
+
+    // execution
+
+    Z80_API z80_status z80_run(z80_emulator* z80, uint64_t tstates);
+    Z80_API z80_status z80_step(z80_emulator* z80, uint64_t instructions);
+    Z80_API uint64_t z80_cycles(const z80_emulator* z80);
+    Z80_API void z80_interrupt(z80_emulator* z80, int level);
+    Z80_API void z80_nmi(z80_emulator* z80);
+
+    // state
+
+    Z80_API void z80_get_state(z80_emulator* z80, z80_state_t* state);
+    Z80_API void z80_set_state(z80_emulator* z80, const z80_state_t* state);
+
+    // callbacks, a null function removes the handler
+
+    Z80_API void z80_on_in(z80_emulator* z80, z80_in_fn in, void* user);
+    Z80_API void z80_on_out(z80_emulator* z80, z80_out_fn out, void* user);
+    // a returning trap pops PC as the routine's RET would
+    Z80_API z80_status z80_trap(z80_emulator* z80, uint16_t pc, z80_trap_fn trap, void* user, int returns);
+    Z80_API void z80_untrap(z80_emulator* z80, uint16_t pc);
+    Z80_API z80_status z80_schedule(z80_emulator* z80, uint64_t when, z80_event_fn event, void* user);
+
+#ifdef __cplusplus
+}
+#endif
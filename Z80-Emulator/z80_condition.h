@@ -0,0 +1,409 @@
+/**
+
+    @file      z80_condition.h
+    @brief     breakpoint conditions compiled once to a stack bytecode e.g. "HL == 0x4000 && (IY+0x3B) & 0x80"
+    @details   the expression language is C's integer expressions over the machine:
+               + registers by their z80_registers.h names, F A B C D E H L I R SP PC IX IY and the shadows F' A'
+                 B' C' D' E' H' L', the pairs AF BC DE HL AF' BC' DE' HL', and cycles, the T-state count
+               + the flag masks CARRY NEGATE PARITY_OVERFLOW BIT3_Y HALF_CARRY BIT5_X ZERO SIGN e.g. F & ZERO
+               + (e) is the byte at address e as in Z80 assembly, so [ ] groups
+               + numbers are decimal, 0x or $ hex and % binary, names are not case sensitive
+               + || && | ^ & == != < <= > >= << >> + - * / % and unary ! ~ -, with C's precedence, && and || short
+                 circuit, / and % by 0 are 0
+               the parse tree is folded, every subexpression of constants is one constant, then emitted as
+               bytecode that evaluate() runs with a switch over a fixed stack, a few tens of nanoseconds for a
+               typical condition; memory is read without contention or watchpoints
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "z80_registers.h"
+
+namespace emu {
+
+    class z80_condition {
+
+        static constexpr size_t MAX_DEPTH = 32;
+
+        enum class op_t : uint8_t {
+            push,           // the constant
+            byte,           // register file byte at index
+            pair,           // register file bytes at index (high) and index + 1
+            word,           // little-endian register file word at index
+            refresh,        // R
+            cycles,
+            peek,           // the byte at the address on top
+            neg, invert, lnot, truth,
+            mul, div, mod, add, sub, shl, shr, lt, le, gt, ge, eq, ne, band, bxor, bor,
+            and_then,       // jump over the right side if the left is 0, it is the result
+            or_else         // jump over the right side if the left is not, 1 is the result
+        };
+
+        struct instruction_t {
+            op_t op;
+            int64_t operand;
+        };
+
+        struct node_t {
+            op_t op;
+            int64_t value{ 0 };
+            std::unique_ptr<node_t> left;
+            std::unique_ptr<node_t> right;
+        };
+
+        using node_ptr = std::unique_ptr<node_t>;
+
+    public:
+
+        z80_condition() = default;
+
+        explicit z80_condition(const std::string& text) {
+            parser p{ text };
+            auto tree = p.expression(0);
+            p.skip_space();
+            if (p.at < text.size()) {
+                p.error("unexpected");
+            }
+            fold(tree);
+            emit(*tree);
+            if (depth_ > MAX_DEPTH) {
+                throw std::runtime_error(std::format("condition error: \"{}\" nests deeper than {}", text, MAX_DEPTH));
+            }
+            text_ = text;
+        }
+
+        template<typename MACHINE>
+        int64_t evaluate(MACHINE& m) const {
+            int64_t stack[MAX_DEPTH];
+            auto top = stack - 1;
+            auto& regs = m.registers();
+            const auto* code = program.data();
+            const auto* end = code + program.size();
+            for (auto ip = code; ip < end; ++ip) {
+                switch (ip->op) {
+                case op_t::push: *++top = ip->operand; break;
+                case op_t::byte: *++top = (uint8_t)regs.byte(ip->operand); break;
+                case op_t::pair: *++top = (uint8_t)regs.byte(ip->operand) << 8 | (uint8_t)regs.byte(ip->operand + 1); break;
+                case op_t::word: *++top = (uint16_t)regs.word(ip->operand); break;
+                case op_t::refresh: *++top = m.refresh_register(); break;
+                case op_t::cycles: *++top = (int64_t)m.cycles(); break;
+                case op_t::peek: *top = (uint8_t)m.ram()[(address_t)*top]; break;
+                case op_t::and_then:
+                    if (*top == 0) ip += ip->operand;
+                    else --top;
+                    break;
+                case op_t::or_else:
+                    if (*top != 0) {
+                        *top = 1;
+                        ip += ip->operand;
+                    }
+                    else {
+                        --top;
+                    }
+                    break;
+                default:
+                    if (ip->op <= op_t::truth) {
+                        *top = unary(ip->op, *top);
+                    }
+                    else {
+                        --top;
+                        *top = binary(ip->op, top[0], top[1]);
+                    }
+                    break;
+                }
+            }
+            return *top;
+        }
+
+        template<typename MACHINE>
+        inline bool operator()(MACHINE& m) const {
+            return evaluate(m) != 0;
+        }
+
+        inline const std::string& text() const {
+            return text_;
+        }
+
+        // the number of bytecode instructions, 1 for a constant
+        inline size_t size() const {
+            return program.size();
+        }
+
+        inline bool constant() const {
+            return program.size() == 1 && program[0].op == op_t::push;
+        }
+
+    private:
+
+        static int64_t unary(op_t op, int64_t x) {
+            switch (op) {
+            case op_t::neg: return -x;
+            case op_t::invert: return ~x;
+            case op_t::lnot: return !x;
+            default: return x != 0;
+            }
+        }
+
+        static int64_t binary(op_t op, int64_t x, int64_t y) {
+            switch (op) {
+            case op_t::mul: return x * y;
+            case op_t::div: return y ? x / y : 0;
+            case op_t::mod: return y ? x % y : 0;
+            case op_t::add: return x + y;
+            case op_t::sub: return x - y;
+            case op_t::shl: return (y < 0 || y > 63) ? 0 : (int64_t)((uint64_t)x << y);
+            case op_t::shr: return (y < 0 || y > 63) ? 0 : x >> y;
+            case op_t::lt: return x < y;
+            case op_t::le: return x <= y;
+            case op_t::gt: return x > y;
+            case op_t::ge: return x >= y;
+            case op_t::eq: return x == y;
+            case op_t::ne: return x != y;
+            case op_t::band: return x & y;
+            case op_t::bxor: return x ^ y;
+            case op_t::bor: return x | y;
+            case op_t::and_then: return x && y;
+            default: return x || y;
+            }
+        }
+
+        static node_ptr leaf(op_t op, int64_t value) {
+            return std::make_unique<node_t>(node_t{ op, value, nullptr, nullptr });
+        }
+
+        static node_ptr branch(op_t op, node_ptr left, node_ptr right = nullptr) {
+            return std::make_unique<node_t>(node_t{ op, 0, std::move(left), std::move(right) });
+        }
+
+        struct parser {
+
+            const std::string& text;
+            size_t at{ 0 };
+
+            [[noreturn]] void error(const char* what) const {
+                throw std::runtime_error(std::format("condition error: {} at {} in \"{}\"", what, at, text));
+            }
+
+            void skip_space() {
+                while (at < text.size() && std::isspace((unsigned char)text[at])) ++at;
+            }
+
+            bool accept(const char* token) {
+                skip_space();
+                auto n = std::char_traits<char>::length(token);
+                if (text.compare(at, n, token) != 0) {
+                    return false;
+                }
+                // < is not the start of <= or <<, & not of &&, | not of ||
+                if (n == 1 && at + 1 < text.size()) {
+                    auto next = text[at + 1];
+                    if ((token[0] == '<' || token[0] == '>') && (next == '=' || next == token[0])) return false;
+                    if ((token[0] == '&' || token[0] == '|') && next == token[0]) return false;
+                    if ((token[0] == '!' || token[0] == '=') && next == '=') return false;
+                }
+                at += n;
+                return true;
+            }
+
+            void expect(const char* token) {
+                if (!accept(token)) error(std::format("expected {}", token).c_str());
+            }
+
+            // binary operators from the loosest, C's precedence
+            struct level_t {
+                const char* token;
+                op_t op;
+                int precedence;
+            };
+
+            static constexpr level_t OPERATORS[] = {
+                { "||", op_t::or_else, 1 }, { "&&", op_t::and_then, 2 }, { "|", op_t::bor, 3 }, { "^", op_t::bxor, 4 },
+                { "&", op_t::band, 5 }, { "==", op_t::eq, 6 }, { "!=", op_t::ne, 6 }, { "<=", op_t::le, 7 },
+                { ">=", op_t::ge, 7 }, { "<<", op_t::shl, 8 }, { ">>", op_t::shr, 8 }, { "<", op_t::lt, 7 },
+                { ">", op_t::gt, 7 }, { "+", op_t::add, 9 }, { "-", op_t::sub, 9 }, { "*", op_t::mul, 10 },
+                { "/", op_t::div, 10 }, { "%", op_t::mod, 10 }
+            };
+
+            node_ptr expression(int precedence) {
+                auto left = unary_expression();
+                while (true) {
+                    const level_t* found{ nullptr };
+                    auto mark = at;
+                    for (const auto& level : OPERATORS) {
+                        if (level.precedence > precedence && accept(level.token)) {
+                            found = &level;
+                            break;
+                        }
+                        at = mark;
+                    }
+                    if (!found) {
+                        return left;
+                    }
+                    left = branch(found->op, std::move(left), expression(found->precedence));
+                }
+            }
+
+            node_ptr unary_expression() {
+                if (accept("!")) return branch(op_t::lnot, unary_expression());
+                if (accept("~")) return branch(op_t::invert, unary_expression());
+                if (accept("-")) return branch(op_t::neg, unary_expression());
+                if (accept("+")) return unary_expression();
+                return primary();
+            }
+
+            node_ptr primary() {
+                skip_space();
+                if (accept("[")) {
+                    auto e = expression(0);
+                    expect("]");
+                    return e;
+                }
+                if (accept("(")) {
+                    auto e = expression(0);
+                    expect(")");
+                    return branch(op_t::peek, std::move(e));
+                }
+                if (at < text.size() && (std::isdigit((unsigned char)text[at]) || text[at] == '$' || text[at] == '%')) {
+                    return leaf(op_t::push, number());
+                }
+                if (at < text.size() && (std::isalpha((unsigned char)text[at]) || text[at] == '_')) {
+                    return name();
+                }
+                error(at < text.size() ? "unexpected" : "expected an operand");
+            }
+
+            int64_t number() {
+                int base = 10;
+                if (text[at] == '$') { base = 16; ++at; }
+                else if (text[at] == '%') { base = 2; ++at; }
+                else if (text.compare(at, 2, "0x") == 0 || text.compare(at, 2, "0X") == 0) { base = 16; at += 2; }
+                auto begin = at;
+                int64_t value{ 0 };
+                while (at < text.size() && std::isxdigit((unsigned char)text[at])) {
+                    auto c = (char)std::toupper((unsigned char)text[at]);
+                    int digit = std::isdigit((unsigned char)c) ? c - '0' : c - 'A' + 10;
+                    if (digit >= base) break;
+                    value = value * base + digit;
+                    ++at;
+                }
+                if (at == begin) error("expected digits");
+                return value;
+            }
+
+            node_ptr name() {
+                auto begin = at;
+                while (at < text.size() && (std::isalnum((unsigned char)text[at]) || text[at] == '_')) ++at;
+                if (at < text.size() && text[at] == '\'') ++at;
+                std::string word;
+                for (auto i{ begin }; i < at; ++i) word += (char)std::toupper((unsigned char)text[i]);
+                auto shadow = word.back() == '\'';
+                if (shadow) word.pop_back();
+                static constexpr const char* BYTES[] = { "F", "A", "B", "C", "D", "E", "H", "L" };
+                for (int i{ 0 }; i < 8; ++i) {
+                    if (word == BYTES[i]) return leaf(op_t::byte, shadow ? SHADOW + i : i);
+                }
+                if (word == "AF") return leaf(op_t::word, shadow ? SHADOW + F : F);
+                if (word == "BC") return leaf(op_t::pair, shadow ? SHADOW + B : B);
+                if (word == "DE") return leaf(op_t::pair, shadow ? SHADOW + D : D);
+                if (word == "HL") return leaf(op_t::pair, shadow ? SHADOW + H : H);
+                if (!shadow) {
+                    if (word == "I") return leaf(op_t::byte, I);
+                    if (word == "R") return leaf(op_t::refresh, 0);
+                    if (word == "SP") return leaf(op_t::word, SP);
+                    if (word == "PC") return leaf(op_t::word, PC);
+                    if (word == "IX") return leaf(op_t::word, IX);
+                    if (word == "IY") return leaf(op_t::word, IY);
+                    if (word == "CYCLES") return leaf(op_t::cycles, 0);
+                    struct flag_t { const char* name; int mask; };
+                    static constexpr flag_t FLAGS[] = {
+                        { "CARRY", CARRY }, { "NEGATE", NEGATE }, { "PARITY_OVERFLOW", PARITY_OVERFLOW }, { "BIT3_Y", BIT3_Y },
+                        { "HALF_CARRY", HALF_CARRY }, { "BIT5_X", BIT5_X }, { "ZERO", ZERO }, { "SIGN", SIGN }
+                    };
+                    for (const auto& flag : FLAGS) {
+                        if (word == flag.name) return leaf(op_t::push, flag.mask);
+                    }
+                }
+                at = begin;
+                error("unknown name");
+            }
+
+        };
+
+        // every subexpression of constants becomes one, and && or || with a constant side needs no jump
+        static void fold(node_ptr& n) {
+            if (n->left) fold(n->left);
+            if (n->right) fold(n->right);
+            auto constant = [](const node_ptr& p) { return p && p->op == op_t::push; };
+            if (!n->left || n->op == op_t::peek) {
+                return;
+            }
+            if (!n->right) {
+                if (constant(n->left)) n = leaf(op_t::push, unary(n->op, n->left->value));
+                return;
+            }
+            if (constant(n->left) && constant(n->right)) {
+                n = leaf(op_t::push, binary(n->op, n->left->value, n->right->value));
+                return;
+            }
+            // the expressions have no side effects, so a constant side decides or drops out
+            if (n->op == op_t::and_then || n->op == op_t::or_else) {
+                auto absorbing = (n->op == op_t::or_else);
+                for (auto* side : { &n->left, &n->right }) {
+                    if (constant(*side) && ((*side)->value != 0) == absorbing) {
+                        n = leaf(op_t::push, absorbing ? 1 : 0);
+                        return;
+                    }
+                }
+                if (constant(n->left)) n = branch(op_t::truth, std::move(n->right));
+                else if (constant(n->right)) n = branch(op_t::truth, std::move(n->left));
+            }
+        }
+
+        void emit(const node_t& n) {
+            switch (n.op) {
+            case op_t::push: case op_t::byte: case op_t::pair: case op_t::word: case op_t::refresh: case op_t::cycles:
+                program.push_back({ n.op, n.value });
+                depth_ = std::max(depth_, ++height);
+                return;
+            case op_t::and_then: case op_t::or_else: {
+                emit(*n.left);
+                auto jump = program.size();
+                program.push_back({ n.op, 0 });
+                --height;
+                emit(*n.right);
+                program.push_back({ op_t::truth, 0 });
+                program[jump].operand = (int64_t)(program.size() - 1 - jump);
+                return;
+            }
+            default:
+                emit(*n.left);
+                if (n.right) {
+                    emit(*n.right);
+                    --height;
+                }
+                program.push_back({ n.op, 0 });
+                return;
+            }
+        }
+
+        std::vector<instruction_t> program;
+        size_t height{ 0 };         // of the stack while emitting
+        size_t depth_{ 0 };
+        std::string text_;
+
+    };
+
+}
@@ -0,0 +1,847 @@
+/**
+
+    @file      z80_core.h
+    @brief     an interpreting Z80 CPU core for z80_machine
+    @details   attach to a machine with m.attach(emu::z80_core{}), each call executes one instruction or accepts one
+               interrupt:
+               + decodes the opcode by its fields x (bits 7-6), y (5-3), z (2-0), p (y >> 1) and q (y & 1), with
+                 DD and FD substituting IX or IY for HL, IXH, IXL, IYH and IYL included
+               + every documented and undocumented instruction, x and y flags, MEMPTR and Q (see z80_control_t)
+               + T-states are charged machine cycle by machine cycle so that contention sees each access at its
+                 own T-state, the totals are those of the Zilog data sheet
+               + the refresh register is counted through the machine, one M1 per opcode and prefix byte
+               + HALT leaves PC after the HALT and sets control().halted, the machine runs the NOPs
+               + interrupts are accepted between instructions, never straight after EI or a prefix, IM 0 assumes
+                 the data bus holds $FF i.e. RST $38
+               + z80_core is basic_z80_core<true>, basic_z80_core<false> leaves MEMPTR and Q alone, tracking them
+                 is not free, each is stored as the instruction executes and together they cost the step loop
+                 roughly 5-15% with GCC -O2 (test_alu verbose reports it)
+               the ALU is z80_alu.h
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include "z80_alu.h"
+#include "z80_machine.h"
+#include "z80_registers.h"
+
+namespace emu {
+
+    template<bool HIDDEN>
+    class basic_z80_core {
+
+        static constexpr uint8_t IM_OF[8] = { 0, 0, 1, 2, 0, 0, 1, 2 };
+
+    public:
+
+        void operator()(z80_machine& machine) {
+            m = &machine;
+            regs = &machine.registers();
+            cpu = &machine.control();
+            if (cpu->nmi) {
+                accept_nmi();
+                return;
+            }
+            if (cpu->int_line && cpu->iff1 && !cpu->ei_delay) {
+                accept_int();
+                return;
+            }
+            cpu->ei_delay = false;
+            flags_written = false;
+            index = HL_INDEX;
+            execute(fetch_opcode());
+            if constexpr (HIDDEN) {
+                cpu->q = flags_written ? (uint8_t)regs->byte(F) : 0;
+            }
+        }
+
+    private:
+
+        static constexpr int HL_INDEX = 0;
+        static constexpr int IX_INDEX = 1;
+        static constexpr int IY_INDEX = 2;
+
+        // machine cycles
+
+        inline void tick(unsigned tstates) {
+            m->tick(tstates);
+        }
+
+        // MEMPTR is stored only by the core that tracks it
+        inline void memptr(uint16_t v) {
+            if constexpr (HIDDEN) {
+                cpu->memptr = v;
+            }
+        }
+
+        inline uint8_t fetch_opcode() {
+            auto b = (uint8_t)m->fetch(pc());
+            pc(pc() + 1);
+            tick(4);
+            return b;
+        }
+
+        inline uint8_t fetch_byte() {
+            auto b = (uint8_t)m->read(pc());
+            pc(pc() + 1);
+            tick(3);
+            return b;
+        }
+
+        inline uint16_t fetch_word() {
+            uint16_t lo = fetch_byte();
+            return (uint16_t)(fetch_byte() << 8 | lo);
+        }
+
+        inline uint8_t rd(uint16_t addr) {
+            auto b = (uint8_t)m->read(addr);
+            tick(3);
+            return b;
+        }
+
+        inline void wr(uint16_t addr, uint8_t b) {
+            m->write(addr, (byte_t)b);
+            tick(3);
+        }
+
+        inline uint16_t rd16(uint16_t addr) {
+            uint16_t lo = rd(addr);
+            return (uint16_t)(rd((uint16_t)(addr + 1)) << 8 | lo);
+        }
+
+        inline void wr16(uint16_t addr, uint16_t w) {
+            wr(addr, (uint8_t)w);
+            wr((uint16_t)(addr + 1), (uint8_t)(w >> 8));
+        }
+
+        inline uint8_t port_in(uint16_t port) {
+            auto b = (uint8_t)m->in(port);
+            tick(4);
+            return b;
+        }
+
+        inline void port_out(uint16_t port, uint8_t b) {
+            m->out(port, (byte_t)b);
+            tick(4);
+        }
+
+        inline void push(uint16_t w) {
+            auto sp = (uint16_t)(regs->word(SP) - 1);
+            wr(sp, (uint8_t)(w >> 8));
+            --sp;
+            wr(sp, (uint8_t)w);
+            regs->word(SP) = (word_t)sp;
+        }
+
+        inline uint16_t pop() {
+            auto sp = (uint16_t)regs->word(SP);
+            auto w = rd16(sp);
+            regs->word(SP) = (word_t)(sp + 2);
+            return w;
+        }
+
+        // registers
+
+        inline uint16_t pc() {
+            return (uint16_t)regs->word(PC);
+        }
+
+        inline void pc(uint16_t w) {
+            regs->word(PC) = (word_t)w;
+        }
+
+        inline uint8_t a() {
+            return (uint8_t)regs->byte(A);
+        }
+
+        inline void a(uint8_t v) {
+            regs->byte(A) = (byte_t)v;
+        }
+
+        inline uint8_t f() {
+            return (uint8_t)regs->byte(F);
+        }
+
+        // flags written by an ALU operation, Q follows them
+        inline void f(uint8_t v) {
+            regs->byte(F) = (byte_t)v;
+            flags_written = true;
+        }
+
+        // r[z] with H and L replaced by the index halves under a DD or FD prefix
+        inline size_t r8(unsigned z, bool indexed = true) {
+            static constexpr size_t REG[8] = { B, C, D, E, H, L, 0, A };
+            if (indexed && index != HL_INDEX && (z == 4 || z == 5)) {
+                auto base = (index == IX_INDEX) ? IX : IY;
+                return (z == 4) ? base + 1 : base;      // the index words are little endian
+            }
+            return REG[z];
+        }
+
+        inline uint16_t hl() {
+            switch (index) {
+            case IX_INDEX: return (uint16_t)regs->word(IX);
+            case IY_INDEX: return (uint16_t)regs->word(IY);
+            default: return get_pair(*regs, H);
+            }
+        }
+
+        inline void hl(uint16_t w) {
+            switch (index) {
+            case IX_INDEX: regs->word(IX) = (word_t)w; break;
+            case IY_INDEX: regs->word(IY) = (word_t)w; break;
+            default: set_pair(*regs, H, w);
+            }
+        }
+
+        // rp[p]: BC, DE, HL, SP
+        inline uint16_t rp(unsigned p) {
+            switch (p) {
+            case 0: return get_pair(*regs, B);
+            case 1: return get_pair(*regs, D);
+            case 2: return hl();
+            default: return (uint16_t)regs->word(SP);
+            }
+        }
+
+        inline void rp(unsigned p, uint16_t w) {
+            switch (p) {
+            case 0: set_pair(*regs, B, w); break;
+            case 1: set_pair(*regs, D, w); break;
+            case 2: hl(w); break;
+            default: regs->word(SP) = (word_t)w;
+            }
+        }
+
+        // rp2[p]: BC, DE, HL, AF
+        inline uint16_t rp2(unsigned p) {
+            return (p == 3) ? (uint16_t)(a() << 8 | f()) : rp(p);
+        }
+
+        inline void rp2(unsigned p, uint16_t w) {
+            if (p == 3) {
+                regs->byte(A) = (byte_t)(w >> 8);
+                regs->byte(F) = (byte_t)w;
+            }
+            else {
+                rp(p, w);
+            }
+        }
+
+        // cc[y]: NZ, Z, NC, C, PO, PE, P, M
+        inline bool condition(unsigned y) {
+            static constexpr uint8_t FLAG[4] = { ZERO, CARRY, PARITY_OVERFLOW, SIGN };
+            bool set = f() & FLAG[y >> 1];
+            return (y & 1) ? set : !set;
+        }
+
+        // the (HL) operand, or (IX+d) with its displacement fetched and the address calculation charged
+        inline uint16_t operand_address(unsigned internal = 5) {
+            if (index == HL_INDEX) {
+                return get_pair(*regs, H);
+            }
+            auto d = (int8_t)fetch_byte();
+            tick(internal);
+            auto addr = (uint16_t)(hl() + d);
+            memptr(addr);
+            return addr;
+        }
+
+        // the 8 ALU operations, alu[y]
+        inline void alu_op(unsigned y, uint8_t v) {
+            auto flags = f();
+            switch (y) {
+            case 0: a(alu::add(a(), v, flags)); break;
+            case 1: a(alu::adc(a(), v, flags)); break;
+            case 2: a(alu::sub(a(), v, flags)); break;
+            case 3: a(alu::sbc(a(), v, flags)); break;
+            case 4: a(alu::and_(a(), v, flags)); break;
+            case 5: a(alu::xor_(a(), v, flags)); break;
+            case 6: a(alu::or_(a(), v, flags)); break;
+            default: alu::cp(a(), v, flags); break;
+            }
+            f(flags);
+        }
+
+        // rot[y]
+        inline uint8_t rot(unsigned y, uint8_t v) {
+            auto flags = f();
+            switch (y) {
+            case 0: v = alu::rlc(v, flags); break;
+            case 1: v = alu::rrc(v, flags); break;
+            case 2: v = alu::rl(v, flags); break;
+            case 3: v = alu::rr(v, flags); break;
+            case 4: v = alu::sla(v, flags); break;
+            case 5: v = alu::sra(v, flags); break;
+            case 6: v = alu::sll(v, flags); break;
+            default: v = alu::srl(v, flags); break;
+            }
+            f(flags);
+            return v;
+        }
+
+        inline void jump(uint16_t target) {
+            pc(target);
+            memptr(target);
+        }
+
+        inline void relative(int8_t e) {
+            tick(5);
+            jump((uint16_t)(pc() + e));
+        }
+
+        inline void call(uint16_t target) {
+            push(pc());
+            jump(target);
+        }
+
+        // interrupts
+
+        void accept_nmi() {
+            cpu->nmi = false;
+            cpu->halted = false;
+            cpu->iff1 = false;
+            cpu->ei_delay = false;
+            cpu->q = 0;
+            m->refresh(1);
+            tick(5);
+            call(0x0066);
+        }
+
+        void accept_int() {
+            cpu->halted = false;
+            cpu->iff1 = cpu->iff2 = false;
+            cpu->q = 0;
+            m->refresh(1);
+            tick(7);                                    // acknowledge with 2 wait states
+            if (cpu->im == 2) {
+                auto vector = (uint16_t)((uint8_t)regs->byte(I) << 8 | 0xFF);
+                push(pc());
+                jump(rd16(vector));
+            }
+            else {
+                call(0x0038);
+            }
+        }
+
+        // unprefixed, or DD/FD prefixed when index is set
+
+        void execute(uint8_t op) {
+            unsigned x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+            switch (x) {
+            case 0: execute_x0(y, z, p, q); break;
+            case 1:
+                if (op == 0x76) {                                           // HALT
+                    cpu->halted = true;
+                }
+                else if (z == 6) {                                          // LD r,(HL)
+                    auto addr = operand_address();
+                    regs->byte(r8(y, false)) = (byte_t)rd(addr);
+                }
+                else if (y == 6) {                                          // LD (HL),r
+                    auto addr = operand_address();
+                    wr(addr, (uint8_t)regs->byte(r8(z, false)));
+                }
+                else {                                                      // LD r,r'
+                    regs->byte(r8(y)) = regs->byte(r8(z));
+                }
+                break;
+            case 2:
+                if (z == 6) {
+                    auto addr = operand_address();
+                    alu_op(y, rd(addr));
+                }
+                else {
+                    alu_op(y, (uint8_t)regs->byte(r8(z)));
+                }
+                break;
+            default: execute_x3(y, z, p, q); break;
+            }
+        }
+
+        void execute_x0(unsigned y, unsigned z, unsigned p, unsigned q) {
+            switch (z) {
+            case 0:
+                switch (y) {
+                case 0: break;                                              // NOP
+                case 1:                                                     // EX AF,AF'
+                    std::swap(regs->byte(A), regs->byte(SHADOW + A));
+                    std::swap(regs->byte(F), regs->byte(SHADOW + F));
+                    break;
+                case 2: {                                                   // DJNZ e
+                    tick(1);
+                    auto e = (int8_t)fetch_byte();
+                    auto b = (uint8_t)(regs->byte(B) - 1);
+                    regs->byte(B) = (byte_t)b;
+                    if (b) relative(e);
+                    break;
+                }
+                case 3: relative((int8_t)fetch_byte()); break;             // JR e
+                default: {                                                  // JR cc,e
+                    auto e = (int8_t)fetch_byte();
+                    if (condition(y - 4)) relative(e);
+                }
+                }
+                break;
+            case 1:
+                if (q == 0) {                                               // LD rp,nn
+                    rp(p, fetch_word());
+                }
+                else {                                                      // ADD HL,rp
+                    auto x = hl();
+                    auto flags = f();
+                    memptr((uint16_t)(x + 1));
+                    hl(alu::add16(x, rp(p), flags));
+                    f(flags);
+                    tick(7);
+                }
+                break;
+            case 2:
+                switch (y) {
+                case 0: case 2: {                                           // LD (BC),A  LD (DE),A
+                    auto addr = rp(p);
+                    wr(addr, a());
+                    memptr((uint16_t)(a() << 8 | ((addr + 1) & 0xFF)));
+                    break;
+                }
+                case 1: case 3: {                                           // LD A,(BC)  LD A,(DE)
+                    auto addr = rp(p);
+                    a(rd(addr));
+                    memptr((uint16_t)(addr + 1));
+                    break;
+                }
+                case 4: {                                                   // LD (nn),HL
+                    auto nn = fetch_word();
+                    wr16(nn, hl());
+                    memptr((uint16_t)(nn + 1));
+                    break;
+                }
+                case 5: {                                                   // LD HL,(nn)
+                    auto nn = fetch_word();
+                    hl(rd16(nn));
+                    memptr((uint16_t)(nn + 1));
+                    break;
+                }
+                case 6: {                                                   // LD (nn),A
+                    auto nn = fetch_word();
+                    wr(nn, a());
+                    memptr((uint16_t)(a() << 8 | ((nn + 1) & 0xFF)));
+                    break;
+                }
+                default: {                                                  // LD A,(nn)
+                    auto nn = fetch_word();
+                    a(rd(nn));
+                    memptr((uint16_t)(nn + 1));
+                }
+                }
+                break;
+            case 3:                                                         // INC rp  DEC rp
+                rp(p, (uint16_t)(rp(p) + (q ? -1 : 1)));
+                tick(2);
+                break;
+            case 4: case 5: {                                               // INC r  DEC r
+                auto flags = f();
+                if (y == 6) {
+                    auto addr = operand_address();
+                    auto v = rd(addr);
+                    tick(1);
+                    wr(addr, (z == 4) ? alu::inc(v, flags) : alu::dec(v, flags));
+                }
+                else {
+                    auto& r = regs->byte(r8(y));
+                    r = (byte_t)((z == 4) ? alu::inc((uint8_t)r, flags) : alu::dec((uint8_t)r, flags));
+                }
+                f(flags);
+                break;
+            }
+            case 6:                                                         // LD r,n
+                if (y == 6) {
+                    auto addr = operand_address(2);
+                    wr(addr, fetch_byte());
+                }
+                else {
+                    regs->byte(r8(y)) = (byte_t)fetch_byte();
+                }
+                break;
+            default: {
+                auto flags = f();
+                switch (y) {
+                case 0: a(alu::rlca(a(), flags)); break;
+                case 1: a(alu::rrca(a(), flags)); break;
+                case 2: a(alu::rla(a(), flags)); break;
+                case 3: a(alu::rra(a(), flags)); break;
+                case 4: a(alu::daa(a(), flags)); break;
+                case 5: a(alu::cpl(a(), flags)); break;
+                case 6: alu::scf(a(), flags, cpu->q); break;
+                default: alu::ccf(a(), flags, cpu->q); break;
+                }
+                f(flags);
+            }
+            }
+        }
+
+        void execute_x3(unsigned y, unsigned z, unsigned p, unsigned q) {
+            switch (z) {
+            case 0:                                                         // RET cc
+                tick(1);
+                if (condition(y)) jump(pop());
+                break;
+            case 1:
+                if (q == 0) {                                               // POP rp2
+                    rp2(p, pop());
+                    break;
+                }
+                switch (p) {
+                case 0: jump(pop()); break;                                 // RET
+                case 1:                                                     // EXX
+                    for (auto r : { B, C, D, E, H, L }) {
+                        std::swap(regs->byte(r), regs->byte(SHADOW + r));
+                    }
+                    break;
+                case 2: pc(hl()); break;                                    // JP (HL)
+                default: regs->word(SP) = (word_t)hl(); tick(2); break;     // LD SP,HL
+                }
+                break;
+            case 2: {                                                       // JP cc,nn
+                auto nn = fetch_word();
+                memptr(nn);
+                if (condition(y)) pc(nn);
+                break;
+            }
+            case 3:
+                switch (y) {
+                case 0: jump(fetch_word()); break;                          // JP nn
+                case 1: execute_cb(); break;
+                case 2: {                                                   // OUT (n),A
+                    auto n = fetch_byte();
+                    port_out((uint16_t)(a() << 8 | n), a());
+                    memptr((uint16_t)(a() << 8 | ((n + 1) & 0xFF)));
+                    break;
+                }
+                case 3: {                                                   // IN A,(n)
+                    auto port = (uint16_t)(a() << 8 | fetch_byte());
+                    a(port_in(port));
+                    memptr((uint16_t)(port + 1));
+                    break;
+                }
+                case 4: {                                                   // EX (SP),HL
+                    auto sp = (uint16_t)regs->word(SP);
+                    auto w = rd16(sp);
+                    tick(1);
+                    wr((uint16_t)(sp + 1), (uint8_t)(hl() >> 8));
+                    wr(sp, (uint8_t)hl());
+                    tick(2);
+                    hl(w);
+                    memptr(w);
+                    break;
+                }
+                case 5: {                                                   // EX DE,HL, never indexed
+                    auto de = get_pair(*regs, D);
+                    set_pair(*regs, D, get_pair(*regs, H));
+                    set_pair(*regs, H, de);
+                    break;
+                }
+                case 6: cpu->iff1 = cpu->iff2 = false; break;               // DI
+                default: cpu->iff1 = cpu->iff2 = true; cpu->ei_delay = true; break;     // EI
+                }
+                break;
+            case 4: {                                                       // CALL cc,nn
+                auto nn = fetch_word();
+                memptr(nn);
+                if (condition(y)) {
+                    tick(1);
+                    call(nn);
+                }
+                break;
+            }
+            case 5:
+                if (q == 0) {                                               // PUSH rp2
+                    tick(1);
+                    push(rp2(p));
+                    break;
+                }
+                switch (p) {
+                case 0: {                                                   // CALL nn
+                    auto nn = fetch_word();
+                    tick(1);
+                    call(nn);
+                    break;
+                }
+                case 1: execute_prefix(IX_INDEX); break;
+                case 2: execute_ed(); break;
+                default: execute_prefix(IY_INDEX); break;
+                }
+                break;
+            case 6: alu_op(y, fetch_byte()); break;                         // alu n
+            default:                                                        // RST
+                tick(1);
+                call((uint16_t)(y * 8));
+            }
+        }
+
+        // DD or FD, a further DD or FD replaces it and ED cancels it
+        void execute_prefix(int prefix) {
+            index = prefix;
+            auto op = fetch_opcode();
+            while (op == 0xDD || op == 0xFD) {
+                index = (op == 0xDD) ? IX_INDEX : IY_INDEX;
+                op = fetch_opcode();
+            }
+            if (op == 0xCB) {
+                execute_index_cb();
+                return;
+            }
+            execute(op);
+        }
+
+        void execute_cb() {
+            if (index != HL_INDEX) {
+                execute_index_cb();
+                return;
+            }
+            auto op = fetch_opcode();
+            unsigned x = op >> 6, y = (op >> 3) & 7, z = op & 7;
+            uint8_t v;
+            uint16_t addr{ 0 };
+            if (z == 6) {
+                addr = get_pair(*regs, H);
+                v = rd(addr);
+                tick(1);
+            }
+            else {
+                v = (uint8_t)regs->byte(r8(z, false));
+            }
+            switch (x) {
+            case 0: v = rot(y, v); break;
+            case 1: {                                                       // BIT
+                auto flags = f();
+                alu::bit(y, v, flags, (z == 6) ? (uint8_t)(cpu->memptr >> 8) : v);
+                f(flags);
+                return;
+            }
+            case 2: v &= (uint8_t)~(1u << y); break;                        // RES
+            default: v |= (uint8_t)(1u << y); break;                        // SET
+            }
+            if (z == 6) {
+                wr(addr, v);
+            }
+            else {
+                regs->byte(r8(z, false)) = (byte_t)v;
+            }
+        }
+
+        // DD CB d op and FD CB d op, the result is also copied to r[z] when z is not 6
+        void execute_index_cb() {
+            auto d = (int8_t)fetch_byte();
+            auto op = (uint8_t)m->read(pc());              // not an M1
+            pc(pc() + 1);
+            tick(5);
+            unsigned x = op >> 6, y = (op >> 3) & 7, z = op & 7;
+            auto addr = (uint16_t)(hl() + d);
+            memptr(addr);
+            auto v = rd(addr);
+            tick(1);
+            switch (x) {
+            case 0: v = rot(y, v); break;
+            case 1: {                                                       // BIT
+                auto flags = f();
+                alu::bit(y, v, flags, (uint8_t)(addr >> 8));
+                f(flags);
+                return;
+            }
+            case 2: v &= (uint8_t)~(1u << y); break;
+            default: v |= (uint8_t)(1u << y); break;
+            }
+            wr(addr, v);
+            if (z != 6) {
+                regs->byte(r8(z, false)) = (byte_t)v;
+            }
+        }
+
+        void execute_ed() {
+            index = HL_INDEX;
+            auto op = fetch_opcode();
+            unsigned x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+            if (x == 1) {
+                execute_ed_x1(y, z, p, q);
+            }
+            else if (x == 2 && z <= 3 && y >= 4) {
+                execute_block(y, z);
+            }
+            // everything else is an 8 T-state NOP
+        }
+
+        void execute_ed_x1(unsigned y, unsigned z, unsigned p, unsigned q) {
+            switch (z) {
+            case 0: {                                                       // IN r,(C)
+                auto bc = get_pair(*regs, B);
+                auto v = port_in(bc);
+                memptr((uint16_t)(bc + 1));
+                f((uint8_t)((f() & CARRY) | flags::SZ53P[v]));
+                if (y != 6) regs->byte(r8(y, false)) = (byte_t)v;
+                break;
+            }
+            case 1: {                                                       // OUT (C),r
+                auto bc = get_pair(*regs, B);
+                port_out(bc, (y == 6) ? 0 : (uint8_t)regs->byte(r8(y, false)));
+                memptr((uint16_t)(bc + 1));
+                break;
+            }
+            case 2: {                                                       // SBC HL,rp  ADC HL,rp
+                auto x = get_pair(*regs, H);
+                auto flags = f();
+                memptr((uint16_t)(x + 1));
+                set_pair(*regs, H, q ? alu::adc16(x, rp(p), flags) : alu::sbc16(x, rp(p), flags));
+                f(flags);
+                tick(7);
+                break;
+            }
+            case 3: {                                                       // LD (nn),rp  LD rp,(nn)
+                auto nn = fetch_word();
+                if (q) {
+                    rp(p, rd16(nn));
+                }
+                else {
+                    wr16(nn, rp(p));
+                }
+                memptr((uint16_t)(nn + 1));
+                break;
+            }
+            case 4: {                                                       // NEG
+                auto flags = f();
+                a(alu::neg(a(), flags));
+                f(flags);
+                break;
+            }
+            case 5:                                                         // RETN  RETI
+                cpu->iff1 = cpu->iff2;
+                jump(pop());
+                break;
+            case 6: cpu->im = IM_OF[y]; break;                              // IM
+            default:
+                switch (y) {
+                case 0: regs->byte(I) = (byte_t)a(); tick(1); break;        // LD I,A
+                case 1: tick(1); m->refresh_register(a()); break;           // LD R,A
+                case 2: case 3: {                                           // LD A,I  LD A,R
+                    tick(1);
+                    auto v = (y == 2) ? (uint8_t)regs->byte(I) : m->refresh_register();
+                    a(v);
+                    f((uint8_t)((f() & CARRY) | flags::SZ53[v] | (cpu->iff2 ? PARITY_OVERFLOW : 0)));
+                    break;
+                }
+                case 4: case 5: {                                           // RRD  RLD
+                    auto addr = get_pair(*regs, H);
+                    auto v = rd(addr);
+                    tick(4);
+                    uint8_t result, acc;
+                    if (y == 4) {
+                        result = (uint8_t)(a() << 4 | v >> 4);
+                        acc = (uint8_t)((a() & 0xF0) | (v & 0x0F));
+                    }
+                    else {
+                        result = (uint8_t)(v << 4 | (a() & 0x0F));
+                        acc = (uint8_t)((a() & 0xF0) | v >> 4);
+                    }
+                    wr(addr, result);
+                    a(acc);
+                    f((uint8_t)((f() & CARRY) | flags::SZ53P[acc]));
+                    memptr((uint16_t)(addr + 1));
+                    break;
+                }
+                default: break;                                             // NOP
+                }
+            }
+        }
+
+        // LDI LDD LDIR LDDR, CPI CPD CPIR CPDR, INI IND INIR INDR, OUTI OUTD OTIR OTDR
+        void execute_block(unsigned y, unsigned z) {
+            bool decrement = y & 1, repeat = y >= 6;
+            int step = decrement ? -1 : 1;
+            auto hl_ = get_pair(*regs, H);
+            auto bc = get_pair(*regs, B);
+            bool again{ false };
+            switch (z) {
+            case 0: {                                                       // LD
+                auto de = get_pair(*regs, D);
+                auto v = rd(hl_);
+                wr(de, v);
+                tick(2);
+                set_pair(*regs, H, (uint16_t)(hl_ + step));
+                set_pair(*regs, D, (uint16_t)(de + step));
+                set_pair(*regs, B, --bc);
+                auto n = (uint8_t)(v + a());
+                f((uint8_t)((f() & (SIGN | ZERO | CARRY)) | (bc ? PARITY_OVERFLOW : 0) | (n & BIT3_Y) | ((n << 4) & BIT5_X)));
+                again = repeat && bc;
+                break;
+            }
+            case 1: {                                                       // CP
+                auto v = rd(hl_);
+                tick(5);
+                auto flags = f();
+                auto r = alu::sub(a(), v, flags);
+                set_pair(*regs, H, (uint16_t)(hl_ + step));
+                set_pair(*regs, B, --bc);
+                auto n = (uint8_t)(r - ((flags & HALF_CARRY) ? 1 : 0));
+                f((uint8_t)((flags & (SIGN | ZERO | HALF_CARRY)) | NEGATE | (f() & CARRY) | (bc ? PARITY_OVERFLOW : 0)
+                    | (n & BIT3_Y) | ((n << 4) & BIT5_X)));
+                memptr((uint16_t)(cpu->memptr + step));
+                again = repeat && bc && r != 0;
+                break;
+            }
+            case 2: {                                                       // IN
+                tick(1);
+                auto v = port_in(bc);
+                wr(hl_, v);
+                memptr((uint16_t)(bc + step));
+                auto b = (uint8_t)((bc >> 8) - 1);
+                regs->byte(B) = (byte_t)b;
+                set_pair(*regs, H, (uint16_t)(hl_ + step));
+                unsigned k = v + (uint8_t)((bc & 0xFF) + step);
+                io_block_flags(v, k, b);
+                again = repeat && b;
+                break;
+            }
+            default: {                                                      // OUT
+                tick(1);
+                auto v = rd(hl_);
+                auto b = (uint8_t)((bc >> 8) - 1);
+                regs->byte(B) = (byte_t)b;
+                bc = get_pair(*regs, B);
+                port_out(bc, v);
+                memptr((uint16_t)(bc + step));
+                hl_ = (uint16_t)(hl_ + step);
+                set_pair(*regs, H, hl_);
+                unsigned k = v + (uint8_t)hl_;
+                io_block_flags(v, k, b);
+                again = repeat && b;
+            }
+            }
+            if (again) {
+                tick(5);
+                pc(pc() - 2);
+                memptr((uint16_t)(pc() + 1));
+            }
+        }
+
+        inline void io_block_flags(uint8_t v, unsigned k, uint8_t b) {
+            f((uint8_t)(flags::SZ53[b] | ((v & 0x80) ? NEGATE : 0) | (k > 0xFF ? HALF_CARRY | CARRY : 0)
+                | flags::PARITY[(uint8_t)((k & 7) ^ b)]));
+        }
+
+        z80_machine* m{ nullptr };
+        z80_registers_t* regs{ nullptr };
+        z80_control_t* cpu{ nullptr };
+        int index{ HL_INDEX };
+        bool flags_written{ false };
+
+    };
+
+    using z80_core = basic_z80_core<true>;
+
+}
@@ -0,0 +1,140 @@
+/**
+
+    @file      z80_disk_controller.h
+    @brief     a port mapped sector disk controller on an asynchronous disk image
+    @details   the machine side of emu_async_disk.h, a controller that transfers whole sectors between the image and
+               memory by DMA:
+               + ports from the base: +0 and +1 sector number low and high, +2 and +3 DMA address low and high,
+                 +4 command on write (READ or WRITE) and status on read (BUSY, ERROR)
+               + a command hands the transfer to the image's worker threads and schedules its completion latency
+                 T-states later, the CPU goes on emulating while the host does the I/O
+               + at that event the controller waits for the host if it has not finished, then the data reaches
+                 memory and BUSY clears on exactly that cycle, whatever the host's speed
+               + the status port is pure, so a program that does nothing but poll it is a polling loop (see
+                 z80_polling_loop.h) and run() skips straight to the completion
+               + the controller takes over the machine's port handlers, other ports read $FF
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "emu_async_disk.h"
+#include "emu_memory_types.h"
+#include "z80_machine.h"
+
+namespace emu {
+
+    class z80_disk_controller {
+
+    public:
+
+        static constexpr size_t SECTOR_SIZE = 512;
+
+        // commands
+        static constexpr uint8_t READ = 0x01;
+        static constexpr uint8_t WRITE = 0x02;
+
+        // status
+        static constexpr uint8_t BUSY = 0x80;
+        static constexpr uint8_t ERROR = 0x01;
+
+        z80_disk_controller(z80_machine& m, const std::string& image, uint8_t base = 0xE0, cycle_t latency = 20000) :
+            m(m),
+            disk(image),
+            base(base),
+            latency(latency),
+            buffer(SECTOR_SIZE)
+        {
+            m.on_in([this](address_t port) { return in(port); });
+            m.on_out([this](address_t port, byte_t b) { out(port, b); });
+            m.pure_port((uint8_t)(base + 4));
+        }
+
+        z80_disk_controller(const z80_disk_controller&) = delete;
+        z80_disk_controller& operator=(const z80_disk_controller&) = delete;
+
+        ~z80_disk_controller() {
+            m.on_in(nullptr);
+            m.on_out(nullptr);
+            m.pure_port((uint8_t)(base + 4), false);
+        }
+
+        inline uint8_t status() const {
+            return status_;
+        }
+
+        // completed transfers
+        inline uint64_t transfers() const {
+            return transfers_;
+        }
+
+    private:
+
+        byte_t in(address_t port) {
+            return (uint8_t)port == (uint8_t)(base + 4) ? (byte_t)status_ : (byte_t)0xFF;
+        }
+
+        void out(address_t port, byte_t b) {
+            switch ((uint8_t)((uint8_t)port - base)) {
+            case 0: sector = (uint16_t)((sector & 0xFF00) | (uint8_t)b); break;
+            case 1: sector = (uint16_t)((sector & 0x00FF) | (uint8_t)b << 8); break;
+            case 2: dma = (address_t)((dma & 0xFF00) | (uint8_t)b); break;
+            case 3: dma = (address_t)((dma & 0x00FF) | (uint8_t)b << 8); break;
+            case 4: command((uint8_t)b); break;
+            }
+        }
+
+        void command(uint8_t c) {
+            if (status_ & BUSY) {
+                return;
+            }
+            if ((c != READ && c != WRITE) || dma + SECTOR_SIZE > 0x10000) {
+                status_ = ERROR;
+                return;
+            }
+            status_ = BUSY;
+            auto due = m.cycles() + latency;
+            auto offset = (uint64_t)sector * SECTOR_SIZE;
+            auto to = dma;
+            if (c == WRITE) {
+                m.read_block(dma, buffer.data(), SECTOR_SIZE);
+                disk.write(offset, buffer.data(), SECTOR_SIZE, due, [this](cycle_t, size_t n) { finish(n, false, 0); });
+            }
+            else {
+                disk.read(offset, buffer.data(), SECTOR_SIZE, due, [this, to](cycle_t, size_t n) { finish(n, true, to); });
+            }
+            // the host has had the whole latency to do the transfer, its completion is due now
+            m.events().schedule(due, [this](cycle_t) { disk.complete(m.events()); });
+        }
+
+        void finish(size_t transferred, bool read, address_t to) {
+            if (transferred != SECTOR_SIZE) {
+                status_ = ERROR;
+                return;
+            }
+            if (read) {
+                m.write_block(to, buffer.data(), SECTOR_SIZE);
+            }
+            status_ = 0;
+            ++transfers_;
+        }
+
+        z80_machine& m;
+        async_disk disk;
+        uint8_t base;
+        cycle_t latency;
+        std::vector<byte_t> buffer;     // the one transfer in flight
+        uint16_t sector{ 0 };
+        address_t dma{ 0 };
+        uint8_t status_{ 0 };
+        uint64_t transfers_{ 0 };
+
+    };
+
+}
@@ -0,0 +1,291 @@
+/**
+
+    @file      z80_explorer.h
+    @brief     explores every state a small routine can reach for bounded inputs, in parallel
+    @details   for verifying small firmware routines, checksums, parsers and interrupt handlers, against every input
+               rather than a few:
+               + the inputs are port reads, before an instruction that reads a port (IN, INI, IND and their repeats,
+                 found from the opcode templates, see z80_opcodes.h) the state forks into one branch per value of
+                 the port's input domain, by default all 256
+               + a branch runs one instruction at a time through run() so that breakpoints, with their conditions,
+                 and native traps behave as they do in a plain run, until HALT, the step bound, a breakpoint, a
+                 failed assertion or the next port read
+               + a state is hashed where it forks (see emu_page_hashes.h) and a state already in the concurrent
+                 visited set, sharded by hash with a lock per shard, is not explored again
+               + fork states are copy on write snapshots (see z80_snapshot.h), a branch costs the pages it writes
+               + each worker thread explores its own copy of the start machine from a shared stack of branches,
+                 the last worker to go idle with the stack empty ends the exploration
+               + the report counts branches, distinct and duplicate fork states, halted and bounded branches,
+                 lists the PCs executed and every breakpoint and failed assertion with the inputs that reach it
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "z80_condition.h"
+#include "z80_machine.h"
+#include "z80_opcodes.h"
+#include "z80_registers.h"
+#include "z80_snapshot.h"
+
+namespace emu {
+
+    class z80_explorer {
+
+    public:
+
+        using domain_t = std::function<std::vector<uint8_t>(address_t port)>;
+
+        // a port read and the value the branch gave it
+        struct input_t {
+            address_t port;
+            uint8_t value;
+        };
+
+        struct hit_t {
+            enum class kind_t { breakpoint, assertion } kind;
+            address_t pc;
+            std::vector<input_t> inputs;
+        };
+
+        struct report_t {
+            uint64_t branches{ 0 };         // runs from a start or a fork
+            uint64_t states{ 0 };           // distinct fork states
+            uint64_t duplicates{ 0 };       // fork states already visited
+            uint64_t halted{ 0 };           // branches that reached HALT
+            uint64_t bounded{ 0 };          // branches cut off by the step bound or the state limit
+            std::vector<address_t> coverage;
+            std::vector<hit_t> hits;
+        };
+
+        explicit z80_explorer(const z80_machine& start) :
+            start_(start)
+        {}
+
+        // the values a read of the port may return
+        inline void inputs(domain_t domain) {
+            domain_ = std::move(domain);
+        }
+
+        // instructions a branch may run from the start, across its forks
+        inline void max_steps(uint64_t steps) {
+            max_steps_ = steps;
+        }
+
+        // distinct fork states beyond which branches are no longer forked
+        inline void max_states(uint64_t states) {
+            max_states_ = states;
+        }
+
+        // a failure whenever PC arrives at pc with the condition false
+        void assertion(address_t pc, z80_condition condition) {
+            assertions.insert_or_assign(pc, std::move(condition));
+        }
+
+        report_t explore(unsigned threads = 0) {
+            if (threads == 0) {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            report = {};
+            coverage.reset();
+            visited = std::make_unique<std::array<shard_t, SHARDS>>();
+            states_ = 0;
+            stack.clear();
+            busy = 0;
+            {
+                z80_machine m(start_);
+                stack.push_back({ std::make_shared<z80_snapshot>(m), std::nullopt, {}, 0 });
+            }
+            std::vector<std::thread> pool;
+            for (unsigned i{ 0 }; i < threads; ++i) {
+                pool.emplace_back([this] { work(); });
+            }
+            for (auto& t : pool) {
+                t.join();
+            }
+            for (uint32_t pc{ 0 }; pc < 0x10000; ++pc) {
+                if (coverage.test(pc)) report.coverage.push_back((address_t)pc);
+            }
+            visited.reset();
+            return report;
+        }
+
+        // the instruction at addr reads a port, and which
+        static std::optional<address_t> port_read(z80_machine& m, address_t addr) {
+            static const auto reads = [] {
+                std::array<std::bitset<256>, 2> reads;
+                auto is_in = [](const std::string& t) { return t.starts_with("IN ") || t.starts_with("INI") || t.starts_with("IND"); };
+                for (int op{ 0 }; op < 256; ++op) {
+                    reads[0][op] = is_in(z80_opcodes::main()[op]);
+                    reads[1][op] = is_in(z80_opcodes::ed()[op]);
+                }
+                return reads;
+            }();
+            const auto& ram = m.ram();
+            auto op = (uint8_t)ram[addr];
+            if (reads[0][op]) {
+                return (address_t)((uint8_t)m.registers().byte(A) << 8 | (uint8_t)ram[(address_t)(addr + 1)]);
+            }
+            if (op == 0xED && reads[1][(uint8_t)ram[(address_t)(addr + 1)]]) {
+                return get_pair(m.registers(), B);
+            }
+            return std::nullopt;
+        }
+
+    private:
+
+        static constexpr size_t SHARDS = 64;
+
+        struct shard_t {
+            std::mutex guard;
+            std::unordered_set<uint64_t> hashes;
+        };
+
+        // a branch starts from a state, with the value for the port read it stands on if it forked there
+        struct branch_t {
+            std::shared_ptr<const z80_snapshot> state;
+            std::optional<uint8_t> value;
+            std::vector<input_t> inputs;
+            uint64_t steps;
+        };
+
+        // the hash was not yet visited
+        bool visit(uint64_t hash) {
+            auto& shard = (*visited)[(hash >> 32) % SHARDS];
+            std::lock_guard<std::mutex> lock(shard.guard);
+            return shard.hashes.insert(hash).second;
+        }
+
+        void work() {
+            z80_machine m(start_);
+            std::optional<uint8_t> pending;
+            m.on_in([&pending](address_t) { return (byte_t)pending.value_or(0xFF); });
+            std::shared_ptr<const z80_snapshot> current = std::make_shared<const z80_snapshot>(m);
+            std::bitset<0x10000> covered;
+            report_t local;
+            while (true) {
+                branch_t branch;
+                {
+                    std::unique_lock<std::mutex> lock(guard);
+                    more.wait(lock, [this] { return !stack.empty() || busy == 0; });
+                    if (stack.empty()) {
+                        break;
+                    }
+                    branch = std::move(stack.back());
+                    stack.pop_back();
+                    ++busy;
+                }
+                ++local.branches;
+                branch.state->restore(m, *current);
+                current = branch.state;
+                pending = branch.value;
+                std::vector<branch_t> forks;
+                while (true) {
+                    if (m.control().halted) {
+                        ++local.halted;
+                        break;
+                    }
+                    if (branch.steps >= max_steps_) {
+                        ++local.bounded;
+                        break;
+                    }
+                    auto pc = (address_t)m.registers().word(PC);
+                    covered.set(pc);
+                    if (!assertions.empty()) {
+                        auto a = assertions.find(pc);
+                        if (a != assertions.end() && !a->second.evaluate(m)) {
+                            local.hits.push_back({ hit_t::kind_t::assertion, pc, branch.inputs });
+                            break;
+                        }
+                    }
+                    if (!pending) {
+                        if (auto p = port_read(m, pc)) {
+                            auto fork = std::make_shared<const z80_snapshot>(m, *current);
+                            current = fork;
+                            if (!visit(fork->hash())) {
+                                ++local.duplicates;
+                                break;
+                            }
+                            if (++states_ > max_states_) {
+                                ++local.bounded;
+                                break;
+                            }
+                            ++local.states;
+                            for (auto v : domain_ ? domain_(*p) : all_values()) {
+                                auto inputs = branch.inputs;
+                                inputs.push_back({ *p, v });
+                                forks.push_back({ fork, v, std::move(inputs), branch.steps });
+                            }
+                            break;
+                        }
+                    }
+                    m.run(m.cycles() + 1);
+                    if (m.breakpoint_hit()) {
+                        local.hits.push_back({ hit_t::kind_t::breakpoint, pc, branch.inputs });
+                        break;
+                    }
+                    ++branch.steps;
+                    pending.reset();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(guard);
+                    for (auto& f : forks) stack.push_back(std::move(f));
+                    --busy;
+                }
+                more.notify_all();
+            }
+            std::lock_guard<std::mutex> lock(guard);
+            report.branches += local.branches;
+            report.states += local.states;
+            report.duplicates += local.duplicates;
+            report.halted += local.halted;
+            report.bounded += local.bounded;
+            report.hits.insert(report.hits.end(), local.hits.begin(), local.hits.end());
+            coverage |= covered;
+        }
+
+        static const std::vector<uint8_t>& all_values() {
+            static const std::vector<uint8_t> values = [] {
+                std::vector<uint8_t> v(256);
+                for (int i{ 0 }; i < 256; ++i) v[i] = (uint8_t)i;
+                return v;
+            }();
+            return values;
+        }
+
+        z80_machine start_;
+        domain_t domain_;
+        uint64_t max_steps_{ 1'000'000 };
+        uint64_t max_states_{ 1'000'000 };
+        std::unordered_map<address_t, z80_condition> assertions;
+        report_t report;
+        std::bitset<0x10000> coverage;
+        std::unique_ptr<std::array<shard_t, SHARDS>> visited;
+        std::atomic<uint64_t> states_{ 0 };
+        std::vector<branch_t> stack;
+        unsigned busy{ 0 };
+        std::mutex guard;
+        std::condition_variable more;
+
+    };
+
+}
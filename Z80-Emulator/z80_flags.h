@@ -0,0 +1,61 @@
+/**
+
+    @file      z80_flags.h
+    @brief     constexpr flag lookup tables
+    @details   the flags that depend only on an 8 bit result are looked up rather than computed:
+               + SZ53[v]  S, Z and the undocumented bits 5 (x) and 3 (y) copied from v
+               + SZ53P[v] as SZ53 plus P/V set for even parity, for logical operations, rotates and IN r,(C)
+               + PARITY[v] P/V alone
+               the tables are built at compile time and the undocumented bits come for free with the lookup
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "z80_registers.h"
+
+namespace emu {
+
+    namespace flags {
+
+        using table_t = std::array<uint8_t, 256>;
+
+        constexpr table_t make_parity() {
+            table_t t{};
+            for (unsigned v{ 0 }; v < 256; ++v) {
+                unsigned bits{ 0 };
+                for (auto b{ v }; b; b >>= 1) bits += b & 1;
+                t[v] = (bits & 1) ? 0 : PARITY_OVERFLOW;
+            }
+            return t;
+        }
+
+        constexpr table_t make_sz53() {
+            table_t t{};
+            for (unsigned v{ 0 }; v < 256; ++v) {
+                t[v] = (uint8_t)((v & (SIGN | BIT5_X | BIT3_Y)) | (v == 0 ? ZERO : 0));
+            }
+            return t;
+        }
+
+        constexpr table_t make_sz53p() {
+            table_t t = make_sz53();
+            auto p = make_parity();
+            for (unsigned v{ 0 }; v < 256; ++v) {
+                t[v] |= p[v];
+            }
+            return t;
+        }
+
+        constexpr table_t PARITY = make_parity();
+        constexpr table_t SZ53 = make_sz53();
+        constexpr table_t SZ53P = make_sz53p();
+
+    }
+
+}
@@ -0,0 +1,649 @@
+/**
+
+    @file      z80_gdb.h
+    @brief     GDB remote serial protocol stub, a gdb compatible debugger drives the machine over a local socket
+    @details   the stub listens on a localhost TCP port, or a Unix socket where there are Unix sockets, and serves one
+               debugger connection at a time:
+               + registers are gdb's z80 target: AF BC DE HL SP PC IX IY AF' BC' DE' HL' IR, 16 bits each and
+                 little-endian in g, G, p and P
+               + memory goes in bulk: m and M take any length up to the whole 64K, x reads and X writes binary,
+                 addresses wrap at $FFFF and writes bypass ROM protection like any debugger poke
+               + Z0 and Z1 breakpoints and Z2, Z3 and Z4 write, read and access watchpoints are the machine's own,
+                 flagged per page, so pages without one run as fast as ever
+               + c runs the machine with all of its fast paths in slices of T-states until a breakpoint or
+                 watchpoint stops it, looking for the debugger's interrupt (Ctrl-C) between slices, s steps one
+                 instruction, servicing due events first
+               + handle() is the protocol without the socket, one packet payload in and the reply payload out
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "emu_memory_types.h"
+#include "z80_machine.h"
+#include "z80_registers.h"
+
+namespace emu {
+
+    class z80_gdb_stub {
+
+#if defined(_WIN32)
+        using socket_t = SOCKET;
+        static constexpr socket_t NO_SOCKET = INVALID_SOCKET;
+#else
+        using socket_t = int;
+        static constexpr socket_t NO_SOCKET = -1;
+#endif
+
+        static constexpr cycle_t SLICE = 1'000'000;         // T-states run between looks for an interrupt
+        static constexpr size_t PACKET_SIZE = 0x20100;      // room for the whole 64K in hex
+        static constexpr char HEX[] = "0123456789abcdef";
+
+        // the kinds of watchpoint at an address
+        static constexpr uint8_t READ = 1;
+        static constexpr uint8_t WRITE = 2;
+        static constexpr uint8_t ACCESS = 4;
+
+    public:
+
+        using interrupted_t = std::function<bool()>;
+
+        static constexpr size_t REGISTER_COUNT = 13;
+
+        explicit z80_gdb_stub(z80_machine& m) :
+            m(m)
+        {
+#if defined(_WIN32)
+            WSADATA data;
+            WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+        }
+
+        z80_gdb_stub(const z80_gdb_stub&) = delete;
+        z80_gdb_stub& operator=(const z80_gdb_stub&) = delete;
+
+        ~z80_gdb_stub() {
+            for (auto pc : breakpoints) m.clear_breakpoint(pc);
+            for (auto [addr, kinds] : watchpoints) m.unwatch(addr, watch_t::access);
+            close_socket(client);
+            close_socket(server);
+#if defined(_WIN32)
+            WSACleanup();
+#endif
+        }
+
+        // the reply to one packet's payload, "" is the empty reply for a packet the stub does not support
+        // c returns when interrupted() does, without it only a breakpoint or watchpoint ends a continue
+        std::string handle(const std::string& packet, const interrupted_t& interrupted = {}) {
+            if (packet.empty()) {
+                return "";
+            }
+            auto args = std::string_view(packet).substr(1);
+            switch (packet[0]) {
+            case '?': return stop_reply;
+            case 'g': return read_registers();
+            case 'G': return write_registers(args);
+            case 'p': return read_register(args);
+            case 'P': return write_register(args);
+            case 'm': return read_memory(args, false);
+            case 'x': return read_memory(args, true);
+            case 'M': return write_memory(args, false);
+            case 'X': return write_memory(args, true);
+            case 's': return step(args);
+            case 'c': return resume(args, interrupted);
+            case 'Z': return point(args, true);
+            case 'z': return point(args, false);
+            case 'H': return "OK";
+            case 'T': return "OK";
+            case 'q': return query(args);
+            case 'Q':
+                if (args == "StartNoAckMode") {
+                    no_ack = true;
+                    return "OK";
+                }
+                return "";
+            case 'D':
+                attached_ = false;
+                return "OK";
+            case 'k':
+                attached_ = false;
+                return "";
+            default: return "";
+            }
+        }
+
+        // $payload#checksum
+        static std::string frame(const std::string& payload) {
+            uint8_t sum{ 0 };
+            for (auto c : payload) sum += (uint8_t)c;
+            return std::format("${}#{:02x}", payload, sum);
+        }
+
+        // binary data as it goes in a packet, # $ } and * follow a } and are xored with $20
+        static std::string escape(const std::vector<uint8_t>& bytes) {
+            std::string s;
+            s.reserve(bytes.size() + bytes.size() / 16);
+            for (auto b : bytes) {
+                if (b == '#' || b == '$' || b == '}' || b == '*') {
+                    s += '}';
+                    s += (char)(b ^ 0x20);
+                }
+                else {
+                    s += (char)b;
+                }
+            }
+            return s;
+        }
+
+        static std::string unescape(std::string_view s) {
+            std::string bytes;
+            bytes.reserve(s.size());
+            for (size_t i{ 0 }; i < s.size(); ++i) {
+                bytes += (s[i] == '}' && i + 1 < s.size()) ? (char)(s[++i] ^ 0x20) : s[i];
+            }
+            return bytes;
+        }
+
+        // the debugger is connected and has not detached or killed the session
+        inline bool attached() const {
+            return attached_;
+        }
+
+        // listens on 127.0.0.1, port 0 takes any free port, returns the port
+        uint16_t listen(uint16_t port = 0) {
+            auto s = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (s == NO_SOCKET) {
+                throw std::runtime_error("gdb stub error: no socket");
+            }
+            int yes{ 1 };
+            ::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(port);
+            if (::bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(s, 1) != 0) {
+                close_socket(s);
+                throw std::runtime_error(std::format("gdb stub error: cannot listen on localhost port {}", port));
+            }
+            socklen_t length = sizeof(addr);
+            ::getsockname(s, (sockaddr*)&addr, &length);
+            close_socket(server);
+            server = s;
+            return ntohs(addr.sin_port);
+        }
+
+#if !defined(_WIN32)
+        // listens on a Unix socket, replacing any file at path
+        void listen(const std::string& path) {
+            sockaddr_un addr{};
+            if (path.size() >= sizeof(addr.sun_path)) {
+                throw std::runtime_error("gdb stub error: \"" + path + "\" socket path too long");
+            }
+            auto s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (s == NO_SOCKET) {
+                throw std::runtime_error("gdb stub error: no socket");
+            }
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            ::unlink(path.c_str());
+            if (::bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(s, 1) != 0) {
+                close_socket(s);
+                throw std::runtime_error("gdb stub error: cannot listen on \"" + path + "\"");
+            }
+            close_socket(server);
+            server = s;
+        }
+#endif
+
+        // accepts a debugger and serves it until it detaches, kills the session or hangs up
+        void serve() {
+            if (server == NO_SOCKET) {
+                throw std::runtime_error("gdb stub error: not listening");
+            }
+            client = ::accept(server, nullptr, nullptr);
+            if (client == NO_SOCKET) {
+                throw std::runtime_error("gdb stub error: accept failed");
+            }
+            attached_ = true;
+            no_ack = false;
+            inbox.clear();
+            at = 0;
+            std::string packet;
+            while (attached_ && receive(packet)) {
+                auto reply = handle(packet, [this] { return interrupt_pending(); });
+                if (packet == "k") {
+                    break;
+                }
+                send(frame(reply));
+            }
+            attached_ = false;
+            close_socket(client);
+            client = NO_SOCKET;
+        }
+
+    private:
+
+        // registers
+
+        uint16_t get(size_t n) {
+            auto& regs = m.snapshot();
+            switch (n) {
+            case 0: return (uint16_t)regs.word(F);
+            case 1: return get_pair(regs, B);
+            case 2: return get_pair(regs, D);
+            case 3: return get_pair(regs, H);
+            case 4: return (uint16_t)regs.word(SP);
+            case 5: return (uint16_t)regs.word(PC);
+            case 6: return (uint16_t)regs.word(IX);
+            case 7: return (uint16_t)regs.word(IY);
+            case 8: return (uint16_t)regs.word(SHADOW);
+            case 9: return get_pair(regs, SHADOW + 2);
+            case 10: return get_pair(regs, SHADOW + 4);
+            case 11: return get_pair(regs, SHADOW + 6);
+            default: return get_pair(regs, I);
+            }
+        }
+
+        void set(size_t n, uint16_t value) {
+            auto& regs = m.registers();
+            switch (n) {
+            case 0: regs.word(F) = (word_t)value; break;
+            case 1: set_pair(regs, B, value); break;
+            case 2: set_pair(regs, D, value); break;
+            case 3: set_pair(regs, H, value); break;
+            case 4: regs.word(SP) = (word_t)value; break;
+            case 5: regs.word(PC) = (word_t)value; break;
+            case 6: regs.word(IX) = (word_t)value; break;
+            case 7: regs.word(IY) = (word_t)value; break;
+            case 8: regs.word(SHADOW) = (word_t)value; break;
+            case 9: set_pair(regs, SHADOW + 2, value); break;
+            case 10: set_pair(regs, SHADOW + 4, value); break;
+            case 11: set_pair(regs, SHADOW + 6, value); break;
+            default:
+                regs.byte(I) = (byte_t)(value >> 8);
+                m.refresh_register((uint8_t)value);
+                break;
+            }
+        }
+
+        static void append_word(std::string& s, uint16_t value) {
+            s += HEX[(value >> 4) & 0xF];
+            s += HEX[value & 0xF];
+            s += HEX[(value >> 12) & 0xF];
+            s += HEX[(value >> 8) & 0xF];
+        }
+
+        std::string read_registers() {
+            std::string s;
+            for (size_t n{ 0 }; n < REGISTER_COUNT; ++n) append_word(s, get(n));
+            return s;
+        }
+
+        std::string write_registers(std::string_view args) {
+            auto bytes = from_hex(args);
+            if (!bytes || bytes->size() != REGISTER_COUNT * 2) {
+                return "E01";
+            }
+            for (size_t n{ 0 }; n < REGISTER_COUNT; ++n) set(n, (uint16_t)((*bytes)[2 * n] | (*bytes)[2 * n + 1] << 8));
+            return "OK";
+        }
+
+        std::string read_register(std::string_view args) {
+            auto n = number(args);
+            if (!n || *n >= REGISTER_COUNT) {
+                return "E01";
+            }
+            std::string s;
+            append_word(s, get(*n));
+            return s;
+        }
+
+        std::string write_register(std::string_view args) {
+            auto equals = args.find('=');
+            auto n = number(args.substr(0, equals));
+            auto bytes = (equals == std::string_view::npos) ? std::nullopt : from_hex(args.substr(equals + 1));
+            if (!n || *n >= REGISTER_COUNT || !bytes || bytes->size() != 2) {
+                return "E01";
+            }
+            set(*n, (uint16_t)((*bytes)[0] | (*bytes)[1] << 8));
+            return "OK";
+        }
+
+        // memory, a range may wrap at $FFFF
+
+        void read_range(address_t addr, uint8_t* out, size_t n) {
+            auto first = std::min<size_t>(n, 0x10000 - addr);
+            m.read_block(addr, out, first);
+            if (n > first) m.read_block(0, out + first, n - first);
+        }
+
+        void write_range(address_t addr, const uint8_t* in, size_t n) {
+            auto first = std::min<size_t>(n, 0x10000 - addr);
+            m.write_block(addr, in, first);
+            if (n > first) m.write_block(0, in + first, n - first);
+        }
+
+        std::string read_memory(std::string_view args, bool binary) {
+            auto range = address_length(args);
+            if (!range) {
+                return "E01";
+            }
+            std::vector<uint8_t> bytes(std::min<size_t>(range->second, 0x10000));
+            read_range(range->first, bytes.data(), bytes.size());
+            if (binary) {
+                return "b" + escape(bytes);
+            }
+            std::string s(bytes.size() * 2, '0');
+            for (size_t i{ 0 }; i < bytes.size(); ++i) {
+                s[2 * i] = HEX[bytes[i] >> 4];
+                s[2 * i + 1] = HEX[bytes[i] & 0xF];
+            }
+            return s;
+        }
+
+        std::string write_memory(std::string_view args, bool binary) {
+            auto colon = args.find(':');
+            if (colon == std::string_view::npos) {
+                return "E01";
+            }
+            auto range = address_length(args.substr(0, colon));
+            auto data = args.substr(colon + 1);
+            std::optional<std::vector<uint8_t>> bytes;
+            if (binary) bytes = std::vector<uint8_t>(data.begin(), data.end());
+            else bytes = from_hex(data);
+            if (!range || !bytes || bytes->size() != range->second || bytes->size() > 0x10000) {
+                return "E01";
+            }
+            write_range(range->first, bytes->data(), bytes->size());
+            return "OK";
+        }
+
+        // execution
+
+        std::string stopped() {
+            if (auto hit = m.watch_hit()) {
+                auto point = watchpoints.find(hit->address);
+                auto kind = (point != watchpoints.end() && (point->second & ACCESS)) ? "awatch" : (hit->access == watch_t::write) ? "watch" : "rwatch";
+                return stop_reply = std::format("T05{}:{:04x};", kind, hit->address);
+            }
+            return stop_reply = "S05";
+        }
+
+        // one instruction, HALT included
+        void step_one() {
+            m.events().service(m.cycles());
+            m.step();
+        }
+
+        std::string step(std::string_view args) {
+            if (!args.empty()) {
+                auto addr = number(args);
+                if (!addr) return "E01";
+                m.registers().word(PC) = (word_t)*addr;
+            }
+            step_one();
+            return stopped();
+        }
+
+        std::string resume(std::string_view args, const interrupted_t& interrupted) {
+            if (!args.empty()) {
+                auto addr = number(args);
+                if (!addr) return "E01";
+                m.registers().word(PC) = (word_t)*addr;
+            }
+            // off the breakpoint it stopped on
+            if (m.breakpoint((address_t)m.registers().word(PC))) {
+                step_one();
+                if (m.watch_hit()) {
+                    return stopped();
+                }
+            }
+            while (true) {
+                m.run(m.cycles() + SLICE);
+                if (m.stopped()) {
+                    return stopped();
+                }
+                if (interrupted && interrupted()) {
+                    return stop_reply = "S02";
+                }
+            }
+        }
+
+        // Z and z: type,addr,kind
+        std::string point(std::string_view args, bool insert) {
+            auto type = args.empty() ? '?' : args[0];
+            auto range = (args.size() > 2) ? address_length(args.substr(2)) : std::nullopt;
+            if (!range) {
+                return "E01";
+            }
+            auto addr = range->first;
+            uint8_t kind;
+            switch (type) {
+            case '0': case '1':
+                if (insert) {
+                    m.set_breakpoint(addr);
+                    breakpoints.insert(addr);
+                }
+                else if (breakpoints.erase(addr)) {
+                    m.clear_breakpoint(addr);
+                }
+                return "OK";
+            case '2': kind = WRITE; break;
+            case '3': kind = READ; break;
+            case '4': kind = ACCESS; break;
+            default: return "";
+            }
+            for (uint32_t i{ 0 }; i < std::max<uint32_t>(range->second, 1); ++i) {
+                auto a = (address_t)(addr + i);
+                auto kinds = insert ? (watchpoints[a] | kind) : (watchpoints[a] & ~kind);
+                // the machine watches the union of the kinds at the address
+                m.unwatch(a, watch_t::access);
+                if (kinds & (READ | ACCESS)) m.watch(a, watch_t::read);
+                if (kinds & (WRITE | ACCESS)) m.watch(a, watch_t::write);
+                if (kinds) watchpoints[a] = (uint8_t)kinds;
+                else watchpoints.erase(a);
+            }
+            return "OK";
+        }
+
+        std::string query(std::string_view args) {
+            if (args.starts_with("Supported")) return std::format("PacketSize={:x};QStartNoAckMode+;binary-upload+", PACKET_SIZE);
+            if (args == "Attached") return "1";
+            if (args == "C") return "QC1";
+            if (args == "fThreadInfo") return "m1";
+            if (args == "sThreadInfo") return "l";
+            if (args == "Offsets") return "Text=0;Data=0;Bss=0";
+            if (args.starts_with("Symbol")) return "OK";
+            return "";
+        }
+
+        // parsing
+
+        static std::optional<uint32_t> number(std::string_view s) {
+            uint32_t value{ 0 };
+            auto [end, error] = std::from_chars(s.data(), s.data() + s.size(), value, 16);
+            if (s.empty() || error != std::errc{} || end != s.data() + s.size()) {
+                return std::nullopt;
+            }
+            return value;
+        }
+
+        // addr,length with an address in the 64K, anything after a further comma e.g. a breakpoint's kind is ignored
+        static std::optional<std::pair<address_t, uint32_t>> address_length(std::string_view s) {
+            auto comma = s.find(',');
+            if (comma == std::string_view::npos) {
+                return std::nullopt;
+            }
+            auto length = s.substr(comma + 1);
+            length = length.substr(0, length.find(','));
+            auto addr = number(s.substr(0, comma));
+            auto n = number(length);
+            if (!addr || *addr > 0xFFFF || !n) {
+                return std::nullopt;
+            }
+            return std::pair<address_t, uint32_t>{ (address_t)*addr, *n };
+        }
+
+        static std::optional<std::vector<uint8_t>> from_hex(std::string_view s) {
+            if (s.size() % 2) {
+                return std::nullopt;
+            }
+            std::vector<uint8_t> bytes(s.size() / 2);
+            for (size_t i{ 0 }; i < bytes.size(); ++i) {
+                auto [end, error] = std::from_chars(s.data() + 2 * i, s.data() + 2 * i + 2, bytes[i], 16);
+                if (error != std::errc{} || end != s.data() + 2 * i + 2) {
+                    return std::nullopt;
+                }
+            }
+            return bytes;
+        }
+
+        // the socket
+
+        static void close_socket(socket_t s) {
+            if (s == NO_SOCKET) return;
+#if defined(_WIN32)
+            ::closesocket(s);
+#else
+            ::close(s);
+#endif
+        }
+
+        bool readable() {
+#if defined(_WIN32)
+            WSAPOLLFD p{ client, POLLRDNORM, 0 };
+            return ::WSAPoll(&p, 1, 0) > 0;
+#else
+            pollfd p{ client, POLLIN, 0 };
+            return ::poll(&p, 1, 0) > 0;
+#endif
+        }
+
+        // more bytes from the debugger, false when it has hung up
+        bool fill() {
+            char buffer[4096];
+            auto n = ::recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                return false;
+            }
+            inbox.erase(0, at);
+            at = 0;
+            inbox.append(buffer, (size_t)n);
+            return true;
+        }
+
+        bool read_byte(char& c) {
+            if (at == inbox.size() && !fill()) {
+                return false;
+            }
+            c = inbox[at++];
+            return true;
+        }
+
+        // a Ctrl-C has arrived or the debugger has hung up
+        bool interrupt_pending() {
+            if (readable() && !fill()) {
+                attached_ = false;
+                return true;
+            }
+            auto i = inbox.find('\x03', at);
+            if (i == std::string::npos) {
+                return false;
+            }
+            inbox.erase(i, 1);
+            return true;
+        }
+
+        // the next packet's payload, acknowledged and unescaped, false when the debugger has hung up
+        bool receive(std::string& packet) {
+            while (true) {
+                char c;
+                do {
+                    if (!read_byte(c)) return false;
+                } while (c != '$');                     // acks and an interrupt while stopped are dropped
+                std::string payload;
+                uint8_t sum{ 0 };
+                while (true) {
+                    if (!read_byte(c)) return false;
+                    if (c == '#') break;
+                    payload += c;
+                    sum += (uint8_t)c;
+                }
+                char digits[2];
+                if (!read_byte(digits[0]) || !read_byte(digits[1])) {
+                    return false;
+                }
+                uint8_t expected{ 0 };
+                auto [end, error] = std::from_chars(digits, digits + 2, expected, 16);
+                if (error != std::errc{} || expected != sum) {
+                    if (!no_ack) send("-");
+                    continue;
+                }
+                if (!no_ack) send("+");
+                packet = unescape(payload);
+                return true;
+            }
+        }
+
+        void send(const std::string& data) {
+#if defined(MSG_NOSIGNAL)
+            constexpr int flags = MSG_NOSIGNAL;
+#else
+            constexpr int flags = 0;
+#endif
+            for (size_t sent{ 0 }; sent < data.size();) {
+                auto n = ::send(client, data.data() + sent, (int)(data.size() - sent), flags);
+                if (n <= 0) {
+                    attached_ = false;
+                    return;
+                }
+                sent += (size_t)n;
+            }
+        }
+
+        z80_machine& m;
+        std::unordered_set<address_t> breakpoints;
+        std::unordered_map<address_t, uint8_t> watchpoints;
+        std::string stop_reply{ "S05" };
+        bool attached_{ false };
+        bool no_ack{ false };
+        socket_t server{ NO_SOCKET };
+        socket_t client{ NO_SOCKET };
+        std::string inbox;
+        size_t at{ 0 };
+
+    };
+
+}
@@ -0,0 +1,189 @@
+/**
+
+    @file      z80_loop_idioms.h
+    @brief     recognises hand written block loops that the machine can run as native bulk operations
+    @details   the idioms, each starting at its loop head:
+
+                   copy:   LD A,(HL)       7E        7     counted copy, BC bytes (0 is 65536) from (HL) to (DE)
+                           INC HL          23        6
+                           LD (DE),A       12        7
+                           INC DE          13        6
+                           DEC BC          0B        6
+                           LD A,B          78        4
+                           OR C            B1        4
+                           JR NZ,copy      20 F7    12/7
+
+                   fill:   LD (HL),r       7x        7     B bytes (0 is 256) of r, or n, from HL
+                           (or LD (HL),n   36 nn    10     or of A from DE with LD (DE),A / INC DE)
+                           INC HL          23        6
+                           DJNZ fill       10 FC    13/8
+
+                   mul:    ADD HL,HL       29       11     8 x 8 shift and add, H (or A with RLA) times DE
+                           (RLA            17        4)
+                           JR NC,skip      30 01    12/7
+                           ADD HL,DE       19       11
+                   skip:   DJNZ mul        10 F9    13/8
+
+                   search: LD A,(HL)       7E        7     to the first byte equal to n or B, C, D or E, INC HL,
+                           CP n            FE nn     7     CP and an optional DEC BC in any order after the load,
+                           (or CP r        B8-BB     4)    or with CP (HL) in place of LD A,(HL) and CP, to the
+                           INC HL          23        6     first byte equal to A
+                           (DEC BC         0B        6)
+                           JR NZ,search    20 xx    12/7
+
+               + the machine runs whole iterations, so every register, flag, byte of memory, the refresh register
+                 and the T-state count end up exactly as if the loop had been stepped
+               + an iteration count of 0 wraps, as it does on the CPU
+               + a search has no count, DEC BC sets no flags, so it runs until a byte matches or the budget ends,
+                 at most once round memory at a time
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "emu_memory_types.h"
+#include "z80_registers.h"
+
+namespace emu {
+
+    struct loop_idiom {
+
+        enum class kind_t { copy, fill, multiply, search };
+
+        kind_t kind;
+        address_t head;         // first byte of the loop
+        address_t branch;       // address of the closing branch
+        address_t end;          // one past the closing branch
+
+        // fill and search
+        uint8_t pointer;        // H or D, the register pair written through
+        int8_t source;          // register index of the value, or of the operand compared, -1 for the immediate
+        uint8_t value;          // the immediate
+        uint8_t store_tstates;  // 7 for LD (HL),r and LD (DE),A, 10 for LD (HL),n
+
+        // multiply
+        bool rla;               // the multiplier is shifted out of A
+
+        // search
+        bool load;              // LD A,(HL) then CP, else CP (HL) against A
+        bool counted;           // DEC BC in the body
+        uint8_t tstates;        // an iteration that branches back
+        uint8_t m1;             // opcode fetches in an iteration
+
+    };
+
+    // decodes from head through read(address_t) -> byte_t
+    template<typename READ>
+    std::optional<loop_idiom> detect_loop_idiom(READ read, address_t head) {
+
+        loop_idiom idiom{ loop_idiom::kind_t::copy, head, 0, 0, 0, 0, 0, 0, false, false, false, 0, 0 };
+        address_t pc = head;
+        auto next = [&]() { return (uint8_t)read(pc++); };
+        // a relative branch back to the head
+        auto back = [&](uint8_t op) {
+            auto at = pc;
+            if (next() != op) return false;
+            auto e = (int8_t)next();
+            if ((address_t)(pc + e) != head) return false;
+            idiom.branch = at;
+            idiom.end = pc;
+            return true;
+        };
+        // INC HL, CP unless CP (HL) made the head, and at most one DEC BC in any order, then JR NZ to the head
+        auto search = [&](bool load) -> std::optional<loop_idiom> {
+            static constexpr int8_t REG[4] = { B, C, D, E };
+            idiom.kind = loop_idiom::kind_t::search;
+            idiom.load = load;
+            unsigned tstates{ 7 + 12 }, m1{ 2 };
+            bool compared = !load, stepped = false;
+            for (auto i{ 0 }; i < 3 && (uint8_t)read(pc) != 0x20; ++i) {
+                auto op = next();
+                ++m1;
+                if (op == 0x23 && !stepped) {
+                    stepped = true;
+                    tstates += 6;
+                }
+                else if (op == 0x0B && !idiom.counted) {
+                    idiom.counted = true;
+                    tstates += 6;
+                }
+                else if (op == 0xFE && !compared) {
+                    compared = true;
+                    idiom.source = -1;
+                    idiom.value = next();
+                    tstates += 7;
+                }
+                else if (op >= 0xB8 && op <= 0xBB && !compared) {
+                    compared = true;
+                    idiom.source = REG[op - 0xB8];
+                    tstates += 4;
+                }
+                else {
+                    return std::nullopt;
+                }
+            }
+            // CP B or CP C would see a BC that the loop counts down
+            if (!compared || !stepped || (load && idiom.counted && (idiom.source == B || idiom.source == C))) {
+                return std::nullopt;
+            }
+            if (!back(0x20)) return std::nullopt;
+            idiom.tstates = (uint8_t)tstates;
+            idiom.m1 = (uint8_t)m1;
+            return idiom;
+        };
+
+        auto op = next();
+        switch (op) {
+        case 0x7E: {                                                        // copy, or search
+            static constexpr uint8_t body[] = { 0x23, 0x12, 0x13, 0x0B, 0x78, 0xB1 };
+            auto after = pc;
+            auto copy = [&]() {
+                for (auto b : body) {
+                    if (next() != b) return false;
+                }
+                return back(0x20);
+            };
+            if (copy()) return idiom;
+            pc = after;
+            return search(true);
+        }
+        case 0xBE:                                                          // search with CP (HL)
+            return search(false);
+        case 0x12:                                                          // fill through DE
+        case 0x36: case 0x71: case 0x72: case 0x73: case 0x77: {            // fill through HL
+            idiom.kind = loop_idiom::kind_t::fill;
+            idiom.pointer = (op == 0x12) ? D : H;
+            idiom.store_tstates = 7;
+            switch (op) {
+            case 0x36: idiom.source = -1; idiom.value = next(); idiom.store_tstates = 10; break;
+            case 0x71: idiom.source = C; break;
+            case 0x72: idiom.source = D; break;
+            case 0x73: idiom.source = E; break;
+            default: idiom.source = A; break;
+            }
+            if (next() != ((op == 0x12) ? 0x13 : 0x23)) return std::nullopt;
+            if (!back(0x10)) return std::nullopt;
+            return idiom;
+        }
+        case 0x29: {                                                        // multiply
+            idiom.kind = loop_idiom::kind_t::multiply;
+            op = next();
+            if (op == 0x17) {
+                idiom.rla = true;
+                op = next();
+            }
+            if (op != 0x30 || next() != 0x01 || next() != 0x19) return std::nullopt;
+            if (!back(0x10)) return std::nullopt;
+            return idiom;
+        }
+        default:
+            return std::nullopt;
+        }
+    }
+
+}
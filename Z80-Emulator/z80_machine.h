@@ -0,0 +1,1107 @@
+/**
+
+    @file      z80_machine.h
+    @brief     a Z80 machine: register file, 64K address space, T-state counter and event scheduler
+    @details   the machine is what a CPU core executes against, it owns the memory access path:
+               + read() and write() add the wait states of the machine's contention table at the current T-state
+               + pages can be flagged e.g. as ROM so that writes to them are ignored
+               + the contention table is fixed at construction
+               + device coroutines run on the machine's scheduler with their frames in the machine's arena
+               + run() drives an attached CPU core one instruction at a time and services due events in between,
+                 the core reports HALT through control().halted and clears it when it accepts an interrupt
+               + a halted CPU executes NOPs (4 T-states and one refresh each) until an interrupt can be accepted,
+                 run() credits all of them in one step up to the next scheduled event - the state is identical to
+                 stepping because only an event can raise an interrupt; on a contended page it does step
+               + likewise a side-effect free polling loop (see z80_polling_loop.h) that has just completed a whole
+                 iteration from its head with no event in it is credited whole iterations up to the next event,
+                 provided its code and polled location are uncontended and a polled port is marked pure - a loop
+                 entered part way through first runs once from the head, so its exit test has seen the polled value
+               + hand written copy, fill, multiply and search loops (see z80_loop_idioms.h) are run natively a whole
+                 number of iterations up to the next event, when none of their code or data is on a flagged or
+                 contended page
+               + decoded loops are cached by PC, pages holding cached code are flagged and a write to one flushes
+                 the cache
+               + frequent instruction pairs and triples (see z80_superinstructions.h) run as one dispatch when no
+                 event, interrupt, trap, contended access or store into the group itself could tell the
+                 difference, pair_profile() counts the pairs a program runs to choose them by
+               + native traps (see z80_traps.h) run instead of the code at their PC, only pages flagged as holding
+                 a trap are looked up; in verification mode each trap also runs the original code on a copy of
+                 the machine and throws if registers (but R), memory or T-states differ
+               + R is not stored on every opcode fetch, the machine counts M1 cycles and derives R from the count
+                 and the last value written by LD R,A, so a core must write R with refresh_register(r) and read it
+                 with refresh_register(), or take a snapshot() of the whole register file
+               + stop() ends run() before the next instruction, a trap hook that stops the machine and declines
+                 stops it on the trap's PC
+               + breakpoints stop run() on their PC before the instruction, if their condition (see
+                 z80_condition.h) is true, watchpoints stop it after the instruction that reads or writes the
+                 address, instruction fetches included; both are bitmaps per page (see emu_address_bitmap.h) and
+                 only a PC or an access on a page flagged as holding one tests a bit, the fast paths decline when
+                 their code or data is on a flagged page and fusion while anything is watched
+               + read_block() and write_block() copy a range of memory in one go for a host e.g. through the C API
+                 (see z80_capi.h)
+               + hash() is the state as one 64 bit value, memory, the register file with R materialised and the
+                 control state but not the T-states, every write marks its page dirty (see emu_page_hashes.h) and
+                 only dirty pages are rehashed, a host that writes through ram() marks what it wrote with touch()
+               + a copy of a machine is detached: same state, memory, core and traps but no scheduled events,
+                 devices or port handlers
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "emu_address_bitmap.h"
+#include "emu_arena.h"
+#include "emu_contention.h"
+#include "emu_device_task.h"
+#include "emu_memory.h"
+#include "emu_page_hashes.h"
+#include "emu_scheduler.h"
+#include "z80_alu.h"
+#include "z80_condition.h"
+#include "z80_loop_idioms.h"
+#include "z80_polling_loop.h"
+#include "z80_registers.h"
+#include "z80_superinstructions.h"
+#include "z80_traps.h"
+
+namespace emu {
+
+    // per page flags
+    constexpr uint8_t PAGE_ROM = 0b00000001;
+    constexpr uint8_t PAGE_CODE = 0b00000010;       // holds code decoded into a machine cache
+    constexpr uint8_t PAGE_TRAP = 0b00000100;       // holds the PC of a native trap
+    constexpr uint8_t PAGE_WRITE_WATCH = 0b00001000;    // holds an address watched for writes
+    constexpr uint8_t PAGE_READ_WATCH = 0b00010000;     // holds an address watched for reads
+    constexpr uint8_t PAGE_BREAK = 0b00100000;          // holds a breakpoint
+
+    enum class watch_t { read = 1, write = 2, access = 3 };
+
+    // the access that stopped the machine on a watchpoint, read or write
+    struct watch_hit_t {
+        address_t address;
+        watch_t access;
+    };
+
+    // CPU control state that is not in the register file
+    // MEMPTR (WZ) is the CPU's internal address latch, it only shows in x and y of BIT b,(HL), a core sets it:
+    //   LD A,(BC|DE) and LD A,(nn)    address + 1
+    //   LD (BC|DE|nn),A               low byte (address + 1), high byte A
+    //   LD rr,(nn) and LD (nn),rr     nn + 1
+    //   ADD/ADC/SBC HL,rr             HL + 1, HL before the operation
+    //   JP nn, JP cc,nn, CALL, JR and DJNZ taken, RET, RST    the destination
+    //   EX (SP),HL|IX|IY              the new HL|IX|IY
+    //   (IX+d) and (IY+d) accesses    IX+d or IY+d
+    //   IN A,(n) and OUT (n),A        (A << 8) + n + 1, OUT high byte A
+    //   IN r,(C) and OUT (C),r        BC + 1
+    //   CPI, CPD                      +1, -1
+    //   LDIR, LDDR, CPIR, CPDR        repeating: PC + 1
+    //   RLD, RRD                      HL + 1
+    // Q is the flags the last instruction wrote, 0 if it wrote none, SCF and CCF read it
+    struct z80_control_t {
+        bool halted{ false };
+        bool iff1{ false };
+        bool iff2{ false };
+        uint8_t im{ 0 };
+        bool int_line{ false };     // maskable interrupt request, level triggered
+        bool nmi{ false };          // non-maskable interrupt request, latched until accepted
+        uint16_t memptr{ 0 };
+        uint8_t q{ 0 };
+        bool ei_delay{ false };     // EI was the last instruction, no maskable interrupt before the next
+    };
+
+    class z80_machine {
+
+    public:
+
+        using ram_t = memory<0x10000>;
+        using core_t = std::function<void(z80_machine&)>;  // executes one instruction or accepts one interrupt
+        using in_t = std::function<byte_t(address_t port)>;
+        using out_t = std::function<void(address_t port, byte_t b)>;
+        using traps_t = trap_registry<z80_machine>;
+        using fusion_t = superinstructions<z80_machine>;
+
+        // dispatches made by run()
+        struct dispatch_stats_t {
+            uint64_t core{ 0 };                 // instructions handed to the core
+            uint64_t fused{ 0 };                // superinstruction dispatches
+            uint64_t fused_instructions{ 0 };   // instructions they executed
+            uint64_t idioms{ 0 };               // loop idiom dispatches
+            uint64_t idiom_iterations{ 0 };     // iterations they ran
+            uint64_t breakpoint_lookups{ 0 };   // breakpoint bitmap tests, made only on PAGE_BREAK pages
+        };
+
+        z80_machine(contention_table contention = {}) :
+            ram_(0),
+            contention_(std::move(contention))
+        {}
+
+        z80_machine(const z80_machine& other) :
+            regs(other.regs),
+            cpu(other.cpu),
+            core_(other.core_),
+            pure_ports(other.pure_ports),
+            fast_halt(other.fast_halt),
+            fast_poll(other.fast_poll),
+            fast_idioms(other.fast_idioms),
+            verify_traps(other.verify_traps),
+            fuse(other.fuse),
+            last_pc(other.last_pc),
+            last_event_at(other.last_event_at),
+            poll_head(other.poll_head),
+            poll_arrived_at(other.poll_arrived_at),
+            loop_cache(other.loop_cache),
+            traps(other.traps),
+            breakpoints(other.breakpoints),
+            conditions(other.conditions),
+            read_watch(other.read_watch),
+            write_watch(other.write_watch),
+            ram_(other.ram_),
+            hashes(other.hashes),
+            contention_(other.contention_),
+            page_flags(other.page_flags),
+            cycles_(other.cycles_),
+            m1_(other.m1_),
+            r_m1(other.r_m1)
+        {}
+
+        z80_machine& operator=(const z80_machine&) = delete;
+
+        // R in the register file is stale, see snapshot()
+        inline z80_registers_t& registers() {
+            return regs;
+        }
+
+        // the register file with R brought up to date, e.g. to save or compare machine state
+        inline z80_registers_t& snapshot() {
+            regs.byte(R) = (byte_t)refresh_register();
+            r_m1 = m1_;
+            return regs;
+        }
+
+        inline ram_t& ram() {
+            return ram_;
+        }
+
+        inline const ram_t& ram() const {
+            return ram_;
+        }
+
+        inline scheduler& events() {
+            return events_;
+        }
+
+        // pass to device coroutines
+        inline device_context& devices() {
+            return devices_;
+        }
+
+        inline const contention_table& contention() const {
+            return contention_;
+        }
+
+        // T-states
+
+        inline cycle_t cycles() const {
+            return cycles_;
+        }
+
+        inline void tick(unsigned tstates) {
+            cycles_ += tstates;
+        }
+
+        // execution
+
+        inline void attach(core_t core) {
+            core_ = std::move(core);
+        }
+
+        inline z80_control_t& control() {
+            return cpu;
+        }
+
+        inline void interrupt(bool level) {
+            cpu.int_line = level;
+        }
+
+        inline void nmi() {
+            cpu.nmi = true;
+        }
+
+        inline bool interrupt_acceptable() const {
+            return cpu.nmi || (cpu.int_line && cpu.iff1 && !cpu.ei_delay);
+        }
+
+        // off to step HALT one NOP at a time e.g. to verify the fast-forward
+        inline void halt_fast_forward(bool on) {
+            fast_halt = on;
+        }
+
+        // off to step polling loops one instruction at a time
+        inline void polling_fast_forward(bool on) {
+            fast_poll = on;
+        }
+
+        // off to step copy, fill and multiply loops one instruction at a time
+        inline void loop_idioms(bool on) {
+            fast_idioms = on;
+        }
+
+        // off to hand every instruction to the core
+        inline void superinstruction_fusion(bool on) {
+            fuse = on;
+        }
+
+        inline const dispatch_stats_t& dispatch_stats() const {
+            return stats;
+        }
+
+        inline void reset_dispatch_stats() {
+            stats = {};
+        }
+
+        // on to count, by opcode pair, instructions the core runs one after the other from adjacent addresses,
+        // for choosing superinstructions (see z80_superinstructions.h hottest()), fused groups are not counted
+        inline void pair_profile(bool on) {
+            pair_counts.assign(on ? 0x10000 : 0, 0);
+            profiled_pc = 0;
+        }
+
+        // indexed by first opcode << 8 | second opcode, empty when the profile is off
+        inline const std::vector<uint64_t>& pair_profile() const {
+            return pair_counts;
+        }
+
+        // run until at least T-state until, returns the number of T-states run
+        cycle_t run(cycle_t until) {
+            if (!core_) {
+                throw std::runtime_error("machine error: no CPU core attached");
+            }
+            auto start = cycles_;
+            stop_ = false;
+            breakpoint_hit_ = false;
+            watch_hit_.reset();
+            while (cycles_ < until) {
+                if (events_.service(cycles_)) {
+                    last_event_at = cycles_;
+                }
+                if (stop_) {
+                    break;
+                }
+                if (cpu.halted && !interrupt_acceptable()) {
+                    halt(std::min(until, events_.next_event()));
+                    continue;
+                }
+                auto pc = (address_t)regs.word(PC);
+                if (auto f = page_flags[page_of(pc)] & (PAGE_BREAK | PAGE_TRAP)) {
+                    if (f & PAGE_BREAK) {
+                        ++stats.breakpoint_lookups;
+                        if (breakpoints.test(pc) && break_condition(pc)) {
+                            breakpoint_hit_ = true;
+                            stop_ = true;
+                            break;
+                        }
+                    }
+                    if ((f & PAGE_TRAP) && run_trap(pc)) {
+                        continue;
+                    }
+                    if (stop_) {
+                        break;
+                    }
+                }
+                if (pc <= last_pc && !interrupt_acceptable() && !cpu.ei_delay) {
+                    if (fast_poll && skip_polling_loop(pc, until)) {
+                        continue;
+                    }
+                    if (fast_idioms && run_loop_idiom(pc, until)) {
+                        continue;
+                    }
+                }
+                if (fuse && run_fused(pc, until)) {
+                    continue;
+                }
+                if (!pair_counts.empty()) {
+                    count_pair(pc);
+                }
+                last_pc = pc;
+                core_(*this);
+                ++stats.core;
+            }
+            events_.service(cycles_);
+            return cycles_ - start;
+        }
+
+        // one instruction, interrupt acceptance or HALT NOP, no events are serviced
+        void step() {
+            if (!core_) {
+                throw std::runtime_error("machine error: no CPU core attached");
+            }
+            stop_ = false;
+            breakpoint_hit_ = false;
+            watch_hit_.reset();
+            if (cpu.halted && !interrupt_acceptable()) {
+                halt_nop();
+            }
+            else {
+                last_pc = (address_t)regs.word(PC);
+                core_(*this);
+            }
+        }
+
+        // run() returns before the next instruction
+        inline void stop() {
+            stop_ = true;
+        }
+
+        // the last run() or step() was stopped
+        inline bool stopped() const {
+            return stop_;
+        }
+
+        // breakpoints and watchpoints, a run() that starts on a breakpoint stops at once, step() off it
+
+        void set_breakpoint(address_t pc) {
+            conditions.erase(pc);
+            if (breakpoints.set(pc)) page_flags[page_of(pc)] |= PAGE_BREAK;
+        }
+
+        // stops only when the condition is true, see z80_condition.h
+        void set_breakpoint(address_t pc, z80_condition condition) {
+            set_breakpoint(pc);
+            conditions.insert_or_assign(pc, std::move(condition));
+        }
+
+        void clear_breakpoint(address_t pc) {
+            conditions.erase(pc);
+            if (breakpoints.reset(pc)) page_flags[page_of(pc)] &= ~PAGE_BREAK;
+        }
+
+        inline bool breakpoint(address_t pc) const {
+            return breakpoints.test(pc);
+        }
+
+        void watch(address_t addr, watch_t access = watch_t::write) {
+            if (((int)access & (int)watch_t::read) && read_watch.set(addr)) page_flags[page_of(addr)] |= PAGE_READ_WATCH;
+            if (((int)access & (int)watch_t::write) && write_watch.set(addr)) page_flags[page_of(addr)] |= PAGE_WRITE_WATCH;
+        }
+
+        void unwatch(address_t addr, watch_t access = watch_t::write) {
+            if (((int)access & (int)watch_t::read) && read_watch.reset(addr)) page_flags[page_of(addr)] &= ~PAGE_READ_WATCH;
+            if (((int)access & (int)watch_t::write) && write_watch.reset(addr)) page_flags[page_of(addr)] &= ~PAGE_WRITE_WATCH;
+        }
+
+        inline bool watching() const {
+            return !read_watch.empty() || !write_watch.empty();
+        }
+
+        // the last run() stopped on a breakpoint at PC
+        inline bool breakpoint_hit() const {
+            return breakpoint_hit_;
+        }
+
+        // the watched access that stopped the last run() or step()
+        inline std::optional<watch_hit_t> watch_hit() const {
+            return watch_hit_;
+        }
+
+        // native traps
+
+        void trap(address_t pc, traps_t::hook_t hook, bool returns = true) {
+            if (traps.add(pc, std::move(hook), returns)) {
+                page_flags[page_of(pc)] |= PAGE_TRAP;
+            }
+        }
+
+        void untrap(address_t pc) {
+            if (traps.remove(pc)) {
+                page_flags[page_of(pc)] &= ~PAGE_TRAP;
+            }
+        }
+
+        void untrap_all() {
+            traps.clear();
+            for (auto& f : page_flags) {
+                f &= ~PAGE_TRAP;
+            }
+        }
+
+        // on to run every trap against the original code
+        inline void verify(bool on) {
+            verify_traps = on;
+        }
+
+        // opcode fetch (M1) of the byte at addr: wait states and the refresh register
+        inline byte_t fetch(address_t addr) {
+            refresh(1);
+            return read(addr);
+        }
+
+        // R counts M1 cycles in its low 7 bits, bit 7 is only ever changed by LD R,A
+        inline void refresh(uint64_t m1_cycles) {
+            m1_ += m1_cycles;
+        }
+
+        // LD A,R, and the ZX81 video which puts I and R on the address bus
+        inline uint8_t refresh_register() {
+            auto r = (uint8_t)regs.byte(R);
+            return (uint8_t)((r & 0x80) | ((r + (m1_ - r_m1)) & 0x7F));
+        }
+
+        // LD R,A
+        inline void refresh_register(uint8_t r) {
+            regs.byte(R) = (byte_t)r;
+            r_m1 = m1_;
+        }
+
+        // the address on the bus during the refresh cycle
+        inline address_t refresh_address() {
+            return (address_t)((uint8_t)regs.byte(I) << 8 | refresh_register());
+        }
+
+        // opcode fetches since construction
+        inline uint64_t m1_cycles() const {
+            return m1_;
+        }
+
+        // memory access path
+
+        inline byte_t read(address_t addr) {
+            cycles_ += contention_.wait_states(addr, cycles_);
+            if ((page_flags[page_of(addr)] & PAGE_READ_WATCH) && read_watch.test(addr)) {
+                watch_hit_ = { addr, watch_t::read };
+                stop_ = true;
+            }
+            return ram_[addr];
+        }
+
+        inline void write(address_t addr, byte_t b) {
+            cycles_ += contention_.wait_states(addr, cycles_);
+            if (auto f = page_flags[page_of(addr)]) {
+                if ((f & PAGE_WRITE_WATCH) && write_watch.test(addr)) {
+                    watch_hit_ = { addr, watch_t::write };
+                    stop_ = true;
+                }
+                if (f & PAGE_ROM) return;
+                if (f & PAGE_CODE) flush_code_cache();
+            }
+            hashes.touch(addr);
+            ram_[addr] = b;
+        }
+
+        // I/O ports, the whole 16 bit address is on the bus, an unconnected bus reads $FF
+
+        inline byte_t in(address_t port) {
+            return in_ ? in_(port) : (byte_t)0xFF;
+        }
+
+        inline void out(address_t port, byte_t b) {
+            if (out_) out_(port, b);
+        }
+
+        inline void on_in(in_t handler) {
+            in_ = std::move(handler);
+        }
+
+        inline void on_out(out_t handler) {
+            out_ = std::move(handler);
+        }
+
+        // reading the port (low byte) has no side effects and its value only changes in scheduled events
+        inline void pure_port(uint8_t port, bool pure = true) {
+            pure_ports.set(port, pure);
+        }
+
+        // page flags
+
+        void protect(address_t begin, address_t end) {
+            for (auto page{ page_of(begin) }; page <= page_of(end); ++page) {
+                page_flags[page] |= PAGE_ROM;
+            }
+        }
+
+        inline uint8_t flags(address_t addr) const {
+            return page_flags[page_of(addr)];
+        }
+
+        // image loading bypasses ROM protection
+
+        void load(const std::string& filename, address_t addr) {
+            const std::filesystem::path fpath(filename);
+            if (!std::filesystem::exists(fpath)) {
+                throw std::runtime_error("file load error: \"" + fpath.string() + "\" file not found");
+            }
+            auto file_size = std::filesystem::file_size(fpath);
+            if (addr + file_size > ram_.size()) {
+                throw std::runtime_error(fpath.string() + std::format(" memory overflow: file size {} bytes larger than memory ${:04X} - ${:04X}", file_size, addr, ram_.address_end()));
+            }
+            std::vector<char> image(file_size);
+            std::ifstream f(fpath, std::ios::binary);
+            f.read(image.data(), image.size());
+            for (size_t i{ 0 }; i < image.size(); ++i) {
+                ram_[(address_t)(addr + i)] = image[i];
+            }
+            hashes.touch(addr, image.size());
+        }
+
+        // bulk access for a host, like load() it bypasses ROM protection and contention, a write flushes cached
+        // code it overwrites
+
+        void read_block(address_t addr, void* out, size_t n) const {
+            if (addr + n > ram_.size()) {
+                throw std::runtime_error(std::format("memory overflow: {} bytes from ${:04X} past ${:04X}", n, addr, ram_.address_end()));
+            }
+            std::memcpy(out, ram_.data() + addr, n);
+        }
+
+        void write_block(address_t addr, const void* in, size_t n) {
+            if (addr + n > ram_.size()) {
+                throw std::runtime_error(std::format("memory overflow: {} bytes from ${:04X} past ${:04X}", n, addr, ram_.address_end()));
+            }
+            if (n == 0) {
+                return;
+            }
+            for (auto page{ page_of(addr) }; page <= page_of((address_t)(addr + n - 1)); ++page) {
+                if (page_flags[page] & PAGE_CODE) {
+                    flush_code_cache();
+                    break;
+                }
+            }
+            std::memcpy(ram_.data() + addr, in, n);
+            hashes.touch(addr, n);
+        }
+
+        // state hashing
+
+        // equal states hash equal whatever their T-states, see emu_page_hashes.h
+        uint64_t hash() {
+            auto h = hashes.hash(ram_.data());
+            h = hash_combine(h, hash_bytes(&snapshot().byte(0), Z80_SRAM_SIZE));
+            uint64_t control = (uint64_t)cpu.halted | (uint64_t)cpu.iff1 << 1 | (uint64_t)cpu.iff2 << 2 | (uint64_t)cpu.int_line << 3
+                | (uint64_t)cpu.nmi << 4 | (uint64_t)cpu.ei_delay << 5 | (uint64_t)cpu.im << 8 | (uint64_t)cpu.q << 16 | (uint64_t)cpu.memptr << 24;
+            return hash_combine(h, control);
+        }
+
+        // count bytes from addr were written through ram()
+        inline void touch(address_t addr, size_t count = 1) {
+            hashes.touch(addr, count);
+        }
+
+        // pages the last hash() rehashed
+        inline size_t rehashed_pages() const {
+            return hashes.rehashed();
+        }
+
+        // the page was written since the last hash(), see z80_snapshot.h
+        inline bool dirty_page(size_t page) const {
+            return hashes.dirty_page(page);
+        }
+
+    private:
+
+        static constexpr size_t LOOP_CACHE_SIZE = 256;
+        static constexpr size_t LOOP_BYTES = 16;        // bytes a loop decode may look at
+
+        struct loop_entry {
+            uint32_t key{ 0 };      // PC + 1, 0 is empty
+            bool found{ false };
+            polling_loop loop{};
+            bool idiom_found{ false };
+            loop_idiom idiom{};
+        };
+
+        // the halted CPU re-fetches at PC without incrementing it
+        inline void halt_nop() {
+            fetch((address_t)regs.word(PC));
+            tick(4);
+            cpu.q = 0;
+        }
+
+        void halt(cycle_t target) {
+            auto pc = (address_t)regs.word(PC);
+            // each NOP re-fetches at PC, which a read watchpoint must see
+            if (!fast_halt || contention_.contended(pc) || (page_flags[page_of(pc)] & PAGE_READ_WATCH) || target <= cycles_) {
+                halt_nop();
+                return;
+            }
+            auto t = target - cycles_;
+            auto nops = t / 4 + (t % 4 != 0);           // the NOP that crosses the target completes
+            refresh(nops);
+            cycles_ += nops * 4;
+            cpu.q = 0;
+        }
+
+        inline word_t pop() {
+            auto sp = (address_t)regs.word(SP);
+            regs.word(SP) += 2;
+            return (word_t)((uint8_t)ram_[sp] | (uint8_t)ram_[(address_t)(sp + 1)] << 8);
+        }
+
+        inline bool break_condition(address_t pc) {
+            if (conditions.empty()) {
+                return true;
+            }
+            auto c = conditions.find(pc);
+            return c == conditions.end() || c->second(*this);
+        }
+
+        bool run_trap(address_t pc) {
+            auto t = traps.find(pc);
+            if (!t) {
+                return false;
+            }
+            if (verify_traps) {
+                return verify_trap(*t);
+            }
+            auto cost = t->hook(*this);
+            if (cost == traps_t::DECLINE) {
+                return false;
+            }
+            cycles_ += cost;
+            if (t->returns) {
+                regs.word(PC) = pop();
+            }
+            last_pc = pc;
+            return true;
+        }
+
+        bool verify_trap(const traps_t::trap& t) {
+            static constexpr uint64_t MAX_STEPS = 100000000;
+            auto pc = (address_t)regs.word(PC);
+            z80_machine reference(*this);
+            reference.untrap_all();
+            bool reference_io{ false };
+            reference.on_in([&reference_io](address_t) { reference_io = true; return (byte_t)0xFF; });
+            reference.on_out([&reference_io](address_t, byte_t) { reference_io = true; });
+            auto cost = t.hook(*this);
+            if (cost == traps_t::DECLINE) {
+                return false;
+            }
+            cycles_ += cost;
+            if (t.returns) {
+                regs.word(PC) = pop();
+            }
+            last_pc = pc;
+            uint64_t steps{ 0 };
+            while (reference.regs.word(PC) != regs.word(PC) || reference.regs.word(SP) != regs.word(SP)) {
+                if (++steps > MAX_STEPS) {
+                    throw std::runtime_error(std::format("trap ${:04X} verification error: original code did not arrive at ${:04X}", pc, (address_t)regs.word(PC)));
+                }
+                reference.step();
+            }
+            std::string diff;
+            for (size_t i{ 0 }; i < Z80_SRAM_SIZE; ++i) {
+                if (i != R && regs.byte(i) != reference.regs.byte(i)) {
+                    diff += std::format(" {} ${:02X} != ${:02X}", Z80_SRAM_NAMES[i], (uint8_t)regs.byte(i), (uint8_t)reference.regs.byte(i));
+                }
+            }
+            for (size_t a{ 0 }; a < ram_.size(); ++a) {
+                if (ram_[(address_t)a] != reference.ram_[(address_t)a]) {
+                    diff += std::format(" (${:04X}) ${:02X} != ${:02X}", a, (uint8_t)ram_[(address_t)a], (uint8_t)reference.ram_[(address_t)a]);
+                    break;
+                }
+            }
+            if (cycles_ != reference.cycles_) {
+                diff += std::format(" T-states {} != {}", cost, reference.cycles_ - (cycles_ - cost));
+            }
+            if (reference_io) {
+                diff += " original code did I/O";
+            }
+            if (!diff.empty()) {
+                throw std::runtime_error(std::format("trap ${:04X} verification error: native != original:{}", pc, diff));
+            }
+            return true;
+        }
+
+        // the previous instruction fell through to this one, at most 4 bytes on
+        void count_pair(address_t pc) {
+            auto op = (uint8_t)ram_[pc];
+            if ((address_t)(pc - profiled_pc - 1) < 4) {
+                ++pair_counts[(size_t)profiled_opcode << 8 | op];
+            }
+            profiled_pc = pc;
+            profiled_opcode = op;
+        }
+
+        bool run_fused(address_t pc, cycle_t until) {
+            // a watched access must stop the machine on the instruction that made it
+            if (interrupt_acceptable() || cpu.ei_delay || watching()) {
+                return false;
+            }
+            uint8_t bytes[4];
+            for (address_t i{ 0 }; i < 4; ++i) {
+                bytes[i] = (uint8_t)ram_[(address_t)(pc + i)];
+            }
+            auto s = fusion_t::match(bytes);
+            if (!s) {
+                return false;
+            }
+            // nothing may happen at a boundary inside the group
+            auto horizon = cycles_ + s->max_tstates;
+            if (horizon >= until || horizon >= events_.next_event()) {
+                return false;
+            }
+            auto last = (address_t)(pc + s->last);
+            if ((page_flags[page_of(pc)] | page_flags[page_of(last)]) & (PAGE_TRAP | PAGE_BREAK)) {
+                return false;
+            }
+            // the handler charges the group in one, contention must see each access at its own T-state
+            if (!contention_.empty() && (contention_.contended(pc) || contention_.contended((address_t)(pc + s->length - 1)))) {
+                return false;
+            }
+            if (s->data != superinstruction<z80_machine>::NO_DATA) {
+                auto data = (address_t)get_pair(regs, (size_t)s->data);
+                if (!contention_.empty() && (contention_.contended(data) || contention_.contended((address_t)(data + s->data_bytes - 1)))) {
+                    return false;
+                }
+                // a store into the group itself rewrites an instruction the handler has already decoded
+                if (s->stores && (address_t)(data - pc) < s->length) {
+                    return false;
+                }
+            }
+            s->execute(*this, pc);
+            cpu.q = 0;          // no superinstruction ends with an instruction that writes the flags
+            last_pc = last;
+            ++stats.fused;
+            stats.fused_instructions += s->count;
+            return true;
+        }
+
+        loop_entry& decode_loop(address_t pc) {
+            auto& entry = loop_cache[pc % LOOP_CACHE_SIZE];
+            if (entry.key != pc + 1u) {
+                entry.key = pc + 1u;
+                auto read = [this](address_t a) { return ram_[a]; };
+                auto loop = detect_polling_loop(read, pc);
+                entry.found = loop.has_value();
+                if (entry.found) entry.loop = *loop;
+                auto idiom = detect_loop_idiom(read, pc);
+                entry.idiom_found = idiom.has_value();
+                if (entry.idiom_found) entry.idiom = *idiom;
+                page_flags[page_of(pc)] |= PAGE_CODE;
+                page_flags[page_of((address_t)(pc + LOOP_BYTES))] |= PAGE_CODE;
+            }
+            return entry;
+        }
+
+        bool skip_polling_loop(address_t pc, cycle_t until) {
+            auto& entry = decode_loop(pc);
+            if (!entry.found) {
+                return false;
+            }
+            const auto& loop = entry.loop;
+            // we must be back at the head from the loop's own branch, with no event during that iteration
+            if (loop.branch != last_pc || last_event_at + loop.tstates > cycles_) {
+                return false;
+            }
+            // and have arrived the same way exactly one iteration ago, else the loop was entered part way through
+            // and its test may have seen A or the flags from before the loop rather than the polled value
+            if (poll_head != pc || poll_arrived_at + loop.tstates != cycles_) {
+                poll_head = pc;
+                poll_arrived_at = cycles_;
+                return false;
+            }
+            if (contention_.contended(loop.head) || contention_.contended((address_t)(loop.end - 1)) || !polled_is_stable(loop)
+                || !plain(loop.head, (address_t)(loop.end - loop.head), PAGE_TRAP | PAGE_BREAK | PAGE_READ_WATCH)) {
+                return false;
+            }
+            // BIT b,(HL) sees MEMPTR, which the branch has only set to the head from the second iteration on
+            if (loop.reads_memptr && cpu.memptr != loop.head) {
+                return false;
+            }
+            auto target = std::min(until, events_.next_event());
+            auto iterations = (target > cycles_) ? (target - cycles_) / loop.tstates : 0;
+            if (iterations == 0) {
+                return false;
+            }
+            refresh(iterations * loop.m1);
+            cycles_ += iterations * loop.tstates;
+            return true;
+        }
+
+        bool polled_is_stable(const polling_loop& loop) {
+            address_t addr;
+            switch (loop.source) {
+            case polling_loop::source_t::port: return pure_ports.test(loop.address & 0xFF);
+            case polling_loop::source_t::absolute: addr = loop.address; break;
+            case polling_loop::source_t::bc: addr = get_pair(regs, B); break;
+            case polling_loop::source_t::de: addr = get_pair(regs, D); break;
+            case polling_loop::source_t::hl: addr = get_pair(regs, H); break;
+            case polling_loop::source_t::ix: addr = (address_t)(regs.word(IX) + loop.displacement); break;
+            case polling_loop::source_t::iy: addr = (address_t)(regs.word(IY) + loop.displacement); break;
+            default: return false;
+            }
+            return !contention_.contended(addr) && !(page_flags[page_of(addr)] & PAGE_READ_WATCH);
+        }
+
+        // count bytes from begin touch no page with any of mask's flags and no contended page
+        bool plain(address_t begin, uint32_t count, uint8_t mask) const {
+            if (count == 0) {
+                return true;
+            }
+            auto pages = std::min<uint32_t>(((begin % PAGE_SIZE) + count + PAGE_SIZE - 1) / PAGE_SIZE, PAGE_COUNT);
+            for (uint32_t i{ 0 }; i < pages; ++i) {
+                auto page = (page_of(begin) + i) % PAGE_COUNT;
+                if ((page_flags[page] & mask) || contention_.contended((address_t)(page * PAGE_SIZE))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool run_loop_idiom(address_t pc, cycle_t until) {
+            auto& entry = decode_loop(pc);
+            if (!entry.idiom_found) {
+                return false;
+            }
+            const auto& idiom = entry.idiom;
+            if (!plain(idiom.head, (address_t)(idiom.end - idiom.head), PAGE_TRAP | PAGE_BREAK | PAGE_READ_WATCH)) {
+                return false;
+            }
+            auto horizon = std::min(until, events_.next_event());
+            if (horizon <= cycles_) {
+                return false;
+            }
+            auto budget = horizon - cycles_;
+            uint64_t iterations{ 0 };
+            switch (idiom.kind) {
+            case loop_idiom::kind_t::copy: iterations = copy_idiom(idiom, budget); break;
+            case loop_idiom::kind_t::fill: iterations = fill_idiom(idiom, budget); break;
+            case loop_idiom::kind_t::multiply: iterations = multiply_idiom(idiom, budget); break;
+            case loop_idiom::kind_t::search: iterations = search_idiom(idiom, budget); break;
+            }
+            if (iterations == 0) {
+                return false;
+            }
+            last_pc = idiom.branch;
+            cpu.q = 0;          // every idiom ends with its branch
+            ++stats.idioms;
+            stats.idiom_iterations += iterations;
+            return true;
+        }
+
+        // whole iterations of per T-states, the last of n costs last, that end by the budget
+        static inline uint64_t iterations_within(uint64_t n, unsigned per, unsigned last, cycle_t budget) {
+            if ((n - 1) * per + last <= budget) {
+                return n;
+            }
+            return std::min<uint64_t>(n - 1, budget / per);
+        }
+
+        inline void end_loop(address_t head, address_t end, bool done, uint64_t tstates) {
+            regs.word(PC) = (word_t)(done ? end : head);
+            cycles_ += tstates;
+        }
+
+        uint64_t copy_idiom(const loop_idiom& idiom, cycle_t budget) {
+            static constexpr unsigned PER = 52, LAST = 47, M1 = 8;
+            auto hl = get_pair(regs, H), de = get_pair(regs, D), bc = get_pair(regs, B);
+            uint64_t n = bc ? bc : 0x10000;
+            auto k = iterations_within(n, PER, LAST, budget);
+            if (k == 0 || !plain(hl, (uint32_t)k, PAGE_READ_WATCH) || !plain(de, (uint32_t)k, 0xFF)) {
+                return 0;
+            }
+            // forward a byte at a time, an overlapping copy repeats as it does on the CPU
+            uint8_t b{ 0 };
+            for (uint64_t i{ 0 }; i < k; ++i) {
+                b = (uint8_t)ram_[(address_t)(hl + i)];
+                ram_[(address_t)(de + i)] = (byte_t)b;
+            }
+            hashes.touch(de, k);
+            // the last LD (DE),A, or the JR back to the head
+            cpu.memptr = (k == n) ? (uint16_t)(b << 8 | ((de + k) & 0xFF)) : idiom.head;
+            set_pair(regs, H, (uint16_t)(hl + k));
+            set_pair(regs, D, (uint16_t)(de + k));
+            bc = (uint16_t)(bc - k);
+            set_pair(regs, B, bc);
+            uint8_t f{ 0 };
+            regs.byte(A) = (byte_t)alu::or_((uint8_t)(bc >> 8), (uint8_t)bc, f);      // LD A,B / OR C
+            regs.byte(F) = (byte_t)f;
+            refresh(k * M1);
+            end_loop(idiom.head, idiom.end, k == n, k * PER - (k == n ? PER - LAST : 0));
+            return k;
+        }
+
+        uint64_t fill_idiom(const loop_idiom& idiom, cycle_t budget) {
+            static constexpr unsigned M1 = 3;
+            const unsigned per = idiom.store_tstates + 6 + 13, last = idiom.store_tstates + 6 + 8;
+            auto pointer = get_pair(regs, idiom.pointer);
+            auto b = (uint8_t)regs.byte(B);
+            uint64_t n = b ? b : 0x100;
+            auto k = iterations_within(n, per, last, budget);
+            if (k == 0 || !plain(pointer, (uint32_t)k, 0xFF)) {
+                return 0;
+            }
+            auto value = (idiom.source < 0) ? (byte_t)idiom.value : regs.byte(idiom.source);
+            for (uint64_t i{ 0 }; i < k; ++i) {
+                ram_[(address_t)(pointer + i)] = value;
+            }
+            hashes.touch(pointer, k);
+            // the last LD (DE),A, or DJNZ back to the head
+            if (k < n || k > 1 || idiom.pointer == D) {
+                cpu.memptr = (k == n && idiom.pointer == D) ? (uint16_t)((uint8_t)value << 8 | ((pointer + k) & 0xFF)) : idiom.head;
+            }
+            set_pair(regs, idiom.pointer, (uint16_t)(pointer + k));
+            regs.byte(B) = (byte_t)(b - k);
+            refresh(k * M1);
+            end_loop(idiom.head, idiom.end, k == n, k * per - (k == n ? per - last : 0));
+            return k;
+        }
+
+        // registers only, so simply iterate natively
+        uint64_t multiply_idiom(const loop_idiom& idiom, cycle_t budget) {
+            auto hl = get_pair(regs, H), de = get_pair(regs, D);
+            auto a = (uint8_t)regs.byte(A), f = (uint8_t)regs.byte(F), b = (uint8_t)regs.byte(B);
+            auto memptr = cpu.memptr;
+            uint64_t n = b ? b : 0x100, k{ 0 }, tstates{ 0 }, m1{ 0 };
+            while (k < n) {
+                bool last = k + 1 == n;
+                auto next_f = f;
+                auto next_a = a;
+                uint16_t next_memptr = hl + 1;
+                auto next_hl = alu::add16(hl, hl, next_f);
+                unsigned t{ 11 + (last ? 8u : 13u) }, fetches{ 3 };
+                if (idiom.rla) {
+                    next_a = alu::rla(next_a, next_f);
+                    t += 4;
+                    ++fetches;
+                }
+                if (next_f & CARRY) {
+                    next_memptr = next_hl + 1;
+                    next_hl = alu::add16(next_hl, de, next_f);
+                    t += 7 + 11;
+                    ++fetches;
+                }
+                else {
+                    next_memptr = idiom.branch;     // JR NC taken to the DJNZ
+                    t += 12;
+                }
+                if (tstates + t > budget) {
+                    break;
+                }
+                hl = next_hl; f = next_f; a = next_a;
+                memptr = last ? next_memptr : idiom.head;
+                tstates += t;
+                m1 += fetches;
+                ++k;
+            }
+            if (k == 0) {
+                return 0;
+            }
+            set_pair(regs, H, hl);
+            regs.byte(A) = (byte_t)a;
+            regs.byte(F) = (byte_t)f;
+            regs.byte(B) = (byte_t)(b - k);
+            cpu.memptr = memptr;
+            refresh(m1);
+            end_loop(idiom.head, idiom.end, k == n, tstates);
+            return k;
+        }
+
+        // no count to bound it, scans until a byte matches or the budget ends
+        uint64_t search_idiom(const loop_idiom& idiom, cycle_t budget) {
+            const unsigned per = idiom.tstates, last = per - 5;
+            auto hl = get_pair(regs, H);
+            auto a = (uint8_t)regs.byte(A);
+            auto operand = (idiom.source < 0) ? idiom.value : (uint8_t)regs.byte(idiom.source);
+            // LD A,(HL) compares the byte read with the operand, CP (HL) compares A with the byte read
+            auto matches = [&](uint8_t b) { return idiom.load ? b == operand : a == b; };
+            uint64_t k{ 0 };
+            bool found{ false };
+            while (k < 0x10000) {
+                if (matches((uint8_t)ram_[(address_t)(hl + k)])) {
+                    found = k * per + last <= budget;
+                    k += found;
+                    break;
+                }
+                if ((k + 1) * per > budget) {
+                    break;
+                }
+                ++k;
+            }
+            if (k == 0 || !plain(hl, (uint32_t)k, PAGE_READ_WATCH)) {
+                return 0;
+            }
+            auto b = (uint8_t)ram_[(address_t)(hl + k - 1)];
+            if (idiom.load) {
+                a = b;
+            }
+            uint8_t f{ 0 };
+            alu::cp(a, idiom.load ? operand : b, f);
+            regs.byte(A) = (byte_t)a;
+            regs.byte(F) = (byte_t)f;
+            // JR NZ back to the head, one that falls through at once leaves MEMPTR alone
+            if (!found || k > 1) {
+                cpu.memptr = idiom.head;
+            }
+            set_pair(regs, H, (uint16_t)(hl + k));
+            if (idiom.counted) {
+                set_pair(regs, B, (uint16_t)(get_pair(regs, B) - k));
+            }
+            refresh(k * idiom.m1);
+            end_loop(idiom.head, idiom.end, found, k * per - (found ? per - last : 0));
+            return k;
+        }
+
+        void flush_code_cache() {
+            loop_cache.fill({});
+            for (auto& f : page_flags) {
+                f &= ~PAGE_CODE;
+            }
+        }
+
+        z80_registers_t regs{};
+        z80_control_t cpu;
+        core_t core_;
+        in_t in_;
+        out_t out_;
+        std::bitset<256> pure_ports;
+        bool fast_halt{ true };
+        bool fast_poll{ true };
+        bool fast_idioms{ true };
+        bool verify_traps{ false };
+        bool fuse{ true };
+        dispatch_stats_t stats;
+        address_t last_pc{ 0 };
+        std::vector<uint64_t> pair_counts;
+        address_t profiled_pc{ 0 };
+        uint8_t profiled_opcode{ 0 };
+        cycle_t last_event_at{ 0 };
+        address_t poll_head{ 0 };           // where and when the CPU last came back to a polling loop's head
+        cycle_t poll_arrived_at{ ~cycle_t{ 0 } };
+        std::array<loop_entry, LOOP_CACHE_SIZE> loop_cache{};
+        traps_t traps;
+        address_bitmap breakpoints;
+        std::unordered_map<address_t, z80_condition> conditions;
+        address_bitmap read_watch;
+        address_bitmap write_watch;
+        std::optional<watch_hit_t> watch_hit_;
+        bool breakpoint_hit_{ false };
+        bool stop_{ false };
+        ram_t ram_;
+        page_hashes hashes;
+        scheduler events_;
+        arena frames;
+        device_context devices_{ events_, frames };
+        contention_table contention_;
+        std::array<uint8_t, PAGE_COUNT> page_flags{};
+        cycle_t cycles_{ 0 };
+        uint64_t m1_{ 0 };          // opcode fetches
+        uint64_t r_m1{ 0 };         // m1_ when R was last written
+
+    };
+
+}
@@ -0,0 +1,258 @@
+/**
+
+    @file      z80_opcodes.h
+    @brief     Z80 instruction templates for every opcode of every prefix, shared by the disassembler and assembler
+    @details   a template is the instruction's assembly language with its operands as placeholders:
+
+                   n       immediate byte                  e       relative jump, the target address
+                   nn      immediate word                  d       index displacement, as in (IX+d)
+
+               + main and ED are written out, CB, DD, FD, DDCB and FDCB are derived from them on first use
+               + DD and FD substitute IX or IY for HL, IXH or IYH for H, IXL or IYL for L, and (IX+d) or (IY+d)
+                 for (HL), leaving H and L alone where (HL) is replaced; an opcode that does not involve HL is
+                 empty, the prefix is ignored and executes as a NOP
+               + DDCB and FDCB include the undocumented forms that copy the result to a register e.g.
+                 RLC (IX+d),B, and the BIT mirrors for every register field
+               + undocumented instructions are named: SLL, IXH, IXL, IYH, IYL, IN (C), OUT (C),0, and the
+                 NEG, RETN and IM mirrors repeat the documented name
+               + an empty template is not an instruction, the undefined ED opcodes execute as two NOPs
+               the assembler takes the lowest opcode with a template, for DDCB and FDCB the one with register
+               field 6, so the mirrors assemble to their documented encoding
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace emu {
+
+    class z80_opcodes {
+
+    public:
+
+        using table_t = std::array<std::string, 256>;
+
+        enum class prefix_t { none, cb, ed, dd, fd, ddcb, fdcb };
+
+        static constexpr prefix_t PREFIXES[] = {
+            prefix_t::none, prefix_t::cb, prefix_t::ed, prefix_t::dd, prefix_t::fd, prefix_t::ddcb, prefix_t::fdcb
+        };
+
+        // the bytes before the opcode, DDCB and FDCB put the displacement between them and the opcode
+        static std::vector<uint8_t> prefix_bytes(prefix_t prefix) {
+            switch (prefix) {
+            case prefix_t::cb: return { 0xCB };
+            case prefix_t::ed: return { 0xED };
+            case prefix_t::dd: return { 0xDD };
+            case prefix_t::fd: return { 0xFD };
+            case prefix_t::ddcb: return { 0xDD, 0xCB };
+            case prefix_t::fdcb: return { 0xFD, 0xCB };
+            default: return {};
+            }
+        }
+
+        static const table_t& table(prefix_t prefix) {
+            switch (prefix) {
+            case prefix_t::cb: return cb();
+            case prefix_t::ed: return ed();
+            case prefix_t::dd: return dd();
+            case prefix_t::fd: return fd();
+            case prefix_t::ddcb: return ddcb();
+            case prefix_t::fdcb: return fdcb();
+            default: return main();
+            }
+        }
+
+        // CB, ED, DD and FD are prefixes, not instructions
+        static const table_t& main() {
+            static const table_t table{
+                "NOP", "LD BC,nn", "LD (BC),A", "INC BC", "INC B", "DEC B", "LD B,n", "RLCA",
+                "EX AF,AF'", "ADD HL,BC", "LD A,(BC)", "DEC BC", "INC C", "DEC C", "LD C,n", "RRCA",
+                "DJNZ e", "LD DE,nn", "LD (DE),A", "INC DE", "INC D", "DEC D", "LD D,n", "RLA",
+                "JR e", "ADD HL,DE", "LD A,(DE)", "DEC DE", "INC E", "DEC E", "LD E,n", "RRA",
+                "JR NZ,e", "LD HL,nn", "LD (nn),HL", "INC HL", "INC H", "DEC H", "LD H,n", "DAA",
+                "JR Z,e", "ADD HL,HL", "LD HL,(nn)", "DEC HL", "INC L", "DEC L", "LD L,n", "CPL",
+                "JR NC,e", "LD SP,nn", "LD (nn),A", "INC SP", "INC (HL)", "DEC (HL)", "LD (HL),n", "SCF",
+                "JR C,e", "ADD HL,SP", "LD A,(nn)", "DEC SP", "INC A", "DEC A", "LD A,n", "CCF",
+                "LD B,B", "LD B,C", "LD B,D", "LD B,E", "LD B,H", "LD B,L", "LD B,(HL)", "LD B,A",
+                "LD C,B", "LD C,C", "LD C,D", "LD C,E", "LD C,H", "LD C,L", "LD C,(HL)", "LD C,A",
+                "LD D,B", "LD D,C", "LD D,D", "LD D,E", "LD D,H", "LD D,L", "LD D,(HL)", "LD D,A",
+                "LD E,B", "LD E,C", "LD E,D", "LD E,E", "LD E,H", "LD E,L", "LD E,(HL)", "LD E,A",
+                "LD H,B", "LD H,C", "LD H,D", "LD H,E", "LD H,H", "LD H,L", "LD H,(HL)", "LD H,A",
+                "LD L,B", "LD L,C", "LD L,D", "LD L,E", "LD L,H", "LD L,L", "LD L,(HL)", "LD L,A",
+                "LD (HL),B", "LD (HL),C", "LD (HL),D", "LD (HL),E", "LD (HL),H", "LD (HL),L", "HALT", "LD (HL),A",
+                "LD A,B", "LD A,C", "LD A,D", "LD A,E", "LD A,H", "LD A,L", "LD A,(HL)", "LD A,A",
+                "ADD A,B", "ADD A,C", "ADD A,D", "ADD A,E", "ADD A,H", "ADD A,L", "ADD A,(HL)", "ADD A,A",
+                "ADC A,B", "ADC A,C", "ADC A,D", "ADC A,E", "ADC A,H", "ADC A,L", "ADC A,(HL)", "ADC A,A",
+                "SUB B", "SUB C", "SUB D", "SUB E", "SUB H", "SUB L", "SUB (HL)", "SUB A",
+                "SBC A,B", "SBC A,C", "SBC A,D", "SBC A,E", "SBC A,H", "SBC A,L", "SBC A,(HL)", "SBC A,A",
+                "AND B", "AND C", "AND D", "AND E", "AND H", "AND L", "AND (HL)", "AND A",
+                "XOR B", "XOR C", "XOR D", "XOR E", "XOR H", "XOR L", "XOR (HL)", "XOR A",
+                "OR B", "OR C", "OR D", "OR E", "OR H", "OR L", "OR (HL)", "OR A",
+                "CP B", "CP C", "CP D", "CP E", "CP H", "CP L", "CP (HL)", "CP A",
+                "RET NZ", "POP BC", "JP NZ,nn", "JP nn", "CALL NZ,nn", "PUSH BC", "ADD A,n", "RST $00",
+                "RET Z", "RET", "JP Z,nn", "", "CALL Z,nn", "CALL nn", "ADC A,n", "RST $08",
+                "RET NC", "POP DE", "JP NC,nn", "OUT (n),A", "CALL NC,nn", "PUSH DE", "SUB n", "RST $10",
+                "RET C", "EXX", "JP C,nn", "IN A,(n)", "CALL C,nn", "", "SBC A,n", "RST $18",
+                "RET PO", "POP HL", "JP PO,nn", "EX (SP),HL", "CALL PO,nn", "PUSH HL", "AND n", "RST $20",
+                "RET PE", "JP (HL)", "JP PE,nn", "EX DE,HL", "CALL PE,nn", "", "XOR n", "RST $28",
+                "RET P", "POP AF", "JP P,nn", "DI", "CALL P,nn", "PUSH AF", "OR n", "RST $30",
+                "RET M", "LD SP,HL", "JP M,nn", "EI", "CALL M,nn", "", "CP n", "RST $38"
+            };
+            return table;
+        }
+
+        static const table_t& ed() {
+            static const table_t table{
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "IN B,(C)", "OUT (C),B", "SBC HL,BC", "LD (nn),BC", "NEG", "RETN", "IM 0", "LD I,A",
+                "IN C,(C)", "OUT (C),C", "ADC HL,BC", "LD BC,(nn)", "NEG", "RETI", "IM 0", "LD R,A",
+                "IN D,(C)", "OUT (C),D", "SBC HL,DE", "LD (nn),DE", "NEG", "RETN", "IM 1", "LD A,I",
+                "IN E,(C)", "OUT (C),E", "ADC HL,DE", "LD DE,(nn)", "NEG", "RETN", "IM 2", "LD A,R",
+                "IN H,(C)", "OUT (C),H", "SBC HL,HL", "LD (nn),HL", "NEG", "RETN", "IM 0", "RRD",
+                "IN L,(C)", "OUT (C),L", "ADC HL,HL", "LD HL,(nn)", "NEG", "RETN", "IM 0", "RLD",
+                "IN (C)", "OUT (C),0", "SBC HL,SP", "LD (nn),SP", "NEG", "RETN", "IM 1", "",
+                "IN A,(C)", "OUT (C),A", "ADC HL,SP", "LD SP,(nn)", "NEG", "RETN", "IM 2", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "LDI", "CPI", "INI", "OUTI", "", "", "", "",
+                "LDD", "CPD", "IND", "OUTD", "", "", "", "",
+                "LDIR", "CPIR", "INIR", "OTIR", "", "", "", "",
+                "LDDR", "CPDR", "INDR", "OTDR", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", "",
+                "", "", "", "", "", "", "", ""
+            };
+            return table;
+        }
+
+        static const table_t& cb() {
+            static const table_t table = [] {
+                table_t t;
+                for (unsigned op{ 0 }; op < 256; ++op) {
+                    auto y = (op >> 3) & 7;
+                    auto r = std::string(REGISTERS[op & 7]);
+                    switch (op >> 6) {
+                    case 0: t[op] = std::string(ROTATES[y]) + " " + r; break;
+                    case 1: t[op] = "BIT " + std::to_string(y) + "," + r; break;
+                    case 2: t[op] = "RES " + std::to_string(y) + "," + r; break;
+                    default: t[op] = "SET " + std::to_string(y) + "," + r; break;
+                    }
+                }
+                return t;
+            }();
+            return table;
+        }
+
+        static const table_t& dd() {
+            static const table_t table = index("IX");
+            return table;
+        }
+
+        static const table_t& fd() {
+            static const table_t table = index("IY");
+            return table;
+        }
+
+        static const table_t& ddcb() {
+            static const table_t table = index_cb("IX");
+            return table;
+        }
+
+        static const table_t& fdcb() {
+            static const table_t table = index_cb("IY");
+            return table;
+        }
+
+    private:
+
+        static constexpr const char* REGISTERS[] = { "B", "C", "D", "E", "H", "L", "(HL)", "A" };
+        static constexpr const char* ROTATES[] = { "RLC", "RRC", "RL", "RR", "SLA", "SRA", "SLL", "SRL" };
+
+        // the main table with HL, H, L and (HL) replaced
+        static table_t index(const std::string& xy) {
+            table_t t;
+            for (unsigned op{ 0 }; op < 256; ++op) {
+                const auto& s = main()[op];
+                if (s.empty() || op == 0xEB) continue;                         // EX DE,HL is never indexed
+                if (op == 0xE9) {
+                    t[op] = "JP (" + xy + ")";
+                    continue;
+                }
+                auto space = s.find(' ');
+                if (space == std::string::npos) continue;
+                std::vector<std::string> operands;
+                for (size_t begin{ space + 1 }; begin <= s.size();) {
+                    auto comma = s.find(',', begin);
+                    if (comma == std::string::npos) comma = s.size();
+                    operands.push_back(s.substr(begin, comma - begin));
+                    begin = comma + 1;
+                }
+                bool memory{ false };
+                for (const auto& operand : operands) memory = memory || operand == "(HL)";
+                bool indexed{ false };
+                for (auto& operand : operands) {
+                    if (memory) {
+                        if (operand == "(HL)") {
+                            operand = "(" + xy + "+d)";
+                            indexed = true;
+                        }
+                    }
+                    else if (operand == "HL") {
+                        operand = xy;
+                        indexed = true;
+                    }
+                    else if (operand == "H" || operand == "L") {
+                        operand = xy + operand;
+                        indexed = true;
+                    }
+                }
+                if (!indexed) continue;
+                auto text = s.substr(0, space + 1);
+                for (size_t i{ 0 }; i < operands.size(); ++i) text += (i ? "," : "") + operands[i];
+                t[op] = text;
+            }
+            return t;
+        }
+
+        // DDCB and FDCB, the displacement comes before the opcode
+        static table_t index_cb(const std::string& xy) {
+            table_t t;
+            auto memory = "(" + xy + "+d)";
+            for (unsigned op{ 0 }; op < 256; ++op) {
+                auto y = (op >> 3) & 7;
+                auto z = op & 7;
+                auto copy = (z == 6) ? std::string() : std::string(",") + REGISTERS[z];
+                switch (op >> 6) {
+                case 0: t[op] = std::string(ROTATES[y]) + " " + memory + copy; break;
+                case 1: t[op] = "BIT " + std::to_string(y) + "," + memory; break;
+                case 2: t[op] = "RES " + std::to_string(y) + "," + memory + copy; break;
+                default: t[op] = "SET " + std::to_string(y) + "," + memory + copy; break;
+                }
+            }
+            return t;
+        }
+
+    };
+
+}
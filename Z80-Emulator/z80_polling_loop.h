@@ -0,0 +1,166 @@
+/**
+
+    @file      z80_polling_loop.h
+    @brief     recognises side-effect free polling loops, the spin-waits that only an event can end
+    @details   a polling loop reads one memory location or port, tests it and branches back to its head e.g.
+
+                   wait:   LD A,(FRAMES)       3A nn       13
+                           AND $01             E6 01        7
+                           JR Z,wait           28 F9       12
+
+               + the first instruction is the load or the bit test of the polled value
+               + then up to two tests that only read A, an 8 bit immediate or an unchanged register
+               + last a conditional JR or JP back to the head, the loop's only exit
+               + no writes, no stack, nothing that depends on the carry flag coming in
+               so an iteration ends in the same state it started in, as long as the polled value does not change,
+               and N iterations differ from one only in T-states and the refresh register
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "emu_memory_types.h"
+
+namespace emu {
+
+    struct polling_loop {
+
+        enum class source_t { absolute, bc, de, hl, ix, iy, port };
+
+        address_t head;         // first byte of the loop
+        address_t branch;       // address of the closing branch
+        address_t end;          // one past the closing branch
+        unsigned tstates;       // per iteration, branch taken
+        unsigned m1;            // opcode fetches per iteration
+
+        source_t source;
+        address_t address;      // absolute address or port (low byte)
+        int8_t displacement;    // for (IX+d) and (IY+d)
+        bool reads_memptr;      // BIT b,(HL), whose x and y flags come from MEMPTR
+
+    };
+
+    // decodes from head through read(address_t) -> byte_t, the loop must fit in MAX_BYTES
+    template<typename READ>
+    std::optional<polling_loop> detect_polling_loop(READ read, address_t head) {
+
+        static constexpr size_t MAX_BYTES = 16;
+        static constexpr size_t MAX_TESTS = 2;
+
+        polling_loop loop{ head, 0, 0, 0, 0, polling_loop::source_t::absolute, 0, 0, false };
+        address_t pc = head;
+        auto next = [&]() { return (uint8_t)read(pc++); };
+
+        // the load, which decides whether A is rewritten each iteration
+        bool loads_a{ true };
+        auto op = next();
+        switch (op) {
+        case 0x3A:                                                  // LD A,(nn)
+            loop.address = next();
+            loop.address |= next() << 8;
+            loop.tstates += 13; loop.m1 += 1;
+            break;
+        case 0x0A: loop.source = polling_loop::source_t::bc; loop.tstates += 7; loop.m1 += 1; break;  // LD A,(BC)
+        case 0x1A: loop.source = polling_loop::source_t::de; loop.tstates += 7; loop.m1 += 1; break;  // LD A,(DE)
+        case 0x7E: loop.source = polling_loop::source_t::hl; loop.tstates += 7; loop.m1 += 1; break;  // LD A,(HL)
+        case 0xDB:                                                  // IN A,(n)
+            loop.source = polling_loop::source_t::port;
+            loop.address = next();
+            loop.tstates += 11; loop.m1 += 1;
+            break;
+        case 0xCB:                                                  // BIT b,(HL)
+            op = next();
+            if ((op & 0xC7) != 0x46) return std::nullopt;
+            loop.source = polling_loop::source_t::hl;
+            loop.tstates += 12; loop.m1 += 2;
+            loop.reads_memptr = true;
+            loads_a = false;
+            break;
+        case 0xDD:
+        case 0xFD: {
+            loop.source = (op == 0xDD) ? polling_loop::source_t::ix : polling_loop::source_t::iy;
+            op = next();
+            if (op == 0x7E) {                                       // LD A,(IX+d)
+                loop.displacement = (int8_t)next();
+                loop.tstates += 19; loop.m1 += 2;
+            }
+            else if (op == 0xCB) {                                  // BIT b,(IX+d)
+                loop.displacement = (int8_t)next();
+                if ((next() & 0xC7) != 0x46) return std::nullopt;
+                loop.tstates += 20; loop.m1 += 2;
+                loads_a = false;
+            }
+            else {
+                return std::nullopt;
+            }
+            break;
+        }
+        default:
+            return std::nullopt;
+        }
+
+        // the tests, then the branch back
+        for (size_t tests{ 0 }; (size_t)(address_t)(pc - head) < MAX_BYTES; ) {
+            auto at = pc;
+            op = next();
+            bool is_test{ true };
+            switch (op) {
+            case 0xE6: case 0xF6: case 0xEE:                        // AND n, OR n, XOR n
+                if (!loads_a) return std::nullopt;
+                [[fallthrough]];
+            case 0xFE:                                              // CP n
+                next();
+                loop.tstates += 7; loop.m1 += 1;
+                break;
+            case 0x07: case 0x0F:                                   // RLCA, RRCA
+                if (!loads_a) return std::nullopt;
+                loop.tstates += 4; loop.m1 += 1;
+                break;
+            case 0xCB:                                              // BIT b,r
+                op = next();
+                if ((op & 0xC0) != 0x40 || (op & 0x07) == 6) return std::nullopt;
+                loop.tstates += 8; loop.m1 += 2;
+                break;
+            case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: {
+                if (op == 0x18) return std::nullopt;                // JR e never exits
+                auto target = (address_t)(pc + 1 + (int8_t)read(pc));
+                ++pc;
+                if (target != head) return std::nullopt;
+                loop.tstates += 12; loop.m1 += 1;
+                is_test = false;
+                break;
+            }
+            case 0xC2: case 0xCA: case 0xD2: case 0xDA: case 0xE2: case 0xEA: case 0xF2: case 0xFA: {
+                address_t target = next();
+                target |= next() << 8;
+                if (target != head) return std::nullopt;
+                loop.tstates += 10; loop.m1 += 1;
+                is_test = false;
+                break;
+            }
+            default:
+                if (op >= 0xA0 && op <= 0xBF && (op & 0x07) != 6) {    // AND/XOR/OR/CP r, not (HL)
+                    if (!loads_a && op < 0xB8 && !(op == 0xA7 || op == 0xB7)) return std::nullopt;
+                    loop.tstates += 4; loop.m1 += 1;
+                    break;
+                }
+                return std::nullopt;
+            }
+            if (!is_test) {
+                loop.branch = at;
+                loop.end = pc;
+                return loop;
+            }
+            if (++tests > MAX_TESTS) {
+                return std::nullopt;
+            }
+        }
+        return std::nullopt;
+    }
+
+}
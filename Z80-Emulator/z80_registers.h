@@ -213,10 +213,19 @@ constexpr auto IX = 14;
 constexpr auto IY = 16;
 constexpr auto SHADOW = 18;
 
+// register file byte names e.g. for state reports
+constexpr const char* Z80_SRAM_NAMES[] = {
+    "F", "A", "B", "C", "D", "E", "H", "L", "I", "R",
+    "SP.lo", "SP.hi", "PC.lo", "PC.hi", "IX.lo", "IX.hi", "IY.lo", "IY.hi",
+    "F'", "A'", "B'", "C'", "D'", "E'", "H'", "L'"
+};
+
 constexpr auto CARRY = 0b00000001;
 constexpr auto NEGATE = 0b00000010;
 constexpr auto PARITY_OVERFLOW = 0b00000100;
+constexpr auto BIT3_Y = 0b00001000;
 constexpr auto HALF_CARRY = 0b00010000;
+constexpr auto BIT5_X = 0b00100000;
 constexpr auto ZERO = 0b01000000;
 constexpr auto SIGN = 0b10000000;
 
@@ -224,4 +233,14 @@ namespace emu {
 
     using z80_registers_t = registers_t<Z80_SRAM_SIZE>; // 208 bytes of SRAM
 
+    // BC, DE and HL as the Z80 sees them, the first named register is the high byte
+    inline uint16_t get_pair(z80_registers_t& regs, size_t hi) {
+        return (uint16_t)((uint8_t)regs.byte(hi) << 8 | (uint8_t)regs.byte(hi + 1));
+    }
+
+    inline void set_pair(z80_registers_t& regs, size_t hi, uint16_t value) {
+        regs.byte(hi) = (int8_t)(value >> 8);
+        regs.byte(hi + 1) = (int8_t)value;
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,792 @@
+/**
+
+    @file      z80_selftest.h
+    @brief     instruction exerciser programs for the Z80 core and a timed pass/fail runner
+    @details   in the style of the classic exercisers each group runs a set of instructions over every combination
+               of input flags and operands and folds the registers they leave into a CRC, the program itself
+               compares the CRC with the expected one and reports:
+               + the driver is the same for every group, it loops over the tables and calls the group's setup
+                 routine, which loads the registers from FVAL, XVAL and YVAL, then runs the instruction under
+                 test from a 4 byte slot the driver copies each variant into
+               + after the instruction the driver pushes IY IX HL DE BC AF and the words at CELL2 and CELL, the
+                 group's capture mask picks which of them (bit 0 CELL first) go into the CRC-16/CCITT, high byte
+                 first
+               + the CRC leaves on port $FE low byte first, then 0 (pass) or 1 (fail) on port $FF before HALT
+               + any other port is a latch, reading port p gives the last byte written XOR both bytes of p, so the
+                 I/O group sees which port and which value each instruction used
+               + the expected CRCs were worked out from the documented and undocumented behaviour of each
+                 instruction, independently of z80_alu.h
+               + the groups cover the ALU, INC and DEC, rotates, shifts and bits (CB, DDCB, FDCB), the loads,
+                 the index register halves and stray prefixes, jumps, calls, returns and the stack, the
+                 exchanges, RLD and RRD, the block transfers, searches and I/O and the port instructions
+               + not covered: LD A,R and LD R,A, RST, IM, EI, DI, HALT, RETI, RETN, LD SP,HL and the interrupts
+                 themselves, they depend on the machine around the core and its own tests cover them
+               the memory map:
+
+                   $0000   driver                  $8000   CRC VPTR FPTR XPTR YPTR FVAL XVAL YVAL
+                   $0100   group setup routine     $8010   table bounds, capture mask, expected CRC
+                   $0200   variants, 4 bytes each  $A810   CELL, the memory operand
+                   $0300   input flags             $A820   CELL2, the block transfer destination
+                   $0400   X operands              $FF00   stack
+                   $0600   Y operands
+
+               the runner loads a group into a fresh machine, runs it with the core and reports the result with
+               the emulated clock rate achieved
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+
+namespace emu {
+
+    // one instruction group
+    struct selftest_group {
+
+        const char* name;
+        std::vector<uint8_t> setup;                     // called before each instruction, ends with RET
+        uint8_t capture;                                // CELL CELL2 AF BC DE HL IX IY from bit 0
+        std::vector<std::array<uint8_t, 4>> variants;   // the instructions under test, NOP padded
+        std::vector<uint8_t> flags;                     // F before the instruction
+        std::vector<uint16_t> x;                        // operands, XVAL
+        std::vector<uint16_t> y;                        // operands, YVAL
+        uint16_t crc;                                   // expected
+
+        inline size_t iterations() const {
+            return variants.size() * flags.size() * x.size() * y.size();
+        }
+
+    };
+
+    struct selftest_result {
+
+        const char* name;
+        bool passed;
+        uint16_t crc;
+        uint16_t expected;
+        cycle_t tstates;        // to the report
+        double seconds;         // wall clock
+
+        inline double mhz() const {
+            return (seconds > 0) ? (double)tstates / seconds / 1e6 : 0;
+        }
+
+    };
+
+    class z80_selftest {
+
+    public:
+
+        static constexpr address_t SETUP = 0x0100;
+        static constexpr address_t VARIANTS = 0x0200;
+        static constexpr address_t FLAGS_IN = 0x0300;
+        static constexpr address_t X_OPERANDS = 0x0400;
+        static constexpr address_t Y_OPERANDS = 0x0600;
+        static constexpr address_t BOUNDS = 0x8010;     // VBEG VEND FBEG FEND XBEG XEND YBEG YEND
+        static constexpr address_t MASK = 0x8020;
+        static constexpr address_t EXPECT = 0x8022;
+        static constexpr address_t CELL = 0xA810;
+        static constexpr address_t CELL2 = 0xA820;
+
+        static constexpr uint8_t CRC_PORT = 0xFE;
+        static constexpr uint8_t RESULT_PORT = 0xFF;
+
+        static constexpr uint8_t CAPTURE_CELL = 0b00000001;
+        static constexpr uint8_t CAPTURE_CELL2 = 0b00000010;
+        static constexpr uint8_t CAPTURE_AF = 0b00000100;
+        static constexpr uint8_t CAPTURE_BC = 0b00001000;
+        static constexpr uint8_t CAPTURE_DE = 0b00010000;
+        static constexpr uint8_t CAPTURE_HL = 0b00100000;
+        static constexpr uint8_t CAPTURE_IX = 0b01000000;
+        static constexpr uint8_t CAPTURE_IY = 0b10000000;
+
+        static constexpr cycle_t BUDGET = 1'000'000'000;  // T-states before a group is failed as hung
+
+        static const std::vector<uint8_t>& driver() {
+            static const std::vector<uint8_t> code{
+                0x31, 0x00, 0xFF,       //            LD SP,$FF00
+                0x21, 0xFF, 0xFF,       //            LD HL,$FFFF
+                0x22, 0x00, 0x80,       //            LD (CRC),HL
+                0x2A, 0x10, 0x80,       //            LD HL,(VBEG)
+                0x22, 0x02, 0x80,       //            LD (VPTR),HL
+                0x2A, 0x02, 0x80,       //  vloop:    LD HL,(VPTR)
+                0x11, 0x62, 0x00,       //            LD DE,slot
+                0x01, 0x04, 0x00,       //            LD BC,4
+                0xED, 0xB0,             //            LDIR
+                0x22, 0x02, 0x80,       //            LD (VPTR),HL
+                0x2A, 0x14, 0x80,       //            LD HL,(FBEG)
+                0x22, 0x04, 0x80,       //            LD (FPTR),HL
+                0x2A, 0x04, 0x80,       //  floop:    LD HL,(FPTR)
+                0x7E,                   //            LD A,(HL)
+                0x32, 0x0A, 0x80,       //            LD (FVAL),A
+                0x23,                   //            INC HL
+                0x22, 0x04, 0x80,       //            LD (FPTR),HL
+                0x2A, 0x18, 0x80,       //            LD HL,(XBEG)
+                0x22, 0x06, 0x80,       //            LD (XPTR),HL
+                0x2A, 0x06, 0x80,       //  xloop:    LD HL,(XPTR)
+                0x5E,                   //            LD E,(HL)
+                0x23,                   //            INC HL
+                0x56,                   //            LD D,(HL)
+                0x23,                   //            INC HL
+                0x22, 0x06, 0x80,       //            LD (XPTR),HL
+                0xED, 0x53, 0x0C, 0x80, //            LD (XVAL),DE
+                0x2A, 0x1C, 0x80,       //            LD HL,(YBEG)
+                0x22, 0x08, 0x80,       //            LD (YPTR),HL
+                0x2A, 0x08, 0x80,       //  yloop:    LD HL,(YPTR)
+                0x5E,                   //            LD E,(HL)
+                0x23,                   //            INC HL
+                0x56,                   //            LD D,(HL)
+                0x23,                   //            INC HL
+                0x22, 0x08, 0x80,       //            LD (YPTR),HL
+                0xED, 0x53, 0x0E, 0x80, //            LD (YVAL),DE
+                0x21, 0x00, 0x00,       //            LD HL,0
+                0x22, 0x10, 0xA8,       //            LD (CELL),HL
+                0x22, 0x20, 0xA8,       //            LD (CELL2),HL
+                0xCD, 0x00, 0x01,       //            CALL SETUP
+                0x00,                   //  slot:     NOP
+                0x00,                   //            NOP
+                0x00,                   //            NOP
+                0x00,                   //            NOP
+                0xFD, 0xE5,             //            PUSH IY
+                0xDD, 0xE5,             //            PUSH IX
+                0xE5,                   //            PUSH HL
+                0xD5,                   //            PUSH DE
+                0xC5,                   //            PUSH BC
+                0xF5,                   //            PUSH AF
+                0x2A, 0x20, 0xA8,       //            LD HL,(CELL2)
+                0xE5,                   //            PUSH HL
+                0x2A, 0x10, 0xA8,       //            LD HL,(CELL)
+                0xE5,                   //            PUSH HL
+                0x3A, 0x20, 0x80,       //            LD A,(MASK)
+                0x4F,                   //            LD C,A
+                0x06, 0x08,             //            LD B,8
+                0xD1,                   //  cap:      POP DE
+                0xCB, 0x19,             //            RR C
+                0xDC, 0xD0, 0x00,       //            CALL C,crc_de
+                0x10, 0xF8,             //            DJNZ cap
+                0x2A, 0x08, 0x80,       //            LD HL,(YPTR)
+                0xED, 0x5B, 0x1E, 0x80, //            LD DE,(YEND)
+                0xB7,                   //            OR A
+                0xED, 0x52,             //            SBC HL,DE
+                0xC2, 0x48, 0x00,       //            JP NZ,yloop
+                0x2A, 0x06, 0x80,       //            LD HL,(XPTR)
+                0xED, 0x5B, 0x1A, 0x80, //            LD DE,(XEND)
+                0xB7,                   //            OR A
+                0xED, 0x52,             //            SBC HL,DE
+                0xC2, 0x34, 0x00,       //            JP NZ,xloop
+                0x2A, 0x04, 0x80,       //            LD HL,(FPTR)
+                0xED, 0x5B, 0x16, 0x80, //            LD DE,(FEND)
+                0xB7,                   //            OR A
+                0xED, 0x52,             //            SBC HL,DE
+                0xC2, 0x23, 0x00,       //            JP NZ,floop
+                0x2A, 0x02, 0x80,       //            LD HL,(VPTR)
+                0xED, 0x5B, 0x12, 0x80, //            LD DE,(VEND)
+                0xB7,                   //            OR A
+                0xED, 0x52,             //            SBC HL,DE
+                0xC2, 0x0F, 0x00,       //            JP NZ,vloop
+                0x2A, 0x00, 0x80,       //            LD HL,(CRC)
+                0x7D,                   //            LD A,L
+                0xD3, 0xFE,             //            OUT ($FE),A
+                0x7C,                   //            LD A,H
+                0xD3, 0xFE,             //            OUT ($FE),A
+                0xED, 0x5B, 0x22, 0x80, //            LD DE,(EXPECT)
+                0xB7,                   //            OR A
+                0xED, 0x52,             //            SBC HL,DE
+                0x3E, 0x00,             //            LD A,0
+                0x28, 0x01,             //            JR Z,pass
+                0x3C,                   //            INC A
+                0xD3, 0xFF,             //  pass:     OUT ($FF),A
+                0x76,                   //            HALT
+                0xC5,                   //  crc_de:   PUSH BC
+                0x7A,                   //            LD A,D
+                0xCD, 0xDB, 0x00,       //            CALL crc_a
+                0x7B,                   //            LD A,E
+                0xCD, 0xDB, 0x00,       //            CALL crc_a
+                0xC1,                   //            POP BC
+                0xC9,                   //            RET
+                0x2A, 0x00, 0x80,       //  crc_a:    LD HL,(CRC)
+                0xAC,                   //            XOR H
+                0x67,                   //            LD H,A
+                0x06, 0x08,             //            LD B,8
+                0x29,                   //  crc_bit:  ADD HL,HL
+                0x30, 0x08,             //            JR NC,crc_next
+                0x7C,                   //            LD A,H
+                0xEE, 0x10,             //            XOR $10
+                0x67,                   //            LD H,A
+                0x7D,                   //            LD A,L
+                0xEE, 0x21,             //            XOR $21
+                0x6F,                   //            LD L,A
+                0x10, 0xF3,             //  crc_next: DJNZ crc_bit
+                0x22, 0x00, 0x80,       //            LD (CRC),HL
+                0xC9                    //            RET
+            };
+            return code;
+        }
+
+        static const std::vector<selftest_group>& groups() {
+            // operands chosen for their carries, half carries, overflows and signs
+            static const std::vector<uint16_t> edges8{
+                0x00, 0x01, 0x0F, 0x10, 0x3C, 0x55, 0x6B, 0x7F, 0x80, 0x81, 0xAA, 0xC3, 0xEF, 0xF0, 0xFE, 0xFF
+            };
+            static const std::vector<uint16_t> edges16{
+                0x0000, 0x0001, 0x00FF, 0x0100, 0x0FFF, 0x1000, 0x3C5A, 0x7FFE, 0x7FFF, 0x8000,
+                0x8001, 0xA55A, 0xC3E1, 0xEFFF, 0xF000, 0xFFFE, 0xFFFF, 0x1234, 0x5678, 0x9ABC
+            };
+            // every H, N and C with the other flags clear and set
+            static const std::vector<uint8_t> hnc{
+                0x00, 0x01, 0x02, 0x03, 0x10, 0x11, 0x12, 0x13, 0xEC, 0xED, 0xEE, 0xEF, 0xFC, 0xFD, 0xFE, 0xFF
+            };
+            static const std::vector<uint8_t> rotate_setup{
+                0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                0x32, 0x10, 0xA8,       //            LD (CELL),A
+                0xED, 0x4B, 0x0E, 0x80, //            LD BC,(YVAL)
+                0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                0x6F,                   //            LD L,A
+                0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                0x67,                   //            LD H,A
+                0xE5,                   //            PUSH HL
+                0xF1,                   //            POP AF
+                0x21, 0x10, 0xA8,       //            LD HL,CELL
+                0xDD, 0x21, 0x0B, 0xA8, //            LD IX,CELL-5
+                0xC9                    //            RET
+            };
+            // bit patterns that tell every register byte apart
+            static const std::vector<uint16_t> mixed_x{
+                0x0000, 0x00FF, 0x7F80, 0x8001, 0xFFFF, 0x0FF0, 0x5AA5, 0xC33C
+            };
+            static const std::vector<uint16_t> mixed_y{
+                0x0001, 0x1234, 0x7FFF, 0x8000, 0xF00F, 0xA55A, 0x3C3C, 0xFFFE
+            };
+            // every condition true and false
+            static const std::vector<uint8_t> conditions{
+                0x00, 0x01, 0x04, 0x40, 0x80, 0xC5, 0xFF, 0x3A, 0xBE, 0x41
+            };
+            static const std::vector<uint8_t> load_setup{
+                0x2A, 0x0C, 0x80,       //            LD HL,(XVAL)
+                0x22, 0x10, 0xA8,       //            LD (CELL),HL
+                0x2A, 0x0E, 0x80,       //            LD HL,(YVAL)
+                0x22, 0x20, 0xA8,       //            LD (CELL2),HL
+                0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                0x6F,                   //            LD L,A
+                0x3A, 0x0D, 0x80,       //            LD A,(XVAL+1)
+                0x67,                   //            LD H,A
+                0xE5,                   //            PUSH HL
+                0xF1,                   //            POP AF
+                0xED, 0x4B, 0x0C, 0x80, //            LD BC,(XVAL)
+                0xED, 0x5B, 0x0E, 0x80, //            LD DE,(YVAL)
+                0x21, 0x10, 0xA8,       //            LD HL,CELL
+                0xDD, 0x21, 0x0B, 0xA8, //            LD IX,CELL-5
+                0xFD, 0x21, 0x23, 0xA8, //            LD IY,CELL2+3
+                0xC9                    //            RET
+            };
+            static const std::vector<selftest_group> table{
+                {
+                    "8 bit ALU A,r",
+                    {
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0xED, 0x4B, 0x0E, 0x80, //            LD BC,(YVAL)
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_AF,
+                    {
+                        { 0x80 }, { 0x88 }, { 0x90 }, { 0x98 }, { 0xA0 }, { 0xA8 }, { 0xB0 }, { 0xB8 }
+                    },
+                    { 0x00, 0xFF }, sweep(0x0001), spread(edges8, 0x0101), 0xF8CE
+                },
+                {
+                    "8 bit ALU A,(HL) (IX+d) (IY+d)",
+                    {
+                        0xED, 0x4B, 0x0E, 0x80, //            LD BC,(YVAL)
+                        0x79,                   //            LD A,C
+                        0x32, 0x10, 0xA8,       //            LD (CELL),A
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0x21, 0x10, 0xA8,       //            LD HL,CELL
+                        0xDD, 0x21, 0x0B, 0xA8, //            LD IX,CELL-5
+                        0xFD, 0x21, 0x13, 0xA8, //            LD IY,CELL+3
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_AF,
+                    {
+                        { 0x86 }, { 0x8E }, { 0x96 }, { 0x9E },
+                        { 0xA6 }, { 0xAE }, { 0xB6 }, { 0xBE },
+                        { 0xDD, 0x86, 0x05 }, { 0xDD, 0x8E, 0x05 }, { 0xDD, 0x96, 0x05 }, { 0xDD, 0x9E, 0x05 },
+                        { 0xDD, 0xA6, 0x05 }, { 0xDD, 0xAE, 0x05 }, { 0xDD, 0xB6, 0x05 }, { 0xDD, 0xBE, 0x05 },
+                        { 0xFD, 0x86, 0xFD }, { 0xFD, 0x8E, 0xFD }, { 0xFD, 0x96, 0xFD }, { 0xFD, 0x9E, 0xFD },
+                        { 0xFD, 0xA6, 0xFD }, { 0xFD, 0xAE, 0xFD }, { 0xFD, 0xB6, 0xFD }, { 0xFD, 0xBE, 0xFD }
+                    },
+                    { 0x00, 0xFF }, edges8, spread(edges8, 0x0101), 0xA2AF
+                },
+                {
+                    "INC and DEC",
+                    {
+                        0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                        0x32, 0x10, 0xA8,       //            LD (CELL),A
+                        0x47,                   //            LD B,A
+                        0x4F,                   //            LD C,A
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0x21, 0x10, 0xA8,       //            LD HL,CELL
+                        0xDD, 0x2A, 0x0C, 0x80, //            LD IX,(XVAL)
+                        0xFD, 0x21, 0x0B, 0xA8, //            LD IY,CELL-5
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_CELL | CAPTURE_AF | CAPTURE_BC | CAPTURE_IX,
+                    {
+                        { 0x3C }, { 0x3D }, { 0x04 }, { 0x0D },
+                        { 0x34 }, { 0x35 }, { 0xDD, 0x24 }, { 0xDD, 0x25 },
+                        { 0xDD, 0x2C }, { 0xDD, 0x2D }, { 0xFD, 0x34, 0x05 }, { 0xFD, 0x35, 0x05 }
+                    },
+                    { 0x00, 0xFF }, sweep(0x0101), { 0x0000 }, 0x095A
+                },
+                {
+                    "rotates and shifts",
+                    rotate_setup,
+                    CAPTURE_CELL | CAPTURE_AF | CAPTURE_BC,
+                    {
+                        { 0x07 }, { 0x0F }, { 0x17 }, { 0x1F },
+                        { 0xCB, 0x07 }, { 0xCB, 0x0F }, { 0xCB, 0x17 }, { 0xCB, 0x1F },
+                        { 0xCB, 0x27 }, { 0xCB, 0x2F }, { 0xCB, 0x37 }, { 0xCB, 0x3F },
+                        { 0xCB, 0x06 }, { 0xCB, 0x0E }, { 0xCB, 0x16 }, { 0xCB, 0x1E },
+                        { 0xCB, 0x26 }, { 0xCB, 0x2E }, { 0xCB, 0x36 }, { 0xCB, 0x3E },
+                        { 0xDD, 0xCB, 0x05, 0x00 }, { 0xDD, 0xCB, 0x05, 0x08 }, { 0xDD, 0xCB, 0x05, 0x10 }, { 0xDD, 0xCB, 0x05, 0x18 },
+                        { 0xDD, 0xCB, 0x05, 0x20 }, { 0xDD, 0xCB, 0x05, 0x28 }, { 0xDD, 0xCB, 0x05, 0x30 }, { 0xDD, 0xCB, 0x05, 0x38 }
+                    },
+                    { 0x00, 0xFF }, sweep(0x0001), { 0x5AA5 }, 0xEA54
+                },
+                {
+                    "BIT SET RES",
+                    rotate_setup,
+                    CAPTURE_CELL | CAPTURE_AF | CAPTURE_BC,
+                    {
+                        { 0xCB, 0x47 }, { 0xCB, 0x4F }, { 0xCB, 0x57 }, { 0xCB, 0x5F },
+                        { 0xCB, 0x67 }, { 0xCB, 0x6F }, { 0xCB, 0x77 }, { 0xCB, 0x7F },
+                        { 0xCB, 0xC7 }, { 0xCB, 0xCF }, { 0xCB, 0xD7 }, { 0xCB, 0xDF },
+                        { 0xCB, 0xE7 }, { 0xCB, 0xEF }, { 0xCB, 0xF7 }, { 0xCB, 0xFF },
+                        { 0xCB, 0x87 }, { 0xCB, 0x8F }, { 0xCB, 0x97 }, { 0xCB, 0x9F },
+                        { 0xCB, 0xA7 }, { 0xCB, 0xAF }, { 0xCB, 0xB7 }, { 0xCB, 0xBF },
+                        { 0xDD, 0xCB, 0x05, 0x46 }, { 0xDD, 0xCB, 0x05, 0x4E }, { 0xDD, 0xCB, 0x05, 0x56 }, { 0xDD, 0xCB, 0x05, 0x5E },
+                        { 0xDD, 0xCB, 0x05, 0x66 }, { 0xDD, 0xCB, 0x05, 0x6E }, { 0xDD, 0xCB, 0x05, 0x76 }, { 0xDD, 0xCB, 0x05, 0x7E },
+                        { 0xDD, 0xCB, 0x05, 0xC6 }, { 0xDD, 0xCB, 0x05, 0xCE }, { 0xDD, 0xCB, 0x05, 0xD6 }, { 0xDD, 0xCB, 0x05, 0xDE },
+                        { 0xDD, 0xCB, 0x05, 0xE6 }, { 0xDD, 0xCB, 0x05, 0xEE }, { 0xDD, 0xCB, 0x05, 0xF6 }, { 0xDD, 0xCB, 0x05, 0xFE },
+                        { 0xDD, 0xCB, 0x05, 0x81 }, { 0xDD, 0xCB, 0x05, 0x89 }, { 0xDD, 0xCB, 0x05, 0x91 }, { 0xDD, 0xCB, 0x05, 0x99 },
+                        { 0xDD, 0xCB, 0x05, 0xA1 }, { 0xDD, 0xCB, 0x05, 0xA9 }, { 0xDD, 0xCB, 0x05, 0xB1 }, { 0xDD, 0xCB, 0x05, 0xB9 }
+                    },
+                    { 0x00, 0xFF }, sweep(0x0001), { 0x5AA5 }, 0x2A7F
+                },
+                {
+                    "DAA CPL NEG SCF CCF",
+                    {
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_AF,
+                    {
+                        { 0x27 }, { 0x2F }, { 0xED, 0x44 }, { 0xED, 0x4C },
+                        { 0x37 }, { 0x3F }
+                    },
+                    hnc, sweep(0x0001), { 0x0000 }, 0xC600
+                },
+                {
+                    "16 bit arithmetic",
+                    {
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0x2A, 0x0C, 0x80,       //            LD HL,(XVAL)
+                        0xDD, 0x2A, 0x0C, 0x80, //            LD IX,(XVAL)
+                        0xFD, 0x2A, 0x0C, 0x80, //            LD IY,(XVAL)
+                        0xED, 0x5B, 0x0E, 0x80, //            LD DE,(YVAL)
+                        0xED, 0x4B, 0x0E, 0x80, //            LD BC,(YVAL)
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_AF | CAPTURE_HL | CAPTURE_IX | CAPTURE_IY,
+                    {
+                        { 0x19 }, { 0x29 }, { 0xED, 0x5A }, { 0xED, 0x6A },
+                        { 0xED, 0x4A }, { 0xED, 0x52 }, { 0xED, 0x62 }, { 0xDD, 0x19 },
+                        { 0xFD, 0x29 }
+                    },
+                    { 0x00, 0xFF }, edges16, edges16, 0x5ED7
+                },
+                {
+                    "LDI LDD CPI CPD",
+                    {
+                        0x2A, 0x0C, 0x80,       //            LD HL,(XVAL)
+                        0x7C,                   //            LD A,H
+                        0x32, 0x10, 0xA8,       //            LD (CELL),A
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0x21, 0x10, 0xA8,       //            LD HL,CELL
+                        0x11, 0x20, 0xA8,       //            LD DE,CELL2
+                        0xED, 0x4B, 0x0E, 0x80, //            LD BC,(YVAL)
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_CELL | CAPTURE_CELL2 | CAPTURE_AF | CAPTURE_BC | CAPTURE_DE | CAPTURE_HL,
+                    {
+                        { 0xED, 0xA0 }, { 0xED, 0xA8 }, { 0xED, 0xA1 }, { 0xED, 0xA9 }
+                    },
+                    { 0x00, 0xFF }, sweep(0x3501), { 0x0001, 0x0002, 0x0000, 0x0100 }, 0x15B3
+                },
+                {
+                    "LD r,r'",
+                    load_setup,
+                    CAPTURE_CELL | CAPTURE_CELL2 | CAPTURE_AF | CAPTURE_BC | CAPTURE_DE | CAPTURE_HL | CAPTURE_IX | CAPTURE_IY,
+                    {
+                        { 0x40 }, { 0x41 }, { 0x42 }, { 0x43 }, { 0x44 }, { 0x45 }, { 0x46 }, { 0x47 },
+                        { 0x48 }, { 0x49 }, { 0x4A }, { 0x4B }, { 0x4C }, { 0x4D }, { 0x4E }, { 0x4F },
+                        { 0x50 }, { 0x51 }, { 0x52 }, { 0x53 }, { 0x54 }, { 0x55 }, { 0x56 }, { 0x57 },
+                        { 0x58 }, { 0x59 }, { 0x5A }, { 0x5B }, { 0x5C }, { 0x5D }, { 0x5E }, { 0x5F },
+                        { 0x60 }, { 0x61 }, { 0x62 }, { 0x63 }, { 0x64 }, { 0x65 }, { 0x66 }, { 0x67 },
+                        { 0x68 }, { 0x69 }, { 0x6A }, { 0x6B }, { 0x6C }, { 0x6D }, { 0x6E }, { 0x6F },
+                        { 0x70 }, { 0x71 }, { 0x72 }, { 0x73 }, { 0x74 }, { 0x75 }, { 0x77 }, { 0x78 },
+                        { 0x79 }, { 0x7A }, { 0x7B }, { 0x7C }, { 0x7D }, { 0x7E }, { 0x7F }
+                    },
+                    { 0x00 }, { 0x0000, 0xFFFF, 0x8001, 0x5AA5 }, { 0x1234, 0xEDCB, 0x7FFE, 0x00FF }, 0xE53B
+                },
+                {
+                    "LD immediate, indirect and indexed",
+                    load_setup,
+                    CAPTURE_CELL | CAPTURE_CELL2 | CAPTURE_AF | CAPTURE_BC | CAPTURE_DE | CAPTURE_HL | CAPTURE_IX | CAPTURE_IY,
+                    {
+                        { 0x06, 0x5A }, { 0x0E, 0xA5 }, { 0x16, 0x3C }, { 0x1E, 0xC3 }, { 0x26, 0x81 }, { 0x2E, 0x7E }, { 0x3E, 0x99 },
+                        { 0x36, 0xE7 }, { 0x01, 0x10, 0xA8, 0x0A }, { 0x11, 0x20, 0xA8, 0x1A }, { 0x01, 0x20, 0xA8, 0x02 },
+                        { 0x11, 0x10, 0xA8, 0x12 }, { 0x3A, 0x10, 0xA8 }, { 0x3A, 0x21, 0xA8 }, { 0x32, 0x11, 0xA8 },
+                        { 0x2A, 0x20, 0xA8 }, { 0x22, 0x20, 0xA8 }, { 0x22, 0x11, 0xA8 }, { 0xED, 0x4B, 0x20, 0xA8 },
+                        { 0xED, 0x5B, 0x10, 0xA8 }, { 0xED, 0x6B, 0x20, 0xA8 }, { 0xED, 0x43, 0x20, 0xA8 }, { 0xED, 0x53, 0x10, 0xA8 },
+                        { 0xED, 0x63, 0x20, 0xA8 }, { 0xED, 0x73, 0x20, 0xA8 }, { 0xDD, 0x2A, 0x20, 0xA8 }, { 0xFD, 0x2A, 0x10, 0xA8 },
+                        { 0xDD, 0x22, 0x20, 0xA8 }, { 0xFD, 0x22, 0x11, 0xA8 }, { 0x01, 0x34, 0x12 }, { 0x11, 0xCD, 0xAB },
+                        { 0x21, 0x01, 0x80 }, { 0xDD, 0x21, 0xFE, 0x7F }, { 0xFD, 0x21, 0x5A, 0xA5 }, { 0xDD, 0x46, 0x05 },
+                        { 0xDD, 0x4E, 0x05 }, { 0xDD, 0x56, 0x05 }, { 0xDD, 0x5E, 0x05 }, { 0xDD, 0x66, 0x05 }, { 0xDD, 0x6E, 0x05 },
+                        { 0xDD, 0x7E, 0x05 }, { 0xFD, 0x7E, 0xFD }, { 0xFD, 0x66, 0xFE }, { 0xDD, 0x70, 0x05 }, { 0xDD, 0x71, 0x05 },
+                        { 0xDD, 0x72, 0x05 }, { 0xDD, 0x73, 0x05 }, { 0xDD, 0x74, 0x05 }, { 0xDD, 0x75, 0x06 }, { 0xDD, 0x77, 0x06 },
+                        { 0xFD, 0x74, 0xFD }, { 0xFD, 0x75, 0xFE }, { 0xDD, 0x36, 0x05, 0x5A }, { 0xFD, 0x36, 0xFD, 0xA5 },
+                        { 0xED, 0x47, 0xED, 0x57 }, { 0xFD, 0xCB, 0xFD, 0x06 }, { 0xFD, 0xCB, 0xFE, 0x46 }, { 0xFD, 0xCB, 0xFD, 0xC0 },
+                        { 0xFD, 0xCB, 0xFE, 0x9F }, { 0xFD, 0xCB, 0xFD, 0x2E }, { 0xFD, 0xCB, 0xFD, 0x7E }
+                    },
+                    { 0x00, 0xFF }, mixed_x, mixed_y, 0x699A
+                },
+                {
+                    "IX IY halves and prefixes",
+                    {
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0D, 0x80,       //            LD A,(XVAL+1)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0xED, 0x4B, 0x0E, 0x80, //            LD BC,(YVAL)
+                        0xED, 0x5B, 0x0C, 0x80, //            LD DE,(XVAL)
+                        0x2A, 0x0E, 0x80,       //            LD HL,(YVAL)
+                        0xDD, 0x2A, 0x0C, 0x80, //            LD IX,(XVAL)
+                        0xFD, 0x2A, 0x0E, 0x80, //            LD IY,(YVAL)
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_AF | CAPTURE_BC | CAPTURE_DE | CAPTURE_HL | CAPTURE_IX | CAPTURE_IY,
+                    {
+                        { 0xDD, 0x26, 0x5A }, { 0xDD, 0x2E, 0xA5 }, { 0xFD, 0x26, 0x81 }, { 0xFD, 0x2E, 0x7E }, { 0xDD, 0x44 },
+                        { 0xDD, 0x4D }, { 0xDD, 0x54 }, { 0xDD, 0x5D }, { 0xDD, 0x7C }, { 0xDD, 0x7D }, { 0xFD, 0x44 }, { 0xFD, 0x7D },
+                        { 0xDD, 0x60 }, { 0xDD, 0x69 }, { 0xDD, 0x62 }, { 0xDD, 0x6B }, { 0xDD, 0x67 }, { 0xDD, 0x6F }, { 0xDD, 0x65 },
+                        { 0xDD, 0x6C }, { 0xFD, 0x67 }, { 0xFD, 0x68 }, { 0xDD, 0x84 }, { 0xDD, 0x8D }, { 0xDD, 0x94 }, { 0xDD, 0x9D },
+                        { 0xDD, 0xA4 }, { 0xDD, 0xAD }, { 0xDD, 0xB4 }, { 0xDD, 0xBD }, { 0xFD, 0x84 }, { 0xFD, 0xBD }, { 0xFD, 0x24 },
+                        { 0xFD, 0x2D }, { 0xDD, 0x09 }, { 0xDD, 0x29 }, { 0xDD, 0x39 }, { 0xFD, 0x09 }, { 0xFD, 0x19 }, { 0xFD, 0x29 },
+                        { 0xFD, 0x39 }, { 0xDD, 0x23 }, { 0xDD, 0x2B }, { 0xFD, 0x23 }, { 0xFD, 0x2B }, { 0xDD, 0xE5, 0xE1 },
+                        { 0xFD, 0xE5, 0xD1 }, { 0xC5, 0xDD, 0xE1 }, { 0xD5, 0xFD, 0xE1 }, { 0xDD, 0x04 }, { 0xFD, 0x78 },
+                        { 0xDD, 0xDD, 0x7C }, { 0xFD, 0xDD, 0x7D }, { 0xDD, 0xFD, 0x7C }, { 0xDD, 0xEB }
+                    },
+                    { 0x00, 0xFF }, mixed_x, mixed_y, 0xC292
+                },
+                {
+                    "jumps calls and the stack",
+                    {
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0D, 0x80,       //            LD A,(XVAL+1)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0xED, 0x4B, 0x0C, 0x80, //            LD BC,(XVAL)
+                        0xED, 0x5B, 0x0E, 0x80, //            LD DE,(YVAL)
+                        0x21, 0x66, 0x00,       //            LD HL,slot+4
+                        0xDD, 0x21, 0x66, 0x00, //            LD IX,slot+4
+                        0xFD, 0x21, 0x66, 0x00, //            LD IY,slot+4
+                        0xC9,                   //            RET
+                        0x0C,                   //  sub:      INC C
+                        0xC9,                   //            RET
+                        0xC0,                   //  ret_nz:   RET NZ
+                        0x0C,                   //            INC C
+                        0xC9,                   //            RET
+                        0xC8,                   //  ret_z:    RET Z
+                        0x0C,                   //            INC C
+                        0xC9,                   //            RET
+                        0xD0,                   //  ret_nc:   RET NC
+                        0x0C,                   //            INC C
+                        0xC9,                   //            RET
+                        0xD8,                   //  ret_c:    RET C
+                        0x0C,                   //            INC C
+                        0xC9,                   //            RET
+                        0xE0,                   //  ret_po:   RET PO
+                        0x0C,                   //            INC C
+                        0xC9,                   //            RET
+                        0xE8,                   //  ret_pe:   RET PE
+                        0x0C,                   //            INC C
+                        0xC9,                   //            RET
+                        0xF0,                   //  ret_p:    RET P
+                        0x0C,                   //            INC C
+                        0xC9,                   //            RET
+                        0xF8,                   //  ret_m:    RET M
+                        0x0C,                   //            INC C
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_CELL | CAPTURE_CELL2 | CAPTURE_AF | CAPTURE_BC | CAPTURE_DE | CAPTURE_HL | CAPTURE_IX | CAPTURE_IY,
+                    {
+                        { 0x18, 0x01, 0x04 }, { 0x20, 0x01, 0x04 }, { 0x28, 0x01, 0x04 }, { 0x30, 0x01, 0x04 }, { 0x38, 0x01, 0x04 },
+                        { 0x10, 0x01, 0x0C }, { 0xC3, 0x66, 0x00, 0x04 }, { 0xC2, 0x66, 0x00, 0x04 }, { 0xCA, 0x66, 0x00, 0x04 },
+                        { 0xD2, 0x66, 0x00, 0x04 }, { 0xDA, 0x66, 0x00, 0x04 }, { 0xE2, 0x66, 0x00, 0x04 }, { 0xEA, 0x66, 0x00, 0x04 },
+                        { 0xF2, 0x66, 0x00, 0x04 }, { 0xFA, 0x66, 0x00, 0x04 }, { 0xE9, 0x04 }, { 0xDD, 0xE9, 0x04 },
+                        { 0xFD, 0xE9, 0x04 }, { 0xCD, 0x1E, 0x01, 0x04 }, { 0xC4, 0x1E, 0x01, 0x04 }, { 0xCC, 0x1E, 0x01, 0x04 },
+                        { 0xD4, 0x1E, 0x01, 0x04 }, { 0xDC, 0x1E, 0x01, 0x04 }, { 0xE4, 0x1E, 0x01, 0x04 }, { 0xEC, 0x1E, 0x01, 0x04 },
+                        { 0xF4, 0x1E, 0x01, 0x04 }, { 0xFC, 0x1E, 0x01, 0x04 }, { 0xCD, 0x20, 0x01, 0x04 }, { 0xCD, 0x23, 0x01, 0x04 },
+                        { 0xCD, 0x26, 0x01, 0x04 }, { 0xCD, 0x29, 0x01, 0x04 }, { 0xCD, 0x2C, 0x01, 0x04 }, { 0xCD, 0x2F, 0x01, 0x04 },
+                        { 0xCD, 0x32, 0x01, 0x04 }, { 0xCD, 0x35, 0x01, 0x04 }, { 0xD5, 0xE3, 0xD1 }, { 0xD5, 0xDD, 0xE3, 0xD1 },
+                        { 0xC5, 0xFD, 0xE3, 0xC1 }, { 0xF5, 0xC1 }, { 0xC5, 0xF1 }, { 0xE5, 0xDD, 0xE1 }, { 0xD5, 0xC5, 0xD1, 0xC1 },
+                        { 0xED, 0x73, 0x10, 0xA8 }
+                    },
+                    conditions, { 0x0000, 0x0100, 0x0200, 0xFF80, 0x7F01 }, { 0x1234, 0xFEDC }, 0xE841
+                },
+                {
+                    "EX EXX",
+                    {
+                        0x2A, 0x0C, 0x80,       //            LD HL,(XVAL)
+                        0x3A, 0x0E, 0x80,       //            LD A,(YVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0x08,                   //            EX AF,AF'
+                        0xD9,                   //            EXX
+                        0xED, 0x4B, 0x0E, 0x80, //            LD BC,(YVAL)
+                        0xED, 0x5B, 0x0C, 0x80, //            LD DE,(XVAL)
+                        0x21, 0x20, 0xA8,       //            LD HL,CELL2
+                        0xD9,                   //            EXX
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0D, 0x80,       //            LD A,(XVAL+1)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0xED, 0x4B, 0x0C, 0x80, //            LD BC,(XVAL)
+                        0xED, 0x5B, 0x0E, 0x80, //            LD DE,(YVAL)
+                        0x21, 0x10, 0xA8,       //            LD HL,CELL
+                        0xDD, 0x2A, 0x0C, 0x80, //            LD IX,(XVAL)
+                        0xFD, 0x2A, 0x0E, 0x80, //            LD IY,(YVAL)
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_CELL | CAPTURE_CELL2 | CAPTURE_AF | CAPTURE_BC | CAPTURE_DE | CAPTURE_HL | CAPTURE_IX | CAPTURE_IY,
+                    {
+                        { 0x08 }, { 0xD9 }, { 0xEB }, { 0x08, 0xD9 }, { 0xD9, 0xEB }, { 0xEB, 0xD9, 0xEB }, { 0xDD, 0xEB },
+                        { 0xFD, 0xEB }, { 0x08, 0x08 }, { 0xD9, 0x08, 0xD9 }
+                    },
+                    { 0x00, 0xFF, 0x5A }, mixed_x, mixed_y, 0x6ED5
+                },
+                {
+                    "RLD RRD",
+                    {
+                        0x3A, 0x0E, 0x80,       //            LD A,(YVAL)
+                        0x32, 0x10, 0xA8,       //            LD (CELL),A
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0C, 0x80,       //            LD A,(XVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0x21, 0x10, 0xA8,       //            LD HL,CELL
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_CELL | CAPTURE_AF,
+                    {
+                        { 0xED, 0x6F }, { 0xED, 0x67 }, { 0xED, 0x6F, 0xED, 0x67 }, { 0xED, 0x67, 0xED, 0x67 }
+                    },
+                    { 0x00, 0xFF }, sweep(0x0001), { 0x0000, 0x000F, 0x00F0, 0x005A, 0x00A5, 0x00FF }, 0xDA4C
+                },
+                {
+                    "LDIR LDDR CPIR CPDR",
+                    {
+                        0x2A, 0x0C, 0x80,       //            LD HL,(XVAL)
+                        0x22, 0x10, 0xA8,       //            LD (CELL),HL
+                        0x22, 0x12, 0xA8,       //            LD (CELL+2),HL
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0D, 0x80,       //            LD A,(XVAL+1)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0x21, 0x10, 0xA8,       //            LD HL,CELL
+                        0x11, 0x20, 0xA8,       //            LD DE,CELL2
+                        0xED, 0x4B, 0x0E, 0x80, //            LD BC,(YVAL)
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_CELL | CAPTURE_CELL2 | CAPTURE_AF | CAPTURE_BC | CAPTURE_DE | CAPTURE_HL,
+                    {
+                        { 0xED, 0xB0 }, { 0xED, 0xB8 }, { 0xED, 0xB1 }, { 0xED, 0xB9 }
+                    },
+                    { 0x00, 0xFF }, sweep(0x3501), { 0x0001, 0x0002, 0x0003, 0x0004 }, 0x24F0
+                },
+                {
+                    "IN OUT and the block I/O",
+                    {
+                        0x2A, 0x0E, 0x80,       //            LD HL,(YVAL)
+                        0x22, 0x10, 0xA8,       //            LD (CELL),HL
+                        0x3A, 0x0A, 0x80,       //            LD A,(FVAL)
+                        0x6F,                   //            LD L,A
+                        0x3A, 0x0E, 0x80,       //            LD A,(YVAL)
+                        0x67,                   //            LD H,A
+                        0xE5,                   //            PUSH HL
+                        0xF1,                   //            POP AF
+                        0xED, 0x4B, 0x0C, 0x80, //            LD BC,(XVAL)
+                        0xED, 0x5B, 0x0E, 0x80, //            LD DE,(YVAL)
+                        0x21, 0x10, 0xA8,       //            LD HL,CELL
+                        0xC9                    //            RET
+                    },
+                    CAPTURE_CELL | CAPTURE_AF | CAPTURE_BC | CAPTURE_DE | CAPTURE_HL,
+                    {
+                        { 0xDB, 0x10 }, { 0xD3, 0x10, 0xDB, 0x20 }, { 0xED, 0x40 }, { 0xED, 0x48 }, { 0xED, 0x50 }, { 0xED, 0x58 },
+                        { 0xED, 0x60 }, { 0xED, 0x68 }, { 0xED, 0x70 }, { 0xED, 0x78 }, { 0xED, 0x41, 0xED, 0x78 },
+                        { 0xED, 0x49, 0xED, 0x78 }, { 0xED, 0x51, 0xED, 0x78 }, { 0xED, 0x59, 0xED, 0x78 }, { 0xED, 0x61, 0xED, 0x78 },
+                        { 0xED, 0x69, 0xED, 0x78 }, { 0xED, 0x71, 0xED, 0x78 }, { 0xED, 0x79, 0xED, 0x78 }, { 0xED, 0xA2 },
+                        { 0xED, 0xAA }, { 0xED, 0xA3 }, { 0xED, 0xAB }, { 0xED, 0xB2 }, { 0xED, 0xBA }, { 0xED, 0xB3 }, { 0xED, 0xBB },
+                        { 0xED, 0xA3, 0xED, 0x78 }, { 0xED, 0xBB, 0xED, 0x78 }
+                    },
+                    { 0x00, 0xFF }, { 0x0100, 0x0155, 0x0180, 0x01FD, 0x0300, 0x0355, 0x0380, 0x03FD }, { 0x0000, 0x8001, 0x5AA5, 0xFF7F, 0x3CC3 }, 0xD80A
+                }
+            };
+            return table;
+        }
+
+        // the driver, the group and its tables
+        static void load(z80_machine& m, const selftest_group& group) {
+            if (group.setup.size() > VARIANTS - SETUP || group.variants.size() * 4 > FLAGS_IN - VARIANTS
+                || group.flags.size() > X_OPERANDS - FLAGS_IN || group.x.size() * 2 > Y_OPERANDS - X_OPERANDS
+                || group.y.size() * 2 > 0x8000 - Y_OPERANDS) {
+                throw std::runtime_error(std::format("self test error: group \"{}\" does not fit the memory map", group.name));
+            }
+            auto poke = [&m](address_t addr, uint8_t b) { m.ram()[addr] = (byte_t)b; };
+            auto poke_word = [&poke](address_t addr, uint16_t w) {
+                poke(addr, (uint8_t)w);
+                poke((address_t)(addr + 1), (uint8_t)(w >> 8));
+            };
+            m.ram().fill(0);
+            for (size_t i{ 0 }; i < driver().size(); ++i) poke((address_t)i, driver()[i]);
+            for (size_t i{ 0 }; i < group.setup.size(); ++i) poke((address_t)(SETUP + i), group.setup[i]);
+            for (size_t i{ 0 }; i < group.variants.size(); ++i) {
+                for (size_t j{ 0 }; j < 4; ++j) poke((address_t)(VARIANTS + i * 4 + j), group.variants[i][j]);
+            }
+            for (size_t i{ 0 }; i < group.flags.size(); ++i) poke((address_t)(FLAGS_IN + i), group.flags[i]);
+            for (size_t i{ 0 }; i < group.x.size(); ++i) poke_word((address_t)(X_OPERANDS + i * 2), group.x[i]);
+            for (size_t i{ 0 }; i < group.y.size(); ++i) poke_word((address_t)(Y_OPERANDS + i * 2), group.y[i]);
+            const address_t bounds[] = {
+                VARIANTS, (address_t)(VARIANTS + group.variants.size() * 4),
+                FLAGS_IN, (address_t)(FLAGS_IN + group.flags.size()),
+                X_OPERANDS, (address_t)(X_OPERANDS + group.x.size() * 2),
+                Y_OPERANDS, (address_t)(Y_OPERANDS + group.y.size() * 2)
+            };
+            for (size_t i{ 0 }; i < std::size(bounds); ++i) poke_word((address_t)(BOUNDS + i * 2), bounds[i]);
+            poke(MASK, group.capture);
+            poke_word(EXPECT, group.crc);
+        }
+
+        static selftest_result run(const selftest_group& group, z80_machine::core_t core = z80_core{}) {
+            z80_machine m;
+            load(m, group);
+            m.attach(std::move(core));
+            selftest_result result{ group.name, false, 0, group.crc, 0, 0 };
+            bool reported{ false };
+            unsigned crc_bytes{ 0 };
+            uint8_t latch{ 0 };
+            m.on_out([&](address_t port, byte_t b) {
+                switch (port & 0xFF) {
+                case CRC_PORT:
+                    result.crc |= (uint16_t)((uint8_t)b << (8 * (crc_bytes++ & 1)));
+                    break;
+                case RESULT_PORT:
+                    result.passed = b == 0;
+                    result.tstates = m.cycles();
+                    reported = true;
+                    break;
+                default:
+                    latch = (uint8_t)b;
+                }
+            });
+            m.on_in([&latch](address_t port) { return (byte_t)(latch ^ (port >> 8) ^ (port & 0xFF)); });
+            auto start = std::chrono::steady_clock::now();
+            while (!reported && m.cycles() < BUDGET) {
+                m.run(m.cycles() + 1'000'000);
+            }
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            // the program compares, the runner checks it saw the same CRC
+            result.passed = result.passed && result.crc == group.crc;
+            if (!reported) result.tstates = m.cycles();
+            return result;
+        }
+
+        static std::vector<selftest_result> run_all(z80_machine::core_t core = z80_core{}) {
+            std::vector<selftest_result> results;
+            for (const auto& group : groups()) {
+                results.push_back(run(group, core));
+            }
+            return results;
+        }
+
+    private:
+
+        // i * multiplier for every byte i
+        static std::vector<uint16_t> sweep(uint16_t multiplier) {
+            std::vector<uint16_t> values(256);
+            for (unsigned i{ 0 }; i < 256; ++i) values[i] = (uint16_t)(i * multiplier);
+            return values;
+        }
+
+        static std::vector<uint16_t> spread(const std::vector<uint16_t>& values, uint16_t multiplier) {
+            std::vector<uint16_t> spread;
+            for (auto v : values) spread.push_back((uint16_t)(v * multiplier));
+            return spread;
+        }
+
+    };
+
+}
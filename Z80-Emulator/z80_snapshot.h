@@ -0,0 +1,112 @@
+/**
+
+    @file      z80_snapshot.h
+    @brief     copy on write snapshots of the machine state that share unwritten pages
+    @details   a search that forks the machine keeps many states which differ in a few pages:
+               + a snapshot is the register file with R materialised, the control state, the state hash and the 64K
+                 as 256 shared read only pages
+               + a snapshot taken of a machine that was last in a base state copies only the pages written since
+                 (the machine's dirty pages, see emu_page_hashes.h) and shares the rest with the base
+               + restoring a snapshot into a machine that holds another copies only the pages that are not shared
+                 between the two or were written since, through write_block() so cached code is flushed
+               + taking and restoring end with the machine hashed, its dirty pages are the ones written from then on
+               the T-states are not state, a machine keeps counting from where it is
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "emu_memory_types.h"
+#include "z80_machine.h"
+#include "z80_registers.h"
+
+namespace emu {
+
+    class z80_snapshot {
+
+    public:
+
+        using page_t = std::array<byte_t, PAGE_SIZE>;
+
+        // every page copied
+        explicit z80_snapshot(z80_machine& m) {
+            for (size_t page{ 0 }; page < PAGE_COUNT; ++page) {
+                pages[page] = copy(m, page);
+            }
+            take(m);
+        }
+
+        // m was in the base state, pages written since are copied and the rest shared
+        z80_snapshot(z80_machine& m, const z80_snapshot& base) {
+            for (size_t page{ 0 }; page < PAGE_COUNT; ++page) {
+                pages[page] = m.dirty_page(page) ? copy(m, page) : base.pages[page];
+            }
+            take(m);
+        }
+
+        // m held the current state, possibly written since
+        void restore(z80_machine& m, const z80_snapshot& current) const {
+            for (size_t page{ 0 }; page < PAGE_COUNT; ++page) {
+                if (pages[page] != current.pages[page] || m.dirty_page(page)) {
+                    m.write_block((address_t)(page * PAGE_SIZE), pages[page]->data(), PAGE_SIZE);
+                }
+            }
+            m.registers() = regs;
+            m.refresh_register((uint8_t)m.registers().byte(R));
+            m.control() = cpu;
+            m.hash();
+        }
+
+        inline uint64_t hash() const {
+            return hash_;
+        }
+
+        inline const z80_registers_t& registers() const {
+            return regs;
+        }
+
+        inline const z80_control_t& control() const {
+            return cpu;
+        }
+
+        inline byte_t operator[](address_t addr) const {
+            return (*pages[page_of(addr)])[addr % PAGE_SIZE];
+        }
+
+        // pages this snapshot shares with another
+        size_t shared(const z80_snapshot& other) const {
+            size_t n{ 0 };
+            for (size_t page{ 0 }; page < PAGE_COUNT; ++page) {
+                n += pages[page] == other.pages[page];
+            }
+            return n;
+        }
+
+    private:
+
+        static std::shared_ptr<const page_t> copy(const z80_machine& m, size_t page) {
+            auto p = std::make_shared<page_t>();
+            m.read_block((address_t)(page * PAGE_SIZE), p->data(), PAGE_SIZE);
+            return p;
+        }
+
+        void take(z80_machine& m) {
+            regs = m.snapshot();
+            cpu = m.control();
+            hash_ = m.hash();
+        }
+
+        z80_registers_t regs{};
+        z80_control_t cpu;
+        uint64_t hash_{ 0 };
+        std::array<std::shared_ptr<const page_t>, PAGE_COUNT> pages;
+
+    };
+
+}
@@ -0,0 +1,260 @@
+/**
+
+    @file      z80_superinstructions.h
+    @brief     fused handlers for frequent adjacent Z80 instruction sequences
+    @details   a superinstruction executes a pair or triple of instructions in one dispatch e.g. DEC B / JR NZ,e:
+               + the catalogue was written by hand from common copy, count and test loop shapes and checked
+                 against a static scan of zx81-v2.rom with profile(), not chosen from a dynamic ranking - the pairs
+                 its entries start are only 3-4% of those run by a ZX81 cold boot and by a BASIC program, whose
+                 hottest pairs are the RAM test's DEC (HL) / JR Z and the calculator's EXX and CB shifts
+               + hottest() ranks the opcode pairs a running machine counted (see z80_machine::pair_profile()) with
+                 the entry that fuses each, to choose further entries by
+               + the result, flags, refresh register and T-states are exactly those of the separate instructions
+               + the machine only fuses when no event can fall due and no interrupt can be accepted before the
+                 last instruction of the group, so every boundary an interrupt could see is still there
+               + a handler charges its group's T-states in one, so the machine steps a group whose code or memory
+                 access is on a contended page, each entry says which register pair addresses its access
+               + candidates are indexed by their first opcode so that most dispatches are a single table lookup
+               + operands are matched against the live bytes on every dispatch and a group that would store into
+                 its own bytes is stepped, self-modifying code is safe
+               + handlers set MEMPTR as the last instruction to write it would, no entry ends with an instruction
+                 that writes the flags so the machine clears Q
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "z80_alu.h"
+#include "z80_registers.h"
+
+namespace emu {
+
+    // an opcode pair from a dynamic profile and the superinstruction that fuses it, if any
+    struct opcode_pair {
+        uint8_t first;
+        uint8_t second;
+        uint64_t count;
+        const char* fused;
+    };
+
+    template<typename MACHINE>
+    struct superinstruction {
+
+        static constexpr int16_t OPERAND = -1;      // pattern wildcard
+        static constexpr int8_t NO_DATA = -1;       // the group only fetches its own bytes
+
+        const char* name;
+        std::array<int16_t, 4> pattern;
+        uint8_t length;         // bytes
+        uint8_t count;          // instructions fused
+        uint8_t last;           // offset of the last instruction, the machine's last executed PC
+        uint8_t max_tstates;    // branches taken
+        int8_t data;            // register pair addressing the group's memory access, or NO_DATA
+        uint8_t data_bytes;     // bytes accessed from there
+        bool stores;            // the access is a write
+        void (*execute)(MACHINE& m, address_t pc);
+
+        inline bool matches(const uint8_t* bytes) const {
+            for (size_t i{ 0 }; i < length; ++i) {
+                if (pattern[i] != OPERAND && pattern[i] != bytes[i]) return false;
+            }
+            return true;
+        }
+
+    };
+
+    template<typename MACHINE>
+    class superinstructions {
+
+        using si_t = superinstruction<MACHINE>;
+        static constexpr int16_t N = si_t::OPERAND;
+        static constexpr int8_t X = si_t::NO_DATA;
+
+    public:
+
+        static const std::vector<si_t>& catalogue() {
+            static const std::vector<si_t> table{
+                { "LD A,(HL) / INC HL",             { 0x7E, 0x23 },         2, 2, 1, 13, H, 1, false, ld_a_rr_inc<H> },
+                { "LD A,(DE) / INC DE",             { 0x1A, 0x13 },         2, 2, 1, 13, D, 1, false, ld_a_rr_inc<D> },
+                { "LD (HL),A / INC HL",             { 0x77, 0x23 },         2, 2, 1, 13, H, 1, true, ld_rr_a_inc<H> },
+                { "LD (DE),A / INC DE",             { 0x12, 0x13 },         2, 2, 1, 13, D, 1, true, ld_rr_a_inc<D> },
+                { "DEC B / JR NZ,e",                { 0x05, 0x20, N },      3, 2, 1, 16, X, 0, false, dec_jr_nz<B> },
+                { "DEC C / JR NZ,e",                { 0x0D, 0x20, N },      3, 2, 1, 16, X, 0, false, dec_jr_nz<C> },
+                { "OR A / JR Z,e",                  { 0xB7, 0x28, N },      3, 2, 1, 16, X, 0, false, test_a_jr<false, true> },
+                { "OR A / JR NZ,e",                 { 0xB7, 0x20, N },      3, 2, 1, 16, X, 0, false, test_a_jr<false, false> },
+                { "AND A / JR Z,e",                 { 0xA7, 0x28, N },      3, 2, 1, 16, X, 0, false, test_a_jr<true, true> },
+                { "AND A / JR NZ,e",                { 0xA7, 0x20, N },      3, 2, 1, 16, X, 0, false, test_a_jr<true, false> },
+                { "CP n / JR Z,e",                  { 0xFE, N, 0x28, N },   4, 2, 2, 19, X, 0, false, cp_jr<true> },
+                { "CP n / JR NZ,e",                 { 0xFE, N, 0x20, N },   4, 2, 2, 19, X, 0, false, cp_jr<false> },
+                { "LD A,B / OR C / JR NZ,e",        { 0x78, 0xB1, 0x20, N },4, 3, 2, 20, X, 0, false, ld_a_b_or_c_jr_nz },
+                { "LD E,(HL) / INC HL / LD D,(HL)", { 0x5E, 0x23, 0x56 },   3, 3, 2, 20, H, 2, false, ld_rr_indirect<D> },
+                { "LD C,(HL) / INC HL / LD B,(HL)", { 0x4E, 0x23, 0x46 },   3, 3, 2, 20, H, 2, false, ld_rr_indirect<B> },
+            };
+            return table;
+        }
+
+        // candidates by first opcode, empty when no superinstruction starts with it
+        static const std::array<std::vector<const si_t*>, 256>& by_opcode() {
+            static const auto index = [] {
+                std::array<std::vector<const si_t*>, 256> index;
+                for (const auto& s : catalogue()) {
+                    index[s.pattern[0]].push_back(&s);
+                }
+                return index;
+            }();
+            return index;
+        }
+
+        static inline const si_t* match(const uint8_t* bytes) {
+            for (auto s : by_opcode()[bytes[0]]) {
+                if (s->matches(bytes)) return s;
+            }
+            return nullptr;
+        }
+
+        // static occurrences of each catalogue entry in an image
+        template<typename READ>
+        static std::vector<size_t> profile(READ read, address_t begin, address_t end) {
+            std::vector<size_t> counts(catalogue().size());
+            for (uint32_t addr{ begin }; addr + 3 <= end; ++addr) {
+                uint8_t bytes[4];
+                for (address_t i{ 0 }; i < 4; ++i) bytes[i] = (uint8_t)read((address_t)(addr + i));
+                for (size_t s{ 0 }; s < catalogue().size(); ++s) {
+                    if (catalogue()[s].matches(bytes)) ++counts[s];
+                }
+            }
+            return counts;
+        }
+
+        // the n most frequent pairs of a dynamic profile indexed by first opcode << 8 | second opcode
+        static std::vector<opcode_pair> hottest(const std::vector<uint64_t>& counts, size_t n) {
+            std::vector<opcode_pair> pairs;
+            for (size_t i{ 0 }; i < counts.size(); ++i) {
+                if (counts[i]) pairs.push_back({ (uint8_t)(i >> 8), (uint8_t)i, counts[i], nullptr });
+            }
+            n = std::min(n, pairs.size());
+            std::partial_sort(pairs.begin(), pairs.begin() + n, pairs.end(), [](const auto& x, const auto& y) {
+                return x.count != y.count ? x.count > y.count : (x.first << 8 | x.second) < (y.first << 8 | y.second);
+            });
+            pairs.resize(n);
+            for (auto& pair : pairs) {
+                for (const auto& s : catalogue()) {
+                    auto second = s.pattern[s.pattern[1] == N ? 2 : 1];    // CP n is the only two byte first
+                    if (s.pattern[0] == pair.first && second == pair.second) {
+                        pair.fused = s.name;
+                        break;
+                    }
+                }
+            }
+            return pairs;
+        }
+
+    private:
+
+        static inline void jr(MACHINE& m, address_t next, bool taken, unsigned tstates) {
+            auto& regs = m.registers();
+            if (taken) {
+                regs.word(PC) = (word_t)(next + (int8_t)m.ram()[(address_t)(next - 1)]);
+                m.control().memptr = (uint16_t)regs.word(PC);
+                m.tick(tstates + 12);
+            }
+            else {
+                regs.word(PC) = (word_t)next;
+                m.tick(tstates + 7);
+            }
+        }
+
+        // handlers
+
+        template<size_t RR>
+        static void ld_a_rr_inc(MACHINE& m, address_t pc) {
+            auto& regs = m.registers();
+            auto rr = get_pair(regs, RR);
+            regs.byte(A) = m.read(rr);
+            if (RR == D) m.control().memptr = (uint16_t)(rr + 1);
+            set_pair(regs, RR, (uint16_t)(rr + 1));
+            regs.word(PC) = (word_t)(pc + 2);
+            m.refresh(2);
+            m.tick(13);
+        }
+
+        template<size_t RR>
+        static void ld_rr_a_inc(MACHINE& m, address_t pc) {
+            auto& regs = m.registers();
+            auto rr = get_pair(regs, RR);
+            m.write(rr, regs.byte(A));
+            if (RR == D) m.control().memptr = (uint16_t)((uint8_t)regs.byte(A) << 8 | ((rr + 1) & 0xFF));
+            set_pair(regs, RR, (uint16_t)(rr + 1));
+            regs.word(PC) = (word_t)(pc + 2);
+            m.refresh(2);
+            m.tick(13);
+        }
+
+        template<size_t REG>
+        static void dec_jr_nz(MACHINE& m, address_t pc) {
+            auto& regs = m.registers();
+            auto f = (uint8_t)regs.byte(F);
+            auto result = alu::dec((uint8_t)regs.byte(REG), f);
+            regs.byte(REG) = (byte_t)result;
+            regs.byte(F) = (byte_t)f;
+            m.refresh(2);
+            jr(m, (address_t)(pc + 3), result != 0, 4);
+        }
+
+        template<bool AND, bool ZERO_TAKEN>
+        static void test_a_jr(MACHINE& m, address_t pc) {
+            auto& regs = m.registers();
+            auto a = (uint8_t)regs.byte(A);
+            uint8_t f{ 0 };
+            AND ? alu::and_(a, a, f) : alu::or_(a, a, f);
+            regs.byte(F) = (byte_t)f;
+            m.refresh(2);
+            jr(m, (address_t)(pc + 3), (a == 0) == ZERO_TAKEN, 4);
+        }
+
+        template<bool ZERO_TAKEN>
+        static void cp_jr(MACHINE& m, address_t pc) {
+            auto& regs = m.registers();
+            auto a = (uint8_t)regs.byte(A);
+            auto n = (uint8_t)m.ram()[(address_t)(pc + 1)];
+            uint8_t f{ 0 };
+            alu::cp(a, n, f);
+            regs.byte(F) = (byte_t)f;
+            m.refresh(2);
+            jr(m, (address_t)(pc + 4), (a == n) == ZERO_TAKEN, 7);
+        }
+
+        static void ld_a_b_or_c_jr_nz(MACHINE& m, address_t pc) {
+            auto& regs = m.registers();
+            uint8_t f{ 0 };
+            auto a = alu::or_((uint8_t)regs.byte(B), (uint8_t)regs.byte(C), f);
+            regs.byte(A) = (byte_t)a;
+            regs.byte(F) = (byte_t)f;
+            m.refresh(3);
+            jr(m, (address_t)(pc + 4), a != 0, 8);
+        }
+
+        // LD lo,(HL) / INC HL / LD hi,(HL)
+        template<size_t RR>
+        static void ld_rr_indirect(MACHINE& m, address_t pc) {
+            auto& regs = m.registers();
+            auto hl = get_pair(regs, H);
+            regs.byte(RR + 1) = m.read(hl);
+            regs.byte(RR) = m.read((address_t)(hl + 1));
+            set_pair(regs, H, (uint16_t)(hl + 1));
+            regs.word(PC) = (word_t)(pc + 3);
+            m.refresh(3);
+            m.tick(20);
+        }
+
+    };
+
+}
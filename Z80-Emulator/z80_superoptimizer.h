@@ -0,0 +1,303 @@
+/**
+
+    @file      z80_superoptimizer.h
+    @brief     finds cheaper instruction sequences that compute what a short target sequence computes
+    @details   for hand optimising size and cycle critical routines, a search rather than a proof engine:
+               + the alphabet is every register only instruction of the main, CB and ED tables (see z80_opcodes.h)
+                 without memory, I/O, jumps, the stack, SP, I, R, the shadow registers or interrupt control, its
+                 immediates the bytes the target uses and a few common masks, each instruction costed once by
+                 running it
+               + candidates are enumerated in order of T-states, from the empty sequence up to one T-state short of
+                 the target, up to max_length() instructions, and the search ends with the first T-state cost that
+                 has an equivalent, so every result is one of the cheapest
+               + each candidate runs on the core against a batch of random register files, the first whose live out
+                 registers or flags differ from the target's rejects it, so almost every candidate costs one run
+               + a candidate that matches the whole batch is verified on every value of the live in registers when
+                 they are 16 bits or less, otherwise on a large random sample, and the result says which
+               registers that are not live in are random in every run, a candidate that reads one fails
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "z80_assembler.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+#include "z80_opcodes.h"
+#include "z80_registers.h"
+#include "zx80_disassembler.h"
+
+namespace emu {
+
+    class z80_superoptimizer {
+
+        using prefix_t = z80_opcodes::prefix_t;
+
+    public:
+
+        struct instruction_t {
+            std::string text;
+            std::vector<uint8_t> bytes;
+            unsigned tstates;
+        };
+
+        struct result_t {
+            std::string text;               // instructions separated by "; "
+            std::vector<uint8_t> bytes;
+            unsigned tstates;
+            unsigned saving;                // T-states fewer than the target
+            bool exhaustive;                // verified on every live in value, else on a sample
+        };
+
+        struct stats_t {
+            uint64_t candidates{ 0 };       // sequences run
+            uint64_t shortlisted{ 0 };      // matched the whole batch
+        };
+
+        // the target is assembly language, assembled at 0
+        explicit z80_superoptimizer(const std::string& target) :
+            target_(z80_assembler::assemble(target).bytes())
+        {
+            if (target_.empty()) {
+                throw std::runtime_error("superoptimizer error: empty target");
+            }
+            m.ram().fill(0);
+            m.attach(z80_core{});
+        }
+
+        // the registers the target's result may depend on, indices into the register file e.g. A or F
+        inline void live_in(std::vector<size_t> registers) {
+            in_ = std::move(registers);
+        }
+
+        // the registers and flags a candidate must leave as the target does
+        inline void live_out(std::vector<size_t> registers, uint8_t flags = 0xFF) {
+            out_ = std::move(registers);
+            flags_ = flags;
+        }
+
+        inline void max_length(unsigned n) {
+            length_ = n;
+        }
+
+        // random register files every candidate runs against
+        inline void batch(unsigned n) {
+            batch_ = std::max(1u, n);
+        }
+
+        // the cheapest equivalents
+        std::vector<result_t> search() {
+            stats = {};
+            results.clear();
+            alphabet_of();
+            std::mt19937_64 rand{ 0x5EED };
+            vectors.clear();
+            for (unsigned i{ 0 }; i < batch_; ++i) vectors.push_back(random_state(rand));
+            expected.clear();
+            target_tstates = 0;
+            for (auto& v : vectors) {
+                unsigned t{ 0 };
+                expected.push_back(execute(v, target_, &t));
+                target_tstates = std::max(target_tstates, t);
+            }
+            std::vector<size_t> sequence;
+            for (unsigned cost{ 0 }; cost < target_tstates && results.empty(); ++cost) {
+                enumerate(sequence, 0, cost);
+            }
+            return results;
+        }
+
+        inline const std::vector<instruction_t>& alphabet() {
+            alphabet_of();
+            return alphabet_;
+        }
+
+        inline unsigned target_tstates_of() const {
+            return target_tstates;
+        }
+
+        inline const stats_t& statistics() const {
+            return stats;
+        }
+
+    private:
+
+        static constexpr unsigned EXHAUSTIVE_BITS = 16;
+        static constexpr unsigned SAMPLE = 1 << 16;
+        static constexpr unsigned MAX_TARGET_STEPS = 10000;
+
+        using state_t = z80_registers_t;
+
+        // the live out registers and flags, as one comparable string of bytes
+        using outputs_t = std::vector<uint8_t>;
+
+        void alphabet_of() {
+            if (!alphabet_.empty()) {
+                return;
+            }
+            std::set<uint8_t> constants{ 0x00, 0x01, 0x0F, 0x7F, 0x80, 0xF0, 0xFF };
+            for (size_t at{ 0 }; at < target_.size(); ) {
+                auto i = zx80_disassembler::decode([this](address_t a) { return (byte_t)(a < target_.size() ? target_[a] : 0); }, (address_t)at);
+                for (size_t d{ i.text.find('$') }; d != std::string::npos; d = i.text.find('$', d + 1)) {
+                    if (d + 3 <= i.text.size() && (d + 3 == i.text.size() || !std::isxdigit((unsigned char)i.text[d + 3]))) {
+                        constants.insert((uint8_t)std::stoul(i.text.substr(d + 1, 2), nullptr, 16));
+                    }
+                }
+                at += i.length;
+            }
+            std::set<std::string> seen;
+            for (auto prefix : { prefix_t::none, prefix_t::cb, prefix_t::ed }) {
+                const auto& table = z80_opcodes::table(prefix);
+                for (int op{ 0 }; op < 256; ++op) {
+                    const auto& pattern = table[op];
+                    if (!register_only(pattern) || !seen.insert(pattern).second) continue;
+                    auto bytes = z80_opcodes::prefix_bytes(prefix);
+                    bytes.push_back((uint8_t)op);
+                    auto n = pattern.find(",n");
+                    if (n == std::string::npos && pattern.find(" n") == std::string::npos) {
+                        add(pattern, bytes);
+                        continue;
+                    }
+                    for (auto c : constants) {
+                        auto text = pattern.substr(0, pattern.size() - 1) + std::format("${:02X}", c);
+                        auto with = bytes;
+                        with.push_back(c);
+                        add(text, with);
+                    }
+                }
+            }
+            std::stable_sort(alphabet_.begin(), alphabet_.end(), [](const auto& a, const auto& b) { return a.tstates < b.tstates; });
+        }
+
+        // no memory, I/O, control flow, stack, SP, I, R, shadows, interrupt control, NOP or 16 bit immediate,
+        // RLD and RRD read (HL) without saying so
+        static bool register_only(const std::string& pattern) {
+            static const char* excluded[] = {
+                "NOP", "HALT", "DI", "EI", "IM", "EXX", "EX AF", "JR", "JP", "CALL", "RET", "RST", "DJNZ", "PUSH", "POP",
+                "IN", "OUT", "LDI", "LDD", "CPI", "CPD", "OTI", "OTD", "RLD", "RRD"
+            };
+            if (pattern.empty() || pattern.find('(') != std::string::npos || pattern.find("SP") != std::string::npos
+                || pattern.find("nn") != std::string::npos) {
+                return false;
+            }
+            for (auto x : excluded) {
+                if (pattern.starts_with(x) && !pattern.starts_with("INC")) return false;
+            }
+            auto operands = pattern.find(' ') == std::string::npos ? std::string{} : pattern.substr(pattern.find(' ') + 1);
+            return operands != "A,I" && operands != "I,A" && operands != "A,R" && operands != "R,A";
+        }
+
+        void add(const std::string& text, const std::vector<uint8_t>& bytes) {
+            std::mt19937_64 rand{ 1 };
+            auto v = random_state(rand);
+            unsigned t{ 0 };
+            execute(v, bytes, &t);
+            alphabet_.push_back({ text, bytes, t });
+        }
+
+        state_t random_state(std::mt19937_64& rand) const {
+            state_t s{};
+            for (size_t i{ 0 }; i < Z80_SRAM_SIZE; ++i) {
+                s.byte(i) = (byte_t)rand();
+            }
+            return s;
+        }
+
+        // the live out values after running code from 0 on the state
+        outputs_t execute(state_t& state, const std::vector<uint8_t>& code, unsigned* tstates = nullptr) {
+            m.write_block(0, code.data(), code.size());
+            m.registers() = state;
+            m.registers().word(PC) = 0;
+            m.control() = {};
+            auto start = m.cycles();
+            for (unsigned steps{ 0 }; (address_t)m.registers().word(PC) != code.size(); ++steps) {
+                if (steps == MAX_TARGET_STEPS || m.control().halted) {
+                    throw std::runtime_error(std::format("superoptimizer error: code did not run to its end ${:04X}", code.size()));
+                }
+                m.step();
+            }
+            if (tstates) *tstates = (unsigned)(m.cycles() - start);
+            outputs_t out;
+            for (auto r : out_) out.push_back((uint8_t)m.registers().byte(r));
+            out.push_back((uint8_t)m.registers().byte(F) & flags_);
+            return out;
+        }
+
+        void enumerate(std::vector<size_t>& sequence, unsigned spent, unsigned cost) {
+            if (spent == cost) {
+                test(sequence, cost);
+                return;
+            }
+            if (sequence.size() == length_) {
+                return;
+            }
+            for (size_t i{ 0 }; i < alphabet_.size() && spent + alphabet_[i].tstates <= cost; ++i) {
+                sequence.push_back(i);
+                enumerate(sequence, spent + alphabet_[i].tstates, cost);
+                sequence.pop_back();
+            }
+        }
+
+        void test(const std::vector<size_t>& sequence, unsigned cost) {
+            ++stats.candidates;
+            std::vector<uint8_t> code;
+            for (auto i : sequence) code.insert(code.end(), alphabet_[i].bytes.begin(), alphabet_[i].bytes.end());
+            for (size_t v{ 0 }; v < vectors.size(); ++v) {
+                auto state = vectors[v];
+                if (execute(state, code) != expected[v]) return;
+            }
+            ++stats.shortlisted;
+            bool exhaustive{ false };
+            if (!verify(code, exhaustive)) {
+                return;
+            }
+            std::string text;
+            for (auto i : sequence) text += (text.empty() ? "" : "; ") + alphabet_[i].text;
+            results.push_back({ text, code, cost, target_tstates - cost, exhaustive });
+        }
+
+        // every value of the live in registers, or a sample of them
+        bool verify(const std::vector<uint8_t>& code, bool& exhaustive) {
+            std::mt19937_64 rand{ 0xC0DE };
+            exhaustive = in_.size() * 8 <= EXHAUSTIVE_BITS;
+            uint64_t runs = exhaustive ? 1ull << (in_.size() * 8) : SAMPLE;
+            for (uint64_t n{ 0 }; n < runs; ++n) {
+                auto state = random_state(rand);
+                if (exhaustive) {
+                    for (size_t i{ 0 }; i < in_.size(); ++i) state.byte(in_[i]) = (byte_t)(n >> (8 * i));
+                }
+                auto copy = state;
+                if (execute(state, code) != execute(copy, target_)) return false;
+            }
+            return true;
+        }
+
+        std::vector<uint8_t> target_;
+        std::vector<size_t> in_{ A, F, B, C, D, E, H, L };
+        std::vector<size_t> out_{ A, B, C, D, E, H, L };
+        uint8_t flags_{ 0xFF };
+        unsigned length_{ 3 };
+        unsigned batch_{ 32 };
+        z80_machine m;
+        std::vector<instruction_t> alphabet_;
+        std::vector<state_t> vectors;
+        std::vector<outputs_t> expected;
+        unsigned target_tstates{ 0 };
+        std::vector<result_t> results;
+        stats_t stats;
+
+    };
+
+}
@@ -0,0 +1,381 @@
+/**
+
+    @file      z80_trace.h
+    @brief     golden binary traces of the machine state after every instruction and a streaming comparator
+    @details   a trace is the state after each instruction as a 32 byte record, a golden trace recorded from a
+               canonical workload is the reference any later change to the core must reproduce exactly:
+               + the record holds the whole register file with R materialised, MEMPTR, Q, the interrupt and HALT
+                 state and the low 16 bits of the T-state count, so a timing change shows up on the instruction
+                 that made it
+               + the machine is stepped, HALT included, and due events are serviced between instructions as run()
+                 does, the fast paths of run() are not traced
+               + compare() streams the run against the golden file a block of 64K records at a time and stops at the
+                 end of the block with the first record that differs, the report names the fields that differ and
+                 the PC the instruction was executed from
+               + each pair of records is one 32 byte vector compare with AVX2, two 16 byte compares with SSE2 and a
+                 memcmp elsewhere
+               + workloads() are the canonical runs, the ZX81 boot and the exerciser groups, each with the digest of
+                 its trace and final state committed here, regress() records a workload's golden file the first
+                 time only if the run reproduces that digest and compares every later run with the file
+               + fast_paths() runs a workload with run() twice, every fast path off and every one on, and compares
+                 the two machines at each checkpoint, memory included, as the trace cannot see skipped instructions
+               the file is an 8 byte "Z80TRACE" magic, the version, the record size, the record count and the records
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EMU_TRACE_SSE2
+#endif
+
+#include "emu_memory_types.h"
+#include "emu_page_hashes.h"
+#include "z80_core.h"
+#include "z80_machine.h"
+#include "z80_registers.h"
+#include "z80_selftest.h"
+
+namespace emu {
+
+    struct alignas(32) trace_record {
+
+        static constexpr uint8_t IFF1 = 0b00000001;
+        static constexpr uint8_t IFF2 = 0b00000010;
+        static constexpr uint8_t IM = 0b00001100;
+        static constexpr uint8_t HALTED = 0b00010000;
+        static constexpr uint8_t EI_DELAY = 0b00100000;
+        static constexpr uint8_t INT_LINE = 0b01000000;
+        static constexpr uint8_t NMI = 0b10000000;
+
+        int8_t registers[Z80_SRAM_SIZE];
+        uint16_t memptr;
+        uint8_t control;
+        uint8_t q;
+        uint16_t tstates;       // low 16 bits
+
+        inline address_t pc() const {
+            return (address_t)((uint8_t)registers[PC] | (uint8_t)registers[PC + 1] << 8);
+        }
+
+    };
+
+    static_assert(sizeof(trace_record) == 32, "a trace record is one 32 byte vector");
+
+    // a line for each field of the records that differs
+    inline std::string trace_differences(const trace_record& x, const trace_record& y, const char* x_name, const char* y_name) {
+        std::string text;
+        auto field = [&](const char* name, unsigned a, unsigned b, int digits) {
+            if (a != b) text += std::format("\n    {:<8} {} ${:0{}X} {} ${:0{}X}", name, x_name, a, digits, y_name, b, digits);
+        };
+        for (size_t i{ 0 }; i < Z80_SRAM_SIZE; ++i) {
+            field(Z80_SRAM_NAMES[i], (uint8_t)x.registers[i], (uint8_t)y.registers[i], 2);
+        }
+        field("MEMPTR", x.memptr, y.memptr, 4);
+        field("Q", x.q, y.q, 2);
+        field("control", x.control, y.control, 2);
+        field("T-states", x.tstates, y.tstates, 4);
+        return text;
+    }
+
+    // the first record that differs
+    struct trace_divergence {
+
+        uint64_t index;
+        trace_record golden;
+        trace_record live;
+        address_t pc;           // of the instruction that made the difference
+
+        std::string report() const {
+            return std::format("trace diverges at instruction {}, executed from ${:04X}", index, pc)
+                + trace_differences(golden, live, "golden", "live");
+        }
+
+    };
+
+    // the first checkpoint at which the fast paths left a different machine
+    struct fast_path_divergence {
+
+        cycle_t tstates;                    // the checkpoint
+        trace_record stepped;
+        trace_record fast;
+        std::optional<address_t> memory;    // the first byte that differs
+
+        std::string report() const {
+            auto text = std::format("fast paths diverge by T-state {}", tstates) + trace_differences(stepped, fast, "stepped", "fast");
+            if (memory) text += std::format("\n    memory   first differs at ${:04X}", *memory);
+            return text;
+        }
+
+    };
+
+    // a canonical workload, prepare() loads a fresh machine
+    struct trace_workload {
+        const char* name;
+        uint64_t instructions;
+        std::function<void(z80_machine&)> prepare;
+        uint64_t digest;        // of the trace and the state it ends in, see z80_trace::digest()
+    };
+
+    class z80_trace {
+
+        static constexpr char MAGIC[8] = { 'Z', '8', '0', 'T', 'R', 'A', 'C', 'E' };
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t BLOCK = 0x10000;    // records streamed at a time
+
+        struct header_t {
+            char magic[8];
+            uint32_t version;
+            uint32_t record_size;
+            uint64_t count;
+        };
+
+    public:
+
+        static trace_record capture(z80_machine& m) {
+            trace_record record;
+            std::memcpy(record.registers, &m.snapshot(), Z80_SRAM_SIZE);
+            const auto& cpu = m.control();
+            record.memptr = cpu.memptr;
+            record.q = cpu.q;
+            record.control = (uint8_t)((cpu.iff1 ? trace_record::IFF1 : 0) | (cpu.iff2 ? trace_record::IFF2 : 0)
+                | ((cpu.im & 3) << 2) | (cpu.halted ? trace_record::HALTED : 0) | (cpu.ei_delay ? trace_record::EI_DELAY : 0)
+                | (cpu.int_line ? trace_record::INT_LINE : 0) | (cpu.nmi ? trace_record::NMI : 0));
+            record.tstates = (uint16_t)m.cycles();
+            return record;
+        }
+
+        // one instruction, after servicing the events due
+        static trace_record step(z80_machine& m) {
+            m.events().service(m.cycles());
+            m.step();
+            return capture(m);
+        }
+
+        // the index of the first pair of records that differ, n if none do
+        static size_t mismatch(const trace_record* golden, const trace_record* live, size_t n) {
+            for (size_t i{ 0 }; i < n; ++i) {
+#if defined(__AVX2__)
+                auto x = _mm256_load_si256((const __m256i*)(golden + i));
+                auto y = _mm256_load_si256((const __m256i*)(live + i));
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1) return i;
+#elif defined(EMU_TRACE_SSE2)
+                auto lo = _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(golden + i)), _mm_load_si128((const __m128i*)(live + i)));
+                auto hi = _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(golden + i) + 1), _mm_load_si128((const __m128i*)(live + i) + 1));
+                if (_mm_movemask_epi8(_mm_and_si128(lo, hi)) != 0xFFFF) return i;
+#else
+                if (std::memcmp(golden + i, live + i, sizeof(trace_record)) != 0) return i;
+#endif
+            }
+            return n;
+        }
+
+        // steps the machine for the number of instructions, writing the golden trace, returns its digest
+        static uint64_t record(z80_machine& m, uint64_t instructions, const std::filesystem::path& path) {
+            std::ofstream f(path, std::ios::binary);
+            if (!f) {
+                throw std::runtime_error("trace error: \"" + path.string() + "\" cannot be written");
+            }
+            header_t header{ {}, VERSION, sizeof(trace_record), instructions };
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            f.write((const char*)&header, sizeof(header));
+            std::vector<trace_record> block(BLOCK);
+            uint64_t h{ 0 };
+            for (uint64_t done{ 0 }; done < instructions;) {
+                auto n = (size_t)std::min<uint64_t>(BLOCK, instructions - done);
+                for (size_t i{ 0 }; i < n; ++i) block[i] = step(m);
+                f.write((const char*)block.data(), n * sizeof(trace_record));
+                h = hash_bytes(block.data(), n * sizeof(trace_record), h);
+                done += n;
+            }
+            if (!f) {
+                throw std::runtime_error("trace error: \"" + path.string() + "\" write failed");
+            }
+            return final_state(m, h);
+        }
+
+        // the digest of the trace record() would write, the records a block at a time and then the state the
+        // machine ends in, memory included
+        static uint64_t digest(z80_machine& m, uint64_t instructions) {
+            std::vector<trace_record> block(BLOCK);
+            uint64_t h{ 0 };
+            for (uint64_t done{ 0 }; done < instructions;) {
+                auto n = (size_t)std::min<uint64_t>(BLOCK, instructions - done);
+                for (size_t i{ 0 }; i < n; ++i) block[i] = step(m);
+                h = hash_bytes(block.data(), n * sizeof(trace_record), h);
+                done += n;
+            }
+            return final_state(m, h);
+        }
+
+        // steps the machine against the golden trace, the first divergence if there is one
+        static std::optional<trace_divergence> compare(z80_machine& m, const std::filesystem::path& path) {
+            std::ifstream f(path, std::ios::binary);
+            if (!f) {
+                throw std::runtime_error("trace error: \"" + path.string() + "\" file not found");
+            }
+            header_t header;
+            f.read((char*)&header, sizeof(header));
+            if (!f || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+                || header.record_size != sizeof(trace_record)) {
+                throw std::runtime_error("trace error: \"" + path.string() + "\" is not a version 1 trace");
+            }
+            std::vector<trace_record> golden(BLOCK), live(BLOCK);
+            auto pc = (address_t)m.registers().word(PC);
+            for (uint64_t done{ 0 }; done < header.count;) {
+                auto n = (size_t)std::min<uint64_t>(BLOCK, header.count - done);
+                f.read((char*)golden.data(), n * sizeof(trace_record));
+                if (!f) {
+                    throw std::runtime_error(std::format("trace error: \"{}\" truncated at record {}", path.string(), done));
+                }
+                for (size_t i{ 0 }; i < n; ++i) live[i] = step(m);
+                auto i = mismatch(golden.data(), live.data(), n);
+                if (i < n) {
+                    return trace_divergence{ done + i, golden[i], live[i], (i == 0) ? pc : live[i - 1].pc() };
+                }
+                pc = live[n - 1].pc();
+                done += n;
+            }
+            return std::nullopt;
+        }
+
+        // the number of records in a trace file
+        static uint64_t count(const std::filesystem::path& path) {
+            std::ifstream f(path, std::ios::binary);
+            header_t header{};
+            f.read((char*)&header, sizeof(header));
+            if (!f || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+                throw std::runtime_error("trace error: \"" + path.string() + "\" is not a trace");
+            }
+            return header.count;
+        }
+
+        // ZX81 cold boot from zx81-v2.rom and the exerciser groups, a group without a committed digest has 0 and
+        // its golden trace cannot be recorded
+        static const std::vector<trace_workload>& workloads() {
+            static const std::vector<std::pair<const char*, uint64_t>> group_digests{
+                { "8 bit ALU A,r", 0x99442CF9561DB60Cull },
+                { "8 bit ALU A,(HL) (IX+d) (IY+d)", 0x28282DD2D0B0F039ull },
+                { "INC and DEC", 0x2685749999401C00ull },
+                { "rotates and shifts", 0xA101E045D1FCAF06ull },
+                { "BIT SET RES", 0xB19A8AF7525A8489ull },
+                { "DAA CPL NEG SCF CCF", 0xE0F8493F53756B3Eull },
+                { "16 bit arithmetic", 0xE674F5DC3B7A61F6ull },
+                { "LDI LDD CPI CPD", 0x243421A374FE070Aull },
+                { "LD r,r'", 0x6E43F6EB65522594ull },
+                { "LD immediate, indirect and indexed", 0x66C07206BC2E4919ull },
+                { "IX IY halves and prefixes", 0xF27CD31436F636B9ull },
+                { "jumps calls and the stack", 0x7D7C20C9DF745F32ull },
+                { "EX EXX", 0x768A9BDD74CAB988ull },
+                { "RLD RRD", 0x362F4A03B45A5677ull },
+                { "LDIR LDDR CPIR CPDR", 0xD2A010C77DBE7BE6ull },
+                { "IN OUT and the block I/O", 0xDEDBAC769B7E6576ull }
+            };
+            static const std::vector<trace_workload> table = [] {
+                std::vector<trace_workload> workloads{
+                    { "zx81-boot", 2'000'000, [](z80_machine& m) {
+                        m.ram().fill(0);
+                        m.load("zx81-v2.rom", 0);
+                        m.protect(0x0000, 0x1FFF);
+                    }, 0x77BB19514A2AACF2ull }
+                };
+                for (const auto& group : z80_selftest::groups()) {
+                    auto d = std::find_if(group_digests.begin(), group_digests.end(), [&group](const auto& d) { return std::string(d.first) == group.name; });
+                    workloads.push_back({ group.name, 1'000'000, [&group](z80_machine& m) { z80_selftest::load(m, group); },
+                        d != group_digests.end() ? d->second : 0 });
+                }
+                return workloads;
+            }();
+            return table;
+        }
+
+        // the golden file of a workload in dir, the name with anything but letters and digits as '-'
+        static std::filesystem::path golden_path(const trace_workload& workload, const std::filesystem::path& dir) {
+            std::string name(workload.name);
+            for (auto& c : name) {
+                if (!std::isalnum((unsigned char)c)) c = '-';
+            }
+            return dir / (name + ".z80trace");
+        }
+
+        // records the workload's golden trace in dir if there is none yet, provided the run reproduces the
+        // committed digest, otherwise compares the run with it
+        static std::optional<trace_divergence> regress(const trace_workload& workload, const std::filesystem::path& dir,
+            z80_machine::core_t core = z80_core{}) {
+            z80_machine m;
+            workload.prepare(m);
+            m.attach(std::move(core));
+            auto path = golden_path(workload, dir);
+            if (!std::filesystem::exists(path)) {
+                std::filesystem::create_directories(dir);
+                auto h = record(m, workload.instructions, path);
+                if (h != workload.digest) {
+                    std::filesystem::remove(path);
+                    throw std::runtime_error(std::format("trace error: \"{}\" digest {:016X} is not the committed {:016X}, no golden trace recorded",
+                        workload.name, h, workload.digest));
+                }
+                return std::nullopt;
+            }
+            return compare(m, path);
+        }
+
+        // runs the workload to tstates with every fast path off and again with every one on, comparing the two
+        // machines every interval T-states
+        static std::optional<fast_path_divergence> fast_paths(const trace_workload& workload, cycle_t tstates, cycle_t interval,
+            z80_machine::core_t core = z80_core{}) {
+            z80_machine stepped, fast;
+            workload.prepare(stepped);
+            workload.prepare(fast);
+            stepped.halt_fast_forward(false);
+            stepped.polling_fast_forward(false);
+            stepped.loop_idioms(false);
+            stepped.superinstruction_fusion(false);
+            stepped.attach(core);
+            fast.attach(std::move(core));
+            auto bytes = stepped.ram().size();
+            for (cycle_t at{ 0 }; at < tstates;) {
+                at = std::min(at + interval, tstates);
+                stepped.run(at);
+                fast.run(at);
+                auto x = capture(stepped);
+                auto y = capture(fast);
+                auto differs = std::mismatch(stepped.ram().data(), stepped.ram().data() + bytes, fast.ram().data()).first;
+                std::optional<address_t> memory;
+                if (differs != stepped.ram().data() + bytes) memory = (address_t)(differs - stepped.ram().data());
+                if (stepped.cycles() != fast.cycles() || mismatch(&x, &y, 1) == 0 || memory) {
+                    return fast_path_divergence{ at, x, y, memory };
+                }
+            }
+            return std::nullopt;
+        }
+
+    private:
+
+        // the trace's hash folded with the hash of the state the machine ends in
+        static uint64_t final_state(z80_machine& m, uint64_t h) {
+            m.touch(0, m.ram().size());
+            return hash_combine(h, m.hash());
+        }
+
+    };
+
+}
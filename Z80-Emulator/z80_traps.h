@@ -0,0 +1,73 @@
+/**
+
+    @file      z80_traps.h
+    @brief     native high level emulation hooks keyed by PC
+    @details   a trap replaces a ROM or firmware routine with native code e.g. ZX81 CLS, a CP/M BIOS entry or a
+               multiply routine:
+               + the hook does the routine's work on the machine and returns the T-states the routine would
+                 have taken, or DECLINE to let the original code run this time
+               + a returning trap then pops PC as the routine's RET would, its cost should include the RET
+               + the machine flags pages that hold traps so that execution on untrapped pages never looks one up
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+#include "emu_memory_types.h"
+
+namespace emu {
+
+    template<typename MACHINE>
+    class trap_registry {
+
+    public:
+
+        using hook_t = std::function<unsigned(MACHINE&)>;
+
+        static constexpr unsigned DECLINE = std::numeric_limits<unsigned>::max();
+
+        struct trap {
+            hook_t hook;
+            bool returns;
+        };
+
+        // returns true if the page now holds its first trap
+        bool add(address_t pc, hook_t hook, bool returns) {
+            auto [it, inserted] = traps.insert_or_assign(pc, trap{ std::move(hook), returns });
+            return inserted && ++per_page[page_of(pc)] == 1;
+        }
+
+        // returns true if the page no longer holds any trap
+        bool remove(address_t pc) {
+            return traps.erase(pc) && --per_page[page_of(pc)] == 0;
+        }
+
+        inline const trap* find(address_t pc) const {
+            auto it = traps.find(pc);
+            return (it == traps.end()) ? nullptr : &it->second;
+        }
+
+        inline bool empty() const {
+            return traps.empty();
+        }
+
+        void clear() {
+            traps.clear();
+            per_page.fill(0);
+        }
+
+    private:
+
+        std::unordered_map<address_t, trap> traps;
+        std::array<uint16_t, PAGE_COUNT> per_page{};
+
+    };
+
+}
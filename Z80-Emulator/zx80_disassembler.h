@@ -2,7 +2,12 @@
 
     @file      zx80_disassembler.h
     @brief     translates machine language into ZX80 assembly language
-    @details   ~
+    @details   table driven from z80_opcodes.h, the same templates the assembler encodes from:
+               + decode() takes one instruction through read(address_t) -> byte_t, with its length and text
+               + immediates are $XX and $XXXX, relative jumps show their target and displacements are signed
+               + a DD or FD prefix that does not index the next opcode is a DB on its own, as is an undefined
+                 ED opcode with its second byte, so that every listing assembles back to the same bytes
+               + translate() lists a whole block of memory
     @author    ifknot
     @date      22.11.2022
     @copyright  ifknot, 2022. All right reserved.
@@ -10,32 +15,100 @@
 **/
 #pragma once
 
-#include <array>
-#include <functional>
+#include <cstdint>
+#include <format>
+#include <iostream>
 #include <ostream>
+#include <string>
+
+#include "emu_memory_types.h"
+#include "z80_opcodes.h"
 
 namespace emu {
 
     class zx80_disassembler {
 
-        typedef std::function<void(std::ostream& out)> function_t;
-        typedef std::array<function_t, 2> dictionary_t;
+        using prefix_t = z80_opcodes::prefix_t;
 
     public:
 
-        template<typename T>
-        void translate(T& memory) {
-            (dic[0])(std::cout);
-            (dic[1])(std::cout);
-        }
+        struct instruction_t {
+            address_t address;
+            uint8_t length;
+            std::string text;
+        };
 
-    private:
+        template<typename READ>
+        static instruction_t decode(READ read, address_t addr) {
+            auto byte = [&](unsigned i) { return (uint8_t)read((address_t)(addr + i)); };
+            auto first = byte(0);
+            auto prefix = prefix_t::none;
+            unsigned at{ 0 };               // offset of the opcode
+            switch (first) {
+            case 0xCB: prefix = prefix_t::cb; at = 1; break;
+            case 0xED: prefix = prefix_t::ed; at = 1; break;
+            case 0xDD: case 0xFD: {
+                bool iy = first == 0xFD;
+                if (byte(1) == 0xCB) {
+                    prefix = iy ? prefix_t::fdcb : prefix_t::ddcb;
+                    at = 3;
+                }
+                else if (!z80_opcodes::table(iy ? prefix_t::fd : prefix_t::dd)[byte(1)].empty()) {
+                    prefix = iy ? prefix_t::fd : prefix_t::dd;
+                    at = 1;
+                }
+                else {
+                    return { addr, 1, std::format("DB ${:02X}", first) };
+                }
+                break;
+            }
+            }
+            const auto& pattern = z80_opcodes::table(prefix)[byte(at)];
+            if (pattern.empty()) {
+                return { addr, 2, std::format("DB ${:02X},${:02X}", first, byte(1)) };
+            }
+            // operands follow the opcode in the order they appear, but for the DDCB and FDCB displacement
+            unsigned length = at + 1;
+            std::string text;
+            for (size_t i{ 0 }; i < pattern.size(); ++i) {
+                auto c = pattern[i];
+                if (c == 'n' && i + 1 < pattern.size() && pattern[i + 1] == 'n') {
+                    text += std::format("${:04X}", byte(length) | byte(length + 1) << 8);
+                    length += 2;
+                    ++i;
+                }
+                else if (c == 'n') {
+                    text += std::format("${:02X}", byte(length++));
+                }
+                else if (c == 'e') {
+                    auto e = (int8_t)byte(length++);
+                    text += std::format("${:04X}", (address_t)(addr + length + e));
+                }
+                else if (c == '+' && i + 1 < pattern.size() && pattern[i + 1] == 'd') {
+                    auto d = (int8_t)((prefix == prefix_t::ddcb || prefix == prefix_t::fdcb) ? byte(2) : byte(length++));
+                    text += std::format("{}${:02X}", (d < 0) ? '-' : '+', (d < 0) ? -d : d);
+                    ++i;
+                }
+                else {
+                    text += c;
+                }
+            }
+            return { addr, (uint8_t)length, text };
+        }
 
-        const dictionary_t dic {
-            [&](std::ostream& out) { out << "hello"; },
-            [&](std::ostream& out) { out << " world\n"; },
-        };
+        template<typename T>
+        void translate(T& memory, std::ostream& out = std::cout) {
+            auto end = memory.address_end();
+            auto read = [&memory, end](address_t a) { return (a <= end) ? memory[a] : (byte_t)0; };
+            for (uint32_t addr{ memory.address_begin() }; addr <= end;) {
+                auto instruction = decode(read, (address_t)addr);
+                std::string bytes;
+                for (unsigned i{ 0 }; i < instruction.length; ++i) bytes += std::format("{:02X} ", (uint8_t)read((address_t)(addr + i)));
+                out << std::format("${:04X}  {:<13}{}\n", addr, bytes, instruction.text);
+                addr += instruction.length;
+            }
+        }
 
     };
 
-}
\ No newline at end of file
+}
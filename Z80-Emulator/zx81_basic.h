@@ -0,0 +1,400 @@
+/**
+
+    @file      zx81_basic.h
+    @brief     the ZX81 BASIC program area: system variables, character set, listing and program injection
+    @details   what a host needs to see and change the BASIC program in a ZX81 machine's RAM without the keyboard:
+               + the system variables the ROM keeps from $4000 and the ROM addresses that matter to a host
+               + the character set as UTF-8, graphics as Unicode block elements, inverse characters as their
+                 normal selves but the inverse space which is a full block
+               + listing() decodes the program from PROG to D_FILE into numbered lines of text with the keyword
+                 tokens spelled out and the hidden 5 byte numbers left out, as LIST shows them
+               + tokenize() turns a program as text into the lines the ROM stores, keywords as their tokens, spaces
+                 dropped outside strings and REM, every number literal followed by its hidden 5 byte value
+               + inject() replaces the program with tokenized lines, moving the display file, variables, edit line
+                 and stack up or down and their pointers with them as the ROM's POINTERS does
+               + run() starts the program from its first line as RUN does, the ROM returns to REPORT when the
+                 program ends, stops or fails, with the report code in ERR_NR
+               + screen() is the display file as 24 lines of UTF-8 text
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "emu_memory_types.h"
+#include "z80_machine.h"
+#include "z80_registers.h"
+
+namespace emu {
+
+    class zx81_basic {
+
+    public:
+
+        // system variables
+        static constexpr address_t ERR_NR = 0x4000;
+        static constexpr address_t FLAGS = 0x4001;
+        static constexpr address_t ERR_SP = 0x4002;
+        static constexpr address_t RAMTOP = 0x4004;
+        static constexpr address_t PPC = 0x4007;
+        static constexpr address_t D_FILE = 0x400C;
+        static constexpr address_t DF_CC = 0x400E;
+        static constexpr address_t VARS = 0x4010;
+        static constexpr address_t E_LINE = 0x4014;
+        static constexpr address_t STKBOT = 0x401A;
+        static constexpr address_t STKEND = 0x401C;
+        static constexpr address_t NXTLIN = 0x4029;
+        static constexpr address_t CDFLAG = 0x403B;
+        static constexpr address_t PROG = 0x407D;
+
+        // ROM
+        static constexpr address_t LINE_STORE = 0x0695;     // LD (PPC),DE, a program line starts
+        static constexpr address_t COMMAND_STORE = 0x0640;  // LD (PPC),BC, a command line starts
+        static constexpr address_t LINE_DONE = 0x0676;      // LINE-SCAN returns here, or an error does
+        static constexpr address_t REPORT = 0x06AE;         // the program has ended, stopped or failed
+        static constexpr address_t CLS = 0x0A2A;
+        static constexpr address_t DISPLAY = 0x0229;        // DISPLAY-1, a frame
+        static constexpr address_t READY = 0x04CF;          // waiting for a key
+
+        // PPC while a command line runs
+        static constexpr uint16_t COMMAND_LINE = 0xFFFE;
+
+        static constexpr uint8_t NUMBER = 0x7E;            // a 5 byte number follows
+        static constexpr uint8_t NEWLINE = 0x76;
+
+        struct line_t {
+            uint16_t number;
+            address_t address;
+            std::string text;
+        };
+
+        static inline uint16_t word(const z80_machine& m, address_t addr) {
+            return (uint16_t)((uint8_t)m.ram()[addr] | (uint8_t)m.ram()[(address_t)(addr + 1)] << 8);
+        }
+
+        static inline void word(z80_machine& m, address_t addr, uint16_t w) {
+            m.write_block(addr, &w, 2);     // little-endian host, as the Z80
+        }
+
+        // the character as UTF-8, an empty string for a code that is neither a character nor a token
+        static std::string character(uint8_t code) {
+            static const char* GRAPHICS[] = { " ", "▘", "▝", "▀", "▖", "▌", "▞", "▛", "▒", "🮏", "🮎" };
+            static const char* INVERSE_GRAPHICS[] = { "█", "▟", "▙", "▄", "▜", "▐", "▚", "▗", "▒", "🮎", "🮏" };
+            static const char* SYMBOLS = "\"£$:?()><=+-*/;,.0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+            auto c = code & 0x3F;
+            if ((code >= 0x40 && code < 0x80) || code >= 0xC0) {
+                return {};
+            }
+            if (c <= 0x0A) {
+                return (code & 0x80) ? INVERSE_GRAPHICS[c] : GRAPHICS[c];
+            }
+            if (c == 0x0C) {
+                return "£";
+            }
+            auto at = (c < 0x0C) ? c - 0x0B : c - 0x0B + 1;     // £ is two bytes of UTF-8
+            return std::string(1, SYMBOLS[at]);
+        }
+
+        // the keyword or function a token stands for, with the spaces LIST puts round it, a function has none before
+        static std::string token(uint8_t code) {
+            static const std::array<const char*, 64> HIGH = {
+                "\"\"", "AT ", "TAB ", "?", "CODE ", "VAL ", "LEN ", "SIN ", "COS ", "TAN ", "ASN ", "ACS ", "ATN ",
+                "LN ", "EXP ", "INT ", "SQR ", "SGN ", "ABS ", "PEEK ", "USR ", "STR$ ", "CHR$ ", "NOT ", "**", " OR ",
+                " AND ", "<=", ">=", "<>", " THEN ", " TO ", " STEP ", " LPRINT ", " LLIST ", " STOP ", " SLOW ",
+                " FAST ", " NEW ", " SCROLL ", " CONT ", " DIM ", " REM ", " FOR ", " GOTO ", " GOSUB ", " INPUT ",
+                " LOAD ", " LIST ", " LET ", " PAUSE ", " NEXT ", " POKE ", " PRINT ", " PLOT ", " RUN ", " SAVE ",
+                " RAND ", " IF ", " CLS ", " UNPLOT ", " CLEAR ", " RETURN ", " COPY "
+            };
+            switch (code) {
+            case 0x40: return "RND";
+            case 0x41: return "INKEY$";
+            case 0x42: return "PI";
+            }
+            return (code >= 0xC0) ? HIGH[code - 0xC0] : std::string{};
+        }
+
+        // the ZX81 code of a character, upper and lower case the same
+        static uint8_t code_of(char c) {
+            auto upper = std::string(1, (char)std::toupper((unsigned char)c));
+            for (uint8_t code{ 0x00 }; code < 0x40; ++code) {
+                if (character(code) == upper) return code;
+            }
+            throw std::runtime_error(std::format("zx81 basic error: no ZX81 character for '{}'", c));
+        }
+
+        // the 5 byte floating point form, exponent + $80 then the mantissa with its top bit the sign
+        static std::array<uint8_t, 5> number(double value) {
+            std::array<uint8_t, 5> bytes{};
+            if (value == 0) {
+                return bytes;
+            }
+            int exponent;
+            auto mantissa = std::frexp(std::fabs(value), &exponent);
+            auto bits = (uint64_t)std::llround(std::ldexp(mantissa, 32));
+            if (bits >> 32) {
+                bits >>= 1;
+                ++exponent;
+            }
+            if (exponent + 0x80 < 1) {
+                return bytes;
+            }
+            if (exponent + 0x80 > 0xFF) {
+                throw std::runtime_error(std::format("zx81 basic error: {} is out of range", value));
+            }
+            bytes[0] = (uint8_t)(exponent + 0x80);
+            bytes[1] = (uint8_t)((bits >> 24 & 0x7F) | (value < 0 ? 0x80 : 0));
+            bytes[2] = (uint8_t)(bits >> 16);
+            bytes[3] = (uint8_t)(bits >> 8);
+            bytes[4] = (uint8_t)bits;
+            return bytes;
+        }
+
+        // a program of numbered lines in ascending order, as typed
+        static std::vector<uint8_t> tokenize(const std::string& source) {
+            std::vector<uint8_t> program;
+            std::istringstream lines(source);
+            int last{ 0 };
+            for (std::string text; std::getline(lines, text); ) {
+                size_t i{ 0 };
+                while (i < text.size() && std::isspace((unsigned char)text[i])) ++i;
+                if (i == text.size()) {
+                    continue;
+                }
+                size_t digits{ i };
+                while (i < text.size() && std::isdigit((unsigned char)text[i])) ++i;
+                auto number = (i > digits && i - digits <= 4) ? std::stoi(text.substr(digits, i - digits)) : 0;
+                if (number < 1 || number <= last) {
+                    throw std::runtime_error(std::format("zx81 basic error: bad line number in \"{}\"", text));
+                }
+                last = number;
+                auto bytes = tokenize_line(text.substr(i), number);
+                bytes.push_back(NEWLINE);
+                program.push_back((uint8_t)(number >> 8));
+                program.push_back((uint8_t)number);
+                program.push_back((uint8_t)bytes.size());
+                program.push_back((uint8_t)(bytes.size() >> 8));
+                program.insert(program.end(), bytes.begin(), bytes.end());
+            }
+            return program;
+        }
+
+        // the program from PROG to D_FILE
+        static std::vector<line_t> listing(const z80_machine& m) {
+            std::vector<line_t> lines;
+            auto end = word(m, D_FILE);
+            for (uint32_t at{ PROG }; at + 4 <= end; ) {
+                auto number = (uint16_t)((uint8_t)m.ram()[(address_t)at] << 8 | (uint8_t)m.ram()[(address_t)(at + 1)]);
+                auto length = word(m, (address_t)(at + 2));
+                if (number >= 0x4000 || at + 4 + length > end) {
+                    break;
+                }
+                std::string text;
+                for (uint32_t i{ at + 4 }; i < at + 4 + length; ++i) {
+                    auto code = (uint8_t)m.ram()[(address_t)i];
+                    if (code == NUMBER) {
+                        i += 5;
+                    }
+                    else if (code != NEWLINE) {
+                        auto s = character(code);
+                        text += s.empty() ? token(code) : s;
+                    }
+                }
+                lines.push_back({ number, (address_t)at, collapse(text) });
+                at += 4 + length;
+            }
+            return lines;
+        }
+
+        // the program becomes the tokenized lines, each number (big-endian), length, text and NEWLINE
+        static void inject(z80_machine& m, const std::vector<uint8_t>& program) {
+            auto d_file = word(m, D_FILE), stkend = word(m, STKEND);
+            auto old_size = d_file - PROG;
+            int delta = (int)program.size() - (int)old_size;
+            if (stkend + delta > word(m, RAMTOP) - 0x100) {
+                throw std::runtime_error(std::format("zx81 basic error: {} byte program leaves no room below RAMTOP ${:04X}", program.size(), word(m, RAMTOP)));
+            }
+            // what follows the program, display file to the calculator stack, moves as one
+            std::vector<uint8_t> rest(stkend - d_file);
+            m.read_block(d_file, rest.data(), rest.size());
+            if (!program.empty()) m.write_block(PROG, program.data(), program.size());
+            m.write_block((address_t)(d_file + delta), rest.data(), rest.size());
+            for (address_t pointer{ D_FILE }; pointer <= STKEND; pointer += 2) {
+                auto value = word(m, pointer);
+                if (value >= PROG) {
+                    word(m, pointer, (uint16_t)(value + delta));
+                }
+            }
+        }
+
+        // from the READY state: clears the screen and variables and goes to the first line as RUN does, in FAST mode
+        static void run(z80_machine& m) {
+            auto vars = word(m, VARS);
+            m.write(vars, (byte_t)0x80);
+            auto e_line = (address_t)(vars + 1);
+            word(m, E_LINE, e_line);
+            m.write(e_line, (byte_t)0x7F);
+            m.write((address_t)(e_line + 1), (byte_t)NEWLINE);
+            word(m, STKBOT, (uint16_t)(e_line + 2));
+            word(m, STKEND, (uint16_t)(e_line + 2));
+            word(m, NXTLIN, PROG);
+            m.write(ERR_NR, (byte_t)0xFF);
+            m.write(FLAGS, (byte_t)((uint8_t)m.ram()[FLAGS] | 0x80));
+            m.write(CDFLAG, (byte_t)((uint8_t)m.ram()[CDFLAG] & 0x3F));
+            // CLS returns to the line loop as LINE-SCAN would
+            auto& regs = m.registers();
+            auto sp = word(m, ERR_SP);
+            word(m, sp, LINE_DONE);
+            regs.word(SP) = (word_t)sp;
+            regs.word(PC) = (word_t)CLS;
+            m.control().halted = false;
+        }
+
+        // 24 lines from D_FILE, each without trailing spaces
+        static std::string screen(const z80_machine& m) {
+            std::string text;
+            address_t at = (address_t)(word(m, D_FILE) + 1);
+            for (int row{ 0 }; row < 24; ++row) {
+                std::string line;
+                for (int column{ 0 }; column <= 32; ++column) {
+                    auto code = (uint8_t)m.ram()[at++];
+                    if (code == NEWLINE) {
+                        break;
+                    }
+                    auto s = character(code);
+                    line += s.empty() ? "?" : s;
+                }
+                while (!line.empty() && line.back() == ' ') line.pop_back();
+                text += line + '\n';
+            }
+            return text;
+        }
+
+        // the report code of a program that has come to REPORT, 0 for OK
+        static inline uint8_t report_code(const z80_machine& m) {
+            return (uint8_t)((uint8_t)m.ram()[ERR_NR] + 1);
+        }
+
+    private:
+
+        // the longest keyword at text[i], none inside a name or when a letter runs on
+        static int keyword(const std::string& text, size_t i) {
+            int found{ -1 };
+            size_t length{ 0 };
+            for (int code{ 0x40 }; code < 0x100; ++code) {
+                auto name = token((uint8_t)code);
+                if (name.empty() || code == 0xC0 || code == 0xC3) continue;
+                auto first = name.find_first_not_of(' '), last = name.find_last_not_of(' ');
+                name = name.substr(first, last - first + 1);
+                if (name.size() <= length || text.size() - i < name.size()) continue;
+                bool match{ true };
+                for (size_t k{ 0 }; k < name.size() && match; ++k) {
+                    match = std::toupper((unsigned char)text[i + k]) == name[k];
+                }
+                auto next = i + name.size();
+                if (match && std::isalpha((unsigned char)name.back()) && next < text.size() && std::isalpha((unsigned char)text[next])) {
+                    match = false;
+                }
+                if (match) {
+                    found = code;
+                    length = name.size();
+                }
+            }
+            return found;
+        }
+
+        static std::vector<uint8_t> tokenize_line(const std::string& text, int number) {
+            std::vector<uint8_t> bytes;
+            bool name{ false };
+            for (size_t i{ 0 }; i < text.size(); ) {
+                auto c = text[i];
+                if (c == '\r' || c == ' ' || c == '\t') {
+                    name = false;
+                    ++i;
+                }
+                else if (c == '"') {
+                    // a quote in a string is doubled, the "" token
+                    bytes.push_back(code_of(c));
+                    for (++i; i < text.size(); ++i) {
+                        if (text[i] == '"' && i + 1 < text.size() && text[i + 1] == '"') {
+                            bytes.push_back(0xC0);
+                            ++i;
+                        }
+                        else if (text[i] == '"') {
+                            break;
+                        }
+                        else {
+                            bytes.push_back(code_of(text[i]));
+                        }
+                    }
+                    if (i == text.size()) {
+                        throw std::runtime_error(std::format("zx81 basic error: line {} has an unterminated string", number));
+                    }
+                    bytes.push_back(code_of(text[i++]));
+                    name = false;
+                }
+                else if (!name && (std::isdigit((unsigned char)c) || (c == '.' && i + 1 < text.size() && std::isdigit((unsigned char)text[i + 1])))) {
+                    auto end = i;
+                    while (end < text.size() && (std::isdigit((unsigned char)text[end]) || text[end] == '.')) ++end;
+                    if (end < text.size() && std::toupper((unsigned char)text[end]) == 'E') {
+                        auto e = end + 1;
+                        if (e < text.size() && (text[e] == '+' || text[e] == '-')) ++e;
+                        if (e < text.size() && std::isdigit((unsigned char)text[e])) {
+                            end = e;
+                            while (end < text.size() && std::isdigit((unsigned char)text[end])) ++end;
+                        }
+                    }
+                    auto literal = text.substr(i, end - i);
+                    for (auto d : literal) bytes.push_back(code_of(d));
+                    bytes.push_back(NUMBER);
+                    for (auto b : zx81_basic::number(std::stod(literal))) bytes.push_back(b);
+                    i = end;
+                }
+                else if (auto symbol = text.substr(i, 2); symbol == "**" || symbol == "<=" || symbol == ">=" || symbol == "<>") {
+                    bytes.push_back(symbol == "**" ? 0xD8 : symbol == "<=" ? 0xDB : symbol == ">=" ? 0xDC : 0xDD);
+                    name = false;
+                    i += 2;
+                }
+                else if (auto code = name ? -1 : keyword(text, i); code >= 0) {
+                    bytes.push_back((uint8_t)code);
+                    i += token((uint8_t)code).find_last_not_of(' ') - token((uint8_t)code).find_first_not_of(' ') + 1;
+                    if (code == 0xEA) {
+                        // REM keeps the rest of the line as it is
+                        for (; i < text.size(); ++i) {
+                            if (text[i] != '\r') bytes.push_back(code_of(text[i]));
+                        }
+                    }
+                }
+                else {
+                    bytes.push_back(code_of(c));
+                    name = std::isalpha((unsigned char)c) || (name && std::isdigit((unsigned char)c));
+                    ++i;
+                }
+            }
+            return bytes;
+        }
+
+        // the spaces round keywords collapse to one, none at either end
+        static std::string collapse(const std::string& text) {
+            std::string out;
+            for (auto c : text) {
+                if (c == ' ' && (out.empty() || out.back() == ' ')) continue;
+                out += c;
+            }
+            while (!out.empty() && out.back() == ' ') out.pop_back();
+            return out;
+        }
+
+    };
+
+}
@@ -0,0 +1,133 @@
+/**
+
+    @file      zx81_batch.h
+    @brief     runs BASIC programs on a headless ZX81, one job after another or in parallel
+    @details   for evaluating many BASIC programs, each from the same clean machine and each paying only for itself:
+               + the machine cold boots once to READY, with the display routine trapped to a stub so there is no
+                 video emulation, and READY is kept as a copy on write snapshot (see z80_snapshot.h)
+               + a job restores READY, which copies back only the pages the last job wrote, tokenizes its program
+                 and injects it into the program area, sets the system variables RUN would and runs in FAST mode
+                 (see zx81_basic.h) until the ROM reaches REPORT or the job's T-states run out
+               + the result is whether the program ended or timed out, its report code and line, its T-states and
+                 the display file as UTF-8 text, a program that does not tokenize is an error in its result
+               + a batch runs on worker threads, each with its own copy of the booted machine, results in job order
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "z80_core.h"
+#include "z80_machine.h"
+#include "z80_snapshot.h"
+#include "zx81_basic.h"
+
+namespace emu {
+
+    class zx81_batch {
+
+    public:
+
+        static constexpr cycle_t TIMEOUT = 3'250'000 * 10;       // 10 seconds at 3.25MHz
+
+        struct job_t {
+            std::string program;
+            cycle_t timeout{ TIMEOUT };
+        };
+
+        struct result_t {
+            bool ended{ false };            // came to REPORT, else timed out or not run
+            uint8_t report{ 0 };            // the report code, 0 for OK
+            uint16_t line{ 0 };             // PPC, the line that ended it
+            cycle_t tstates{ 0 };
+            std::string screen;
+            std::string error;              // the program did not tokenize or fit
+        };
+
+        explicit zx81_batch(const std::string& rom = "zx81-v2.rom") {
+            static constexpr cycle_t BOOT = 10'000'000;
+            m.ram().fill(0);
+            m.load(rom, 0);
+            m.protect(0x0000, 0x1FFF);
+            m.attach(z80_core{});
+            m.trap(zx81_basic::DISPLAY, [](z80_machine&) { return 10u; });
+            m.set_breakpoint(zx81_basic::READY);
+            m.run(BOOT);
+            if (!m.breakpoint_hit()) {
+                throw std::runtime_error(std::format("zx81 batch error: {} did not boot to READY in {} T-states", rom, BOOT));
+            }
+            m.clear_breakpoint(zx81_basic::READY);
+            m.set_breakpoint(zx81_basic::REPORT);
+            ready = std::make_unique<z80_snapshot>(m);
+        }
+
+        inline result_t run(const std::string& program, cycle_t timeout = TIMEOUT) {
+            return execute(m, *ready, { program, timeout });
+        }
+
+        std::vector<result_t> run(const std::vector<job_t>& jobs, unsigned threads = 0) {
+            if (threads == 0) {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            threads = std::min<unsigned>(threads, (unsigned)std::max<size_t>(1, jobs.size()));
+            std::vector<result_t> results(jobs.size());
+            std::atomic<size_t> next{ 0 };
+            std::vector<std::thread> pool;
+            for (unsigned i{ 0 }; i < threads; ++i) {
+                pool.emplace_back([&] {
+                    z80_machine local(m);
+                    for (auto job = next++; job < jobs.size(); job = next++) {
+                        results[job] = execute(local, *ready, jobs[job]);
+                    }
+                });
+            }
+            for (auto& t : pool) {
+                t.join();
+            }
+            return results;
+        }
+
+        inline z80_machine& machine() {
+            return m;
+        }
+
+    private:
+
+        // m held READY when it was last hashed, every write since is in its dirty pages
+        static result_t execute(z80_machine& m, const z80_snapshot& ready, const job_t& job) {
+            result_t result;
+            ready.restore(m, ready);
+            try {
+                zx81_basic::inject(m, zx81_basic::tokenize(job.program));
+            }
+            catch (const std::runtime_error& e) {
+                result.error = e.what();
+                return result;
+            }
+            zx81_basic::run(m);
+            auto start = m.cycles();
+            m.run(start + job.timeout);
+            result.ended = m.breakpoint_hit() && m.registers().word(PC) == zx81_basic::REPORT;
+            result.report = zx81_basic::report_code(m);
+            result.line = zx81_basic::word(m, zx81_basic::PPC);
+            result.tstates = m.cycles() - start;
+            result.screen = zx81_basic::screen(m);
+            return result;
+        }
+
+        z80_machine m;
+        std::unique_ptr<z80_snapshot> ready;
+
+    };
+
+}
@@ -0,0 +1,133 @@
+/**
+
+    @file      zx81_profiler.h
+    @brief     attributes T-states to the BASIC lines of a ZX81 program as it runs
+    @details   where a BASIC program spends its time, line by line, from the ROM's own bookkeeping:
+               + the ROM stores the number of the line it is about to run in PPC at one place for program lines
+                 and at another for a command line, the profiler traps the instruction after each store with a
+                 hook that reads PPC and declines, so the ROM runs on unchanged and the T-states are the same
+               + the T-states from one store to the next belong to the line stored first, its statement, the
+                 line loop and the BREAK test, REPORT closes the last line
+               + the cost is one hook call per line run, the traps are all on the ROM page of the line loop and
+                 execution on every other page never looks one up (see z80_traps.h)
+               + report() is a row per line of the listing decoded from RAM (see zx81_basic.h) with its T-states
+                 and runs, lines that never ran included, and a row for command lines
+    @author    ifknot
+    @date      17.10.2026
+    @copyright © ifknot, 2026. All right reserved.
+
+**/
+#pragma once
+
+#include <cstdint>
+#include <format>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "z80_machine.h"
+#include "zx81_basic.h"
+
+namespace emu {
+
+    class zx81_profiler {
+
+    public:
+
+        struct line_cost_t {
+            uint16_t line;
+            uint64_t tstates;
+            uint64_t runs;
+            std::string text;
+        };
+
+        explicit zx81_profiler(z80_machine& m) : m(m) {
+            auto store = [this](z80_machine& m) {
+                enter(m.cycles(), zx81_basic::word(m, zx81_basic::PPC));
+                return z80_machine::traps_t::DECLINE;
+            };
+            m.trap(zx81_basic::LINE_STORE + 4, store);
+            m.trap(zx81_basic::COMMAND_STORE + 4, store);
+            m.trap(zx81_basic::REPORT, [this](z80_machine& m) {
+                leave(m.cycles());
+                return z80_machine::traps_t::DECLINE;
+            });
+        }
+
+        zx81_profiler(const zx81_profiler&) = delete;
+        zx81_profiler& operator=(const zx81_profiler&) = delete;
+
+        ~zx81_profiler() {
+            m.untrap(zx81_basic::LINE_STORE + 4);
+            m.untrap(zx81_basic::COMMAND_STORE + 4);
+            m.untrap(zx81_basic::REPORT);
+        }
+
+        inline void reset() {
+            costs.clear();
+            running = false;
+        }
+
+        // a row per line in program order, the line running now counted up to now
+        std::vector<line_cost_t> report() const {
+            auto totals = costs;
+            if (running) {
+                totals[current].tstates += m.cycles() - since;
+            }
+            std::vector<line_cost_t> rows;
+            for (const auto& line : zx81_basic::listing(m)) {
+                auto at = totals.find(line.number);
+                rows.push_back({ line.number, at == totals.end() ? 0 : at->second.tstates, at == totals.end() ? 0 : at->second.runs, line.text });
+                if (at != totals.end()) totals.erase(at);
+            }
+            // lines since deleted and command lines
+            for (const auto& [line, cost] : totals) {
+                rows.push_back({ line, cost.tstates, cost.runs, line == zx81_basic::COMMAND_LINE ? "(command)" : "" });
+            }
+            return rows;
+        }
+
+        // the report as a table, each line's share of the total
+        std::string table() const {
+            auto rows = report();
+            uint64_t total{ 0 };
+            for (const auto& row : rows) total += row.tstates;
+            std::string out = std::format("{:>5} {:>12} {:>6} {:>8}  {}\n", "line", "T-states", "%", "runs", "text");
+            for (const auto& row : rows) {
+                auto share = total ? 100.0 * row.tstates / total : 0.0;
+                out += std::format("{:>5} {:>12} {:>6.2f} {:>8}  {}\n", row.line, row.tstates, share, row.runs, row.text);
+            }
+            return out;
+        }
+
+    private:
+
+        struct cost_t {
+            uint64_t tstates{ 0 };
+            uint64_t runs{ 0 };
+        };
+
+        void enter(cycle_t now, uint16_t line) {
+            leave(now);
+            current = line;
+            ++costs[line].runs;
+            running = true;
+        }
+
+        void leave(cycle_t now) {
+            if (running) {
+                costs[current].tstates += now - since;
+            }
+            since = now;
+            running = false;
+        }
+
+        z80_machine& m;
+        std::map<uint16_t, cost_t> costs;
+        uint16_t current{ 0 };
+        cycle_t since{ 0 };
+        bool running{ false };
+
+    };
+
+}